@@ -9,6 +9,7 @@
 BEGIN_C_INCLUDES
 #include "plugin.h"
 #include "runtime.h"
+#include "snapshot.h"
 #include "utils/log.h"
 #include "value-inl.h"
 END_C_INCLUDES
@@ -178,6 +179,23 @@ Maybe<> Runtime::initialize(RuntimeConfig *config) {
   return internal_->initialize(config);
 }
 
+Maybe<> Runtime::dump_heap_snapshot(const char *path) {
+  runtime_t *runtime = this->operator*();
+  if (runtime == NULL)
+    return Maybe<>::with_message("Runtime has not been initialized");
+  value_t value = runtime_dump_heap_snapshot(runtime, new_c_string(path));
+  Maybe<> result;
+  if (is_condition(value)) {
+    value_to_string_t to_string;
+    value_to_string(&to_string, value);
+    result = Maybe<>::with_message(to_string.str.chars);
+    value_to_string_dispose(&to_string);
+  } else {
+    result = Maybe<>::with_value();
+  }
+  return result;
+}
+
 Runtime::Internal::Internal(Runtime *owner)
   : owner_(owner)
   , runtime_(NULL) { }
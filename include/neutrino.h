@@ -11,11 +11,45 @@
 // Settings to apply when creating a runtime. This struct gets passed by value
 // under some circumstances so be sure it doesn't break anything to do that.
 typedef struct {
-  // The size in bytes of the space to create.
+  // The size in bytes of the spaces to create. The heap never shrinks them
+  // below this.
   size_t semispace_size_bytes;
+  // The size in bytes the spaces may grow to when much of the heap survives
+  // collections. The heap also keeps both of them plus the nursery within the
+  // system memory limit. Zero, or anything not larger than the initial size,
+  // means the size is fixed. A new size is applied to the spare semispace when
+  // a collection completes so to-space only gets it after the next flip.
+  size_t max_semispace_size_bytes;
+  // If at least this percentage of a semispace survives a full collection the
+  // heap doubles its size.
+  uint32_t heap_grow_survival_percent;
+  // If less than this percentage of a semispace survives a full collection the
+  // heap halves its size.
+  uint32_t heap_shrink_survival_percent;
+  // The size in bytes of the nursery where new objects are allocated. Zero
+  // means don't use a nursery, in which case every collection is a full one.
+  // The nursery is never made larger than a quarter of the semispace size.
+  size_t nursery_size_bytes;
+  // Blobs, arrays, and strings at least this large are allocated in the large
+  // object space rather than in the semispaces. Large objects are never moved,
+  // they're reclaimed by marking and sweeping during full collections. Zero
+  // means put everything in the semispaces.
+  size_t large_object_size_bytes;
+  // The number of threads that work on full collections. One means they're
+  // done on the thread that triggers them, larger values start additional
+  // worker threads for the duration of each collection.
+  uint32_t gc_thread_count;
+  // If nonzero, full collections are done incrementally, in slices that
+  // aim to pause the program for at most this many milliseconds, once to-space
+  // is half full. Each collection replicates to-space and the nursery so it
+  // only happens if their size fits within the max semispace size. Zero means
+  // always collect in one go.
+  uint32_t gc_max_pause_millis;
   // The max amount of memory we'll allocate from the system. This is mainly a
   // failsafe in case a bug causes the runtime to allocate out of control, which
   // has happened, because the OS doesn't necessarily handle that very well.
+  // The heap's spaces are mapped directly so they don't count towards this but
+  // the heap doesn't grow them beyond it.
   size_t system_memory_limit;
   // How often, on average, to simulate an allocation failure when fuzzing?
   uint32_t gc_fuzz_freq;
@@ -129,6 +129,10 @@ public:
   // Has this runtime been successfully initialized?
   bool is_initialized() { return internal_ != NULL; }
 
+  // Writes a snapshot of this runtime's heap to the file with the given name.
+  // See snapshot.h for a description of the format.
+  Maybe<> dump_heap_snapshot(const char *path);
+
   // Accessors for the underlying runtime.
   // TODO: remove.
   runtime_t *operator*();
@@ -14,6 +14,7 @@
 #include "try-inl.h"
 #include "utils/string-inl.h"
 #include "value-inl.h"
+#include "verify.h"
 
 
 // --- B a s i c ---
@@ -47,16 +48,18 @@ value_t new_heap_uninitialized_roots(runtime_t *runtime) {
 value_t new_heap_mutable_roots(runtime_t *runtime) {
   TRY_DEF(argument_map_trie_root, new_heap_argument_map_trie(runtime,
       ROOT(runtime, empty_array)));
+  TRY_DEF(global_lookup_cache, new_heap_array(runtime, kGlobalLookupCacheSize));
   size_t size = kMutableRootsSize;
   TRY_DEF(result, alloc_heap_object(runtime, size,
       ROOT(runtime, mutable_mutable_roots_species)));
   RAW_MROOT(result, argument_map_trie_root) = argument_map_trie_root;
+  RAW_MROOT(result, global_lookup_cache) = global_lookup_cache;
   return result;
 }
 
 value_t new_heap_utf8(runtime_t *runtime, utf8_t contents) {
   size_t size = calc_utf8_size(string_size(contents));
-  TRY_DEF(result, alloc_heap_object(runtime, size,
+  TRY_DEF(result, alloc_heap_object_maybe_large(runtime, size,
       ROOT(runtime, utf8_species)));
   set_utf8_length(result, string_size(contents));
   string_copy_to(contents, get_utf8_chars(result), string_size(contents) + 1);
@@ -65,7 +68,7 @@ value_t new_heap_utf8(runtime_t *runtime, utf8_t contents) {
 
 value_t new_heap_utf8_empty(runtime_t *runtime, size_t length) {
   size_t size = calc_utf8_size(length);
-  TRY_DEF(result, alloc_heap_object(runtime, size,
+  TRY_DEF(result, alloc_heap_object_maybe_large(runtime, size,
       ROOT(runtime, utf8_species)));
   set_utf8_length(result, length);
   memset(get_utf8_chars(result), 0, length + 1);
@@ -83,7 +86,7 @@ value_t new_heap_ascii_string_view(runtime_t *runtime, value_t value) {
 
 value_t new_heap_blob(runtime_t *runtime, size_t length, alloc_flags_t flags) {
   size_t size = calc_blob_size(length);
-  TRY_DEF(result, alloc_heap_object(runtime, size,
+  TRY_DEF(result, alloc_heap_object_maybe_large(runtime, size,
       ROOT(runtime, mutable_blob_species)));
   set_blob_length(result, length);
   blob_t data = get_blob_data(result);
@@ -111,6 +114,7 @@ value_t new_heap_instance_species(runtime_t *runtime, value_t primary,
   set_species_instance_family(result, ofInstance);
   set_species_family_behavior(result, &kInstanceBehavior);
   set_species_division_behavior(result, &kInstanceSpeciesBehavior);
+  set_species_heap(result, &runtime->heap);
   set_instance_species_primary_type_field(result, primary);
   set_instance_species_manager(result, manager);
   set_instance_species_raw_mode(result, new_integer(mode));
@@ -130,6 +134,7 @@ value_t new_heap_compact_species(runtime_t *runtime, family_behavior_t *behavior
   set_species_instance_family(result, behavior->family);
   set_species_family_behavior(result, behavior);
   set_species_division_behavior(result, &kCompactSpeciesBehavior);
+  set_species_heap(result, &runtime->heap);
   return post_create_sanity_check(result, bytes);
 }
 
@@ -141,6 +146,7 @@ value_t new_heap_modal_species_unchecked(runtime_t *runtime,
   set_species_instance_family(result, behavior->family);
   set_species_family_behavior(result, behavior);
   set_species_division_behavior(result, &kModalSpeciesBehavior);
+  set_species_heap(result, &runtime->heap);
   set_modal_species_mode(result, mode);
   set_modal_species_base_root(result, base_root);
   return result;
@@ -157,7 +163,7 @@ value_t new_heap_array(runtime_t *runtime, int64_t length) {
   // early to tell. If this ever fails reconsider.
   CHECK_TRUE("array too large", fits_in_signed_bits(IF_32_BIT(30, 60), length));
   size_t size = calc_array_size(length);
-  TRY_DEF(result, alloc_heap_object(runtime, size,
+  TRY_DEF(result, alloc_heap_object_maybe_large(runtime, size,
       ROOT(runtime, mutable_array_species)));
   set_array_length(result, length);
   for (int64_t i = 0; i < length; i++)
@@ -274,6 +280,7 @@ value_t new_heap_c_object_species(runtime_t *runtime, alloc_flags_t flags,
   set_species_instance_family(result, ofCObject);
   set_species_family_behavior(result, &kCObjectBehavior);
   set_species_division_behavior(result, &kCObjectSpeciesBehavior);
+  set_species_heap(result, &runtime->heap);
   set_c_object_species_data_size(result, new_integer(info->layout.data_size));
   set_c_object_species_value_count(result, new_integer(info->layout.value_count));
   set_c_object_species_type(result, type);
@@ -364,12 +371,19 @@ value_t new_heap_factory(runtime_t *runtime, factory_new_instance_t *new_instanc
 
 value_t new_heap_code_block(runtime_t *runtime, value_t bytecode,
     value_t value_pool, size_t high_water_mark) {
+  // Code that fails verification can still be run, the interpreter just can't
+  // make any assumptions about it.
+  value_t verified = verify_bytecode(get_blob_data(bytecode), value_pool,
+      high_water_mark);
+  if (in_condition_cause(ccSystemError, verified))
+    return verified;
   size_t size = kCodeBlockSize;
   TRY_DEF(result, alloc_heap_object(runtime, size,
       ROOT(runtime, mutable_code_block_species)));
   set_code_block_bytecode(result, bytecode);
   set_code_block_value_pool(result, value_pool);
   set_code_block_high_water_mark(result, high_water_mark);
+  set_code_block_is_verified(result, !is_condition(verified));
   TRY(ensure_frozen(runtime, result));
   return post_create_sanity_check(result, size);
 }
@@ -1287,19 +1301,37 @@ value_t new_heap_current_module_ast(runtime_t *runtime) {
 
 // --- M i s c ---
 
-value_t alloc_heap_object(runtime_t *runtime, size_t bytes, value_t species) {
+// Allocates a heap object either in the large object space or as usual.
+static value_t alloc_heap_object_in(runtime_t *runtime, size_t bytes,
+    value_t species, bool is_large) {
   address_t addr = NULL;
   if (runtime->gc_fuzzer != NULL) {
     if (gc_fuzzer_tick(runtime->gc_fuzzer))
       return new_heap_exhausted_condition((uint32_t) bytes);
   }
-  if (!heap_try_alloc(&runtime->heap, bytes, &addr))
+  if (heap_tick_replication(&runtime->heap, bytes))
+    TRY(runtime_garbage_collect_increment(runtime));
+  bool succeeded = is_large
+      ? heap_try_alloc_large(&runtime->heap, bytes, &addr)
+      : heap_try_alloc(&runtime->heap, bytes, &addr);
+  if (!succeeded)
     return new_heap_exhausted_condition((uint32_t) bytes);
+  runtime->heap.stats.bytes_allocated_since_gc += bytes;
   value_t result = new_heap_object(addr);
   set_heap_object_header(result, species);
   return result;
 }
 
+value_t alloc_heap_object(runtime_t *runtime, size_t bytes, value_t species) {
+  return alloc_heap_object_in(runtime, bytes, species, false);
+}
+
+value_t alloc_heap_object_maybe_large(runtime_t *runtime, size_t bytes,
+    value_t species) {
+  bool is_large = heap_is_large_object_size(&runtime->heap, bytes);
+  return alloc_heap_object_in(runtime, bytes, species, is_large);
+}
+
 value_t clone_heap_object(runtime_t *runtime, value_t original) {
   heap_object_layout_t layout;
   get_heap_object_layout(original, &layout);
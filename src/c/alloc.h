@@ -464,6 +464,13 @@ value_t new_heap_os_in_stream(runtime_t *runtime, in_stream_t *out, value_t life
 // create an object tracker that finalizes it.
 value_t alloc_heap_object(runtime_t *runtime, size_t bytes, value_t species);
 
+// Works the same as alloc_heap_object except that if the object is large enough
+// it is allocated in the large object space where it will never be moved. Only
+// use this for families whose instances host no derived objects and need no
+// post-migrate fixup.
+value_t alloc_heap_object_maybe_large(runtime_t *runtime, size_t bytes,
+    value_t species);
+
 // Creates and returns a clone of the given object. The contents of the object
 // will be exactly the same as before so typically you don't want to use this on
 // objects that contain derived pointers or that own values, unless you know
@@ -178,8 +178,12 @@ static value_t custom_tagged_transient_identity_hash(value_t self,
 
 static value_t default_heap_heap_object_transient_identity_hash(value_t value,
     hash_stream_t *stream, cycle_detector_t *detector) {
-  // heap_object_transient_identity_hash has already written the tags.
-  hash_stream_write_int64(stream, value.encoded);
+  // heap_object_transient_identity_hash has already written the tags. The
+  // address changes when the object is moved so the hash is the serial number
+  // the heap gives the object the first time it's hashed.
+  heap_t *heap = get_species_heap(get_heap_object_species(value));
+  TRY_DEF(serial, heap_get_identity_hash(heap, value));
+  hash_stream_write_int64(stream, get_integer_value(serial));
   return success();
 }
 
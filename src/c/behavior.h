@@ -131,7 +131,9 @@ value_t value_validate(value_t value);
 void get_heap_object_layout(value_t value, heap_object_layout_t *layout_out);
 
 // Returns the transient identity hash of the given value. This hash is
-// transient in the sense that it may be changed by garbage collection. It
+// transient in the sense that it changes if the parts of the value it is
+// calculated from change. Objects that are hashed by address alone get a hash
+// from the heap that stays the same when garbage collection moves them. It
 // is an identity hash because it must be consistent with object identity,
 // so two identical values must have the same hash.
 //
@@ -40,6 +40,22 @@ void MAKE_BUFFER_NAME(append)(MAKE_BUFFER_NAME(t) *buf, BUFFER_TYPE value) {
   buf->length++;
 }
 
+BUFFER_TYPE MAKE_BUFFER_NAME(get)(MAKE_BUFFER_NAME(t) *buf, size_t offset) {
+  CHECK_REL("get out of bounds", offset, <, buf->length);
+  return ((BUFFER_TYPE*) buf->memory.start)[offset];
+}
+
+void MAKE_BUFFER_NAME(set)(MAKE_BUFFER_NAME(t) *buf, size_t offset,
+    BUFFER_TYPE value) {
+  CHECK_REL("set out of bounds", offset, <, buf->length);
+  ((BUFFER_TYPE*) buf->memory.start)[offset] = value;
+}
+
+void MAKE_BUFFER_NAME(truncate)(MAKE_BUFFER_NAME(t) *buf, size_t length) {
+  CHECK_REL("truncate beyond end", length, <=, buf->length);
+  buf->length = length;
+}
+
 blob_t MAKE_BUFFER_NAME(flush)(MAKE_BUFFER_NAME(t) *buf) {
   return blob_new(buf->memory.start, buf->length * sizeof(BUFFER_TYPE));
 }
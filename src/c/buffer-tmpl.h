@@ -30,6 +30,17 @@ void MAKE_BUFFER_NAME(dispose)(MAKE_BUFFER_NAME(t) *buf);
 void MAKE_BUFFER_NAME(append)(MAKE_BUFFER_NAME(t) *buf,
     BUFFER_TYPE value);
 
+// Returns the element at the given offset which must be within the buffer.
+BUFFER_TYPE MAKE_BUFFER_NAME(get)(MAKE_BUFFER_NAME(t) *buf, size_t offset);
+
+// Sets the element at the given offset which must be within the buffer.
+void MAKE_BUFFER_NAME(set)(MAKE_BUFFER_NAME(t) *buf, size_t offset,
+    BUFFER_TYPE value);
+
+// Discards all elements from the given length onwards. Any cursors pointing
+// into the discarded part of the buffer become invalid.
+void MAKE_BUFFER_NAME(truncate)(MAKE_BUFFER_NAME(t) *buf, size_t length);
+
 // Return the contents of this buffer as a blob. The data in the blob will
 // still be backed by this buffer so disposing this will make the blob invalid.
 blob_t MAKE_BUFFER_NAME(flush)(MAKE_BUFFER_NAME(t) *buf);
@@ -14,14 +14,36 @@ void builtin_arguments_init(builtin_arguments_t *args, runtime_t *runtime,
   args->runtime = runtime;
   args->frame = frame;
   args->process = process;
+  args->direct_argument_map = nothing();
+}
+
+void builtin_arguments_init_direct(builtin_arguments_t *args,
+    runtime_t *runtime, frame_t *frame, value_t process, value_t arg_map) {
+  builtin_arguments_init(args, runtime, frame, process);
+  args->direct_argument_map = arg_map;
+}
+
+// Returns the argument with the given parameter index, taking into account
+// whether the builtin was called directly or through a frame.
+static value_t get_builtin_parameter(builtin_arguments_t *args,
+    size_t param_index) {
+  value_t arg_map = args->direct_argument_map;
+  if (is_nothing(arg_map)) {
+    return frame_get_argument(args->frame, param_index);
+  } else {
+    // The arguments are still pending on top of the caller's stack, exactly
+    // where the callee's frame would have seen them.
+    size_t offset = (size_t) get_integer_value(get_array_at(arg_map, param_index));
+    return frame_peek_value(args->frame, offset);
+  }
 }
 
 value_t get_builtin_argument(builtin_arguments_t *args, size_t index) {
-  return frame_get_argument(args->frame, kImplicitArgumentCount + index);
+  return get_builtin_parameter(args, kImplicitArgumentCount + index);
 }
 
 value_t get_builtin_subject(builtin_arguments_t *args) {
-  return frame_get_argument(args->frame, 0);
+  return get_builtin_parameter(args, 0);
 }
 
 runtime_t *get_builtin_runtime(builtin_arguments_t *args) {
@@ -51,7 +73,11 @@ value_t add_builtin_method_impl(runtime_t *runtime, value_t map,
   assembler_t assm;
   TRY_FINALLY {
     E_TRY(assembler_init(&assm, runtime, nothing(), scope_get_bottom()));
+    value_t method_flags = new_flag_set(kFlagSetAllOff);
     if (leave_argc == -1) {
+      // Simple builtins don't touch the frame so the interpreter can quicken
+      // calls to them into direct calls.
+      method_flags = new_flag_set(mfFrameless);
       // Simple case where there can be no signals.
       E_TRY(assembler_emit_builtin(&assm, impl));
       E_TRY(assembler_emit_return(&assm));
@@ -72,7 +98,7 @@ value_t add_builtin_method_impl(runtime_t *runtime, value_t map,
     E_TRY_DEF(code_block, assembler_flush(&assm));
     E_TRY_DEF(name, new_heap_utf8(runtime, new_c_string(name_c_str)));
     E_TRY_DEF(builtin, new_heap_builtin_implementation(runtime, afFreeze,
-        name, code_block, arg_count, new_flag_set(kFlagSetAllOff)));
+        name, code_block, arg_count, method_flags));
     E_RETURN(set_id_hash_map_at(runtime, map, name, builtin));
   } FINALLY {
     assembler_dispose(&assm);
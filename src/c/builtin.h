@@ -18,6 +18,10 @@ typedef struct {
   frame_t *frame;
   // The current process
   value_t process;
+  // If the builtin is being called directly, without a frame of its own, this
+  // is the argument map that locates the arguments among the values on top of
+  // the current frame's stack. Otherwise nothing.
+  value_t direct_argument_map;
 } builtin_arguments_t;
 
 // Number of implicit arguments, that is, subject, selector, and is_async.
@@ -27,6 +31,12 @@ typedef struct {
 void builtin_arguments_init(builtin_arguments_t *args, runtime_t *runtime,
     frame_t *frame, value_t process);
 
+// Initialize a built_in_arguments for a direct call to a frameless builtin
+// where the arguments are the topmost values on the given frame's stack, laid
+// out according to the given argument map.
+void builtin_arguments_init_direct(builtin_arguments_t *args,
+    runtime_t *runtime, frame_t *frame, value_t process, value_t arg_map);
+
 // Returns the index'th positional argument to a built-in method.
 value_t get_builtin_argument(builtin_arguments_t *args, size_t index);
 
@@ -4,12 +4,16 @@
 #include "alloc.h"
 #include "behavior.h"
 #include "codegen.h"
+#include "runtime.h"
 #include "tagged-inl.h"
 #include "try-inl.h"
 #include "utils/log.h"
 #include "utils/ook-inl.h"
 #include "value-inl.h"
 
+#include <stdlib.h>
+#include <string.h>
+
 
 // --- B i n d i n g   i n f o ---
 
@@ -255,8 +259,13 @@ value_t assembler_init_stripped_down(assembler_t *assm, runtime_t *runtime) {
   assm->runtime = runtime;
   assm->fragment = null();
   assm->value_pool = nothing();
+  assm->constant_values = nothing();
+  assm->fold_ambience = nothing();
   short_buffer_init(&assm->code);
   assm->stack_height = assm->high_water_mark = 0;
+  assm->is_last_invoke_in_tail_position = false;
+  assm->last_op_offset = kNoLastOperation;
+  assm->inline_depth = 0;
   reusable_scratch_memory_init(&assm->scratch_memory);
   return success();
 }
@@ -315,9 +324,59 @@ static void assembler_emit_short(assembler_t *assm, size_t value) {
 
 // Writes an opcode to this assembler.
 static void assembler_emit_opcode(assembler_t *assm, opcode_t opcode) {
+  // Slaps and stack checks don't affect the top of the stack so a preceding
+  // invocation stays in tail position. Anything else spoils it.
+  if (opcode != ocSlap && opcode != ocCheckStackHeight)
+    assm->is_last_invoke_in_tail_position = false;
+  assm->last_op_offset = assm->code.length;
   assembler_emit_short(assm, opcode);
 }
 
+// Returns the opcode of the last operation emitted if the peephole optimizer
+// is allowed to fuse it with the next one, otherwise __ocFirst__.
+static opcode_t assembler_get_last_opcode(assembler_t *assm) {
+  if (assm->last_op_offset == kNoLastOperation)
+    return __ocFirst__;
+  return (opcode_t) short_buffer_get(&assm->code, assm->last_op_offset);
+}
+
+// Returns the single operand of the last operation emitted.
+static size_t assembler_get_last_operand(assembler_t *assm) {
+  return short_buffer_get(&assm->code, assm->last_op_offset + 1);
+}
+
+// Replaces the opcode of the last operation emitted, keeping its operands.
+static void assembler_set_last_opcode(assembler_t *assm, opcode_t opcode) {
+  short_buffer_set(&assm->code, assm->last_op_offset, (short_t) opcode);
+}
+
+// If the last operation emitted is followed by a stack height check, removes
+// the check so the operation can be changed or extended. The check would be
+// wrong for the fused operation anyway and the adjustment that comes with the
+// fused operation emits a new one.
+static void assembler_drop_trailing_stack_height_check(assembler_t *assm) {
+  opcode_t last = assembler_get_last_opcode(assm);
+  size_t check_offset = assm->last_op_offset + get_opcode_size(last);
+  if (check_offset + kCheckStackHeightOperationSize == assm->code.length
+      && short_buffer_get(&assm->code, check_offset) == ocCheckStackHeight)
+    short_buffer_truncate(&assm->code, check_offset);
+}
+
+// Returns true if the given opcode pushes a single value and has no other
+// effect, such that it can be removed along with a pop of the value.
+static bool is_pure_push_opcode(opcode_t opcode) {
+  switch (opcode) {
+    case ocPush:
+    case ocLoadLocal:
+    case ocLoadArgument:
+    case ocLoadRawArgument:
+    case ocLoadLambdaCapture:
+      return true;
+    default:
+      return false;
+  }
+}
+
 static void assembler_emit_cursor(assembler_t *assm, short_buffer_cursor_t *out) {
   short_buffer_append_cursor(&assm->code, out);
 }
@@ -339,16 +398,21 @@ static value_t assembler_emit_value(assembler_t *assm, value_t value) {
     // Yes we have, grab the previous index.
     index = get_integer_value(prev_index);
   }
-  // TODO: handle the case where there's more than 0xFF constants.
+  // Value operands are shorts so that's how many constants we can refer to.
+  // Every invocation has its own inline cache in the pool so larger methods
+  // can have quite a few constants.
+  // TODO: handle the case where there's more than 0xFFFF constants.
   CHECK_REL("negative index", index, >=, 0);
-  CHECK_REL("large index", index, <=, 0xFF);
+  CHECK_REL("large index", index, <=, 0xFFFF);
   short_buffer_append(&assm->code, (uint16_t) index);
   return success();
 }
 
 // Adjusts the stack height and optionally inserts a check stack height op.
+// The check isn't an operation the peephole optimizer considers so it doesn't
+// keep the operation before it from being fused with the next one.
 static void assembler_emit_stack_height_check(assembler_t *assm) {
-  assembler_emit_opcode(assm, ocCheckStackHeight);
+  assembler_emit_short(assm, ocCheckStackHeight);
   assembler_emit_short(assm, assm->stack_height);
 }
 
@@ -364,14 +428,25 @@ void assembler_adjust_stack_height(assembler_t *assm, int64_t delta) {
 }
 
 size_t assembler_get_code_cursor(assembler_t *assm) {
+  // Code may jump to this point so whatever comes next must stand alone.
+  assm->last_op_offset = kNoLastOperation;
   // The length is measured in number of elements so we can just return it
   // directly, there's no need to adjust for the element size.
   return assm->code.length;
 }
 
 value_t assembler_emit_push(assembler_t *assm, value_t value) {
-  assembler_emit_opcode(assm, ocPush);
-  TRY(assembler_emit_value(assm, value));
+  if (assembler_get_last_opcode(assm) == ocPush) {
+    // Push;Push becomes a single PushPair. Every invocation starts by pushing
+    // the selector and the transport so this saves a dispatch per call.
+    assembler_drop_trailing_stack_height_check(assm);
+    assembler_set_last_opcode(assm, ocPushPair);
+    TRY(assembler_emit_value(assm, value));
+    assm->last_op_offset = kNoLastOperation;
+  } else {
+    assembler_emit_opcode(assm, ocPush);
+    TRY(assembler_emit_value(assm, value));
+  }
   assembler_adjust_stack_height(assm, +1);
   return success();
 }
@@ -384,15 +459,44 @@ value_t assembler_emit_reify_arguments(assembler_t *assm, value_t params) {
 }
 
 value_t assembler_emit_pop(assembler_t *assm, size_t count) {
-  assembler_emit_opcode(assm, ocPop);
-  assembler_emit_short(assm, count);
+  size_t remaining = count;
+  if (remaining > 0 && is_pure_push_opcode(assembler_get_last_opcode(assm))) {
+    // A value that is pushed only to be popped right away doesn't have to be
+    // pushed at all.
+    short_buffer_truncate(&assm->code, assm->last_op_offset);
+    assm->last_op_offset = kNoLastOperation;
+    remaining--;
+  }
+  if (remaining > 0) {
+    size_t total = remaining;
+    if (assembler_get_last_opcode(assm) == ocPop)
+      total += assembler_get_last_operand(assm);
+    if (total != remaining && total <= 0xFFFF) {
+      // Pop;Pop becomes a single Pop of both counts.
+      assembler_drop_trailing_stack_height_check(assm);
+      short_buffer_set(&assm->code, assm->last_op_offset + 1, (short_t) total);
+    } else {
+      assembler_emit_opcode(assm, ocPop);
+      assembler_emit_short(assm, remaining);
+    }
+  }
+  // This also accounts for the value pushed by any operation dropped above.
   assembler_adjust_stack_height(assm, -count);
   return success();
 }
 
 value_t assembler_emit_slap(assembler_t *assm, size_t count) {
-  assembler_emit_opcode(assm, ocSlap);
-  assembler_emit_short(assm, count);
+  size_t total = count;
+  if (assembler_get_last_opcode(assm) == ocSlap)
+    total += assembler_get_last_operand(assm);
+  if (total != count && total <= 0xFFFF) {
+    // Slap;Slap becomes a single Slap of both counts.
+    assembler_drop_trailing_stack_height_check(assm);
+    short_buffer_set(&assm->code, assm->last_op_offset + 1, (short_t) total);
+  } else {
+    assembler_emit_opcode(assm, ocSlap);
+    assembler_emit_short(assm, count);
+  }
   assembler_adjust_stack_height(assm, -count);
   return success();
 }
@@ -452,6 +556,15 @@ value_t assembler_emit_goto_forward(assembler_t *assm,
   return success();
 }
 
+value_t assembler_emit_guard_inline(assembler_t *assm, value_t space,
+    short_buffer_cursor_t *offset_out) {
+  CHECK_FAMILY(ofMethodspace, space);
+  assembler_emit_opcode(assm, ocGuardInline);
+  TRY(assembler_emit_value(assm, space));
+  assembler_emit_cursor(assm, offset_out);
+  return success();
+}
+
 value_t assembler_emit_fire_escape_or_barrier(assembler_t *assm) {
   // A tiny bit of stack space is required to fire some barriers so the first
   // step here is to push null that take up that space. That way, each time
@@ -507,12 +620,25 @@ value_t assembler_emit_invocation(assembler_t *assm, value_t fragment,
     value_t tags, value_t nexts) {
   CHECK_FAMILY_OPT(ofModuleFragment, fragment);
   CHECK_FAMILY(ofCallTags, tags);
-  assembler_emit_opcode(assm, ocInvoke);
+  // Emit the opcode through a cursor so it can be changed into a tail invoke
+  // if it turns out the result is returned directly. The invoke isn't fused
+  // with the push before it: quickening rewrites the opcode in place and
+  // backtraces find it at a fixed distance from the return pc, so it has to
+  // stay a separate operation, and a fused push would still have to dispatch
+  // on whatever the invoke has been rewritten into.
+  assembler_emit_cursor(assm, &assm->last_invoke_cursor);
+  short_buffer_cursor_set(&assm->last_invoke_cursor, ocInvoke);
+  assm->last_op_offset = assm->last_invoke_cursor.offset;
   TRY(assembler_emit_value(assm, tags));
   TRY(assembler_emit_value(assm, fragment));
   TRY(assembler_emit_value(assm, nexts));
+  // Each invocation gets its own inline cache which starts out empty. The
+  // freeze cheat is fresh so it'll get its own entry in the value pool.
+  TRY_DEF(cache_ptr, new_heap_freeze_cheat(assm->runtime, nothing()));
+  TRY(assembler_emit_value(assm, cache_ptr));
   // The result will be pushed onto the stack on top of the arguments.
   assembler_adjust_stack_height(assm, 1);
+  assm->is_last_invoke_in_tail_position = true;
   return success();
 }
 
@@ -532,6 +658,7 @@ value_t assembler_emit_signal(assembler_t *assm, opcode_t opcode, value_t tags)
   // Pad the instruction to give it the same length as the other invoke ops.
   assembler_emit_short(assm, 0);
   assembler_emit_short(assm, 0);
+  assembler_emit_short(assm, 0);
   // Do Not Adjust Your Stack Height.
   return success();
 }
@@ -553,7 +680,10 @@ value_t assembler_emit_builtin_maybe_escape(assembler_t *assm,
   TRY(assembler_emit_value(assm, wrapper));
   assembler_emit_cursor(assm, leave_offset_out);
   // Pad this op to be the same length as invoke ops since all ops that can
-  // produce a backtrace entry should have the same length.
+  // produce a backtrace entry should have the same length. The interpreter
+  // doesn't need the argument count but the verifier does so it goes in the
+  // padding.
+  assembler_emit_short(assm, leave_argc);
   assembler_emit_short(assm, 0);
   // The builting will either succeed and leave one value on the stack or fail
   // and leave argc signal params on the stack plus the appropriate invocation
@@ -568,6 +698,15 @@ value_t assembler_emit_builtin_maybe_escape(assembler_t *assm,
 
 value_t assembler_emit_return(assembler_t *assm) {
   CHECK_EQ("invalid stack height", 1, assm->stack_height);
+  if (assm->is_last_invoke_in_tail_position)
+    // The result of the last invocation is what we're returning so there's no
+    // need to keep this frame around while it executes.
+    short_buffer_cursor_set(&assm->last_invoke_cursor, ocTailInvoke);
+  if (assembler_get_last_opcode(assm) == ocSlap)
+    // Returning restores the caller's stack pointer from the frame header so
+    // whatever is below the result gets discarded anyway; Slap;Return becomes
+    // just Return.
+    short_buffer_truncate(&assm->code, assm->last_op_offset);
   TRY(assembler_emit_unchecked_return(assm));
   return success();
 }
@@ -599,8 +738,16 @@ value_t assembler_emit_new_reference(assembler_t *assm) {
 }
 
 value_t assembler_emit_load_local(assembler_t *assm, size_t index) {
-  assembler_emit_opcode(assm, ocLoadLocal);
-  assembler_emit_short(assm, index);
+  if (assembler_get_last_opcode(assm) == ocLoadLocal) {
+    // LoadLocal;LoadLocal becomes a single LoadLocalPair.
+    assembler_drop_trailing_stack_height_check(assm);
+    assembler_set_last_opcode(assm, ocLoadLocalPair);
+    assembler_emit_short(assm, index);
+    assm->last_op_offset = kNoLastOperation;
+  } else {
+    assembler_emit_opcode(assm, ocLoadLocal);
+    assembler_emit_short(assm, index);
+  }
   assembler_adjust_stack_height(assm, +1);
   return success();
 }
@@ -621,6 +768,9 @@ value_t assembler_emit_load_global(assembler_t *assm, value_t path,
   assembler_emit_opcode(assm, ocLoadGlobal);
   TRY(assembler_emit_value(assm, path));
   TRY(assembler_emit_value(assm, fragment));
+  // The slot that caches the resolved value once it's known to be stable.
+  TRY_DEF(cache_ptr, new_heap_freeze_cheat(assm->runtime, nothing()));
+  TRY(assembler_emit_value(assm, cache_ptr));
   assembler_adjust_stack_height(assm, +1);
   return success();
 }
@@ -699,6 +849,7 @@ value_t assembler_emit_call_ensurer(assembler_t *assm) {
   assembler_emit_short(assm, 0);
   assembler_emit_short(assm, 0);
   assembler_emit_short(assm, 0);
+  assembler_emit_short(assm, 0);
   assembler_adjust_stack_height(assm,
       + 1);               // the return value from the shard
   return success();
@@ -727,3 +878,129 @@ value_t assembler_emit_uninstall_signal_handler(assembler_t *assm) {
   assembler_adjust_stack_height(assm, -get_genus_descriptor(dgSignalHandlerSection)->field_count - 1);
   return success();
 }
+
+
+// --- O p c o d e   h i s t o g r a m ---
+
+IMPLEMENTATION(opcode_histogram_o, value_visitor_o);
+
+// Value visitor that counts the operations, and pairs of adjacent operations,
+// in each code block in the heap.
+struct opcode_histogram_o {
+  IMPLEMENTATION_HEADER(opcode_histogram_o, value_visitor_o);
+  // The number of times each opcode occurs, indexed by opcode.
+  size_t *singles;
+  // The number of times each opcode is followed directly by another, indexed
+  // by first * kOpcodeCount + second.
+  size_t *pairs;
+  // The number of code blocks seen.
+  size_t code_block_count;
+};
+
+static value_t opcode_histogram_visit(value_visitor_o *super_self,
+    value_t object) {
+  opcode_histogram_o *self = DOWNCAST(opcode_histogram_o, super_self);
+  if (!in_family(ofCodeBlock, object))
+    return success();
+  self->code_block_count++;
+  blob_t bytecode = get_blob_data(get_code_block_bytecode(object));
+  size_t length = blob_short_length(bytecode);
+  size_t pc = 0;
+  opcode_t prev = __ocFirst__;
+  while (pc < length) {
+    opcode_t opcode = (opcode_t) blob_short_at(bytecode, pc);
+    size_t size = get_opcode_size(opcode);
+    if (size == 0)
+      // Not a code block we understand, bail out rather than read garbage.
+      break;
+    self->singles[opcode]++;
+    if (prev != __ocFirst__)
+      self->pairs[prev * kOpcodeCount + opcode]++;
+    prev = opcode;
+    pc += size;
+  }
+  return success();
+}
+
+VTABLE(opcode_histogram_o, value_visitor_o) { opcode_histogram_visit };
+
+// An entry in the printed histogram.
+typedef struct {
+  size_t count;
+  size_t index;
+} opcode_histogram_entry_t;
+
+// Sorts histogram entries by decreasing count, then by index.
+static int compare_opcode_histogram_entries(const void *a, const void *b) {
+  const opcode_histogram_entry_t *ea = (const opcode_histogram_entry_t*) a;
+  const opcode_histogram_entry_t *eb = (const opcode_histogram_entry_t*) b;
+  if (ea->count != eb->count)
+    return (ea->count < eb->count) ? 1 : -1;
+  return (ea->index < eb->index) ? -1 : ((ea->index > eb->index) ? 1 : 0);
+}
+
+// Prints the top_count largest nonzero counts in the given table, largest
+// first, along with their share of the total.
+static void print_opcode_histogram_table(out_stream_t *out, size_t *counts,
+    size_t countc, bool is_pairs, size_t top_count,
+    opcode_histogram_entry_t *scratch) {
+  size_t entryc = 0;
+  size_t total = 0;
+  for (size_t i = 0; i < countc; i++) {
+    if (counts[i] == 0)
+      continue;
+    scratch[entryc].count = counts[i];
+    scratch[entryc].index = i;
+    entryc++;
+    total += counts[i];
+  }
+  qsort(scratch, entryc, sizeof(opcode_histogram_entry_t),
+      compare_opcode_histogram_entries);
+  for (size_t i = 0; i < entryc && i < top_count; i++) {
+    size_t index = scratch[i].index;
+    double percent = (100.0 * scratch[i].count) / total;
+    if (is_pairs) {
+      out_stream_printf(out, "  %8lli %5.1f%%  %s;%s\n",
+          (long long) scratch[i].count, percent,
+          get_opcode_name((opcode_t) (index / kOpcodeCount)),
+          get_opcode_name((opcode_t) (index % kOpcodeCount)));
+    } else {
+      out_stream_printf(out, "  %8lli %5.1f%%  %s\n",
+          (long long) scratch[i].count, percent,
+          get_opcode_name((opcode_t) index));
+    }
+  }
+}
+
+value_t runtime_write_opcode_histogram(runtime_t *runtime, out_stream_t *out,
+    size_t top_count) {
+  size_t pair_count = kOpcodeCount * kOpcodeCount;
+  size_t counts_size = (kOpcodeCount + pair_count) * sizeof(size_t);
+  size_t scratch_size = pair_count * sizeof(opcode_histogram_entry_t);
+  blob_t memory = allocator_default_malloc(counts_size + scratch_size);
+  if (blob_is_empty(memory))
+    return new_system_call_failed_condition("malloc");
+  memset(memory.start, 0, counts_size);
+  opcode_histogram_o histogram;
+  VTABLE_INIT(opcode_histogram_o, UPCAST(&histogram));
+  histogram.singles = (size_t*) memory.start;
+  histogram.pairs = histogram.singles + kOpcodeCount;
+  histogram.code_block_count = 0;
+  opcode_histogram_entry_t *scratch = (opcode_histogram_entry_t*)
+      (((byte_t*) memory.start) + counts_size);
+  TRY_FINALLY {
+    E_TRY(heap_for_each_allocated_object(&runtime->heap, UPCAST(&histogram)));
+    out_stream_printf(out, "Code blocks: %lli\n",
+        (long long) histogram.code_block_count);
+    out_stream_printf(out, "Operations:\n");
+    print_opcode_histogram_table(out, histogram.singles, kOpcodeCount, false,
+        top_count, scratch);
+    out_stream_printf(out, "Adjacent pairs:\n");
+    print_opcode_histogram_table(out, histogram.pairs, pair_count, true,
+        top_count, scratch);
+    out_stream_flush(out);
+    E_RETURN(success());
+  } FINALLY {
+    allocator_default_free(memory);
+  } YRT
+}
@@ -124,6 +124,12 @@ typedef struct assembler_t {
   short_buffer_t code;
   // The value pool map.
   value_t value_pool;
+  // Map from the invocations the constant folder has looked at to their
+  // compile-time values, or nothing if they don't have one.
+  value_t constant_values;
+  // Ambience the constant folder looks up methods in, created the first time
+  // it's needed.
+  value_t fold_ambience;
   // The current stack height.
   size_t stack_height;
   // The highest the stack has been at any point.
@@ -134,8 +140,25 @@ typedef struct assembler_t {
   reusable_scratch_memory_t scratch_memory;
   // The module fragment we're compiling within.
   value_t fragment;
+  // Cursor pointing to the opcode of the last invocation emitted.
+  short_buffer_cursor_t last_invoke_cursor;
+  // True if the last invocation has only been followed by operations that
+  // leave its result alone, which means that it can be turned into a tail
+  // invocation if a return comes next.
+  bool is_last_invoke_in_tail_position;
+  // Offset of the opcode of the last operation emitted, which the peephole
+  // optimizer may fuse with the next one, or kNoLastOperation if there is no
+  // such operation.
+  size_t last_op_offset;
+  // The number of method bodies currently being inlined into the code, which
+  // bounds how deeply inlining can nest.
+  size_t inline_depth;
 } assembler_t;
 
+// Value of an assembler's last_op_offset when the next operation can't be
+// fused with the previous one.
+static const size_t kNoLastOperation = ~((size_t) 0);
+
 // Initializes an assembler. If the given scope callback is NULL it is taken to
 // mean that there is no enclosing scope.
 value_t assembler_init(assembler_t *assm, runtime_t *runtime, value_t fragment,
@@ -165,7 +188,9 @@ reusable_scratch_memory_t *assembler_get_scratch_memory(assembler_t *assm);
 void assembler_adjust_stack_height(assembler_t *assm, int64_t delta);
 
 // Returns the offset in words of the next location in the code stream which
-// will be written, that is, one past the last written instruction.
+// will be written, that is, one past the last written instruction. Since the
+// offset may be used as a jump target this also stops the peephole optimizer
+// from fusing the operations on either side of it.
 size_t assembler_get_code_cursor(assembler_t *assm);
 
 // Emits a push instruction.
@@ -302,6 +327,12 @@ value_t assembler_emit_create_escape(assembler_t *assm,
 value_t assembler_emit_goto_forward(assembler_t *assm,
     short_buffer_cursor_t *offset_out);
 
+// Emits a guard that continues with the next instruction if the current
+// methodspace is the given one and otherwise moves an as yet undetermined
+// amount forward.
+value_t assembler_emit_guard_inline(assembler_t *assm, value_t space,
+    short_buffer_cursor_t *offset_out);
+
 // Either fire the next barrier if the current escape lies below it, or fire
 // the current escape if there are no more barriers to fire.
 value_t assembler_emit_fire_escape_or_barrier(assembler_t *assm);
@@ -420,4 +451,15 @@ value_t assembler_lookup_symbol(assembler_t *assm, value_t symbol,
 // Returns true if this assembler currently has a binding for the given symbol.
 bool assembler_is_symbol_bound(assembler_t *assm, value_t symbol);
 
+
+// --- O p c o d e   h i s t o g r a m ---
+
+// Writes a static histogram of the operations in all the code blocks in the
+// given runtime's heap to the given stream, along with one of the pairs of
+// operations that occur next to each other. Only the top_count most frequent
+// entries of each are written. The pairs are what decides which sequences are
+// worth fusing into a single operation in the assembler.
+value_t runtime_write_opcode_histogram(runtime_t *runtime, out_stream_t *out,
+    size_t top_count);
+
 #endif // _CODEGEN
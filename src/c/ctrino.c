@@ -4,9 +4,11 @@
 #include "alloc.h"
 #include "behavior.h"
 #include "builtin.h"
+#include "codegen.h"
 #include "ctrino.h"
 #include "freeze.h"
 #include "io.h"
+#include "snapshot.h"
 #include "sync.h"
 #include "tagged-inl.h"
 #include "try-inl.h"
@@ -259,6 +261,99 @@ static value_t ctrino_collect_garbage(builtin_arguments_t *args) {
   return new_heap_exhausted_condition(0);
 }
 
+static value_t ctrino_dump_heap_snapshot(builtin_arguments_t *args) {
+  value_t self = get_builtin_subject(args);
+  value_t path = get_builtin_argument(args, 0);
+  CHECK_C_OBJECT_TAG(btCtrino, self);
+  CHECK_FAMILY(ofUtf8, path);
+  runtime_t *runtime = get_builtin_runtime(args);
+  TRY(runtime_dump_heap_snapshot(runtime, get_utf8_contents(path)));
+  return null();
+}
+
+static value_t ctrino_print_opcode_histogram(builtin_arguments_t *args) {
+  value_t self = get_builtin_subject(args);
+  value_t top_count = get_builtin_argument(args, 0);
+  CHECK_C_OBJECT_TAG(btCtrino, self);
+  CHECK_DOMAIN(vdInteger, top_count);
+  runtime_t *runtime = get_builtin_runtime(args);
+  TRY(runtime_write_opcode_histogram(runtime,
+      file_system_stdout(runtime->file_system),
+      (size_t) get_integer_value(top_count)));
+  return null();
+}
+
+// The gc stats that can be read through get_gc_stat, the ones prefixed with
+// last_ being those of the most recent collection.
+#define FOR_EACH_CTRINO_GC_STAT(F)                                             \
+  F(full_count,                 stats->full_count)                             \
+  F(nursery_count,              stats->nursery_count)                          \
+  F(incremental_count,          stats->incremental_count)                      \
+  F(total_pause_micros,         stats->total_pause_micros)                     \
+  F(max_pause_micros,           stats->max_pause_micros)                       \
+  F(total_bytes_allocated,      stats->total_bytes_allocated)                  \
+  F(total_bytes_copied,         stats->total_bytes_copied)                     \
+  F(bytes_allocated_since_gc,   stats->bytes_allocated_since_gc)               \
+  F(last_pause_micros,          stats->last.pause_micros)                      \
+  F(last_bytes_allocated,       stats->last.bytes_allocated)                   \
+  F(last_bytes_before,          stats->last.bytes_before)                      \
+  F(last_bytes_copied,          stats->last.bytes_copied)                      \
+  F(last_survival_percent,      stats->last.survival_percent)                  \
+  F(last_object_tracker_count,  stats->last.object_tracker_count)              \
+  F(last_fixup_count,           stats->last.fixup_count)                       \
+  F(last_slice_count,           stats->last.slice_count)                       \
+  F(last_slice_micros,          stats->last.slice_micros)
+
+static value_t ctrino_get_gc_stat(builtin_arguments_t *args) {
+  value_t self = get_builtin_subject(args);
+  value_t name = get_builtin_argument(args, 0);
+  CHECK_C_OBJECT_TAG(btCtrino, self);
+  CHECK_FAMILY(ofUtf8, name);
+  runtime_t *runtime = get_builtin_runtime(args);
+  const gc_stats_t *stats = runtime_get_gc_stats(runtime);
+  utf8_t chars = get_utf8_contents(name);
+  if (string_equals(chars, new_c_string("last_kind"))) {
+    if ((stats->full_count + stats->nursery_count + stats->incremental_count) == 0)
+      return null();
+    return new_heap_utf8(runtime, new_c_string(get_gc_kind_name(stats->last.kind)));
+  }
+#define __CHECK_GC_STAT__(NAME, EXPR)                                          \
+  if (string_equals(chars, new_c_string(#NAME)))                               \
+    return new_integer((int64_t) (EXPR));
+  FOR_EACH_CTRINO_GC_STAT(__CHECK_GC_STAT__)
+#undef __CHECK_GC_STAT__
+  WARN("Unknown gc stat %v.", name);
+  return null();
+}
+
+static value_t ctrino_get_gc_family_stats(builtin_arguments_t *args) {
+  value_t self = get_builtin_subject(args);
+  CHECK_C_OBJECT_TAG(btCtrino, self);
+  runtime_t *runtime = get_builtin_runtime(args);
+  const gc_family_stats_t *families = runtime_get_gc_stats(runtime)->last.families;
+  size_t family_count = 0;
+  for (size_t i = 0; i < kGcFamilyStatsCount; i++) {
+    if (families[i].count > 0)
+      family_count++;
+  }
+  TRY_DEF(result, new_heap_array(runtime, family_count));
+  size_t next = 0;
+  for (size_t i = 0; i < kGcFamilyStatsCount; i++) {
+    if (families[i].count == 0)
+      continue;
+    heap_object_family_t family =
+        (heap_object_family_t) NEW_STATIC_INTEGER(i);
+    TRY_DEF(entry, new_heap_array(runtime, 3));
+    TRY_DEF(family_name, new_heap_utf8(runtime,
+        new_c_string(get_heap_object_family_name(family))));
+    set_array_at(entry, 0, family_name);
+    set_array_at(entry, 1, new_integer(families[i].count));
+    set_array_at(entry, 2, new_integer(families[i].bytes));
+    set_array_at(result, next++, entry);
+  }
+  return result;
+}
+
 static value_t ctrino_delay(builtin_arguments_t *args) {
   value_t self = get_builtin_subject(args);
   value_t thunk = get_builtin_argument(args, 0);
@@ -365,15 +460,17 @@ static value_t ctrino_get_environment_variable(builtin_arguments_t *args) {
   return result;
 }
 
-#define kCtrinoMethodCount 29
-static const c_object_method_t kCtrinoMethods[kCtrinoMethodCount] = {
+static const c_object_method_t kCtrinoMethods[] = {
   BUILTIN_METHOD("builtin", 1, ctrino_builtin),
   BUILTIN_METHOD("collect_garbage!", 0, ctrino_collect_garbage),
   BUILTIN_METHOD("delay", 2, ctrino_delay),
+  BUILTIN_METHOD("dump_heap_snapshot!", 1, ctrino_dump_heap_snapshot),
   BUILTIN_METHOD("freeze", 1, ctrino_freeze),
   BUILTIN_METHOD("get_builtin_type", 1, ctrino_get_builtin_type),
   BUILTIN_METHOD("get_current_backtrace", 0, ctrino_get_current_backtrace),
   BUILTIN_METHOD("get_environment_variable", 1, ctrino_get_environment_variable),
+  BUILTIN_METHOD("get_gc_family_stats", 0, ctrino_get_gc_family_stats),
+  BUILTIN_METHOD("get_gc_stat", 1, ctrino_get_gc_stat),
   BUILTIN_METHOD("is_deep_frozen?", 1, ctrino_is_deep_frozen),
   BUILTIN_METHOD("is_frozen?", 1, ctrino_is_frozen),
   BUILTIN_METHOD("log_error_canonical!", 1, ctrino_log_error_canonical),
@@ -391,6 +488,7 @@ static const c_object_method_t kCtrinoMethods[kCtrinoMethodCount] = {
   BUILTIN_METHOD("new_pending_promise", 0, ctrino_new_pending_promise),
   BUILTIN_METHOD("new_plugin_instance", 1, ctrino_new_plugin_instance),
   BUILTIN_METHOD("print_ln!", 1, ctrino_print_ln),
+  BUILTIN_METHOD("print_opcode_histogram!", 1, ctrino_print_opcode_histogram),
   BUILTIN_METHOD("schedule_post_mortem", 2, ctrino_schedule_post_mortem),
   BUILTIN_METHOD("stdin", 0, ctrino_stdin),
   BUILTIN_METHOD("stdout", 0, ctrino_stdout),
@@ -401,7 +499,8 @@ static const c_object_method_t kCtrinoMethods[kCtrinoMethodCount] = {
 value_t create_ctrino_factory(runtime_t *runtime, value_t space) {
   c_object_info_t ctrino_info;
   c_object_info_reset(&ctrino_info);
-  c_object_info_set_methods(&ctrino_info, kCtrinoMethods, kCtrinoMethodCount);
+  c_object_info_set_methods(&ctrino_info, kCtrinoMethods,
+      ARRAY_SIZE(kCtrinoMethods));
   c_object_info_set_tag(&ctrino_info, new_integer((uint32_t) btCtrino));
   return new_c_object_factory(runtime, &ctrino_info, space);
 }
@@ -554,6 +653,9 @@ static value_array_t get_c_object_values(value_t self) {
 
 value_array_t get_mutable_c_object_values(value_t self) {
   CHECK_MUTABLE(self);
+  // The caller is going to write directly into the values so we can't tell
+  // what gets stored; just record the object.
+  heap_object_bulk_write_barrier(self);
   return get_c_object_values(self);
 }
 
@@ -133,6 +133,7 @@ value_t freeze_cheat_validate(value_t self) {
 void set_freeze_cheat_value(value_t self, value_t value) {
   CHECK_FAMILY(ofFreezeCheat, self);
   *access_heap_object_field(self, kFreezeCheatValueOffset) = value;
+  heap_object_write_barrier(self, value);
 }
 
 value_t get_freeze_cheat_value(value_t self) {
@@ -41,6 +41,9 @@ static size_t min_size(size_t a, size_t b) {
   return (a < b) ? a : b;
 }
 
+// Returns the number of elements in the given statically sized array.
+#define ARRAY_SIZE(A) (sizeof(A) / sizeof(*(A)))
+
 // The token "namespace" without upsetting C++ compilers.
 #define NAMESPACE __CONCAT_NO_EVAL__(name, space)
 
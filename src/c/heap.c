@@ -36,6 +36,13 @@ static size_t is_size_aligned(uint32_t alignment, size_t size) {
 static const extended_runtime_config_t kDefaultConfig = {
   /* base */ {
   1 * kMB,               // semispace_size_bytes
+  0,                     // max_semispace_size_bytes
+  50,                    // heap_grow_survival_percent
+  10,                    // heap_shrink_survival_percent
+  256 * kKB,             // nursery_size_bytes
+  64 * kKB,              // large_object_size_bytes
+  1,                     // gc_thread_count
+  0,                     // gc_max_pause_millis
   100 * kMB,             // system_memory_limit
   0,                     // allocation_failure_fuzzer_frequency
   0,                     // allocation_failure_fuzzer_seed,
@@ -56,37 +63,60 @@ const extended_runtime_config_t *extended_runtime_config_get_default() {
   return &kDefaultConfig;
 }
 
-value_t space_init(space_t *space, const extended_runtime_config_t *config) {
+// Maps a block of memory of the given size directly from the system, bypassing
+// the allocator. The memory is page aligned and reads as zero until written.
+// Returns the empty blob on failure.
+static blob_t system_memory_map(size_t size);
+
+// Returns a block of memory returned by system_memory_map to the system.
+static void system_memory_unmap(blob_t memory);
+
+// Tells the system it may reclaim the pages from start up to limit, which must
+// be within a block returned by system_memory_map. The address range stays
+// usable but what it reads as afterwards depends on the system: zero on posix,
+// either zero or the old contents on windows.
+static void system_memory_discard(address_t start, address_t limit);
+
+// Initialize the given space such that it can hold the given number of bytes.
+static value_t space_init_with_size(space_t *space, size_t size_bytes) {
   // Start out by clearing it, just for good measure.
   space_clear(space);
-  // Allocate one word more than strictly necessary to account for possible
-  // alignment.
-  size_t bytes = config->base.semispace_size_bytes + kValueSize;
-  blob_t memory = allocator_default_malloc(bytes);
+  // Spaces are big and, since they're reused across collections, long-lived so
+  // they're mapped directly rather than going through the allocator.
+  blob_t memory = system_memory_map(size_bytes);
   if (blob_is_empty(memory))
-    return new_system_call_failed_condition("malloc");
+    return new_system_call_failed_condition("mmap");
   // Clear the newly allocated memory to a recognizable value.
-  blob_fill(memory, kUnusedHeapMarker);
-  address_t aligned = align_address(kValueSize, (address_t) memory.start);
+  IF_HEAP_ZAPPING_ENABLED(blob_fill(memory, kUnusedHeapMarker));
   space->memory = memory;
-  space->next_free = space->start = aligned;
-  // If malloc gives us an aligned pointer using only 'size_bytes' of memory
-  // wastes the extra word we allocated to make room for alignment. However,
-  // making the space size slightly different depending on whether malloc
-  // aligns its data or not is a recipe for subtle bugs.
-  space->limit = space->next_free + config->base.semispace_size_bytes;
+  space->next_free = space->start = (address_t) memory.start;
+  space->limit = space->next_free + size_bytes;
   return success();
 }
 
+value_t space_init(space_t *space, const extended_runtime_config_t *config) {
+  return space_init_with_size(space, config->base.semispace_size_bytes);
+}
+
+// Returns the number of bytes the given space can hold.
+static size_t space_capacity(space_t *space) {
+  return space->limit - space->start;
+}
+
+// Returns the number of bytes that have been allocated in the given space.
+static size_t space_used(space_t *space) {
+  return space->next_free - space->start;
+}
+
 void space_dispose(space_t *space) {
   if (blob_is_empty(space->memory))
     return;
-  blob_fill(space->memory, kFreedHeapMarker);
-  allocator_default_free(space->memory);
+  system_memory_unmap(space->memory);
   space_clear(space);
 }
 
 void space_clear(space_t *space) {
+  space->start = NULL;
   space->next_free = NULL;
   space->limit = NULL;
   space->memory = blob_empty();
@@ -104,7 +134,7 @@ bool space_try_alloc(space_t *space, size_t size, address_t *memory_out) {
   if (next <= space->limit) {
     // Clear the newly allocated memory to a different value, again to make the
     // contents recognizable.
-    memset(addr, kAllocatedHeapMarker, aligned);
+    IF_HEAP_ZAPPING_ENABLED(memset(addr, kAllocatedHeapMarker, aligned));
     *memory_out = addr;
     space->next_free = next;
     return true;
@@ -118,9 +148,91 @@ bool space_contains(space_t *space, address_t addr) {
   return (((address_t) space->memory.start) <= addr) && (addr < space->next_free);
 }
 
+void space_reset(space_t *space) {
+  CHECK_FALSE("resetting empty space", space_is_empty(space));
+  // Clear the used part to a recognizable value like when it was freed.
+  IF_HEAP_ZAPPING_ENABLED(memset(space->start, kFreedHeapMarker,
+      space->next_free - space->start));
+  space->next_free = space->start;
+}
+
+void space_discard(space_t *space) {
+  CHECK_FALSE("discarding empty space", space_is_empty(space));
+  // Nothing past next_free has been touched since the space was last reset so
+  // only the used part needs to be discarded.
+  system_memory_discard(space->start, space->next_free);
+  // Whether discarded pages read as zero depends on the system so nothing
+  // allocated in the space may assume it starts out zeroed. That's no change
+  // since a space that has only been reset isn't zeroed either. Zapping still
+  // happens after the discard so in checked builds the pages read as freed
+  // however the system treated them.
+  space_reset(space);
+}
+
+bool space_try_alloc_shared(space_t *space, size_t size, address_t *memory_out) {
+  CHECK_FALSE("allocating in empty space", space_is_empty(space));
+  size_t aligned = align_size(kValueSize, size);
+  volatile address_arith_t *next_free_ptr =
+      (volatile address_arith_t*) &space->next_free;
+  while (true) {
+    address_arith_t addr = atomic_word_load(next_free_ptr);
+    address_arith_t next = addr + aligned;
+    if (next > (address_arith_t) space->limit)
+      return false;
+    if (atomic_word_compare_and_swap(next_free_ptr, addr, next) == addr) {
+      *memory_out = (address_t) addr;
+      return true;
+    }
+  }
+}
+
+bool space_try_alloc_buffer(space_t *space, size_t size, size_t min_bytes,
+    space_t *buffer_out) {
+  volatile address_arith_t *next_free_ptr =
+      (volatile address_arith_t*) &space->next_free;
+  while (true) {
+    address_arith_t addr = atomic_word_load(next_free_ptr);
+    // The limit may not be aligned so round the remaining size down.
+    size_t remaining = ((address_arith_t) space->limit - addr)
+        & ~(kValueSize - 1);
+    if (addr > (address_arith_t) space->limit || remaining < min_bytes)
+      return false;
+    size_t buffer_size = min_size(size, remaining);
+    address_arith_t next = addr + buffer_size;
+    if (atomic_word_compare_and_swap(next_free_ptr, addr, next) == addr) {
+      space_clear(buffer_out);
+      buffer_out->start = buffer_out->next_free = (address_t) addr;
+      buffer_out->limit = (address_t) next;
+      return true;
+    }
+  }
+}
+
+void space_retire_buffer(space_t *buffer) {
+  if (space_is_empty(buffer))
+    return;
+  size_t unused = buffer->limit - buffer->next_free;
+  if (unused > 0)
+    // Instead of a header the gap starts with its size in words which tells
+    // traversals to step over it.
+    *((value_t*) buffer->next_free) = new_integer(unused / kValueSize);
+  space_clear(buffer);
+}
+
 value_t space_for_each_object(space_t *space, value_visitor_o *visitor) {
-  address_t current = space->start;
+  return space_for_each_object_from(space, space->start, visitor);
+}
+
+value_t space_for_each_object_from(space_t *space, address_t start,
+    value_visitor_o *visitor) {
+  address_t current = start;
   while (current < space->next_free) {
+    value_t header = *((value_t*) current);
+    if (get_value_domain(header) == vdInteger) {
+      // This is the unused end of a buffer retired by a parallel collection.
+      current += get_integer_value(header) * kValueSize;
+      continue;
+    }
     value_t value = new_heap_object(current);
     TRY(value_visitor_visit(visitor, value));
     heap_object_layout_t layout;
@@ -135,12 +247,105 @@ value_t space_for_each_object(space_t *space, value_visitor_o *visitor) {
 
 // --- G C   S a f e ---
 
+// Returns the index of the slab that trackers with the given flags are
+// allocated from. Must agree with object_tracker_size.
+static size_t object_tracker_slab_index(uint32_t flags) {
+  if ((flags & tfMaybeWeak) != 0) {
+    return 1;
+  } else if ((flags & tfFinalizeExplicit) != 0) {
+    return 2;
+  } else {
+    return 0;
+  }
+}
+
+// Returns the array of chunks of the given slab.
+static address_t *object_tracker_slab_chunks(object_tracker_slab_t *slab) {
+  return (address_t*) slab->chunks.start;
+}
+
+// Returns the index'th tracker in the given chunk of the given slab.
+static object_tracker_t *object_tracker_slab_get(object_tracker_slab_t *slab,
+    size_t chunk, size_t index) {
+  address_t start = object_tracker_slab_chunks(slab)[chunk];
+  return (object_tracker_t*) (start + (index * slab->tracker_size));
+}
+
+// Initializes the given slab to hold trackers of the given size.
+static void object_tracker_slab_init(object_tracker_slab_t *slab,
+    size_t tracker_size) {
+  // Trackers are tagged when used as safe values so they must be aligned like
+  // objects.
+  slab->tracker_size = align_size(kValueSize, tracker_size);
+  slab->chunks = blob_empty();
+  slab->chunk_count = 0;
+  slab->chunk_capacity = 0;
+  slab->free_list = NULL;
+}
+
+static void object_tracker_slab_dispose(object_tracker_slab_t *slab) {
+  for (size_t i = 0; i < slab->chunk_count; i++) {
+    address_t start = object_tracker_slab_chunks(slab)[i];
+    allocator_default_free(blob_new(start,
+        kObjectTrackerChunkSize * slab->tracker_size));
+  }
+  if (!blob_is_empty(slab->chunks))
+    allocator_default_free(slab->chunks);
+  object_tracker_slab_init(slab, slab->tracker_size);
+}
+
+// Pushes the given tracker onto the free list of the given slab.
+static void object_tracker_slab_free(object_tracker_slab_t *slab,
+    object_tracker_t *tracker) {
+  tracker->state = tsFree;
+  tracker->flags = tfNone;
+  tracker->value.encoded = (address_arith_t) slab->free_list;
+  slab->free_list = tracker;
+}
+
+// Adds a chunk of free trackers to the given slab. Returns false if there was
+// no memory for it.
+static bool object_tracker_slab_grow(object_tracker_slab_t *slab) {
+  if (slab->chunk_count == slab->chunk_capacity) {
+    size_t new_capacity = (slab->chunk_capacity == 0)
+        ? 16
+        : (2 * slab->chunk_capacity);
+    blob_t new_chunks = allocator_default_malloc(
+        new_capacity * sizeof(address_t));
+    if (blob_is_empty(new_chunks))
+      return false;
+    if (slab->chunk_count > 0)
+      memcpy(new_chunks.start, slab->chunks.start,
+          slab->chunk_count * sizeof(address_t));
+    if (!blob_is_empty(slab->chunks))
+      allocator_default_free(slab->chunks);
+    slab->chunks = new_chunks;
+    slab->chunk_capacity = new_capacity;
+  }
+  blob_t chunk = allocator_default_malloc(
+      kObjectTrackerChunkSize * slab->tracker_size);
+  if (blob_is_empty(chunk))
+    return false;
+  size_t chunk_index = slab->chunk_count++;
+  object_tracker_slab_chunks(slab)[chunk_index] = (address_t) chunk.start;
+  // Free them in reverse such that they're handed out in order of address.
+  for (size_t i = kObjectTrackerChunkSize; i > 0; i--)
+    object_tracker_slab_free(slab,
+        object_tracker_slab_get(slab, chunk_index, i - 1));
+  return true;
+}
+
 // Data used when iterating object trackers within a heap.
 typedef struct {
-  // The current node being visited.
+  // The heap whose trackers are being visited.
+  heap_t *heap;
+  // The position of the current tracker: its slab, chunk, and index within
+  // the chunk.
+  size_t slab;
+  size_t chunk;
+  size_t index;
+  // The current tracker, NULL when we've reached the end.
   object_tracker_t *current;
-  // The node that indicates when we've reached the end.
-  object_tracker_t *limit;
   // Include weak references?
   bool include_weak;
 } object_tracker_iter_t;
@@ -148,7 +353,7 @@ typedef struct {
 // Returns true if there is a current node to return, false if we've reached the
 // end.
 static bool object_tracker_iter_has_current(object_tracker_iter_t *iter) {
-  return iter->current != iter->limit;
+  return iter->current != NULL;
 }
 
 // Returns the current object tracker.
@@ -160,31 +365,56 @@ static object_tracker_t *object_tracker_iter_get_current(object_tracker_iter_t *
   return iter->current;
 }
 
-// Skip past any trackers we've been asked to ignore.
-static void object_tracker_skip_ignored(object_tracker_iter_t *iter) {
-  if (iter->include_weak)
-    return;
-  while (object_tracker_iter_has_current(iter) && object_tracker_is_currently_weak(iter->current))
-    // Advance by hand since iter_advance would call this one recursively.
-    iter->current = iter->current->next;
+// Returns true if the iterator should stop at the given tracker.
+static bool object_tracker_iter_accepts(object_tracker_iter_t *iter,
+    object_tracker_t *tracker) {
+  if ((tracker->state & tsFree) != 0)
+    return false;
+  return iter->include_weak || !object_tracker_is_currently_weak(tracker);
+}
+
+// Moves the iterator to the first tracker at or after its position that it
+// should stop at. The slab sizes are read on every step since trackers may be
+// created, for instance by finalizers, while iterating.
+static void object_tracker_iter_seek(object_tracker_iter_t *iter) {
+  while (iter->slab < kObjectTrackerSlabCount) {
+    object_tracker_slab_t *slab = &iter->heap->object_tracker_slabs[iter->slab];
+    while (iter->chunk < slab->chunk_count) {
+      while (iter->index < kObjectTrackerChunkSize) {
+        object_tracker_t *tracker = object_tracker_slab_get(slab, iter->chunk,
+            iter->index);
+        if (object_tracker_iter_accepts(iter, tracker)) {
+          iter->current = tracker;
+          return;
+        }
+        iter->index++;
+      }
+      iter->chunk++;
+      iter->index = 0;
+    }
+    iter->slab++;
+    iter->chunk = 0;
+  }
+  iter->current = NULL;
 }
 
 // Initializes an object tracker iterator so that it's ready to iterate through
 // all the handles in the given heap.
 static void object_tracker_iter_init(object_tracker_iter_t *iter, heap_t *heap,
     bool include_weak) {
-  iter->current = heap->root_object_tracker.next;
-  iter->limit = &heap->root_object_tracker;
+  iter->heap = heap;
+  iter->slab = iter->chunk = iter->index = 0;
   iter->include_weak = include_weak;
-  object_tracker_skip_ignored(iter);
+  object_tracker_iter_seek(iter);
 }
 
-// Advances the iterator to the next node.
+// Advances the iterator to the next node. It's safe to destroy the current
+// tracker before advancing past it.
 static void object_tracker_iter_advance(object_tracker_iter_t *iter) {
   CHECK_TRUE("object tracker iter advance past end",
       object_tracker_iter_has_current(iter));
-  iter->current = iter->current->next;
-  object_tracker_skip_ignored(iter);
+  iter->index++;
+  object_tracker_iter_seek(iter);
 }
 
 size_t object_tracker_size(uint32_t flags) {
@@ -201,17 +431,17 @@ object_tracker_t *heap_new_heap_object_tracker(heap_t *heap, value_t value,
     uint32_t flags, protect_value_data_t *data) {
   CHECK_FALSE("tracker for immediate", value_is_immediate(value));
   CHECK_FALSE("invalid flags", (flags & tfMaybeWeak) && (flags & tfFinalizeExplicit));
-  size_t size = object_tracker_size(flags);
-  blob_t memory = allocator_default_malloc(size);
-  object_tracker_t *new_tracker = (object_tracker_t*) memory.start;
-  object_tracker_t *next = heap->root_object_tracker.next;
-  object_tracker_t *prev = next->prev;
+  object_tracker_slab_t *slab =
+      &heap->object_tracker_slabs[object_tracker_slab_index(flags)];
+  if (slab->free_list == NULL) {
+    bool grew = object_tracker_slab_grow(slab);
+    CHECK_TRUE("object tracker alloc failed", grew);
+  }
+  object_tracker_t *new_tracker = slab->free_list;
+  slab->free_list = (object_tracker_t*) (address_t) new_tracker->value.encoded;
   new_tracker->value = value;
   new_tracker->flags = flags;
-  new_tracker->next = next;
-  new_tracker->prev = prev;
-  prev->next = new_tracker;
-  next->prev = new_tracker;
+  new_tracker->state = 0;
   heap->object_tracker_count++;
   if (object_tracker_is_maybe_weak(new_tracker)) {
     CHECK_TRUE("no maybe-weak data", data != NULL);
@@ -231,29 +461,39 @@ object_tracker_t *heap_new_heap_object_tracker(heap_t *heap, value_t value,
 
 void heap_destroy_object_tracker(heap_t *heap, object_tracker_t *tracker) {
   CHECK_REL("freed too many object trackers", heap->object_tracker_count, >, 0);
-  object_tracker_t *prev = tracker->prev;
-  CHECK_PTREQ("wrong tracker prev", tracker, prev->next);
-  object_tracker_t *next = tracker->next;
-  CHECK_PTREQ("wrong tracker next", tracker, next->prev);
-  size_t size = object_tracker_size(tracker->flags);
-  allocator_default_free(blob_new(tracker, size));
-  prev->next = next;
-  next->prev = prev;
+  CHECK_EQ("tracker already freed", 0, tracker->state & tsFree);
+  object_tracker_slab_t *slab =
+      &heap->object_tracker_slabs[object_tracker_slab_index(tracker->flags)];
+  object_tracker_slab_free(slab, tracker);
   heap->object_tracker_count--;
 }
 
 value_t heap_validate(heap_t *heap) {
-  object_tracker_iter_t iter;
-  object_tracker_iter_init(&iter, heap, true);
-  object_tracker_t *prev = &heap->root_object_tracker;
   size_t trackers_seen = 0;
-  while (object_tracker_iter_has_current(&iter)) {
-    object_tracker_t *current = object_tracker_iter_get_current(&iter);
-    trackers_seen++;
-    COND_CHECK_EQ("tracker validate", ccValidationFailed, prev->next, current);
-    COND_CHECK_EQ("tracker validate", ccValidationFailed, current->prev, prev);
-    prev = current;
-    object_tracker_iter_advance(&iter);
+  for (size_t i = 0; i < kObjectTrackerSlabCount; i++) {
+    object_tracker_slab_t *slab = &heap->object_tracker_slabs[i];
+    // Every tracker is either in use or on the free list.
+    size_t free_count = 0;
+    for (object_tracker_t *free = slab->free_list; free != NULL;
+        free = (object_tracker_t*) (address_t) free->value.encoded) {
+      COND_CHECK_EQ("tracker validate", ccValidationFailed, tsFree,
+          free->state);
+      free_count++;
+    }
+    size_t used_count = 0;
+    for (size_t chunk = 0; chunk < slab->chunk_count; chunk++) {
+      for (size_t index = 0; index < kObjectTrackerChunkSize; index++) {
+        object_tracker_t *tracker = object_tracker_slab_get(slab, chunk, index);
+        if ((tracker->state & tsFree) != 0)
+          continue;
+        COND_CHECK_EQ("tracker validate", ccValidationFailed, i,
+            object_tracker_slab_index(tracker->flags));
+        used_count++;
+      }
+    }
+    COND_CHECK_EQ("tracker validate", ccValidationFailed,
+        slab->chunk_count * kObjectTrackerChunkSize, free_count + used_count);
+    trackers_seen += used_count;
   }
   COND_CHECK_EQ("tracker validate", ccValidationFailed, trackers_seen,
       heap->object_tracker_count);
@@ -261,8 +501,402 @@ value_t heap_validate(heap_t *heap) {
 }
 
 
+// --- L a r g e   o b j e c t s ---
+
+// Returns the offset from the start of a large object's mapping to the object
+// itself.
+static size_t get_large_object_header_size() {
+  return align_size(kValueSize, sizeof(large_object_t));
+}
+
+// Returns the header of the given object, which must be a large object.
+static large_object_t *get_large_object_header(value_t object) {
+  address_t addr = get_heap_object_address(object);
+  return (large_object_t*) (addr - get_large_object_header_size());
+}
+
+// Returns the object that follows the given large object header.
+static value_t get_large_object_value(large_object_t *large) {
+  return new_heap_object(((address_t) large) + get_large_object_header_size());
+}
+
+// Returns true if the given address is within the memory of the given space,
+// whether it has been allocated or not.
+static bool space_spans(space_t *space, address_t addr) {
+  return (space->start <= addr) && (addr < space->limit);
+}
+
+
+// --- R e m e m b e r e d   s e t ---
+
+// Initializes a remembered set for objects in a space with the given size.
+static value_t remembered_set_init(remembered_set_t *set, size_t space_size) {
+  TRY(bit_vector_init(&set->bits, space_size / kValueSize, false));
+  set->memory = allocator_default_malloc(kRememberedSetCapacity * kValueSize);
+  if (blob_is_empty(set->memory)) {
+    bit_vector_dispose(&set->bits);
+    return new_system_call_failed_condition("malloc");
+  }
+  set->length = 0;
+  set->has_overflowed = false;
+  return success();
+}
+
+static void remembered_set_dispose(remembered_set_t *set) {
+  bit_vector_dispose(&set->bits);
+  allocator_default_free(set->memory);
+  set->memory = blob_empty();
+}
+
+// Returns the array of objects recorded in the given set.
+static value_t *remembered_set_objects(remembered_set_t *set) {
+  return (value_t*) set->memory.start;
+}
+
+// Returns the index of the bit that records whether the given object, which
+// lives in the given space, is in the set.
+static size_t remembered_set_bit_index(space_t *space, value_t object) {
+  return (get_heap_object_address(object) - space->start) / kValueSize;
+}
+
+// Removes all objects from the given heap's remembered set. The objects may
+// have moved since they were added, in which case clear_all_bits must be set.
+static value_t remembered_set_clear(heap_t *heap, bool clear_all_bits) {
+  remembered_set_t *set = &heap->remembered_set;
+  if (clear_all_bits || set->has_overflowed) {
+    // We don't know which bits are set so the cheapest thing is to start over.
+    size_t bit_count = set->bits.length;
+    bit_vector_dispose(&set->bits);
+    TRY(bit_vector_init(&set->bits, bit_count, false));
+    for (large_object_t *large = heap->large_objects; large != NULL;
+        large = large->next)
+      large->is_remembered = false;
+  } else {
+    value_t *objects = remembered_set_objects(set);
+    for (size_t i = 0; i < set->length; i++) {
+      value_t object = objects[i];
+      if (heap_is_large_address(heap, get_heap_object_address(object))) {
+        get_large_object_header(object)->is_remembered = false;
+      } else {
+        bit_vector_set_at(&set->bits,
+            remembered_set_bit_index(&heap->to_space, object), false);
+      }
+    }
+  }
+  set->length = 0;
+  set->has_overflowed = false;
+  return success();
+}
+
+void heap_remember_object(heap_t *heap, value_t object) {
+  remembered_set_t *set = &heap->remembered_set;
+  address_t addr = get_heap_object_address(object);
+  if (heap_is_large_address(heap, addr)) {
+    // Large objects are outside to-space so they don't have a bit, the header
+    // records whether they're in the set instead.
+    large_object_t *large = get_large_object_header(object);
+    if (large->is_remembered)
+      return;
+    large->is_remembered = true;
+  } else {
+    CHECK_TRUE("remembering object outside to-space",
+        space_contains(&heap->to_space, addr));
+    size_t index = remembered_set_bit_index(&heap->to_space, object);
+    if (bit_vector_get_at(&set->bits, index))
+      return;
+    bit_vector_set_at(&set->bits, index, true);
+  }
+  if (set->length == kRememberedSetCapacity) {
+    // There's no room to record the object but setting the bit still saves us
+    // from coming back here every time it's written.
+    set->has_overflowed = true;
+    return;
+  }
+  remembered_set_objects(set)[set->length++] = object;
+}
+
+bool heap_is_object_remembered(heap_t *heap, value_t object) {
+  if (heap_is_large_address(heap, get_heap_object_address(object)))
+    return get_large_object_header(object)->is_remembered;
+  return bit_vector_get_at(&heap->remembered_set.bits,
+      remembered_set_bit_index(&heap->to_space, object));
+}
+
+value_t heap_for_each_remembered_object(heap_t *heap,
+    value_visitor_o *visitor) {
+  remembered_set_t *set = &heap->remembered_set;
+  CHECK_FALSE("iterating overflowed remembered set", set->has_overflowed);
+  value_t *objects = remembered_set_objects(set);
+  for (size_t i = 0; i < set->length; i++)
+    TRY(value_visitor_visit(visitor, objects[i]));
+  return success();
+}
+
+
+// --- R e p l i c a t i o n ---
+
+// The bit set in a replication table entry if the original has been written
+// since it was replicated.
+#define kReplicaDirtyBit ((address_arith_t) 1)
+
+// Adds the given object to the given log, returning false if there wasn't
+// memory for it.
+static bool object_log_add(object_log_t *log, value_t object) {
+  size_t capacity = log->memory.size / kValueSize;
+  if (log->length == capacity) {
+    size_t new_capacity = (capacity == 0) ? 64 : (2 * capacity);
+    blob_t new_memory = allocator_default_malloc(new_capacity * kValueSize);
+    if (blob_is_empty(new_memory))
+      return false;
+    if (capacity > 0) {
+      memcpy(new_memory.start, log->memory.start, log->length * kValueSize);
+      allocator_default_free(log->memory);
+    }
+    log->memory = new_memory;
+  }
+  object_log_objects(log)[log->length++] = object;
+  return true;
+}
+
+static void object_log_dispose(object_log_t *log) {
+  if (!blob_is_empty(log->memory))
+    allocator_default_free(log->memory);
+  log->memory = blob_empty();
+  log->length = 0;
+}
+
+// Resets the given replication state to having no collection in progress.
+// Doesn't release anything it holds.
+static void replication_clear(replication_t *replication) {
+  replication->state = rsIdle;
+  space_clear(&replication->space);
+  replication->scan = NULL;
+  replication->originals_start = replication->originals_limit = NULL;
+  replication->table = blob_empty();
+  replication->dirty.memory = replication->fixups.memory = blob_empty();
+  replication->dirty.length = replication->fixups.length = 0;
+  replication->has_failed = false;
+  replication->allocated_since_slice = 0;
+}
+
+// Releases the side data held by the given replication state and clears it.
+// The replica space is not touched, it's the caller's responsibility.
+static void replication_dispose(replication_t *replication) {
+  if (!blob_is_empty(replication->table))
+    system_memory_unmap(replication->table);
+  object_log_dispose(&replication->dirty);
+  object_log_dispose(&replication->fixups);
+  replication_clear(replication);
+}
+
+
+// --- S t a t s ---
+
+const char *get_gc_kind_name(gc_kind_t kind) {
+  switch (kind) {
+  case gkFull: return "full";
+  case gkNursery: return "nursery";
+  case gkIncremental: return "incremental";
+  default: return "?";
+  }
+}
+
+// Clears the given collection stats and sets them up for a collection of the
+// given kind.
+static void gc_collection_stats_reset(gc_collection_stats_t *stats,
+    gc_kind_t kind) {
+  memset(stats, 0, sizeof(gc_collection_stats_t));
+  stats->kind = kind;
+}
+
+// Starts the stats of a collection of the given kind which is about to collect
+// the given number of bytes.
+static void gc_stats_begin(gc_stats_t *stats, gc_kind_t kind,
+    size_t bytes_before) {
+  gc_collection_stats_t *current = &stats->current;
+  if (kind == gkIncremental) {
+    // The replication has already been recorded, what's left is the flip.
+    *current = stats->incremental;
+  } else {
+    gc_collection_stats_reset(current, kind);
+  }
+  current->bytes_before = bytes_before;
+  current->bytes_allocated = stats->bytes_allocated_since_gc;
+}
+
+void heap_end_gc_stats(heap_t *heap, uint64_t pause_micros) {
+  gc_stats_t *stats = &heap->stats;
+  gc_collection_stats_t *current = &stats->current;
+  current->pause_micros = pause_micros;
+  current->object_tracker_count = heap->object_tracker_count;
+  size_t copied = 0;
+  for (size_t i = 0; i < kGcFamilyStatsCount; i++)
+    copied += current->families[i].bytes;
+  current->bytes_copied = copied;
+  current->survival_percent = (current->bytes_before == 0)
+      ? 0
+      : (uint32_t) ((((uint64_t) copied) * 100) / current->bytes_before);
+  switch (current->kind) {
+  case gkFull: stats->full_count++; break;
+  case gkNursery: stats->nursery_count++; break;
+  case gkIncremental: stats->incremental_count++; break;
+  }
+  stats->total_pause_micros += pause_micros;
+  if (pause_micros > stats->max_pause_micros)
+    stats->max_pause_micros = pause_micros;
+  stats->total_bytes_allocated += stats->bytes_allocated_since_gc;
+  stats->total_bytes_copied += copied;
+  stats->bytes_allocated_since_gc = 0;
+  stats->last = *current;
+}
+
+
+// --- I d e n t i t y   h a s h e s ---
+
+// The size of an identity hash table when the first object is hashed.
+static const size_t kIdentityHashTableInitialCapacity = 256;
+
+static void identity_hash_table_clear(identity_hash_table_t *table) {
+  table->memory = blob_empty();
+  table->capacity = 0;
+  table->length = 0;
+  table->next_serial = 0;
+}
+
+static void identity_hash_table_dispose(identity_hash_table_t *table) {
+  if (!blob_is_empty(table->memory))
+    allocator_default_free(table->memory);
+  table->memory = blob_empty();
+  table->capacity = 0;
+  table->length = 0;
+}
+
+// Returns the array of entries in the given table.
+static identity_hash_entry_t *identity_hash_table_entries(
+    identity_hash_table_t *table) {
+  return (identity_hash_entry_t*) table->memory.start;
+}
+
+// Returns the entry that holds the given address in the given table or, if
+// there is none, the empty entry where it would go. The table must not be
+// full.
+static identity_hash_entry_t *identity_hash_table_find(
+    identity_hash_table_t *table, address_t addr) {
+  // Objects are aligned so the low bits carry no information; mix the rest
+  // such that neighbouring objects spread out over the table.
+  uint64_t hash = ((uint64_t) (address_arith_t) addr) / kValueSize;
+  hash = (hash ^ (hash >> 16)) * 0x9E3779B97F4A7C15ULL;
+  hash ^= hash >> 32;
+  size_t mask = table->capacity - 1;
+  identity_hash_entry_t *entries = identity_hash_table_entries(table);
+  size_t index = ((size_t) hash) & mask;
+  while (entries[index].address != NULL && entries[index].address != addr)
+    index = (index + 1) & mask;
+  return &entries[index];
+}
+
+// Makes the given table empty with room for the given number of entries, a
+// power of two, replacing the memory it had before.
+static value_t identity_hash_table_reset(identity_hash_table_t *table,
+    size_t capacity) {
+  blob_t memory = allocator_default_malloc(
+      capacity * sizeof(identity_hash_entry_t));
+  if (blob_is_empty(memory))
+    return new_system_call_failed_condition("malloc");
+  blob_fill(memory, 0);
+  if (!blob_is_empty(table->memory))
+    allocator_default_free(table->memory);
+  table->memory = memory;
+  table->capacity = capacity;
+  table->length = 0;
+  return success();
+}
+
+// Adds an entry for the given address, which must not be in the table
+// already, and which there must be room for.
+static void identity_hash_table_add(identity_hash_table_t *table,
+    address_t addr, uint64_t serial) {
+  identity_hash_entry_t *entry = identity_hash_table_find(table, addr);
+  CHECK_TRUE("identity hash already recorded", entry->address == NULL);
+  entry->address = addr;
+  entry->serial = serial;
+  table->length++;
+}
+
+// Returns the capacity a table needs to hold the given number of entries
+// while staying at most half full.
+static size_t identity_hash_table_capacity_for(size_t length) {
+  size_t capacity = kIdentityHashTableInitialCapacity;
+  while (capacity < (2 * length))
+    capacity <<= 1;
+  return capacity;
+}
+
+// Makes room for at least one more entry in the given table.
+static value_t identity_hash_table_ensure_room(identity_hash_table_t *table) {
+  if ((2 * (table->length + 1)) <= table->capacity)
+    return success();
+  // Move the entries out of the way and add them back into the new memory.
+  blob_t old_memory = table->memory;
+  size_t old_capacity = table->capacity;
+  table->memory = blob_empty();
+  value_t reset = identity_hash_table_reset(table,
+      identity_hash_table_capacity_for(table->length + 1));
+  if (is_condition(reset)) {
+    table->memory = old_memory;
+    return reset;
+  }
+  identity_hash_entry_t *old_entries = (identity_hash_entry_t*) old_memory.start;
+  for (size_t i = 0; i < old_capacity; i++) {
+    if (old_entries[i].address != NULL)
+      identity_hash_table_add(table, old_entries[i].address,
+          old_entries[i].serial);
+  }
+  if (!blob_is_empty(old_memory))
+    allocator_default_free(old_memory);
+  return success();
+}
+
+value_t heap_get_identity_hash(heap_t *heap, value_t object) {
+  identity_hash_table_t *table = &heap->identity_hashes;
+  address_t addr = get_heap_object_address(object);
+  if (table->length > 0) {
+    identity_hash_entry_t *entry = identity_hash_table_find(table, addr);
+    if (entry->address != NULL)
+      return new_integer(entry->serial);
+  }
+  TRY(identity_hash_table_ensure_room(table));
+  uint64_t serial = table->next_serial++;
+  identity_hash_table_add(table, addr, serial);
+  return new_integer(serial);
+}
+
+
 // --- H e a p ---
 
+// The number of claim bits stored in each word of a heap's claim bits.
+#define kClaimBitsPerWord (kValueSize * 8)
+
+// Returns the size of the largest object that will be allocated in the
+// nursery. Larger objects are allocated directly in to-space since they would
+// take up a lot of room in the nursery and are expensive to promote.
+static size_t heap_max_nursery_object_size(heap_t *heap) {
+  return (heap->nursery.limit - heap->nursery.start) / 8;
+}
+
+// Returns the largest size the semispaces of a heap with the given config and
+// nursery size may grow to. Both of them plus the nursery must fit within the
+// system memory limit but they're never smaller than their initial size.
+static size_t get_max_semispace_size(const extended_runtime_config_t *config,
+    size_t nursery_size) {
+  const neu_runtime_config_t *base = &config->base;
+  size_t limit = base->system_memory_limit;
+  size_t budget = (limit > nursery_size) ? ((limit - nursery_size) / 2) : 0;
+  size_t max = min_size(base->max_semispace_size_bytes, budget)
+      & ~(kValueSize - 1);
+  return max_size(max, base->semispace_size_bytes);
+}
+
 value_t heap_init(heap_t *heap, const extended_runtime_config_t *config) {
   // Initialize new space, leave old space clear; we won't use that until
   // later.
@@ -271,8 +905,45 @@ value_t heap_init(heap_t *heap, const extended_runtime_config_t *config) {
   heap->config = *config;
   TRY(space_init(&heap->to_space, config));
   space_clear(&heap->from_space);
-  // Initialize the object tracker loop using the dummy node.
-  heap->root_object_tracker.next = heap->root_object_tracker.prev = &heap->root_object_tracker;
+  TRY(space_init(&heap->spare_space, config));
+  size_t nursery_size = min_size(config->base.nursery_size_bytes,
+      config->base.semispace_size_bytes / 4);
+  heap->semispace_size = config->base.semispace_size_bytes;
+  heap->max_semispace_size = get_max_semispace_size(config, nursery_size);
+  if (nursery_size > 0) {
+    TRY(space_init_with_size(&heap->nursery, nursery_size));
+    // To-space may grow so the set is made big enough up front for the
+    // largest it can become.
+    TRY(remembered_set_init(&heap->remembered_set, heap->max_semispace_size));
+  } else {
+    space_clear(&heap->nursery);
+  }
+  heap->large_objects = NULL;
+  heap->large_object_count = 0;
+  heap->large_object_bytes = 0;
+  heap->large_object_bytes_since_gc = 0;
+  heap->grey_large_objects = NULL;
+  heap->promotion_start = NULL;
+  heap->needs_full_collection = false;
+  heap->claim_bits = blob_empty();
+  if (heap_gc_thread_count(heap) > 1) {
+    size_t word_count = (heap->max_semispace_size + nursery_size) / kValueSize;
+    size_t claim_words = (word_count + kClaimBitsPerWord - 1)
+        / kClaimBitsPerWord;
+    heap->claim_bits = allocator_default_malloc(claim_words * kValueSize);
+    if (blob_is_empty(heap->claim_bits))
+      return new_system_call_failed_condition("malloc");
+  }
+  heap->replication.is_enabled = false;
+  replication_clear(&heap->replication);
+  identity_hash_table_clear(&heap->identity_hashes);
+  memset(&heap->stats, 0, sizeof(gc_stats_t));
+  object_tracker_slab_init(&heap->object_tracker_slabs[0],
+      object_tracker_size(tfNone));
+  object_tracker_slab_init(&heap->object_tracker_slabs[1],
+      object_tracker_size(tfMaybeWeak));
+  object_tracker_slab_init(&heap->object_tracker_slabs[2],
+      object_tracker_size(tfFinalizeExplicit));
   heap->object_tracker_count = 0;
   heap->creator_ = native_thread_get_current_id();
   heap->backpointer_space = blob_empty();
@@ -283,7 +954,20 @@ bool heap_try_alloc(heap_t *heap, size_t size, address_t *memory_out) {
   IF_EXPENSIVE_CHECKS_ENABLED(CHECK_TRUE("accessing heap from other thread",
       native_thread_ids_equal(
           heap->creator_, native_thread_get_current_id())));
-  return space_try_alloc(&heap->to_space, size, memory_out);
+  if (!heap_has_nursery(heap))
+    return space_try_alloc(&heap->to_space, size, memory_out);
+  if (size <= heap_max_nursery_object_size(heap))
+    return space_try_alloc(&heap->nursery, size, memory_out);
+  if (!space_try_alloc(&heap->to_space, size, memory_out)) {
+    // Collecting the nursery won't make room for this so the next collection
+    // has to be a full one.
+    heap->needs_full_collection = true;
+    return false;
+  }
+  // The object is old from the start so it's remembered straight away, that
+  // way the stores that initialize it don't need to go through the barrier.
+  heap_remember_object(heap, new_heap_object(*memory_out));
+  return true;
 }
 
 value_t heap_dispose(heap_t *heap) {
@@ -293,6 +977,28 @@ value_t heap_dispose(heap_t *heap) {
     result = new_condition(ccValidationFailed);
   space_dispose(&heap->to_space);
   space_dispose(&heap->from_space);
+  space_dispose(&heap->spare_space);
+  if (heap_has_nursery(heap)) {
+    space_dispose(&heap->nursery);
+    remembered_set_dispose(&heap->remembered_set);
+  }
+  if (!blob_is_empty(heap->claim_bits)) {
+    allocator_default_free(heap->claim_bits);
+    heap->claim_bits = blob_empty();
+  }
+  if (heap->replication.state == rsReplicating)
+    space_dispose(&heap->replication.space);
+  replication_dispose(&heap->replication);
+  identity_hash_table_dispose(&heap->identity_hashes);
+  for (size_t i = 0; i < kObjectTrackerSlabCount; i++)
+    object_tracker_slab_dispose(&heap->object_tracker_slabs[i]);
+  large_object_t *large = heap->large_objects;
+  while (large != NULL) {
+    large_object_t *next = large->next;
+    system_memory_unmap(large->memory);
+    large = next;
+  }
+  heap->large_objects = NULL;
   return result;
 }
 
@@ -305,7 +1011,18 @@ value_t heap_for_each_object(heap_t *heap, value_visitor_o *visitor) {
     TRY(value_visitor_visit(visitor, current->value));
     object_tracker_iter_advance(&iter);
   }
-  return space_for_each_object(&heap->to_space, visitor);
+  return heap_for_each_allocated_object(heap, visitor);
+}
+
+value_t heap_for_each_allocated_object(heap_t *heap, value_visitor_o *visitor) {
+  CHECK_FALSE("traversing empty space", space_is_empty(&heap->to_space));
+  TRY(space_for_each_object(&heap->to_space, visitor));
+  if (heap_has_nursery(heap))
+    TRY(space_for_each_object(&heap->nursery, visitor));
+  for (large_object_t *large = heap->large_objects; large != NULL;
+      large = large->next)
+    TRY(value_visitor_visit(visitor, get_large_object_value(large)));
+  return success();
 }
 
 IMPLEMENTATION(field_delegator_o, value_visitor_o);
@@ -337,8 +1054,15 @@ static value_t field_delegator_visit(value_visitor_o *super_self, value_t object
 
 VTABLE(field_delegator_o, value_visitor_o) { field_delegator_visit };
 
-value_t heap_for_each_field(heap_t *heap, field_visitor_o *visitor,
-    bool include_weak) {
+value_t heap_object_for_each_field(value_t object, field_visitor_o *visitor) {
+  field_delegator_o delegator;
+  VTABLE_INIT(field_delegator_o, UPCAST(&delegator));
+  delegator.field_visitor = visitor;
+  return field_delegator_visit(UPCAST(&delegator), object);
+}
+
+value_t heap_for_each_object_tracker_field(heap_t *heap,
+    field_visitor_o *visitor, bool include_weak) {
   object_tracker_iter_t iter;
   object_tracker_iter_init(&iter, heap, include_weak);
   while (object_tracker_iter_has_current(&iter)) {
@@ -346,10 +1070,34 @@ value_t heap_for_each_field(heap_t *heap, field_visitor_o *visitor,
     field_visitor_visit(visitor, value_field_new(nothing(), &current->value));
     object_tracker_iter_advance(&iter);
   }
+  return success();
+}
+
+value_t heap_for_each_field(heap_t *heap, field_visitor_o *visitor,
+    bool include_weak) {
+  TRY(heap_for_each_object_tracker_field(heap, visitor, include_weak));
   field_delegator_o delegator;
   VTABLE_INIT(field_delegator_o, UPCAST(&delegator));
   delegator.field_visitor = visitor;
-  return space_for_each_object(&heap->to_space, UPCAST(&delegator));
+  // During a nursery collection the objects that were already in to-space are
+  // left alone, only the ones promoted by the collection need to be scanned.
+  address_t start = (heap->promotion_start == NULL)
+      ? heap->to_space.start
+      : heap->promotion_start;
+  while (true) {
+    TRY(space_for_each_object_from(&heap->to_space, start,
+        UPCAST(&delegator)));
+    // Scanning a large object may copy more objects into to-space so go back
+    // to scanning that after each one.
+    large_object_t *grey = heap->grey_large_objects;
+    if (grey == NULL)
+      return success();
+    heap->grey_large_objects = grey->next_grey;
+    grey->next_grey = NULL;
+    start = heap->to_space.next_free;
+    TRY(field_delegator_visit(UPCAST(&delegator),
+        get_large_object_value(grey)));
+  }
 }
 
 static value_t finalize_heap_object_explicit(object_tracker_t *raw_tracker) {
@@ -372,12 +1120,45 @@ void heap_trace_live_tracker(heap_t *heap, object_tracker_t *tracker, out_stream
     // Use the backpointer space to find the object that kept the current one
     // alive.
     address_t addr = get_heap_object_address(current);
+    if (!space_contains(&heap->to_space, addr))
+      // Large objects aren't migrated so there's no backpointer for them.
+      break;
     size_t offset = addr - heap->to_space.start;
     address_t back_addr = ((address_t) heap->backpointer_space.start) + offset;
     current = *((value_t*) back_addr);
   }
 }
 
+// Returns where the given object, which may or may not have survived the
+// collection in progress, lives once everything has been migrated: the object
+// itself if the collection doesn't move it, its new location if it has been
+// migrated, and nothing if it is garbage.
+static value_t heap_get_surviving_object(heap_t *heap, value_t object) {
+  address_t addr = get_heap_object_address(object);
+  if (heap_is_large_address(heap, addr)) {
+    // Large objects never move; they're alive if this is a nursery collection,
+    // which leaves them alone, or if they were marked.
+    if (space_is_empty(&heap->from_space)
+        || get_large_object_header(object)->mark != 0)
+      return object;
+    return nothing();
+  } else if (!heap_is_collecting_address(heap, addr)) {
+    // This is a nursery collection and the value is old so it is neither
+    // moved nor garbage.
+    return object;
+  }
+  value_t header = get_heap_object_header(object);
+  if (get_value_domain(header) == vdMovedObject) {
+    return get_moved_object_target(header);
+  } else if (heap_is_replica_original(heap, addr)) {
+    // An incremental collection doesn't forward the originals, the table is
+    // where to find the new location.
+    return heap_get_replica(heap, object);
+  } else {
+    return nothing();
+  }
+}
+
 value_t heap_post_process_object_trackers(heap_t *heap) {
   object_tracker_iter_t iter;
   object_tracker_iter_init(&iter, heap, true);
@@ -388,12 +1169,15 @@ value_t heap_post_process_object_trackers(heap_t *heap) {
     // as it's scanned past it.
     object_tracker_iter_advance(&iter);
     if (object_tracker_is_currently_weak(current)) {
-      value_t header = get_heap_object_header(current->value);
-      if (get_value_domain(header) == vdMovedObject) {
+      value_t target = heap_get_surviving_object(heap, current->value);
+      if (is_same_value(target, current->value)) {
+        // The value wasn't touched by this collection.
+        continue;
+      } else if (!is_nothing(target)) {
         // This is a weak reference whose value is still alive. Update the
         // value ref since the first pass will have skipped this and hence it
         // hasn't been updated yet.
-        current->value = get_moved_object_target(header);
+        current->value = target;
         if ((current->flags & tfTraceLiveness) != 0)
           heap_trace_live_tracker(heap, current, file_system_stdout(file_system_native()));
       } else {
@@ -417,6 +1201,42 @@ value_t heap_post_process_object_trackers(heap_t *heap) {
   return success();
 }
 
+value_t heap_post_process_identity_hashes(heap_t *heap) {
+  identity_hash_table_t *table = &heap->identity_hashes;
+  if (table->length == 0)
+    return success();
+  // Count the survivors first such that the new table can be sized to fit
+  // them, the old one may have been grown for objects that are now gone.
+  identity_hash_entry_t *old_entries = identity_hash_table_entries(table);
+  size_t old_capacity = table->capacity;
+  size_t survivor_count = 0;
+  for (size_t i = 0; i < old_capacity; i++) {
+    address_t addr = old_entries[i].address;
+    if (addr != NULL
+        && !is_nothing(heap_get_surviving_object(heap, new_heap_object(addr))))
+      survivor_count++;
+  }
+  blob_t old_memory = table->memory;
+  table->memory = blob_empty();
+  value_t reset = identity_hash_table_reset(table,
+      identity_hash_table_capacity_for(survivor_count));
+  if (is_condition(reset)) {
+    table->memory = old_memory;
+    return reset;
+  }
+  for (size_t i = 0; i < old_capacity; i++) {
+    address_t addr = old_entries[i].address;
+    if (addr == NULL)
+      continue;
+    value_t target = heap_get_surviving_object(heap, new_heap_object(addr));
+    if (!is_nothing(target))
+      identity_hash_table_add(table, get_heap_object_address(target),
+          old_entries[i].serial);
+  }
+  allocator_default_free(old_memory);
+  return success();
+}
+
 // Is there a action or side-effect associated with the value of this tracker
 // becoming garbage?
 static bool object_tracker_has_action_on_garbage(object_tracker_t *tracker) {
@@ -489,15 +1309,70 @@ static void heap_clear_maybe_weak_tracker_weakness(heap_t *heap) {
   }
 }
 
+// Unmaps the large objects that weren't marked by the full collection that's
+// completing and clears the marks of the rest.
+static void heap_sweep_large_objects(heap_t *heap) {
+  CHECK_TRUE("unscanned large objects", heap->grey_large_objects == NULL);
+  large_object_t **link = &heap->large_objects;
+  while (*link != NULL) {
+    large_object_t *large = *link;
+    if (large->mark != 0) {
+      large->mark = 0;
+      link = &large->next;
+    } else {
+      *link = large->next;
+      heap->large_object_count--;
+      heap->large_object_bytes -= large->memory.size;
+      system_memory_unmap(large->memory);
+    }
+  }
+  heap->large_object_bytes_since_gc = 0;
+}
+
+// Replaces the spare space with an empty one of the given size.
+static value_t heap_resize_spare_space(heap_t *heap, size_t size_bytes) {
+  space_dispose(&heap->spare_space);
+  return space_init_with_size(&heap->spare_space, size_bytes);
+}
+
+// Adjusts the size the heap wants its semispaces to have after a full
+// collection of a from-space with the given capacity, based on how much of it
+// survived into to-space. This only changes the target; the caller remaps the
+// spare space and to-space only gets the new size at the next flip, so until
+// then the heap keeps allocating within the old to-space.
+static void heap_update_semispace_size(heap_t *heap, size_t collected_capacity) {
+  const neu_runtime_config_t *config = &heap->config.base;
+  uint64_t survived = space_used(&heap->to_space);
+  uint64_t survival_percent = (survived * 100) / collected_capacity;
+  size_t current = heap->semispace_size;
+  if (survival_percent >= config->heap_grow_survival_percent) {
+    heap->semispace_size = min_size(2 * current, heap->max_semispace_size);
+  } else if (survival_percent < config->heap_shrink_survival_percent) {
+    heap->semispace_size = max_size(current / 2,
+        config->semispace_size_bytes);
+  }
+}
+
 value_t heap_prepare_garbage_collection(heap_t *heap) {
   CHECK_TRUE("from space not empty", space_is_empty(&heap->from_space));
   CHECK_FALSE("to space empty", space_is_empty(&heap->to_space));
-  // Move to-space to from-space so we have a handle on it for later.
+  CHECK_FALSE("spare space empty", space_is_empty(&heap->spare_space));
+  // Everything in the spaces being collected might survive so the new to-space
+  // should be able to hold it all, even if the heap has decided to shrink.
+  size_t collected = space_used(&heap->to_space);
+  if (heap_has_nursery(heap))
+    collected += space_used(&heap->nursery);
+  gc_stats_begin(&heap->stats, gkFull, collected);
+  collected = min_size(collected, heap->max_semispace_size);
+  if (space_capacity(&heap->spare_space) < collected)
+    TRY(heap_resize_spare_space(heap, collected));
+  // Move to-space to from-space so we have a handle on it for later and make
+  // the spare space, which is empty, the new to-space.
   heap->from_space = heap->to_space;
-  // Reset to-space so we can use the fields again.
-  space_clear(&heap->to_space);
-  // Then create a new empty to-space.
-  TRY(space_init(&heap->to_space, &heap->config));
+  heap->to_space = heap->spare_space;
+  space_clear(&heap->spare_space);
+  if (!blob_is_empty(heap->claim_bits))
+    blob_fill(heap->claim_bits, 0);
   TRY(heap_pre_process_object_trackers(heap));
   return success();
 }
@@ -506,12 +1381,402 @@ value_t heap_complete_garbage_collection(heap_t *heap) {
   CHECK_FALSE("from space empty", space_is_empty(&heap->from_space));
   CHECK_FALSE("to space empty", space_is_empty(&heap->to_space));
   heap_clear_maybe_weak_tracker_weakness(heap);
-  space_dispose(&heap->from_space);
+  // Keep from-space around as the spare for next time but let the system have
+  // its pages back until then.
+  space_discard(&heap->from_space);
+  heap->spare_space = heap->from_space;
+  space_clear(&heap->from_space);
+  heap_sweep_large_objects(heap);
+  heap_update_semispace_size(heap, space_capacity(&heap->spare_space));
+  if (space_capacity(&heap->spare_space) != heap->semispace_size)
+    TRY(heap_resize_spare_space(heap, heap->semispace_size));
+  if (heap_has_nursery(heap)) {
+    // Everything in the nursery has been moved too and the objects recorded in
+    // the remembered set were all in from-space.
+    space_reset(&heap->nursery);
+    TRY(remembered_set_clear(heap, true));
+    heap->needs_full_collection = false;
+  }
+  allocator_default_free(heap->backpointer_space);
+  heap->backpointer_space = blob_empty();
+  if (heap->replication.state == rsFlipping)
+    replication_dispose(&heap->replication);
+  return success();
+}
+
+bool heap_is_collecting_address(heap_t *heap, address_t addr) {
+  if (heap_is_young_address(heap, addr))
+    return true;
+  return !space_is_empty(&heap->from_space)
+      && space_contains(&heap->from_space, addr);
+}
+
+bool heap_is_large_address(heap_t *heap, address_t addr) {
+  // Every object is either in one of the spaces or in the large object space
+  // so there's no need to search through the large objects.
+  return (heap->large_objects != NULL)
+      && !heap_is_young_address(heap, addr)
+      && !space_spans(&heap->to_space, addr)
+      && !space_spans(&heap->from_space, addr)
+      && !space_spans(&heap->replication.space, addr);
+}
+
+// Returns how many bytes may be mapped for large objects, which is what the
+// system memory limit leaves after the semispaces and the nursery.
+static size_t heap_get_large_object_budget(heap_t *heap) {
+  size_t limit = heap->config.base.system_memory_limit;
+  size_t spaces = (2 * heap->semispace_size) + space_capacity(&heap->nursery);
+  return (limit > spaces) ? (limit - spaces) : 0;
+}
+
+bool heap_try_alloc_large(heap_t *heap, size_t size, address_t *memory_out) {
+  size_t header_size = get_large_object_header_size();
+  size_t mapping_size = header_size + align_size(kValueSize, size);
+  // Garbage large objects are only reclaimed by full collections so once a
+  // semispace's worth has been allocated since the last one it's time for
+  // another. The first allocation after a collection is allowed regardless so
+  // objects larger than that can still be allocated.
+  size_t since_gc = heap->large_object_bytes_since_gc;
+  bool is_due_for_gc = (since_gc > 0)
+      && (since_gc + mapping_size > heap->semispace_size);
+  bool is_over_budget = (heap->large_object_bytes + mapping_size)
+      > heap_get_large_object_budget(heap);
+  blob_t memory = (is_due_for_gc || is_over_budget)
+      ? blob_empty()
+      : system_memory_map(mapping_size);
+  if (blob_is_empty(memory)) {
+    heap->needs_full_collection = true;
+    return false;
+  }
+  large_object_t *large = (large_object_t*) memory.start;
+  large->next = heap->large_objects;
+  large->next_grey = NULL;
+  large->memory = memory;
+  // An incremental collection in progress won't get to see new large objects
+  // before it flips so they're kept alive by marking them up front.
+  large->mark = heap_is_replicating(heap) ? 1 : 0;
+  large->is_remembered = false;
+  heap->large_objects = large;
+  heap->large_object_count++;
+  heap->large_object_bytes += mapping_size;
+  heap->large_object_bytes_since_gc += mapping_size;
+  address_t addr = ((address_t) memory.start) + header_size;
+  IF_HEAP_ZAPPING_ENABLED(memset(addr, kAllocatedHeapMarker, size));
+  *memory_out = addr;
+  // Like objects allocated directly in to-space large objects are old from the
+  // start.
+  if (heap_has_nursery(heap))
+    heap_remember_object(heap, new_heap_object(addr));
+  return true;
+}
+
+bool heap_try_mark_large_object(heap_t *heap, value_t object) {
+  // Only full collections, which have a from-space, and incremental ones look
+  // at large objects. Nursery collections during an incremental collection
+  // leave them to it.
+  bool is_marking = !space_is_empty(&heap->from_space)
+      || (heap_is_replicating(heap) && (heap->promotion_start == NULL));
+  if (!is_marking
+      || !heap_is_large_address(heap, get_heap_object_address(object)))
+    return false;
+  large_object_t *large = get_large_object_header(object);
+  return (atomic_word_load(&large->mark) == 0)
+      && (atomic_word_compare_and_swap(&large->mark, 0, 1) == 0);
+}
+
+void heap_schedule_large_object_scan(heap_t *heap, value_t object) {
+  large_object_t *large = get_large_object_header(object);
+  large->next_grey = heap->grey_large_objects;
+  heap->grey_large_objects = large;
+}
+
+bool heap_try_claim_object(heap_t *heap, value_t object) {
+  CHECK_FALSE("no claim bits", blob_is_empty(heap->claim_bits));
+  address_t addr = get_heap_object_address(object);
+  size_t index;
+  if (heap_is_young_address(heap, addr)) {
+    size_t from_words = heap->max_semispace_size / kValueSize;
+    index = from_words + (addr - heap->nursery.start) / kValueSize;
+  } else {
+    CHECK_TRUE("claiming object not being collected",
+        space_contains(&heap->from_space, addr));
+    index = (addr - heap->from_space.start) / kValueSize;
+  }
+  volatile address_arith_t *word =
+      ((volatile address_arith_t*) heap->claim_bits.start)
+      + (index / kClaimBitsPerWord);
+  address_arith_t bit = ((address_arith_t) 1) << (index % kClaimBitsPerWord);
+  while (true) {
+    address_arith_t old_word = atomic_word_load(word);
+    if ((old_word & bit) != 0)
+      return false;
+    if (atomic_word_compare_and_swap(word, old_word, old_word | bit) == old_word)
+      return true;
+  }
+}
+
+bool heap_can_collect_nursery(heap_t *heap) {
+  if (!heap_has_nursery(heap)
+      || heap->needs_full_collection
+      || heap->remembered_set.has_overflowed)
+    return false;
+  // Promoting can't fail midway so there has to be room in to-space for
+  // everything in the nursery, just in case it all survives.
+  size_t young_size = heap->nursery.next_free - heap->nursery.start;
+  size_t old_free = heap->to_space.limit - heap->to_space.next_free;
+  return young_size <= old_free;
+}
+
+value_t heap_prepare_nursery_collection(heap_t *heap) {
+  CHECK_TRUE("can't collect nursery", heap_can_collect_nursery(heap));
+  CHECK_TRUE("from space not empty", space_is_empty(&heap->from_space));
+  heap->promotion_start = heap->to_space.next_free;
+  gc_stats_begin(&heap->stats, gkNursery, space_used(&heap->nursery));
+  TRY(heap_pre_process_object_trackers(heap));
+  return success();
+}
+
+value_t heap_complete_nursery_collection(heap_t *heap) {
+  CHECK_FALSE("no nursery collection", heap->promotion_start == NULL);
+  heap_clear_maybe_weak_tracker_weakness(heap);
+  space_reset(&heap->nursery);
+  TRY(remembered_set_clear(heap, false));
+  heap->promotion_start = NULL;
+  // If there's no longer room to promote a full nursery we'll need a full
+  // collection next time around.
+  size_t old_free = heap->to_space.limit - heap->to_space.next_free;
+  if (old_free < (size_t) (heap->nursery.limit - heap->nursery.start))
+    heap->needs_full_collection = true;
   allocator_default_free(heap->backpointer_space);
   heap->backpointer_space = blob_empty();
   return success();
 }
 
+bool heap_wants_replication(heap_t *heap) {
+  if (!heap->replication.is_enabled
+      || heap_is_replicating(heap)
+      || !space_is_empty(&heap->from_space)
+      || (heap->promotion_start != NULL))
+    return false;
+  // The replicas of everything in to-space and the nursery have to fit in the
+  // replica space and that can't be larger than the side tables allow.
+  size_t to_capacity = space_capacity(&heap->to_space);
+  if (to_capacity + space_capacity(&heap->nursery) > heap->max_semispace_size)
+    return false;
+  return space_used(&heap->to_space) >= (to_capacity / 2);
+}
+
+// Returns the table entry that records the replica of the object at the given
+// address, which must be an original.
+static address_arith_t *heap_get_replica_entry(heap_t *heap, address_t addr) {
+  CHECK_TRUE("not an original", heap_is_replica_original(heap, addr));
+  size_t index = (addr - heap->replication.originals_start) / kValueSize;
+  return ((address_arith_t*) heap->replication.table.start) + index;
+}
+
+value_t heap_start_replication(heap_t *heap) {
+  CHECK_FALSE("already replicating", heap_is_replicating(heap));
+  CHECK_TRUE("from space not empty", space_is_empty(&heap->from_space));
+  replication_t *replication = &heap->replication;
+  // Objects may be promoted into to-space while replicating so there has to
+  // be room for all of it, as well as the nursery which is replicated when
+  // the heap flips.
+  size_t to_capacity = space_capacity(&heap->to_space);
+  size_t needed = to_capacity + space_capacity(&heap->nursery);
+  if (space_capacity(&heap->spare_space) < needed)
+    TRY(heap_resize_spare_space(heap, needed));
+  // Mapping the table means that it starts out zero and that only the pages
+  // covering replicated objects are ever touched.
+  size_t table_size = (to_capacity / kValueSize) * sizeof(address_arith_t);
+  replication->table = system_memory_map(table_size);
+  if (blob_is_empty(replication->table))
+    return new_system_call_failed_condition("mmap");
+  replication->space = heap->spare_space;
+  space_clear(&heap->spare_space);
+  replication->scan = replication->space.start;
+  replication->originals_start = heap->to_space.start;
+  replication->originals_limit = heap->to_space.start + to_capacity;
+  replication->state = rsReplicating;
+  gc_collection_stats_reset(&heap->stats.incremental, gkIncremental);
+  return success();
+}
+
+// Unschedules the scans of all the large objects waiting to be scanned.
+static void heap_clear_grey_large_objects(heap_t *heap) {
+  while (heap->grey_large_objects != NULL) {
+    large_object_t *grey = heap->grey_large_objects;
+    heap->grey_large_objects = grey->next_grey;
+    grey->next_grey = NULL;
+  }
+}
+
+void heap_abort_replication(heap_t *heap) {
+  replication_t *replication = &heap->replication;
+  CHECK_TRUE("not replicating", replication->state == rsReplicating);
+  space_discard(&replication->space);
+  heap->spare_space = replication->space;
+  // The marks and the scans scheduled were all for this collection.
+  heap_clear_grey_large_objects(heap);
+  for (large_object_t *large = heap->large_objects; large != NULL;
+      large = large->next)
+    large->mark = 0;
+  replication_dispose(replication);
+}
+
+bool heap_is_replica_original(heap_t *heap, address_t addr) {
+  replication_t *replication = &heap->replication;
+  return (replication->state != rsIdle)
+      && (replication->originals_start <= addr)
+      && (addr < replication->originals_limit);
+}
+
+value_t heap_get_replica(heap_t *heap, value_t original) {
+  address_arith_t entry = *heap_get_replica_entry(heap,
+      get_heap_object_address(original));
+  if (entry == 0)
+    return nothing();
+  return new_heap_object((address_t) (entry & ~kReplicaDirtyBit));
+}
+
+value_t heap_replicate_object(heap_t *heap, value_t original, size_t size) {
+  address_arith_t *entry = heap_get_replica_entry(heap,
+      get_heap_object_address(original));
+  CHECK_EQ("already replicated", 0, *entry);
+  address_t target = NULL;
+  // The replica space has room for all of to-space and the nursery so this
+  // can't fail.
+  bool alloc_succeeded = space_try_alloc(heap_get_replica_space(heap), size,
+      &target);
+  CHECK_TRUE("replica alloc failed", alloc_succeeded);
+  memcpy(target, get_heap_object_address(original), size);
+  *entry = (address_arith_t) target;
+  value_t replica = new_heap_object(target);
+  // Once the heap has flipped the stats of the replication have become the
+  // current ones.
+  gc_collection_stats_t *stats = heap_is_replicating(heap)
+      ? &heap->stats.incremental
+      : &heap->stats.current;
+  gc_family_stats_record(stats->families, replica, size);
+  return replica;
+}
+
+void heap_record_replica_write(heap_t *heap, value_t object) {
+  address_t addr = get_heap_object_address(object);
+  if (!heap_is_replica_original(heap, addr))
+    // Young and large objects don't have replicas before the heap flips.
+    return;
+  address_arith_t *entry = heap_get_replica_entry(heap, addr);
+  if ((*entry == 0) || ((*entry & kReplicaDirtyBit) != 0))
+    return;
+  *entry |= kReplicaDirtyBit;
+  if (!object_log_add(&heap->replication.dirty, object))
+    heap->replication.has_failed = true;
+}
+
+value_t heap_record_replica_fixup(heap_t *heap, value_t original) {
+  if (!object_log_add(&heap->replication.fixups, original))
+    return new_system_call_failed_condition("malloc");
+  return success();
+}
+
+space_t *heap_get_replica_space(heap_t *heap) {
+  replication_t *replication = &heap->replication;
+  CHECK_TRUE("not replicating", heap_is_replicating(heap));
+  return (replication->state == rsReplicating)
+      ? &replication->space
+      : &heap->to_space;
+}
+
+bool heap_is_replication_complete(heap_t *heap) {
+  return (heap->replication.scan == heap_get_replica_space(heap)->next_free)
+      && (heap->grey_large_objects == NULL);
+}
+
+bool heap_take_grey_large_object(heap_t *heap, value_t *object_out) {
+  large_object_t *grey = heap->grey_large_objects;
+  if (grey == NULL)
+    return false;
+  heap->grey_large_objects = grey->next_grey;
+  grey->next_grey = NULL;
+  *object_out = get_large_object_value(grey);
+  return true;
+}
+
+value_t heap_flip_replication(heap_t *heap) {
+  replication_t *replication = &heap->replication;
+  CHECK_TRUE("not replicating", replication->state == rsReplicating);
+  size_t collected = space_used(&heap->to_space);
+  if (heap_has_nursery(heap))
+    collected += space_used(&heap->nursery);
+  gc_stats_begin(&heap->stats, gkIncremental, collected);
+  heap->from_space = heap->to_space;
+  heap->to_space = replication->space;
+  space_clear(&replication->space);
+  replication->state = rsFlipping;
+  // The large objects that have been scanned already were scanned without
+  // updating their fields, and may have been written since, so they all have
+  // to be scanned again now.
+  heap_clear_grey_large_objects(heap);
+  for (large_object_t *large = heap->large_objects; large != NULL;
+      large = large->next) {
+    if (large->mark != 0)
+      heap_schedule_large_object_scan(heap, get_large_object_value(large));
+  }
+  TRY(heap_pre_process_object_trackers(heap));
+  return success();
+}
+
+IMPLEMENTATION(remembered_set_validator_o, value_visitor_o);
+
+// Visitor that checks that objects pointing into the nursery are remembered.
+struct remembered_set_validator_o {
+  IMPLEMENTATION_HEADER(remembered_set_validator_o, value_visitor_o);
+  heap_t *heap;
+};
+
+// Returns true if the given value points into the nursery of the given heap.
+static bool is_young_value(heap_t *heap, value_t value) {
+  value_domain_t domain = get_value_domain(value);
+  return (domain == vdHeapObject || domain == vdDerivedObject)
+      && heap_is_young_address(heap,
+          (address_t) value_to_pointer_bit_cast(value));
+}
+
+static value_t remembered_set_validator_visit(value_visitor_o *super_self,
+    value_t object) {
+  remembered_set_validator_o *self = DOWNCAST(remembered_set_validator_o,
+      super_self);
+  if (heap_is_object_remembered(self->heap, object))
+    return success();
+  COND_CHECK_FALSE("young species not remembered", ccValidationFailed,
+      is_young_value(self->heap, get_heap_object_header(object)));
+  value_field_iter_t iter;
+  value_field_iter_init(&iter, object);
+  value_field_t field = value_field_empty();
+  while (value_field_iter_next(&iter, &field))
+    COND_CHECK_FALSE("young value not remembered", ccValidationFailed,
+        is_young_value(self->heap, *field.ptr));
+  return success();
+}
+
+VTABLE(remembered_set_validator_o, value_visitor_o) {
+  remembered_set_validator_visit
+};
+
+value_t heap_validate_remembered_set(heap_t *heap) {
+  if (!heap_has_nursery(heap) || heap->remembered_set.has_overflowed)
+    return success();
+  remembered_set_validator_o validator;
+  VTABLE_INIT(remembered_set_validator_o, UPCAST(&validator));
+  validator.heap = heap;
+  TRY(space_for_each_object(&heap->to_space, UPCAST(&validator)));
+  for (large_object_t *large = heap->large_objects; large != NULL;
+      large = large->next)
+    TRY(value_visitor_visit(UPCAST(&validator),
+        get_large_object_value(large)));
+  return success();
+}
+
 void value_field_iter_init(value_field_iter_t *iter, value_t value) {
   iter->value = value;
   if (!is_heap_object(value)) {
@@ -549,3 +1814,50 @@ size_t value_field_iter_offset(value_field_iter_t *iter, value_t value) {
   // to go back one step from the current next.
   return (iter->next - start) - kValueSize;
 }
+
+
+// --- S y s t e m   m e m o r y ---
+
+// This comes last because the windows headers, which mingw builds also use in
+// place of mmap, should be included as late as possible.
+#ifdef _WIN32
+#  include "c/winhdr.h"
+
+static blob_t system_memory_map(size_t size) {
+  void *start = VirtualAlloc(NULL, size, MEM_RESERVE | MEM_COMMIT,
+      PAGE_READWRITE);
+  return (start == NULL) ? blob_empty() : blob_new(start, size);
+}
+
+static void system_memory_unmap(blob_t memory) {
+  VirtualFree(memory.start, 0, MEM_RELEASE);
+}
+
+static void system_memory_discard(address_t start, address_t limit) {
+  // Unlike MADV_DONTNEED, reset pages keep their old contents unless the
+  // system reclaims them before they're touched again.
+  if (limit > start)
+    VirtualAlloc(start, limit - start, MEM_RESET, PAGE_READWRITE);
+}
+
+#else
+#  include <sys/mman.h>
+
+static blob_t system_memory_map(size_t size) {
+  void *start = mmap(NULL, size, PROT_READ | PROT_WRITE,
+      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  return (start == MAP_FAILED) ? blob_empty() : blob_new(start, size);
+}
+
+static void system_memory_unmap(blob_t memory) {
+  munmap(memory.start, memory.size);
+}
+
+static void system_memory_discard(address_t start, address_t limit) {
+  // The length gets rounded up to whole pages, which is fine since the rest of
+  // the last page is unused too.
+  if (limit > start)
+    madvise(start, limit - start, MADV_DONTNEED);
+}
+
+#endif
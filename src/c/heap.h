@@ -15,11 +15,20 @@
 #include "utils/ook.h"
 #include "value.h"
 
+#ifdef IS_MSVC
+#  include <intrin.h>
+#endif
+
 
 static const byte_t kUnusedHeapMarker = 0xA4;
 static const byte_t kAllocatedHeapMarker = 0xB4;
 static const byte_t kFreedHeapMarker = 0xC4;
 
+// Heap memory is only cleared to the markers above when checks are enabled.
+// Filling touches every page of a space so doing it on every collection in a
+// release build would cost more than the copying itself.
+#define IF_HEAP_ZAPPING_ENABLED(EXPR) IF_CHECKS_ENABLED(EXPR)
+
 FORWARD(c_object_info_t);
 
 // A runtime config with some additional extensions for the public api bindings
@@ -91,6 +100,53 @@ struct field_visitor_o {
 // Invokes the given callback with the given value.
 value_t field_visitor_visit(field_visitor_o *self, value_field_t field);
 
+
+// --- A t o m i c s ---
+
+// The few atomic word operations needed by parallel collections. The sync
+// library only does atomic counters so these are inlined here rather than
+// adding general support for something only the gc needs.
+
+// Atomically stores the desired value at the given location if it currently
+// holds the expected one. Returns the value that was there before, so the
+// store happened if and only if the result equals the expected value. This is
+// a full barrier.
+static inline address_arith_t atomic_word_compare_and_swap(
+    volatile address_arith_t *ptr, address_arith_t expected,
+    address_arith_t desired) {
+#if defined(IS_MSVC) && defined(IS_64_BIT)
+  return (address_arith_t) _InterlockedCompareExchange64(
+      (volatile __int64*) ptr, (__int64) desired, (__int64) expected);
+#elif defined(IS_MSVC)
+  return (address_arith_t) _InterlockedCompareExchange(
+      (volatile long*) ptr, (long) desired, (long) expected);
+#else
+  return __sync_val_compare_and_swap(ptr, expected, desired);
+#endif
+}
+
+// Reads the value at the given location such that nothing written before it
+// was stored by another thread through atomic_word_store is missed.
+static inline address_arith_t atomic_word_load(volatile address_arith_t *ptr) {
+#ifdef IS_MSVC
+  // Volatile accesses have acquire/release semantics under msvc.
+  return *ptr;
+#else
+  return __atomic_load_n(ptr, __ATOMIC_ACQUIRE);
+#endif
+}
+
+// Stores a value at the given location such that everything this thread wrote
+// before is visible to a thread that reads the value with atomic_word_load.
+static inline void atomic_word_store(volatile address_arith_t *ptr,
+    address_arith_t value) {
+#ifdef IS_MSVC
+  *ptr = value;
+#else
+  __atomic_store_n(ptr, value, __ATOMIC_RELEASE);
+#endif
+}
+
 // Returns a pointer to a runtime config that holds the default values.
 const extended_runtime_config_t *extended_runtime_config_get_default();
 
@@ -104,8 +160,9 @@ typedef struct {
   // First address past the end of this space. This may not be value pointer
   // aligned.
   address_t limit;
-  // The memory to free when disposing this space. The start address may point
-  // somewhere inside this memory so we can't free that directly.
+  // The memory mapped for this space, to be unmapped when disposing it. Empty
+  // for spaces that don't own their memory, like buffers carved out of other
+  // spaces.
   blob_t memory;
 } space_t;
 
@@ -141,25 +198,361 @@ address_t align_address(address_arith_t alignment, address_t ptr);
 // Returns true if the given address is within the given space.
 bool space_contains(space_t *space, address_t addr);
 
-// A full garbage-collectable heap.
+// Invokes the given callback for each object in the space from the given
+// address, which must be the start of an object, and onwards. Like
+// space_for_each_object it is safe to allocate while traversing.
+value_t space_for_each_object_from(space_t *space, address_t start,
+    value_visitor_o *visitor);
+
+// Clears the contents of the given space so it can be allocated in again from
+// the beginning.
+void space_reset(space_t *space);
+
+// Like space_reset but also gives the pages back to the system while keeping
+// the address range. They're mapped in again when next touched, with contents
+// that are no more reliable than after space_reset. Use for spaces that will
+// stay unused for a while.
+void space_discard(space_t *space);
+
+// Like space_try_alloc but safe to call from several threads at the same time.
+// Doesn't clear the memory.
+bool space_try_alloc_shared(space_t *space, size_t size, address_t *memory_out);
+
+// Carves a buffer out of the given space, which may be shared between threads,
+// that the calling thread can then allocate in using space_try_alloc without
+// synchronizing. The buffer gets the given size if there's room, otherwise
+// what's left of the space as long as that's at least min_bytes. Returns false
+// if there isn't even room for that.
+bool space_try_alloc_buffer(space_t *space, size_t size, size_t min_bytes,
+    space_t *buffer_out);
+
+// Marks the part of the given buffer that hasn't been allocated as unused such
+// that it is skipped when traversing the space the buffer was carved from,
+// then clears the buffer.
+void space_retire_buffer(space_t *buffer);
+
+
+// --- R e m e m b e r e d   s e t ---
+
+// The max number of objects that can be recorded in a remembered set. If more
+// old objects than this are written between two collections the next one has
+// to be a full collection.
+static const size_t kRememberedSetCapacity = 4096;
+
+// The set of objects in to-space that may hold pointers into the nursery.
+typedef struct {
+  // One bit per word in to-space, set for the address of each object in the
+  // set such that each object is recorded at most once.
+  bit_vector_t bits;
+  // The backing store for the recorded objects.
+  blob_t memory;
+  // The number of objects recorded.
+  size_t length;
+  // Set if more objects were recorded than there was room for.
+  bool has_overflowed;
+} remembered_set_t;
+
+
+// --- L a r g e   o b j e c t s ---
+
+// The header of an object in the large object space. Each large object gets a
+// mapping of its own which starts with this header, immediately followed by
+// the object.
+typedef struct large_object_t {
+  // The next object in the heap's list of large objects.
+  struct large_object_t *next;
+  // During a serial full collection, the next marked object whose fields are
+  // waiting to be scanned.
+  struct large_object_t *next_grey;
+  // The mapping holding this header and the object.
+  blob_t memory;
+  // Nonzero if the object has been reached by the full collection currently
+  // in progress. Set atomically since parallel workers race to mark.
+  volatile address_arith_t mark;
+  // Is the object recorded in the remembered set?
+  bool is_remembered;
+} large_object_t;
+
+
+// --- O b j e c t   t r a c k e r s ---
+
+// The number of object trackers in each chunk of a tracker slab.
+static const size_t kObjectTrackerChunkSize = 256;
+
+// The number of tracker slabs, one for each size of tracker.
+#define kObjectTrackerSlabCount 3
+
+// The object trackers of one size. Trackers are allocated from fixed-size
+// chunks which are kept until the heap is disposed, such that protecting and
+// unprotecting a value doesn't go through malloc and the gc can scan the
+// trackers chunk by chunk. Free trackers are linked together through their
+// value fields.
 typedef struct {
+  // The size of the trackers in this slab.
+  size_t tracker_size;
+  // The chunks, an array of chunk_capacity pointers of which the first
+  // chunk_count are in use.
+  blob_t chunks;
+  size_t chunk_count;
+  size_t chunk_capacity;
+  // The first free tracker, NULL if there are none.
+  object_tracker_t *free_list;
+} object_tracker_slab_t;
+
+
+// --- R e p l i c a t i o n ---
+
+// The states an incremental collection goes through.
+typedef enum {
+  // There is no incremental collection in progress.
+  rsIdle,
+  // Objects are being copied into the replica space in slices while the
+  // mutator keeps running on the originals.
+  rsReplicating,
+  // The mutator is stopped and the heap is switching over to the replicas.
+  rsFlipping
+} replication_state_t;
+
+// A growable list of objects.
+typedef struct {
+  // The backing store, empty until the first object is added.
+  blob_t memory;
+  // The number of objects in the list.
+  size_t length;
+} object_log_t;
+
+// Returns the array of objects recorded in the given log.
+static inline value_t *object_log_objects(object_log_t *log) {
+  return (value_t*) log->memory.start;
+}
+
+// The state of an incremental collection. Unlike a full collection, which
+// moves the objects and leaves forward pointers in their headers, an
+// incremental collection leaves the objects in to-space alone and copies them
+// into the spare space, recording where each copy went in a side table. That
+// way the mutator can keep running on the originals between the slices of
+// copying without any read barrier. Stores into originals that have already
+// been copied are logged by the write barrier and the copies refreshed when
+// the heap flips over to them, which happens during a short pause.
+typedef struct {
+  // Is incremental collection enabled? It is turned on by the runtime once it
+  // has been initialized.
+  bool is_enabled;
+  // What stage the current collection, if any, is in.
+  replication_state_t state;
+  // The space the replicas are copied into while replicating.
+  space_t space;
+  // The next replica whose fields haven't been scanned.
+  address_t scan;
+  // The range of to-space being replicated.
+  address_t originals_start;
+  address_t originals_limit;
+  // For each word of to-space the address of the replica of the object that
+  // starts there, or zero if it hasn't been replicated. The lowest bit is set
+  // if the original has been written since it was replicated.
+  blob_t table;
+  // The originals that have been written since they were replicated.
+  object_log_t dirty;
+  // The originals whose replicas need a post-migrate fixup.
+  object_log_t fixups;
+  // Set if the write barrier couldn't log a store, in which case the
+  // collection has to be abandoned.
+  bool has_failed;
+  // Bytes allocated since the last slice.
+  size_t allocated_since_slice;
+} replication_t;
+
+
+// --- I d e n t i t y   h a s h e s ---
+
+// An entry in an identity hash table.
+typedef struct {
+  // The address of the object, NULL if the entry is empty.
+  address_t address;
+  // The serial number the object was given when it was first hashed.
+  uint64_t serial;
+} identity_hash_entry_t;
+
+// The side table that gives heap objects hashes that stay the same when they
+// move. The first time an object is hashed by identity it is given the next
+// serial number, which is recorded in the table under its address. After each
+// collection the table is rebuilt under the objects' new addresses, dropping
+// the ones that didn't survive, so maps keyed by those objects don't have to be
+// rehashed. That costs time proportional to the number of objects that have
+// been hashed rather than to the number of maps they've been used in.
+typedef struct {
+  // The entries, empty until the first object is hashed.
+  blob_t memory;
+  // The number of entries; always a power of two.
+  size_t capacity;
+  // The number of entries in use.
+  size_t length;
+  // The serial number to give the next object that is hashed.
+  uint64_t next_serial;
+} identity_hash_table_t;
+
+
+// --- S t a t s ---
+
+// The kinds of garbage collection.
+typedef enum {
+  // A full collection done in one go.
+  gkFull,
+  // A collection of just the nursery.
+  gkNursery,
+  // A full collection done incrementally. The copying it did while replicating
+  // is included in its stats but its pause is just that of the flip.
+  gkIncremental
+} gc_kind_t;
+
+// Returns the string name of the given kind of collection.
+const char *get_gc_kind_name(gc_kind_t kind);
+
+// The number of entries in the per-family tables of gc stats. Must be larger
+// than any family ordinal.
+#define kGcFamilyStatsCount 128
+
+// How many objects of a particular family a collection copied and how many
+// bytes they took up.
+typedef struct {
+  size_t count;
+  size_t bytes;
+} gc_family_stats_t;
+
+// Statistics about a single garbage collection.
+typedef struct {
+  // What kind of collection this was.
+  gc_kind_t kind;
+  // How long the program was paused by the collection, in microseconds.
+  uint64_t pause_micros;
+  // Bytes allocated between the previous collection and this one.
+  size_t bytes_allocated;
+  // Bytes in use in the spaces being collected when the collection started.
+  size_t bytes_before;
+  // Bytes copied by the collection, that is, the size of what survived it.
+  // Large objects aren't copied so they don't count.
+  size_t bytes_copied;
+  // The percentage of bytes_before that survived.
+  uint32_t survival_percent;
+  // The number of object trackers after the collection.
+  size_t object_tracker_count;
+  // The number of post-migrate fixups applied.
+  size_t fixup_count;
+  // For incremental collections, the number of slices of replication and the
+  // time spent in them in microseconds.
+  size_t slice_count;
+  uint64_t slice_micros;
+  // The objects copied, indexed by family ordinal.
+  gc_family_stats_t families[kGcFamilyStatsCount];
+} gc_collection_stats_t;
+
+// Statistics about all the garbage collections done by a heap.
+typedef struct {
+  // The number of collections of each kind.
+  size_t full_count;
+  size_t nursery_count;
+  size_t incremental_count;
+  // The sum of all pauses and the longest one, in microseconds.
+  uint64_t total_pause_micros;
+  uint64_t max_pause_micros;
+  // The total number of bytes allocated and copied.
+  uint64_t total_bytes_allocated;
+  uint64_t total_bytes_copied;
+  // Bytes allocated since the last collection.
+  size_t bytes_allocated_since_gc;
+  // The stats of the most recent collection.
+  gc_collection_stats_t last;
+  // The stats of the collection in progress.
+  gc_collection_stats_t current;
+  // The stats of the incremental collection in progress, which become the
+  // current ones when the heap flips.
+  gc_collection_stats_t incremental;
+} gc_stats_t;
+
+// Records in the given family table that the given object, which has just been
+// copied, was copied. This is called on the copy, not the original, since the
+// original's header may have been replaced with a forward pointer. Its species
+// may have been moved but its fields will still be intact.
+static inline void gc_family_stats_record(gc_family_stats_t *families,
+    value_t copy, size_t size) {
+  size_t ordinal = ((size_t) get_heap_object_family(copy)) >> kDomainTagSize;
+  CHECK_REL("family ordinal too large", ordinal, <, kGcFamilyStatsCount);
+  families[ordinal].count++;
+  families[ordinal].bytes += size;
+}
+
+
+// --- H e a p ---
+
+// A full garbage-collectable heap.
+//
+// If the config gives the heap a nursery it is generational: new objects are
+// allocated in the nursery and the survivors of a nursery collection are
+// promoted into to-space, which holds the old generation. Only a full
+// collection copies the old generation. Stores of young values into old
+// objects are recorded in the remembered set by the write barrier such that a
+// nursery collection can find them without scanning to-space.
+struct heap_t {
   // The space configuration this heap gets it settings from.
   extended_runtime_config_t config;
-  // The space where we allocate new objects.
+  // The space where we allocate new objects if there is no nursery and where
+  // old objects live if there is.
   space_t to_space;
   // The space that, during gc, holds existing object and from which values are
   // copied into to-space.
   space_t from_space;
-  // A the object trackers are kept in a linked list cycle where this node is
-  // always linked in.
-  object_tracker_t root_object_tracker;
+  // The semispace that isn't in use between collections. The next full
+  // collection flips it with to-space so the semispaces are only mapped once.
+  space_t spare_space;
+  // The size the heap currently wants its semispaces to have. It is adjusted
+  // after each full collection depending on how much survived. The spare space
+  // is remapped when its size is different so to-space follows one collection
+  // later.
+  size_t semispace_size;
+  // The largest size the semispaces are allowed to grow to.
+  size_t max_semispace_size;
+  // The objects in the large object space, which are allocated individually
+  // and never moved.
+  large_object_t *large_objects;
+  // The number of large objects and how many bytes are mapped for them.
+  size_t large_object_count;
+  size_t large_object_bytes;
+  // The number of bytes mapped for large objects since the last full
+  // collection.
+  size_t large_object_bytes_since_gc;
+  // During a serial full collection, the marked large objects whose fields
+  // haven't been scanned yet.
+  large_object_t *grey_large_objects;
+  // The space where new objects are allocated. Empty if the heap isn't
+  // generational.
+  space_t nursery;
+  // The objects in to-space that may point into the nursery.
+  remembered_set_t remembered_set;
+  // While a nursery collection is running this is where the objects promoted
+  // by it start in to-space; otherwise it is null.
+  address_t promotion_start;
+  // Set when something happened that a nursery collection can't deal with,
+  // for instance an allocation directly in to-space failing.
+  bool needs_full_collection;
+  // The object trackers, one slab for each size.
+  object_tracker_slab_t object_tracker_slabs[kObjectTrackerSlabCount];
   // The number of object trackers allocated.
   size_t object_tracker_count;
   // The thread that created this heap.
   native_thread_id_t creator_;
   // If we're recording backpointers this blob is where they'll be recorded.
   blob_t backpointer_space;
-} heap_t;
+  // If full collections use more than one thread this is where the threads
+  // claim the objects they migrate: one bit for each word of from-space
+  // followed by one for each word of the nursery. Empty otherwise.
+  blob_t claim_bits;
+  // The incremental collection state.
+  replication_t replication;
+  // The identity hashes given out to the objects in this heap.
+  identity_hash_table_t identity_hashes;
+  // Statistics about the collections done so far.
+  gc_stats_t stats;
+};
 
 // Initialize the given heap, returning a condition to indicate success or
 // failure. If the config is NULL the default is used.
@@ -174,17 +567,233 @@ bool heap_try_alloc(heap_t *heap, size_t size, address_t *memory_out);
 // Invokes the given callback for each object in the heap.
 value_t heap_for_each_object(heap_t *heap, value_visitor_o *visitor);
 
+// Invokes the given callback for each object allocated in the heap's spaces,
+// including the large objects. Unlike heap_for_each_object this doesn't also
+// visit the values held by object trackers so each object is visited exactly
+// once, whether it is still reachable or not.
+value_t heap_for_each_allocated_object(heap_t *heap, value_visitor_o *visitor);
+
 // Invokes the given callback for each object field in the space. It is safe to
 // allocate new object while traversing the space, new objects will have their
 // fields visited in order of allocation. The include_weak flag controls whether
-// weak references are visited.
+// weak references are visited. During a nursery collection only the objects
+// promoted by the collection are visited, not all of to-space. During a full
+// collection the large objects scheduled for scanning along the way are
+// visited too.
 value_t heap_for_each_field(heap_t *heap, field_visitor_o *visitor,
     bool include_weak);
 
+// Invokes the given callback for each field of the given object, including
+// the header.
+value_t heap_object_for_each_field(value_t object, field_visitor_o *visitor);
+
+// Returns true if the heap allocates new objects in a nursery.
+static inline bool heap_has_nursery(heap_t *heap) {
+  return heap->nursery.next_free != NULL;
+}
+
+// Returns true if the given address is within the nursery. Always false if the
+// heap has no nursery.
+static inline bool heap_is_young_address(heap_t *heap, address_t addr) {
+  return (heap->nursery.start <= addr) && (addr < heap->nursery.limit);
+}
+
+// Returns true if the object at the given address is being collected by the
+// collection currently in progress, that is, if it must be migrated to survive.
+bool heap_is_collecting_address(heap_t *heap, address_t addr);
+
+// Returns true if objects of the given size that can live in the large object
+// space should be allocated there.
+static inline bool heap_is_large_object_size(heap_t *heap, size_t size) {
+  size_t threshold = heap->config.base.large_object_size_bytes;
+  return (threshold > 0) && (size >= threshold);
+}
+
+// Allocates room for an object of the given size in the large object space.
+// Returns false if the space is full or if enough has been allocated since
+// the last full collection that it's time for another, in which case the next
+// collection will be a full one.
+bool heap_try_alloc_large(heap_t *heap, size_t size, address_t *memory_out);
+
+// Returns true if the given address, which must be that of an object in this
+// heap, is in the large object space.
+bool heap_is_large_address(heap_t *heap, address_t addr);
+
+// During a full collection, marks the given object if it is in the large
+// object space and hasn't been marked yet. If this call did mark it the result
+// is true and the caller is responsible for having its fields scanned. Safe to
+// call from several threads at the same time.
+bool heap_try_mark_large_object(heap_t *heap, value_t object);
+
+// Schedules the fields of the given large object, which has just been marked,
+// to be scanned by the heap_for_each_field that's in progress.
+void heap_schedule_large_object_scan(heap_t *heap, value_t object);
+
+// Returns the number of threads that should work on full collections.
+static inline size_t heap_gc_thread_count(heap_t *heap) {
+  return max_size(heap->config.base.gc_thread_count, 1);
+}
+
+// Atomically claims the given object, which must be being collected, for the
+// calling thread during a parallel collection. Returns true if this call
+// claimed it; false if it had been claimed already, in which case the claiming
+// thread will forward the object to its new location.
+bool heap_try_claim_object(heap_t *heap, value_t object);
+
+// Invokes the given callback for each field of the heap's object trackers. The
+// include_weak flag controls whether weak references are visited.
+value_t heap_for_each_object_tracker_field(heap_t *heap,
+    field_visitor_o *visitor, bool include_weak);
+
+// Records the given object, which must be in to-space or the large object
+// space, in the remembered set.
+// This is the slow case of the write barrier.
+void heap_remember_object(heap_t *heap, value_t object);
+
+// Returns true if the given object is recorded in the remembered set.
+bool heap_is_object_remembered(heap_t *heap, value_t object);
+
+// Invokes the given callback for each object in the remembered set.
+value_t heap_for_each_remembered_object(heap_t *heap,
+    value_visitor_o *visitor);
+
+// Records that the given object has been written while an incremental
+// collection is replicating, such that its replica gets refreshed before the
+// heap flips. Objects that haven't been replicated yet are ignored since they
+// will be copied as they are whenever they are.
+// This is the slow case of the write barrier during incremental collections.
+void heap_record_replica_write(heap_t *heap, value_t object);
+
+// Must be called after storing a value in a field of an existing object by any
+// means other than the setters, which do it themselves. If the object is old
+// and the value young the object is recorded such that the next nursery
+// collection will update the field. While an incremental collection is
+// replicating every store is recorded, whatever the value. This is inline
+// because it sits on every store and the common cases, storing an immediate or
+// storing into a young object, are cheap to rule out.
+static inline void heap_object_write_barrier(value_t self, value_t value) {
+  value_t species = get_heap_object_species(self);
+  if (get_value_domain(species) != vdHeapObject)
+    // The object is still being bootstrapped; it can't be old yet.
+    return;
+  heap_t *heap = get_species_heap(species);
+  if (heap->replication.state == rsReplicating)
+    heap_record_replica_write(heap, self);
+  value_domain_t domain = get_value_domain(value);
+  if (domain != vdHeapObject && domain != vdDerivedObject)
+    return;
+  address_t target = (address_t) value_to_pointer_bit_cast(value);
+  if (heap_is_young_address(heap, target)
+      && !heap_is_young_address(heap, get_heap_object_address(self)))
+    heap_remember_object(heap, self);
+}
+
+// Write barrier for code that stores directly into an object's memory, where
+// it's impractical to apply the barrier to each store. Records the object if
+// it is old regardless of what gets stored.
+static inline void heap_object_bulk_write_barrier(value_t self) {
+  heap_t *heap = get_species_heap(get_heap_object_species(self));
+  if (heap->replication.state == rsReplicating)
+    heap_record_replica_write(heap, self);
+  if (heap_has_nursery(heap)
+      && !heap_is_young_address(heap, get_heap_object_address(self)))
+    heap_remember_object(heap, self);
+}
+
+// Returns true if the heap is in a state where a nursery collection can be
+// used to free up space. If not a full collection is required.
+bool heap_can_collect_nursery(heap_t *heap);
+
+// The number of bytes to allocate between two slices of incremental
+// collection.
+static const size_t kReplicationSliceBytes = 32 * kKB;
+
+// Counts the given number of allocated bytes towards the next slice of
+// incremental collection. Returns true if it's time for the slice, or, if
+// there is no collection in progress, to consider starting one.
+static inline bool heap_tick_replication(heap_t *heap, size_t bytes) {
+  replication_t *replication = &heap->replication;
+  // Finalizers may allocate while a collection is running but that's not the
+  // time for incremental work.
+  if (!replication->is_enabled
+      || (replication->state == rsFlipping)
+      || !space_is_empty(&heap->from_space)
+      || (heap->promotion_start != NULL))
+    return false;
+  replication->allocated_since_slice += bytes;
+  if (replication->allocated_since_slice < kReplicationSliceBytes)
+    return false;
+  replication->allocated_since_slice = 0;
+  return true;
+}
+
+// Returns true if there is an incremental collection in progress.
+static inline bool heap_is_replicating(heap_t *heap) {
+  return heap->replication.state != rsIdle;
+}
+
+// Returns true if incremental collection is enabled and there is none in
+// progress but to-space has filled up enough that it's time to start one.
+bool heap_wants_replication(heap_t *heap);
+
+// Starts an incremental collection of to-space and, if there is one, the
+// nursery. The spare space must be empty.
+value_t heap_start_replication(heap_t *heap);
+
+// Abandons the incremental collection in progress, dropping the replicas.
+void heap_abort_replication(heap_t *heap);
+
+// Returns true if the given address is in the part of to-space that the
+// incremental collection in progress is replicating.
+bool heap_is_replica_original(heap_t *heap, address_t addr);
+
+// Returns the replica of the given original, nothing if it hasn't been
+// replicated.
+value_t heap_get_replica(heap_t *heap, value_t original);
+
+// Copies the given original, which has the given size and hasn't been
+// replicated, into the replica space and returns the copy.
+value_t heap_replicate_object(heap_t *heap, value_t original, size_t size);
+
+// Records that the replica of the given original must have its post-migrate
+// fixup applied once the heap flips.
+value_t heap_record_replica_fixup(heap_t *heap, value_t original);
+
+// Returns the space the replicas are copied into. That's the replica space
+// while replicating and to-space once the heap has flipped.
+space_t *heap_get_replica_space(heap_t *heap);
+
+// Returns true if every replica and every marked large object has had its
+// fields scanned.
+bool heap_is_replication_complete(heap_t *heap);
+
+// If there are large objects waiting to have their fields scanned, takes the
+// next one, stores it in the out parameter, and returns true.
+bool heap_take_grey_large_object(heap_t *heap, value_t *object_out);
+
+// Prepares the heap for switching over to the replicas. The replica space
+// becomes to-space and the originals become from-space such that the rest
+// of the collection can proceed like a full one, completed by
+// heap_complete_garbage_collection. Every marked large object is scheduled to
+// be scanned again since they may have been written since they were scanned.
+value_t heap_flip_replication(heap_t *heap);
+
 // Update the state of trackers post migration but before the gc has been
 // finalized.
 value_t heap_post_process_object_trackers(heap_t *heap);
 
+// Returns the identity hash of the given object, which must be in this heap,
+// giving it one if it doesn't have one yet. Unlike the address the hash stays
+// the same for as long as the object is alive. Returns a condition if there is
+// no memory to record a new hash.
+value_t heap_get_identity_hash(heap_t *heap, value_t object);
+
+// Moves the identity hashes of the objects that survived the collection in
+// progress to their new addresses and drops those of the ones that didn't.
+// Must be called once everything has been migrated but before any fixups,
+// which may depend on the hashes, are applied.
+value_t heap_post_process_identity_hashes(heap_t *heap);
+
 // Returns true if the heap, in its current state, must be garbage collected
 // before it can be disposed.
 bool heap_collect_before_dispose(heap_t *heap);
@@ -204,6 +813,23 @@ value_t heap_prepare_garbage_collection(heap_t *heap);
 // Wraps up an in-progress garbage collection by discarding from-space.
 value_t heap_complete_garbage_collection(heap_t *heap);
 
+// Prepares this heap for a nursery collection which will promote the objects
+// that survive from the nursery into to-space.
+value_t heap_prepare_nursery_collection(heap_t *heap);
+
+// Wraps up an in-progress nursery collection by clearing the nursery.
+value_t heap_complete_nursery_collection(heap_t *heap);
+
+// Completes the stats of the collection that has just been completed, given
+// how many microseconds it paused the program, and adds them to the totals. Preparing a
+// collection, or flipping an incremental one, starts the stats.
+void heap_end_gc_stats(heap_t *heap, uint64_t pause_micros);
+
+// Checks that every object in to-space that points into the nursery has been
+// recorded by the write barrier. This scans all of to-space so it's only
+// meant for validation.
+value_t heap_validate_remembered_set(heap_t *heap);
+
 // Returns the size in bytes of an object tracker with the given set of flags.
 size_t object_tracker_size(uint32_t flags);
 
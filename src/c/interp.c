@@ -20,6 +20,11 @@ typedef struct {
   blob_t bytecode;
   // The pool of constant values used by the bytecode.
   value_t value_pool;
+  // The elements of the value pool.
+  value_t *values;
+  // Has the code been verified? If so every operation's operands can be read
+  // without bounds checks.
+  bool is_verified;
 } code_cache_t;
 
 // Updates the code cache according to the given frame. This must be called each
@@ -29,6 +34,8 @@ static void code_cache_refresh(code_cache_t *cache, frame_t *frame) {
   value_t bytecode = get_code_block_bytecode(code_block);
   cache->bytecode = get_blob_data(bytecode);
   cache->value_pool = get_code_block_value_pool(code_block);
+  cache->values = get_array_start(cache->value_pool);
+  cache->is_verified = get_code_block_is_verified(code_block);
 }
 
 // Records the current state of the given frame in the given escape state object
@@ -68,12 +75,16 @@ static void restore_escape_state(frame_t *frame, value_t stack,
 
 // Returns the short value at the given offset from the current pc.
 static short_t read_short(code_cache_t *cache, frame_t *frame, size_t offset) {
+  if (cache->is_verified)
+    return ((short_t*) cache->bytecode.start)[frame->pc + offset];
   return blob_short_at(cache->bytecode, frame->pc + offset);
 }
 
 // Returns the value at the given offset from the current pc.
 static value_t read_value(code_cache_t *cache, frame_t *frame, size_t offset) {
   size_t index = read_short(cache, frame, offset);
+  if (cache->is_verified)
+    return cache->values[index];
   return get_array_at(cache->value_pool, index);
 }
 
@@ -104,6 +115,207 @@ static value_t ensure_method_code(runtime_t *runtime, value_t method) {
   return code;
 }
 
+/// ## Inline caches
+///
+/// Each invoke operation has its own inline cache, a freeze cheat in the value
+/// pool, that remembers the results of previous lookups at that site. The cache
+/// is an array whose first element is the methodspace epoch it was populated
+/// under, followed by up to kInlineCacheCapacity entries. Each entry is an array
+/// holding the methodspace that was looked through, the resulting method and
+/// argument map, the identity mask of the lookup's footprint, and then one key
+/// per argument: the argument itself if it's in the identity mask, otherwise
+/// its primary type.
+
+// The max number of entries in an inline cache. Once a cache is full the site
+// is considered megamorphic and no more entries are added until the cache is
+// flushed.
+#define kInlineCacheCapacity 4
+
+// The max number of arguments an invocation can have and still be cached. The
+// identity mask has one bit per argument so invocations with more arguments
+// than that are always looked up.
+#define kInlineCacheMaxArgc 31
+
+static const size_t kInlineCacheEpochIndex = 0;
+static const size_t kInlineCacheFirstEntryIndex = 1;
+
+static const size_t kInlineCacheEntryMethodspaceIndex = 0;
+static const size_t kInlineCacheEntryMethodIndex = 1;
+static const size_t kInlineCacheEntryArgumentMapIndex = 2;
+static const size_t kInlineCacheEntryIdentityMaskIndex = 3;
+static const size_t kInlineCacheEntryFirstKeyIndex = 4;
+
+// Returns the key the given argument is identified by in an inline cache entry.
+static value_t get_inline_cache_key(runtime_t *runtime, value_t value,
+    bool use_identity) {
+  return use_identity ? value : get_primary_type(value, runtime);
+}
+
+// Returns true if the given inline cache is valid under the current
+// methodspace epoch.
+static bool is_inline_cache_current(runtime_t *runtime, value_t inline_cache) {
+  value_t epoch = get_array_at(inline_cache, kInlineCacheEpochIndex);
+  return get_integer_value(epoch) == (int64_t) runtime->methodspace_epoch;
+}
+
+// Returns the entry of the given inline cache that matches the invocation
+// pending on the given frame, or nothing if there is none.
+static value_t inline_cache_lookup(runtime_t *runtime, value_t inline_cache,
+    value_t space, value_t tags, frame_t *frame) {
+  if (is_nothing(inline_cache) || !is_inline_cache_current(runtime, inline_cache))
+    return nothing();
+  size_t argc = (size_t) get_call_tags_entry_count(tags);
+  if (argc > kInlineCacheMaxArgc)
+    return nothing();
+  int64_t length = get_array_length(inline_cache);
+  for (int64_t i = kInlineCacheFirstEntryIndex; i < length; i++) {
+    value_t entry = get_array_at(inline_cache, i);
+    if (is_null(entry))
+      // Entries are added in order so the rest will be empty too.
+      break;
+    value_t entry_space = get_array_at(entry, kInlineCacheEntryMethodspaceIndex);
+    if (!is_same_value(space, entry_space))
+      continue;
+    value_t mask_value = get_array_at(entry, kInlineCacheEntryIdentityMaskIndex);
+    uint32_t identity_mask = (uint32_t) get_integer_value(mask_value);
+    bool is_match = true;
+    for (size_t j = 0; j < argc && is_match; j++) {
+      value_t arg = frame_get_pending_argument_at(frame, tags, j);
+      value_t key = get_inline_cache_key(runtime, arg,
+          (identity_mask & (1u << j)) != 0);
+      value_t entry_key = get_array_at(entry, kInlineCacheEntryFirstKeyIndex + j);
+      is_match = is_same_value(key, entry_key);
+    }
+    if (is_match)
+      return entry;
+  }
+  return nothing();
+}
+
+// Records the result of a lookup of the invocation pending on the given frame
+// in the inline cache held by the given freeze cheat.
+static value_t inline_cache_add(runtime_t *runtime, value_t cache_ptr,
+    value_t space, value_t tags, frame_t *frame, value_t method,
+    value_t arg_map, lookup_footprint_t *footprint) {
+  CHECK_TRUE("caching uncacheable", footprint->is_cacheable);
+  size_t argc = (size_t) get_call_tags_entry_count(tags);
+  if (argc > kInlineCacheMaxArgc)
+    return success();
+  value_t inline_cache = get_freeze_cheat_value(cache_ptr);
+  if (is_nothing(inline_cache) || !is_inline_cache_current(runtime, inline_cache)) {
+    // Either this is the first lookup at this site or the methodspaces have
+    // changed since the cache was populated. Either way we start over.
+    TRY_SET(inline_cache, new_heap_array(runtime,
+        kInlineCacheFirstEntryIndex + kInlineCacheCapacity));
+    set_array_at(inline_cache, kInlineCacheEpochIndex,
+        new_integer((int64_t) runtime->methodspace_epoch));
+    set_freeze_cheat_value(cache_ptr, inline_cache);
+  }
+  int64_t length = get_array_length(inline_cache);
+  int64_t slot = kInlineCacheFirstEntryIndex;
+  while (slot < length && !is_null(get_array_at(inline_cache, slot)))
+    slot++;
+  if (slot == length)
+    // The cache is full; this site is megamorphic.
+    return success();
+  TRY_DEF(entry, new_heap_array(runtime, kInlineCacheEntryFirstKeyIndex + argc));
+  set_array_at(entry, kInlineCacheEntryMethodspaceIndex, space);
+  set_array_at(entry, kInlineCacheEntryMethodIndex, method);
+  set_array_at(entry, kInlineCacheEntryArgumentMapIndex, arg_map);
+  set_array_at(entry, kInlineCacheEntryIdentityMaskIndex,
+      new_integer(footprint->identity_mask));
+  for (size_t j = 0; j < argc; j++) {
+    value_t arg = frame_get_pending_argument_at(frame, tags, j);
+    value_t key = get_inline_cache_key(runtime, arg,
+        (footprint->identity_mask & (1u << j)) != 0);
+    if (is_condition(key))
+      // If we can't key on this argument we just don't cache it.
+      return success();
+    set_array_at(entry, kInlineCacheEntryFirstKeyIndex + j, key);
+  }
+  set_array_at(inline_cache, slot, entry);
+  return success();
+}
+
+// Returns true if the given inline cache holds exactly one entry.
+static bool is_inline_cache_monomorphic(value_t inline_cache) {
+  return !is_null(get_array_at(inline_cache, kInlineCacheFirstEntryIndex))
+      && is_null(get_array_at(inline_cache, kInlineCacheFirstEntryIndex + 1));
+}
+
+/// ## Quickening
+///
+/// An invoke site whose inline cache has settled on a single frameless builtin
+/// gets rewritten in place into an InvokeBuiltin operation which calls the
+/// builtin's implementation directly on the arguments on the caller's stack,
+/// without pushing a frame. The operation uses the site's inline cache as its
+/// type guard and rewrites itself back into a plain invoke if the guard fails.
+///
+/// Tail invoke sites are quickened the same way, into TailInvokeBuiltin. Since
+/// no frame is pushed there's nothing to replace; the result is pushed just
+/// like for InvokeBuiltin and the return that follows every tail invoke
+/// returns it. The only difference is that it goes back to being a tail
+/// invoke if the guard fails.
+
+// Replaces the opcode at the current pc. Bytecode is frozen as far as the rest
+// of the system is concerned; this is only safe because the quickened and
+// generic operations are interchangeable.
+static void rewrite_opcode(code_cache_t *cache, frame_t *frame, opcode_t opcode) {
+  ((short_t*) cache->bytecode.start)[frame->pc] = (short_t) opcode;
+}
+
+// Returns true if the given method can be invoked through a quickened
+// invoke operation.
+static bool is_method_quickenable(value_t method) {
+  return get_flag_set_at(get_method_flags(method), mfFrameless);
+}
+
+// Returns the implementation of a frameless builtin given its code block.
+static builtin_implementation_t get_frameless_builtin_implementation(
+    value_t code_block) {
+  blob_t bytecode = get_blob_data(get_code_block_bytecode(code_block));
+  CHECK_EQ("frameless not builtin", ocBuiltin, blob_short_at(bytecode, 0));
+  size_t index = blob_short_at(bytecode, 1);
+  value_t wrapper = get_array_at(get_code_block_value_pool(code_block), index);
+  return (builtin_implementation_t) get_void_p_value(wrapper);
+}
+
+/// ## Tail calls
+///
+/// Invocations whose result is immediately returned are emitted as tail
+/// invokes which replace the caller's frame instead of pushing a new one on top
+/// of it. The codegen only emits them where nothing else happens between the
+/// invocation and the return, so there are no barriers, blocks, or escapes
+/// belonging to the frame that's being replaced.
+///
+/// Whether a frame is replaced depends only on the frame making the call, never
+/// on the method being called or how full the stack is. The caller's pc keeps
+/// pointing to the invocation that pushed the replaced frame so a frame pushed
+/// by a tail call records its own call tags in its header, which is where
+/// argument reification and backtraces get them from.
+
+// Returns true if the given frame has barriers that are still live.
+static bool frame_has_live_barriers(value_t stack, frame_t *frame) {
+  value_t barrier = get_stack_top_barrier(stack);
+  if (is_nothing(barrier))
+    return false;
+  if (!is_same_value(get_derived_object_host(barrier), frame->stack_piece))
+    return false;
+  value_t *location = (value_t*) get_derived_object_address(barrier);
+  return location >= frame->frame_pointer;
+}
+
+// Returns true if the given frame can be replaced by the frame of a tail call
+// it's making.
+static bool can_tail_call(value_t stack, frame_t *frame) {
+  // Only organic frames have headers that can be reused.
+  if (!frame_has_flag(frame, ffOrganic))
+    return false;
+  // This should be impossible given how tail invokes are emitted but better
+  // safe than sorry.
+  return !frame_has_live_barriers(stack, frame);
+}
+
 // Reports a lookup error as if it were a signal. It's not one that can be
 // caught though, it's mainly a trick to get the stack trace when lookup fails.
 static value_t signal_lookup_error(runtime_t *runtime, value_t stack, frame_t *frame) {
@@ -156,6 +368,11 @@ static bool maybe_fire_next_barrier(code_cache_t *cache, frame_t *frame,
 }
 
 static always_inline value_t get_caller_call_tags(frame_t *callee) {
+  // If the callee was pushed by a tail call the caller's pc points to the
+  // invocation it replaced, not the one that pushed it.
+  value_t tail_call_tags = frame_get_tail_call_tags(callee);
+  if (!is_nothing(tail_call_tags))
+    return tail_call_tags;
   // Get access to the caller's frame.
   frame_iter_t iter = frame_iter_from_frame(callee);
   bool advanced = frame_iter_advance(&iter);
@@ -217,6 +434,46 @@ static uint64_t interrupt_counter = 0;
   }                                                                            \
 } while (false)
 
+// Reads the opcode at the current pc into the opcode variable. This also
+// takes care of the bookkeeping that happens before each operation.
+#define FETCH_OPCODE() do {                                                    \
+  opcode = (opcode_t) read_short(&cache, &frame, 0);                           \
+  TOPIC_INFO(Interpreter, "Opcode: %s (%i)", get_opcode_name(opcode),          \
+      ++opcode_counter);                                                       \
+  IF_EXPENSIVE_CHECKS_ENABLED(MAYBE_INTERRUPT());                              \
+} while (false)
+
+// The interpreter loop can dispatch in two ways. By default it uses a plain
+// switch but if the compiler supports labels-as-values (gcc and clang do) it
+// threads through a table of label addresses built from ENUM_OPCODES instead,
+// such that each operation jumps directly to the next. That gives each
+// operation its own indirect branch which is a lot easier on the branch
+// predictor than funneling everything through the one in the switch. Define
+// NO_THREADED_DISPATCH to force the switch.
+#if defined(__GNUC__) && !defined(NO_THREADED_DISPATCH)
+#  define USE_THREADED_DISPATCH 1
+#else
+#  define USE_THREADED_DISPATCH 0
+#endif
+
+#if USE_THREADED_DISPATCH
+// Jumps to the implementation of the given opcode.
+#  define DISPATCH(OPCODE)                                                     \
+  CHECK_REL("invalid opcode", (size_t) (OPCODE), <, kDispatchTableSize);       \
+  goto *kDispatchTable[(OPCODE)];
+// Marks the start of the implementation of the given opcode.
+#  define DISPATCH_CASE(Name) op_##Name
+// Moves on to the next operation when the current one is done.
+#  define DISPATCH_NEXT() do {                                                 \
+  FETCH_OPCODE();                                                              \
+  DISPATCH(opcode)                                                             \
+} while (false)
+#else
+#  define DISPATCH(OPCODE) switch (OPCODE)
+#  define DISPATCH_CASE(Name) case oc##Name
+#  define DISPATCH_NEXT() break
+#endif
+
 // Runs the given task within the given ambience until a condition is
 // encountered or evaluation completes. This function also bails on and leaves
 // it to the surrounding code to report error messages.
@@ -230,33 +487,48 @@ static value_t run_task_pushing_signals(value_t ambience, value_t task) {
   code_cache_t cache;
   code_cache_refresh(&cache, &frame);
   TRY_FINALLY {
+#if USE_THREADED_DISPATCH
+    static void *const kDispatchTable[] = {
+#define __EMIT_LABEL_ADDRESS__(Name, ARGC) &&op_##Name,
+      ENUM_OPCODES(__EMIT_LABEL_ADDRESS__)
+#undef __EMIT_LABEL_ADDRESS__
+    };
+    static const size_t kDispatchTableSize =
+        sizeof(kDispatchTable) / sizeof(*kDispatchTable);
+#endif
+    opcode_t opcode;
     while (true) {
-      opcode_t opcode = (opcode_t) read_short(&cache, &frame, 0);
-      TOPIC_INFO(Interpreter, "Opcode: %s (%i)", get_opcode_name(opcode),
-          ++opcode_counter);
-      IF_EXPENSIVE_CHECKS_ENABLED(MAYBE_INTERRUPT());
-      switch (opcode) {
-        case ocPush: {
+      FETCH_OPCODE();
+      DISPATCH(opcode) {
+        DISPATCH_CASE(Push): {
           value_t value = read_value(&cache, &frame, 1);
           frame_push_value(&frame, value);
           frame.pc += kPushOperationSize;
-          break;
+          DISPATCH_NEXT();
+        }
+        DISPATCH_CASE(PushPair): {
+          value_t first = read_value(&cache, &frame, 1);
+          value_t second = read_value(&cache, &frame, 2);
+          frame_push_value(&frame, first);
+          frame_push_value(&frame, second);
+          frame.pc += kPushPairOperationSize;
+          DISPATCH_NEXT();
         }
-        case ocPop: {
+        DISPATCH_CASE(Pop): {
           size_t count = read_short(&cache, &frame, 1);
           for (size_t i = 0; i < count; i++)
             frame_pop_value(&frame);
           frame.pc += kPopOperationSize;
-          break;
+          DISPATCH_NEXT();
         }
-        case ocCheckStackHeight: {
+        DISPATCH_CASE(CheckStackHeight): {
           size_t expected = read_short(&cache, &frame, 1);
           size_t height = frame.stack_pointer - frame.frame_pointer;
           CHECK_EQ("stack height", expected, height);
           frame.pc += kCheckStackHeightOperationSize;
-          break;
+          DISPATCH_NEXT();
         }
-        case ocNewArray: {
+        DISPATCH_CASE(NewArray): {
           size_t length = read_short(&cache, &frame, 1);
           E_TRY_DEF(array, new_heap_array(runtime, length));
           for (size_t i = 0; i < length; i++) {
@@ -265,9 +537,9 @@ static value_t run_task_pushing_signals(value_t ambience, value_t task) {
           }
           frame_push_value(&frame, array);
           frame.pc += kNewArrayOperationSize;
-          break;
+          DISPATCH_NEXT();
         }
-        case ocInvoke: {
+        DISPATCH_CASE(Invoke): DISPATCH_CASE(TailInvoke): {
           // Look up the method in the method space.
           value_t tags = read_value(&cache, &frame, 1);
           CHECK_FAMILY(ofCallTags, tags);
@@ -275,15 +547,56 @@ static value_t run_task_pushing_signals(value_t ambience, value_t task) {
           CHECK_FAMILY_OPT(ofModuleFragment, fragment);
           value_t next_guards = read_value(&cache, &frame, 3);
           CHECK_FAMILY_OPT(ofArray, next_guards);
-          value_t arg_map;
-          sigmap_input_layout_t layout = sigmap_input_layout_new(ambience, tags,
-              next_guards);
-          value_t method = lookup_method_full_from_frame(&layout, &frame, &arg_map);
-          if (in_condition_cause(ccLookupError, method))
-            E_RETURN(signal_lookup_error(runtime, stack, &frame));
-          // The lookup may have failed with a different condition. Check for that.
-          E_TRY(method);
+          value_t cache_ptr = read_value(&cache, &frame, 4);
+          CHECK_FAMILY(ofFreezeCheat, cache_ptr);
+          value_t space = get_ambience_methodspace(ambience);
+          value_t method = whatever();
+          value_t arg_map = whatever();
+          value_t entry = inline_cache_lookup(runtime,
+              get_freeze_cheat_value(cache_ptr), space, tags, &frame);
+          if (is_nothing(entry)) {
+            // Cache miss; do the full lookup.
+            sigmap_input_layout_t layout = sigmap_input_layout_new(ambience,
+                tags, next_guards);
+            lookup_footprint_t footprint;
+            method = lookup_method_full_from_frame_with_footprint(&layout,
+                &frame, &arg_map, &footprint);
+            if (in_condition_cause(ccLookupError, method))
+              E_RETURN(signal_lookup_error(runtime, stack, &frame));
+            // The lookup may have failed with a different condition. Check
+            // for that.
+            E_TRY(method);
+            if (footprint.is_cacheable)
+              E_TRY(inline_cache_add(runtime, cache_ptr, space, tags, &frame,
+                  method, arg_map, &footprint));
+          } else {
+            method = get_array_at(entry, kInlineCacheEntryMethodIndex);
+            arg_map = get_array_at(entry, kInlineCacheEntryArgumentMapIndex);
+            if (is_method_quickenable(method)
+                && is_inline_cache_monomorphic(get_freeze_cheat_value(cache_ptr))) {
+              // This site has hit the same frameless builtin more than once
+              // and nothing else; quicken it and let the quickened operation
+              // do the call.
+              rewrite_opcode(&cache, &frame, (opcode == ocTailInvoke)
+                  ? ocTailInvokeBuiltin
+                  : ocInvokeBuiltin);
+              DISPATCH_NEXT();
+            }
+          }
           E_TRY_DEF(code_block, ensure_method_code(runtime, method));
+          if (opcode == ocTailInvoke && can_tail_call(stack, &frame)) {
+            // Replace the current frame rather than pushing a new one on top.
+            // If there's no room on this stack piece we fall through and do a
+            // normal invocation which knows how to get more room.
+            size_t argc = (size_t) get_call_tags_entry_count(tags);
+            if (try_push_tail_frame(&frame,
+                (size_t) get_code_block_high_water_mark(code_block), argc,
+                arg_map, tags)) {
+              frame_set_code_block(&frame, code_block);
+              code_cache_refresh(&cache, &frame);
+              DISPATCH_NEXT();
+            }
+          }
           // Optimistically advance the pc to the operation we'll return to
           // after this invocation, since the pc will be captured by pushing
           // the new frame. If pushing fails we rewind.
@@ -299,9 +612,42 @@ static value_t run_task_pushing_signals(value_t ambience, value_t task) {
           }
           frame_set_code_block(&frame, code_block);
           code_cache_refresh(&cache, &frame);
-          break;
+          DISPATCH_NEXT();
+        }
+        DISPATCH_CASE(InvokeBuiltin): DISPATCH_CASE(TailInvokeBuiltin): {
+          value_t tags = read_value(&cache, &frame, 1);
+          CHECK_FAMILY(ofCallTags, tags);
+          value_t cache_ptr = read_value(&cache, &frame, 4);
+          CHECK_FAMILY(ofFreezeCheat, cache_ptr);
+          value_t space = get_ambience_methodspace(ambience);
+          value_t entry = inline_cache_lookup(runtime,
+              get_freeze_cheat_value(cache_ptr), space, tags, &frame);
+          if (is_nothing(entry)
+              || !is_method_quickenable(get_array_at(entry, kInlineCacheEntryMethodIndex))) {
+            // The guard failed so this site is no longer monomorphic, or the
+            // cache has been flushed. Go back to the generic invoke which will
+            // take it from here.
+            rewrite_opcode(&cache, &frame, (opcode == ocTailInvokeBuiltin)
+                ? ocTailInvoke
+                : ocInvoke);
+            DISPATCH_NEXT();
+          }
+          value_t method = get_array_at(entry, kInlineCacheEntryMethodIndex);
+          value_t arg_map = get_array_at(entry, kInlineCacheEntryArgumentMapIndex);
+          E_TRY_DEF(code_block, ensure_method_code(runtime, method));
+          builtin_implementation_t impl =
+              get_frameless_builtin_implementation(code_block);
+          builtin_arguments_t args;
+          builtin_arguments_init_direct(&args, runtime, &frame, process, arg_map);
+          E_TRY_DEF(result, impl(&args));
+          // Leave the arguments on the stack, just like returning from a
+          // normal invocation would. For a tail invoke the return that
+          // follows takes care of returning the result.
+          frame_push_value(&frame, result);
+          frame.pc += kInvokeBuiltinOperationSize;
+          DISPATCH_NEXT();
         }
-        case ocSignalContinue: case ocSignalEscape: {
+        DISPATCH_CASE(SignalContinue): DISPATCH_CASE(SignalEscape): {
           // Look up the method in the method space.
           value_t tags = read_value(&cache, &frame, 1);
           CHECK_FAMILY(ofCallTags, tags);
@@ -341,15 +687,30 @@ static value_t run_task_pushing_signals(value_t ambience, value_t task) {
             frame_set_argument(&frame, 0, handler);
             code_cache_refresh(&cache, &frame);
           }
-          break;
+          DISPATCH_NEXT();
         }
-        case ocGoto: {
+        DISPATCH_CASE(Goto): {
           size_t delta = read_short(&cache, &frame, 1);
           frame.pc += delta;
-          break;
+          DISPATCH_NEXT();
         }
-        case ocDelegateToLambda:
-        case ocDelegateToBlock: {
+        DISPATCH_CASE(GuardInline): {
+          // The inlined code that follows is only valid in the methodspace it
+          // was resolved in; anywhere else jump to the normal invocation. The
+          // methodspace was frozen when the code was compiled so checking its
+          // identity is enough, unlike the epoch which changes whenever any
+          // methodspace has a method added.
+          value_t space = read_value(&cache, &frame, 1);
+          if (is_same_value(space, get_ambience_methodspace(ambience))) {
+            frame.pc += kGuardInlineOperationSize;
+          } else {
+            size_t delta = read_short(&cache, &frame, 2);
+            frame.pc += delta;
+          }
+          DISPATCH_NEXT();
+        }
+        DISPATCH_CASE(DelegateToLambda):
+        DISPATCH_CASE(DelegateToBlock): {
           // This op only appears in the lambda and block delegator methods.
           // They should never be executed because the delegation happens during
           // method lookup. If we hit here something's likely wrong with the
@@ -357,7 +718,7 @@ static value_t run_task_pushing_signals(value_t ambience, value_t task) {
           UNREACHABLE("delegate to lambda");
           return new_condition(ccWat);
         }
-        case ocBuiltin: {
+        DISPATCH_CASE(Builtin): {
           value_t wrapper = read_value(&cache, &frame, 1);
           builtin_implementation_t impl = (builtin_implementation_t) get_void_p_value(wrapper);
           builtin_arguments_t args;
@@ -365,9 +726,9 @@ static value_t run_task_pushing_signals(value_t ambience, value_t task) {
           E_TRY_DEF(result, impl(&args));
           frame_push_value(&frame, result);
           frame.pc += kBuiltinOperationSize;
-          break;
+          DISPATCH_NEXT();
         }
-        case ocBuiltinMaybeEscape: {
+        DISPATCH_CASE(BuiltinMaybeEscape): {
           value_t wrapper = read_value(&cache, &frame, 1);
           builtin_implementation_t impl = (builtin_implementation_t) get_void_p_value(wrapper);
           builtin_arguments_t args;
@@ -422,21 +783,21 @@ static value_t run_task_pushing_signals(value_t ambience, value_t task) {
             frame_push_value(&frame, result);
             frame.pc += kBuiltinMaybeEscapeOperationSize;
           }
-          break;
+          DISPATCH_NEXT();
         }
-        case ocReturn: {
+        DISPATCH_CASE(Return): {
           value_t result = frame_pop_value(&frame);
           frame_pop_within_stack_piece(&frame);
           code_cache_refresh(&cache, &frame);
           frame_push_value(&frame, result);
-          break;
+          DISPATCH_NEXT();
         }
-        case ocStackBottom: {
+        DISPATCH_CASE(StackBottom): {
           value_t result = frame_pop_value(&frame);
           validate_stack_on_normal_exit(&frame);
           E_RETURN(result);
         }
-        case ocStackPieceBottom: {
+        DISPATCH_CASE(StackPieceBottom): {
           value_t top_piece = frame.stack_piece;
           value_t result = frame_pop_value(&frame);
           value_t next_piece = get_stack_piece_previous(top_piece);
@@ -444,18 +805,18 @@ static value_t run_task_pushing_signals(value_t ambience, value_t task) {
           frame = open_stack(stack);
           code_cache_refresh(&cache, &frame);
           frame_push_value(&frame, result);
-          break;
+          DISPATCH_NEXT();
         }
-        case ocSlap: {
+        DISPATCH_CASE(Slap): {
           value_t value = frame_pop_value(&frame);
           size_t argc = read_short(&cache, &frame, 1);
           for (size_t i = 0; i < argc; i++)
             frame_pop_value(&frame);
           frame_push_value(&frame, value);
           frame.pc += kSlapOperationSize;
-          break;
+          DISPATCH_NEXT();
         }
-        case ocNewReference: {
+        DISPATCH_CASE(NewReference): {
           // Create the reference first so that if it fails we haven't clobbered
           // the stack yet.
           E_TRY_DEF(ref, new_heap_reference(runtime, nothing()));
@@ -463,60 +824,79 @@ static value_t run_task_pushing_signals(value_t ambience, value_t task) {
           set_reference_value(ref, value);
           frame_push_value(&frame, ref);
           frame.pc += kNewReferenceOperationSize;
-          break;
+          DISPATCH_NEXT();
         }
-        case ocSetReference: {
+        DISPATCH_CASE(SetReference): {
           value_t ref = frame_pop_value(&frame);
           CHECK_FAMILY(ofReference, ref);
           value_t value = frame_peek_value(&frame, 0);
           set_reference_value(ref, value);
           frame.pc += kSetReferenceOperationSize;
-          break;
+          DISPATCH_NEXT();
         }
-        case ocGetReference: {
+        DISPATCH_CASE(GetReference): {
           value_t ref = frame_pop_value(&frame);
           CHECK_FAMILY(ofReference, ref);
           value_t value = get_reference_value(ref);
           frame_push_value(&frame, value);
           frame.pc += kGetReferenceOperationSize;
-          break;
+          DISPATCH_NEXT();
         }
-        case ocLoadLocal: {
+        DISPATCH_CASE(LoadLocal): {
           size_t index = read_short(&cache, &frame, 1);
           value_t value = frame_get_local(&frame, index);
           frame_push_value(&frame, value);
           frame.pc += kLoadLocalOperationSize;
-          break;
+          DISPATCH_NEXT();
         }
-        case ocLoadGlobal: {
+        DISPATCH_CASE(LoadLocalPair): {
+          size_t first = read_short(&cache, &frame, 1);
+          size_t second = read_short(&cache, &frame, 2);
+          frame_push_value(&frame, frame_get_local(&frame, first));
+          frame_push_value(&frame, frame_get_local(&frame, second));
+          frame.pc += kLoadLocalPairOperationSize;
+          DISPATCH_NEXT();
+        }
+        DISPATCH_CASE(LoadGlobal): {
           value_t path = read_value(&cache, &frame, 1);
           CHECK_FAMILY(ofPath, path);
           value_t fragment = read_value(&cache, &frame, 2);
           CHECK_FAMILY_OPT(ofModuleFragment, fragment);
-          E_TRY_DEF(value, module_fragment_lookup_path_full(runtime, fragment, path));
+          value_t cache_ptr = read_value(&cache, &frame, 3);
+          CHECK_FAMILY(ofFreezeCheat, cache_ptr);
+          value_t value = get_freeze_cheat_value(cache_ptr);
+          if (is_nothing(value)) {
+            E_TRY_SET(value, module_fragment_lookup_path_full(runtime, fragment,
+                path));
+            // Once a fragment is bound its bindings, and those of its
+            // predecessors, can't change so from then on the result can be
+            // reused.
+            if (is_nothing(fragment) || is_module_fragment_bound(fragment))
+              set_freeze_cheat_value(cache_ptr, value);
+          }
           frame_push_value(&frame, value);
           frame.pc += kLoadGlobalOperationSize;
-          break;
+          DISPATCH_NEXT();
         }
-        case ocLoadArgument: {
+        DISPATCH_CASE(LoadArgument): {
           size_t param_index = read_short(&cache, &frame, 1);
           value_t value = frame_get_argument(&frame, param_index);
           frame_push_value(&frame, value);
           frame.pc += kLoadArgumentOperationSize;
-          break;
+          DISPATCH_NEXT();
         }
-        case ocReifyArguments: {
+        DISPATCH_CASE(ReifyArguments): {
           E_TRY(do_reify_arguments(runtime, &frame, &cache));
-          break;
+          DISPATCH_NEXT();
         }
-        case ocLoadRawArgument: {
+        DISPATCH_CASE(LoadRawArgument): {
           size_t eval_index = read_short(&cache, &frame, 1);
           value_t value = frame_get_raw_argument(&frame, eval_index);
           frame_push_value(&frame, value);
           frame.pc += kLoadRawArgumentOperationSize;
-          break;
+          DISPATCH_NEXT();
         }
-        case ocLoadRefractedArgument: {
+        DISPATCH_CASE(LoadRefractedArgument): {
           size_t param_index = read_short(&cache, &frame, 1);
           size_t block_depth = read_short(&cache, &frame, 2);
           value_t subject = frame_get_argument(&frame, 0);
@@ -525,9 +905,9 @@ static value_t run_task_pushing_signals(value_t ambience, value_t task) {
           value_t value = frame_get_argument(&home, param_index);
           frame_push_value(&frame, value);
           frame.pc += kLoadRefractedArgumentOperationSize;
-          break;
+          DISPATCH_NEXT();
         }
-        case ocLoadRefractedLocal: {
+        DISPATCH_CASE(LoadRefractedLocal): {
           size_t index = read_short(&cache, &frame, 1);
           size_t block_depth = read_short(&cache, &frame, 2);
           value_t subject = frame_get_argument(&frame, 0);
@@ -536,18 +916,18 @@ static value_t run_task_pushing_signals(value_t ambience, value_t task) {
           value_t value = frame_get_local(&home, index);
           frame_push_value(&frame, value);
           frame.pc += kLoadRefractedLocalOperationSize;
-          break;
+          DISPATCH_NEXT();
         }
-        case ocLoadLambdaCapture: {
+        DISPATCH_CASE(LoadLambdaCapture): {
           size_t index = read_short(&cache, &frame, 1);
           value_t subject = frame_get_argument(&frame, 0);
           CHECK_FAMILY(ofLambda, subject);
           value_t value = get_lambda_capture(subject, index);
           frame_push_value(&frame, value);
           frame.pc += kLoadLambdaCaptureOperationSize;
-          break;
+          DISPATCH_NEXT();
         }
-        case ocLoadRefractedCapture: {
+        DISPATCH_CASE(LoadRefractedCapture): {
           size_t index = read_short(&cache, &frame, 1);
           size_t block_depth = read_short(&cache, &frame, 2);
           value_t subject = frame_get_argument(&frame, 0);
@@ -558,9 +938,9 @@ static value_t run_task_pushing_signals(value_t ambience, value_t task) {
           value_t value = get_lambda_capture(lambda, index);
           frame_push_value(&frame, value);
           frame.pc += kLoadRefractedLocalOperationSize;
-          break;
+          DISPATCH_NEXT();
         }
-        case ocLambda: {
+        DISPATCH_CASE(Lambda): {
           value_t space = read_value(&cache, &frame, 1);
           CHECK_FAMILY(ofMethodspace, space);
           size_t capture_count = read_short(&cache, &frame, 2);
@@ -581,9 +961,9 @@ static value_t run_task_pushing_signals(value_t ambience, value_t task) {
           }
           set_lambda_captures(lambda, captures);
           frame_push_value(&frame, lambda);
-          break;
+          DISPATCH_NEXT();
         }
-        case ocCreateBlock: {
+        DISPATCH_CASE(CreateBlock): {
           value_t space = read_value(&cache, &frame, 1);
           CHECK_FAMILY(ofMethodspace, space);
           // Create the block object.
@@ -599,9 +979,9 @@ static value_t run_task_pushing_signals(value_t ambience, value_t task) {
           // Push the block object.
           frame_push_value(&frame, block);
           frame.pc += kCreateBlockOperationSize;
-          break;
+          DISPATCH_NEXT();
         }
-        case ocCreateEnsurer: {
+        DISPATCH_CASE(CreateEnsurer): {
           value_t code_block = read_value(&cache, &frame, 1);
           value_t section = frame_alloc_derived_object(&frame,
               get_genus_descriptor(dgEnsureSection));
@@ -610,9 +990,9 @@ static value_t run_task_pushing_signals(value_t ambience, value_t task) {
           value_validate(section);
           frame_push_value(&frame, section);
           frame.pc += kCreateEnsurerOperationSize;
-          break;
+          DISPATCH_NEXT();
         }
-        case ocCallEnsurer: {
+        DISPATCH_CASE(CallEnsurer): {
           value_t value = frame_pop_value(&frame);
           value_t shard = frame_pop_value(&frame);
           frame_push_value(&frame, value);
@@ -633,9 +1013,9 @@ static value_t run_task_pushing_signals(value_t ambience, value_t task) {
           }
           frame_set_code_block(&frame, code_block);
           code_cache_refresh(&cache, &frame);
-          break;
+          DISPATCH_NEXT();
         }
-        case ocDisposeEnsurer: {
+        DISPATCH_CASE(DisposeEnsurer): {
           // Discard the result of the ensure block. If an ensure blocks needs
           // to return a useful value it can do it via an escape.
           frame_pop_value(&frame);
@@ -645,9 +1025,9 @@ static value_t run_task_pushing_signals(value_t ambience, value_t task) {
           frame_destroy_derived_object(&frame, get_genus_descriptor(dgEnsureSection));
           frame_push_value(&frame, value);
           frame.pc += kDisposeEnsurerOperationSize;
-          break;
+          DISPATCH_NEXT();
         }
-        case ocInstallSignalHandler: {
+        DISPATCH_CASE(InstallSignalHandler): {
           value_t space = read_value(&cache, &frame, 1);
           CHECK_FAMILY(ofMethodspace, space);
           size_t dest_offset = read_short(&cache, &frame, 2);
@@ -665,9 +1045,9 @@ static value_t run_task_pushing_signals(value_t ambience, value_t task) {
           // Finally capture the escape state.
           capture_escape_state(section, &frame, dest_offset);
           value_validate(section);
-          break;
+          DISPATCH_NEXT();
         }
-        case ocUninstallSignalHandler: {
+        DISPATCH_CASE(UninstallSignalHandler): {
           // The result has been left at the top of the stack.
           value_t value = frame_pop_value(&frame);
           value_t section = frame_pop_value(&frame);
@@ -676,9 +1056,9 @@ static value_t run_task_pushing_signals(value_t ambience, value_t task) {
           frame_destroy_derived_object(&frame, get_genus_descriptor(dgSignalHandlerSection));
           frame_push_value(&frame, value);
           frame.pc += kUninstallSignalHandlerOperationSize;
-          break;
+          DISPATCH_NEXT();
         }
-        case ocCreateEscape: {
+        DISPATCH_CASE(CreateEscape): {
           size_t dest_offset = read_short(&cache, &frame, 1);
           // Create an initially empty escape object.
           E_TRY_DEF(escape, new_heap_escape(runtime, nothing()));
@@ -694,9 +1074,9 @@ static value_t run_task_pushing_signals(value_t ambience, value_t task) {
           // This is the execution state the escape will escape to (modulo the
           // destination offset) so this is what we want to capture.
           capture_escape_state(section, &frame, dest_offset);
-          break;
+          DISPATCH_NEXT();
         }
-        case ocLeaveOrFireBarrier: {
+        DISPATCH_CASE(LeaveOrFireBarrier): {
           size_t argc = read_short(&cache, &frame, 1);
           // At this point the handler has been set as the subject of the call
           // to the handler method. Above the arguments are also two scratch
@@ -718,9 +1098,9 @@ static value_t run_task_pushing_signals(value_t ambience, value_t task) {
             // If a barrier was fired we'll want to let the interpreter loop
             // around again so just break without touching .pc.
           }
-          break;
+          DISPATCH_NEXT();
         }
-        case ocFireEscapeOrBarrier: {
+        DISPATCH_CASE(FireEscapeOrBarrier): {
           value_t escape = frame_get_argument(&frame, 0);
           CHECK_FAMILY(ofEscape, escape);
           value_t section = get_escape_section(escape);
@@ -735,9 +1115,9 @@ static value_t run_task_pushing_signals(value_t ambience, value_t task) {
             // If a barrier was fired we'll want to let the interpreter loop
             // around again so just break without touching .pc.
           }
-          break;
+          DISPATCH_NEXT();
         }
-        case ocDisposeEscape: {
+        DISPATCH_CASE(DisposeEscape): {
           value_t value = frame_pop_value(&frame);
           value_t escape = frame_pop_value(&frame);
           CHECK_FAMILY(ofEscape, escape);
@@ -748,9 +1128,9 @@ static value_t run_task_pushing_signals(value_t ambience, value_t task) {
           frame_destroy_derived_object(&frame, get_genus_descriptor(dgEscapeSection));
           frame_push_value(&frame, value);
           frame.pc += kDisposeEscapeOperationSize;
-          break;
+          DISPATCH_NEXT();
         }
-        case ocDisposeBlock: {
+        DISPATCH_CASE(DisposeBlock): {
           value_t value = frame_pop_value(&frame);
           value_t block = frame_pop_value(&frame);
           CHECK_FAMILY(ofBlock, block);
@@ -760,9 +1140,9 @@ static value_t run_task_pushing_signals(value_t ambience, value_t task) {
           frame_destroy_derived_object(&frame, get_genus_descriptor(dgBlockSection));
           frame_push_value(&frame, value);
           frame.pc += kDisposeBlockOperationSize;
-          break;
+          DISPATCH_NEXT();
         }
-        case ocCreateCallData: {
+        DISPATCH_CASE(CreateCallData): {
           size_t argc = read_short(&cache, &frame, 1);
           E_TRY_DEF(raw_tags, new_heap_array(runtime, argc));
           for (size_t i = 0; i < argc; i++) {
@@ -780,10 +1160,10 @@ static value_t run_task_pushing_signals(value_t ambience, value_t task) {
           E_TRY_DEF(call_data, new_heap_call_data(runtime, call_tags, values));
           frame_push_value(&frame, call_data);
           frame.pc += kCreateCallDataOperationSize;
-          break;
+          DISPATCH_NEXT();
         }
-        case ocModuleFragmentPrivateInvokeCallData:
-        case ocModuleFragmentPrivateInvokeReifiedArguments: {
+        DISPATCH_CASE(ModuleFragmentPrivateInvokeCallData):
+        DISPATCH_CASE(ModuleFragmentPrivateInvokeReifiedArguments): {
           // Perform the method lookup.
           value_t phrivate = frame_get_argument(&frame, 0);
           CHECK_FAMILY(ofModuleFragmentPrivate, phrivate);
@@ -829,9 +1209,9 @@ static value_t run_task_pushing_signals(value_t ambience, value_t task) {
           CHECK_FALSE("call literal invocation failed", is_condition(pushed));
           frame_set_code_block(&frame, code_block);
           code_cache_refresh(&cache, &frame);
-          break;
+          DISPATCH_NEXT();
         }
-        case ocModuleFragmentPrivateLeaveReifiedArguments: {
+        DISPATCH_CASE(ModuleFragmentPrivateLeaveReifiedArguments): {
           // Perform the method lookup.
           value_t phrivate = frame_get_argument(&frame, 0);
           CHECK_FAMILY(ofModuleFragmentPrivate, phrivate);
@@ -872,12 +1252,14 @@ static value_t run_task_pushing_signals(value_t ambience, value_t task) {
           CHECK_TRUE("subject not null", is_null(frame_get_argument(&frame, 0)));
           frame_set_argument(&frame, 0, handler);
           code_cache_refresh(&cache, &frame);
-          break;
+          DISPATCH_NEXT();
         }
+#if !USE_THREADED_DISPATCH
         default:
           ERROR("Unexpected opcode %i", opcode);
           UNREACHABLE("unexpected opcode");
           break;
+#endif
       }
     }
   } FINALLY {
@@ -920,7 +1302,7 @@ static value_t run_task_until_signal(safe_value_t s_ambience, safe_value_t s_tas
     value_t result = run_task_pushing_signals(ambience, task);
     if (in_condition_cause(ccHeapExhausted, result)) {
       runtime_t *runtime = get_ambience_runtime(ambience);
-      runtime_garbage_collect(runtime);
+      runtime_garbage_collect_young(runtime);
       goto loop;
     } else if (in_condition_cause(ccForceValidate, result)) {
       runtime_t *runtime = get_ambience_runtime(ambience);
@@ -943,6 +1325,18 @@ const char *get_opcode_name(opcode_t opcode) {
   }
 }
 
+size_t get_opcode_size(opcode_t opcode) {
+  switch (opcode) {
+#define __EMIT_CASE__(Name, ARGC)                                              \
+    case oc##Name:                                                             \
+      return k##Name##OperationSize;
+  ENUM_OPCODES(__EMIT_CASE__)
+#undef __EMIT_CASE__
+    default:
+      return 0;
+  }
+}
+
 value_t run_code_block_until_condition(value_t ambience, value_t code) {
   CHECK_FAMILY(ofAmbience, ambience);
   CHECK_FAMILY(ofCodeBlock, code);
@@ -1042,6 +1436,13 @@ static value_t run_next_process_job(safe_value_t s_ambience, safe_value_t s_proc
   TRY(finish_process_delivered_undertakings(deref(s_process), false, NULL));
   runtime_t *runtime = get_ambience_runtime(deref(s_ambience));
   while (true) {
+    // Between jobs only safe values are held so it's a good time to make
+    // progress on an incremental collection, or to let it flip.
+    if (runtime_is_incremental_collection_ready(runtime)) {
+      TRY(runtime_garbage_collect(runtime));
+    } else if (heap_is_replicating(&runtime->heap)) {
+      TRY(runtime_garbage_collect_increment(runtime));
+    }
     job_t job;
     struct_zero_fill(job);
     // Try to get the next job that's ready to be run.
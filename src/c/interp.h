@@ -13,8 +13,8 @@
 // Invokes the given macro for each opcode name and argument count.
 #define ENUM_OPCODES(F)                                                        \
   F(Builtin,                                    2)                             \
-  F(BuiltinMaybeEscape,                         4)                             \
-  F(CallEnsurer,                                4)                             \
+  F(BuiltinMaybeEscape,                         5)                             \
+  F(CallEnsurer,                                5)                             \
   F(CheckStackHeight,                           2)                             \
   F(CreateBlock,                                2)                             \
   F(CreateCallData,                             2)                             \
@@ -28,14 +28,17 @@
   F(FireEscapeOrBarrier,                        1)                             \
   F(GetReference,                               1)                             \
   F(Goto,                                       2)                             \
+  F(GuardInline,                                3)                             \
   F(InstallSignalHandler,                       3)                             \
   F(UninstallSignalHandler,                     1)                             \
-  F(Invoke,                                     4)                             \
+  F(Invoke,                                     5)                             \
+  F(InvokeBuiltin,                              5)                             \
   F(Lambda,                                     3)                             \
   F(LeaveOrFireBarrier,                         2)                             \
   F(LoadArgument,                               2)                             \
-  F(LoadGlobal,                                 3)                             \
+  F(LoadGlobal,                                 4)                             \
   F(LoadLocal,                                  2)                             \
+  F(LoadLocalPair,                              3)                             \
   F(LoadLambdaCapture,                          2)                             \
   F(LoadRawArgument,                            2)                             \
   F(LoadRefractedArgument,                      3)                             \
@@ -48,14 +51,17 @@
   F(NewReference,                               1)                             \
   F(Pop,                                        2)                             \
   F(Push,                                       2)                             \
+  F(PushPair,                                   3)                             \
   F(ReifyArguments,                             2)                             \
   F(Return,                                     1)                             \
   F(SetReference,                               1)                             \
-  F(SignalEscape,                               4)                             \
-  F(SignalContinue,                             4)                             \
+  F(SignalEscape,                               5)                             \
+  F(SignalContinue,                             5)                             \
   F(Slap,                                       2)                             \
   F(StackBottom,                                1)                             \
-  F(StackPieceBottom,                           1)
+  F(StackPieceBottom,                           1)                             \
+  F(TailInvoke,                                 5)                             \
+  F(TailInvokeBuiltin,                          5)
 
 // The enum of all opcodes.
 typedef enum {
@@ -71,9 +77,18 @@ typedef enum {
   ENUM_OPCODES(__DECLARE_OPCODE_SIZE__)
 #undef __DECLARE_OPCODE_SIZE__
 
+// The number of distinct opcodes.
+#define __COUNT_OPCODE__(Name, ARGC) + 1
+static const size_t kOpcodeCount = 0 ENUM_OPCODES(__COUNT_OPCODE__);
+#undef __COUNT_OPCODE__
+
 // Returns the string name of the opcode with the given index.
 const char *get_opcode_name(opcode_t opcode);
 
+// Returns the size in shorts of operations with the given opcode, counting the
+// opcode itself, or 0 if the opcode is invalid.
+size_t get_opcode_size(opcode_t opcode);
+
 // Executes the given code block object, returning the result. If any conditions
 // occur evaluation is interrupted.
 value_t run_code_block_until_condition(value_t ambience, value_t code);
@@ -332,6 +332,7 @@ static value_t os_process_set_stream(builtin_arguments_t *args,
   native_process_t *process = get_os_process_native(os_process);
   native_process_set_stream(process, stream, stream_redirect_from_pipe(pipe, dir));
   *access_heap_object_field(os_process, lifeline_offset) = os_pipe;
+  heap_object_write_barrier(os_process, os_pipe);
   return null();
 }
 
@@ -59,14 +59,35 @@ static bool parse_options(int argc, const char **argv, main_options_t *flags_out
     return false;
   }
 
-  flags_out->config->gc_fuzz_freq = (uint32_t) pton_int64_value(
+  neu_runtime_config_t *config = flags_out->config;
+  config->gc_fuzz_freq = (uint32_t) pton_int64_value(
       pton_command_line_option(cmdline,
           pton_c_str("garbage-collect-fuzz-frequency"),
           pton_integer(0)));
-  flags_out->config->gc_fuzz_seed = (uint32_t) pton_int64_value(
+  config->gc_fuzz_seed = (uint32_t) pton_int64_value(
       pton_command_line_option(cmdline,
           pton_c_str("garbage-collect-fuzz-seed"),
           pton_integer(0)));
+  config->semispace_size_bytes = (size_t) pton_int64_value(
+      pton_command_line_option(cmdline,
+          pton_c_str("semispace-size-bytes"),
+          pton_integer(config->semispace_size_bytes)));
+  config->max_semispace_size_bytes = (size_t) pton_int64_value(
+      pton_command_line_option(cmdline,
+          pton_c_str("max-semispace-size-bytes"),
+          pton_integer(config->max_semispace_size_bytes)));
+  config->nursery_size_bytes = (size_t) pton_int64_value(
+      pton_command_line_option(cmdline,
+          pton_c_str("nursery-size-bytes"),
+          pton_integer(config->nursery_size_bytes)));
+  config->gc_thread_count = (uint32_t) pton_int64_value(
+      pton_command_line_option(cmdline,
+          pton_c_str("gc-thread-count"),
+          pton_integer(config->gc_thread_count)));
+  config->gc_max_pause_millis = (uint32_t) pton_int64_value(
+      pton_command_line_option(cmdline,
+          pton_c_str("gc-max-pause-millis"),
+          pton_integer(config->gc_max_pause_millis)));
   return true;
 }
 
@@ -109,6 +130,9 @@ static void runtime_config_init_main_defaults(neu_runtime_config_t *config) {
   // Currently the runtime doesn't handle allocation failures super well
   // (particularly plankton parsing) so keep the semispace size big.
   config->semispace_size_bytes = 16 * kMB;
+  // Let the heap double once for programs that need it. Both semispaces plus
+  // the nursery still fit within the default memory limit.
+  config->max_semispace_size_bytes = 32 * kMB;
 }
 
 // Native echo service, mainly for testing.
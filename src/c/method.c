@@ -130,32 +130,6 @@ value_t guard_validate(value_t value) {
   return success();
 }
 
-// Given two scores returns the best of them.
-static value_t best_score(value_t a, value_t b) {
-  return (compare_tagged_scores(a, b) > 0) ? a : b;
-}
-
-static value_t find_best_match(runtime_t *runtime, value_t current,
-    value_t target, value_t current_score, value_t space, value_t *score_out) {
-  if (value_identity_compare(current, target)) {
-    *score_out = current_score;
-    return success();
-  } else {
-    TRY_DEF(parents, get_type_parents(runtime, space, current));
-    int64_t length = get_array_buffer_length(parents);
-    value_t score = new_no_match_score();
-    for (int64_t i = 0; i < length; i++) {
-      value_t parent = get_array_buffer_at(parents, i);
-      value_t next_score = whatever();
-      TRY(find_best_match(runtime, parent, target, get_score_successor(current_score),
-          space, &next_score));
-      score = best_score(score, next_score);
-    }
-    *score_out = score;
-    return success();
-  }
-}
-
 value_t guard_match(value_t guard, value_t value, runtime_t *runtime,
     value_t space, value_t *score_out) {
   CHECK_FAMILY(ofGuard, guard);
@@ -169,8 +143,8 @@ value_t guard_match(value_t guard, value_t value, runtime_t *runtime,
     case gtIs: {
       TRY_DEF(primary, get_primary_type(value, runtime));
       value_t target = get_guard_value(guard);
-      return find_best_match(runtime, primary, target,
-          new_perfect_is_match_score(), space, score_out);
+      return match_methodspace_type(runtime, space, primary, target,
+          score_out);
     }
     case gtAny:
       *score_out = new_any_match_score();
@@ -320,7 +294,7 @@ value_t add_methodspace_inheritance(runtime_t *runtime, value_t self,
   }
   // If this fails we may have set the parents array of the subtype to an empty
   // array which is awkward but okay.
-  invalidate_methodspace_caches(self);
+  invalidate_methodspace_type_caches(runtime, self);
   return add_to_array_buffer(runtime, parents, supertype);
 }
 
@@ -329,10 +303,11 @@ value_t add_methodspace_method(runtime_t *runtime, value_t self,
   CHECK_FAMILY(ofMethodspace, self);
   CHECK_MUTABLE(self);
   CHECK_FAMILY(ofMethod, method);
-  invalidate_methodspace_caches(self);
   value_t signature = get_method_signature(method);
-  return add_to_signature_map(runtime, get_methodspace_methods(self), signature,
-      method);
+  TRY(add_to_signature_map(runtime, get_methodspace_methods(self), signature,
+      method));
+  update_methodspace_selector_caches(runtime, self, signature, method);
+  return success();
 }
 
 value_t get_type_parents(runtime_t *runtime, value_t space, value_t type) {
@@ -345,20 +320,25 @@ value_t get_type_parents(runtime_t *runtime, value_t space, value_t type) {
   }
 }
 
-// Returns true if the given signature could possibly match an invocation where
-// the given tag maps to the given value.
-static bool can_match_eq(value_t signature, value_t tag, value_t value) {
+// Returns the parameter of the given signature that has the given tag, or
+// nothing if there is none.
+static value_t find_signature_parameter_with_tag(value_t signature,
+    value_t tag) {
   int64_t paramc = get_signature_parameter_count(signature);
-  // First look for a matching parameter in the signature.
-  value_t match = nothing();
   for (int64_t i = 0; i < paramc; i++) {
     value_t param = get_signature_parameter_at(signature, i);
     value_t tags = get_parameter_tags(param);
-    if (in_array(tags, tag)) {
-      match = param;
-      break;
-    }
+    if (in_array(tags, tag))
+      return param;
   }
+  return nothing();
+}
+
+// Returns true if the given signature could possibly match an invocation where
+// the given tag maps to the given value.
+static bool can_match_eq(value_t signature, value_t tag, value_t value) {
+  // First look for a matching parameter in the signature.
+  value_t match = find_signature_parameter_with_tag(signature, tag);
   if (is_nothing(match)) {
     // There was no matching parameter so this can only match if the signature
     // permits it as an extra argument.
@@ -374,10 +354,41 @@ static bool can_match_eq(value_t signature, value_t tag, value_t value) {
   }
 }
 
+// Which selectors' slices a signature can be part of.
+typedef enum {
+  // The signature can't match any selector.
+  srNone,
+  // The signature can only match one particular selector.
+  srOne,
+  // The signature can match any selector.
+  srAll
+} selector_reach_t;
+
+// Returns which selector slices the given signature can be part of, that is,
+// for which selectors can_match_eq will be true. If it's a single selector it
+// is stored in selector_out.
+static selector_reach_t get_signature_selector_reach(runtime_t *runtime,
+    value_t signature, value_t *selector_out) {
+  value_t match = find_signature_parameter_with_tag(signature,
+      ROOT(runtime, selector_key));
+  if (is_nothing(match))
+    return get_signature_allow_extra(signature) ? srAll : srNone;
+  value_t guard = get_parameter_guard(match);
+  if (get_guard_type(guard) != gtEq)
+    return srAll;
+  *selector_out = get_guard_value(guard);
+  return srOne;
+}
+
+// Creates the slice of the given methodspace's methods, including its parents',
+// that can match the given selector. The number of entries that come from the
+// methodspace itself, which come before those from its parents, is stored in
+// own_count_out.
 static value_t create_methodspace_selector_slice(runtime_t *runtime, value_t self,
-    value_t selector) {
+    value_t selector, size_t *own_count_out) {
   TRY_DEF(result, new_heap_signature_map(runtime));
   value_t current = self;
+  *own_count_out = 0;
   while (!is_nothing(current)) {
     value_t methods = get_methodspace_methods(current);
     value_t entries = get_signature_map_entries(methods);
@@ -388,30 +399,395 @@ static value_t create_methodspace_selector_slice(runtime_t *runtime, value_t sel
         TRY(add_to_signature_map(runtime, result, signature, method));
       }
     }
+    if (is_same_value(current, self))
+      *own_count_out = (size_t) get_pair_array_buffer_length(
+          get_signature_map_entries(result));
     current = get_methodspace_parent(current);
   }
   return result;
 }
 
-value_t get_or_create_methodspace_selector_slice(runtime_t *runtime, value_t self,
-    value_t selector) {
-  value_t cache_ptr = get_methodspace_cache_ptr(self);
-  value_t cache = get_freeze_cheat_value(cache_ptr);
-  // Create the cache if it doesn't exist.
+// The methodspace cache is an array that holds a map from selectors to the
+// record for that selector and a map from types to their ancestry. Each map is
+// created when it's first needed so a part of the cache can be flushed without
+// touching the rest by clearing its slot.
+static const size_t kMethodspaceCacheSelectorsIndex = 0;
+static const size_t kMethodspaceCacheAncestriesIndex = 1;
+static const size_t kMethodspaceCacheSize = 2;
+
+// Each selector record holds the slice for that selector, the number of
+// entries in the slice that come from the methodspace itself, and the map from
+// call tags to the dispatch plans that have been compiled from the slice. A
+// record whose slice is nothing is stale and will be rebuilt when next needed;
+// if the plans are nothing they will be too.
+static const size_t kSelectorRecordSliceIndex = 0;
+static const size_t kSelectorRecordOwnCountIndex = 1;
+static const size_t kSelectorRecordPlansIndex = 2;
+static const size_t kSelectorRecordSize = 3;
+
+// Returns the given methodspace's cache, or nothing if it hasn't been created.
+static value_t get_methodspace_cache(value_t self) {
+  return get_freeze_cheat_value(get_methodspace_cache_ptr(self));
+}
+
+// Returns the map stored at the given index in the given methodspace's cache,
+// creating the map and the cache if necessary.
+static value_t get_or_create_methodspace_cache_map(runtime_t *runtime,
+    value_t self, size_t index, size_t initial_capacity) {
+  value_t cache = get_methodspace_cache(self);
   if (is_nothing(cache)) {
-    TRY_SET(cache, new_heap_id_hash_map(runtime, 128));
-    set_freeze_cheat_value(cache_ptr, cache);
+    TRY_SET(cache, new_heap_array(runtime, kMethodspaceCacheSize));
+    for (size_t i = 0; i < kMethodspaceCacheSize; i++)
+      set_array_at(cache, i, nothing());
+    set_freeze_cheat_value(get_methodspace_cache_ptr(self), cache);
   }
+  value_t map = get_array_at(cache, index);
+  if (is_nothing(map)) {
+    TRY_SET(map, new_heap_id_hash_map(runtime, initial_capacity));
+    set_array_at(cache, index, map);
+  }
+  return map;
+}
+
+// Clears the map at the given index of the given methodspace's cache, if there
+// is one.
+static void clear_methodspace_cache_map(value_t self, size_t index) {
+  value_t cache = get_methodspace_cache(self);
+  if (!is_nothing(cache))
+    set_array_at(cache, index, nothing());
+}
+
+// Returns the cache record for the given selector, creating or rebuilding it if
+// it doesn't already exist or is stale.
+static value_t get_or_create_methodspace_selector_record(runtime_t *runtime,
+    value_t self, value_t selector) {
+  TRY_DEF(selectors, get_or_create_methodspace_cache_map(runtime, self,
+      kMethodspaceCacheSelectorsIndex, 128));
   // Create the selector-specific cache if it doesn't exits.
-  value_t slice = get_id_hash_map_at(cache, selector);
-  if (in_condition_cause(ccNotFound, slice)) {
-    TRY_SET(slice, create_methodspace_selector_slice(runtime, self, selector));
-    TRY(set_id_hash_map_at(runtime, cache, selector, slice));
+  value_t record = get_id_hash_map_at(selectors, selector);
+  if (in_condition_cause(ccNotFound, record)) {
+    TRY_SET(record, new_heap_array(runtime, kSelectorRecordSize));
+    set_array_at(record, kSelectorRecordSliceIndex, nothing());
+    set_array_at(record, kSelectorRecordOwnCountIndex, new_integer(0));
+    set_array_at(record, kSelectorRecordPlansIndex, nothing());
+    TRY(set_id_hash_map_at(runtime, selectors, selector, record));
+  }
+  if (is_nothing(get_array_at(record, kSelectorRecordSliceIndex))) {
+    size_t own_count = 0;
+    TRY_DEF(slice, create_methodspace_selector_slice(runtime, self, selector,
+        &own_count));
+    set_array_at(record, kSelectorRecordSliceIndex, slice);
+    set_array_at(record, kSelectorRecordOwnCountIndex, new_integer(own_count));
+    set_array_at(record, kSelectorRecordPlansIndex, nothing());
+  }
+  return record;
+}
+
+// Adds the given method to the slice held by the given selector record. The
+// slice holds the methodspace's own methods before its parents' so the method
+// is moved to just after the last of the methodspace's own entries, where
+// rebuilding the slice would have put it. Any plans compiled from the slice
+// are dropped. If there's a problem the record is marked stale instead.
+static void add_method_to_selector_record(runtime_t *runtime, value_t record,
+    value_t signature, value_t method) {
+  value_t slice = get_array_at(record, kSelectorRecordSliceIndex);
+  set_array_at(record, kSelectorRecordPlansIndex, nothing());
+  if (is_nothing(slice))
+    return;
+  value_t added = add_to_signature_map(runtime, slice, signature, method);
+  if (is_condition(added)) {
+    set_array_at(record, kSelectorRecordSliceIndex, nothing());
+    return;
+  }
+  int64_t own_count = get_integer_value(get_array_at(record,
+      kSelectorRecordOwnCountIndex));
+  value_t entries = get_signature_map_entries(slice);
+  int64_t length = get_pair_array_buffer_length(entries);
+  for (int64_t i = length - 1; i > own_count; i--) {
+    // Shift the parent entry before the new one up by one.
+    set_array_buffer_at(entries, 2 * i,
+        get_array_buffer_at(entries, 2 * (i - 1)));
+    set_array_buffer_at(entries, 2 * i + 1,
+        get_array_buffer_at(entries, 2 * (i - 1) + 1));
+  }
+  set_array_buffer_at(entries, 2 * own_count, signature);
+  set_array_buffer_at(entries, 2 * own_count + 1, method);
+  set_array_at(record, kSelectorRecordOwnCountIndex,
+      new_integer(own_count + 1));
+}
+
+// Flushes the caches that hold the results of lookups.
+static void flush_lookup_result_caches(runtime_t *runtime) {
+  // Inline caches and the global lookup cache don't keep track of which
+  // methodspaces they've looked through so changing any methodspace causes all
+  // of them to be flushed.
+  runtime->methodspace_epoch++;
+}
+
+void update_methodspace_selector_caches(runtime_t *runtime, value_t self,
+    value_t signature, value_t method) {
+  flush_lookup_result_caches(runtime);
+  value_t cache = get_methodspace_cache(self);
+  if (is_nothing(cache))
+    return;
+  value_t selectors = get_array_at(cache, kMethodspaceCacheSelectorsIndex);
+  if (is_nothing(selectors))
+    return;
+  value_t selector = whatever();
+  switch (get_signature_selector_reach(runtime, signature, &selector)) {
+    case srNone:
+      // The method can't be in any slice so there's nothing to update.
+      break;
+    case srOne: {
+      // Only the one slice that can hold the method has to be updated; if it
+      // hasn't been created yet there's nothing to do.
+      value_t record = get_id_hash_map_at(selectors, selector);
+      if (!in_condition_cause(ccNotFound, record))
+        add_method_to_selector_record(runtime, record, signature, method);
+      break;
+    }
+    case srAll:
+      // The method can be in any slice so drop them all, they'll be rebuilt
+      // as they're needed.
+      clear_methodspace_cache_map(self, kMethodspaceCacheSelectorsIndex);
+      break;
+  }
+}
+
+void invalidate_methodspace_type_caches(runtime_t *runtime, value_t self) {
+  flush_lookup_result_caches(runtime);
+  // The slices and plans only depend on the methods, not the inheritance
+  // hierarchy, so only the ancestries have to go.
+  clear_methodspace_cache_map(self, kMethodspaceCacheAncestriesIndex);
+}
+
+value_t get_or_create_methodspace_selector_slice(runtime_t *runtime, value_t self,
+    value_t selector) {
+  TRY_DEF(record, get_or_create_methodspace_selector_record(runtime, self,
+      selector));
+  return get_array_at(record, kSelectorRecordSliceIndex);
+}
+
+// Records in the given ancestry map that the given type is an ancestor with
+// the given score, and then the same for all its parents, unless the type has
+// already been recorded with a score at least as good, in which case its
+// parents will have been too.
+static value_t add_type_ancestry(runtime_t *runtime, value_t space,
+    value_t ancestry, value_t current, value_t current_score) {
+  value_t existing = get_id_hash_map_at(ancestry, current);
+  if (!in_condition_cause(ccNotFound, existing)
+      && compare_tagged_scores(current_score, existing) <= 0)
+    return success();
+  TRY(set_id_hash_map_at(runtime, ancestry, current, current_score));
+  TRY_DEF(parents, get_type_parents(runtime, space, current));
+  int64_t length = get_array_buffer_length(parents);
+  for (int64_t i = 0; i < length; i++) {
+    value_t parent = get_array_buffer_at(parents, i);
+    TRY(add_type_ancestry(runtime, space, ancestry, parent,
+        get_score_successor(current_score)));
+  }
+  return success();
+}
+
+// Returns the ancestry of the given type within the given methodspace, a map
+// from the type and every type it inherits from to the score an is-guard for
+// that type gives a value of the given type. The ancestry is computed the first
+// time it's requested and then cached until the methodspace changes, so an
+// is-guard can be matched with a single lookup instead of a walk through the
+// inheritance hierarchy.
+static value_t get_or_create_type_ancestry(runtime_t *runtime, value_t space,
+    value_t type) {
+  TRY_DEF(ancestries, get_or_create_methodspace_cache_map(runtime, space,
+      kMethodspaceCacheAncestriesIndex, 16));
+  value_t ancestry = get_id_hash_map_at(ancestries, type);
+  if (in_condition_cause(ccNotFound, ancestry)) {
+    TRY_SET(ancestry, new_heap_id_hash_map(runtime, 16));
+    TRY(add_type_ancestry(runtime, space, ancestry, type,
+        new_perfect_is_match_score()));
+    TRY(set_id_hash_map_at(runtime, ancestries, type, ancestry));
+  }
+  return ancestry;
+}
+
+value_t match_methodspace_type(runtime_t *runtime, value_t space, value_t type,
+    value_t target, value_t *score_out) {
+  if (is_nothing(space)
+      || in_condition_cause(ccNotFound,
+          get_id_hash_map_at(get_methodspace_inheritance(space), type))) {
+    // The type has no parents so the only type it can match is itself; we
+    // don't need an ancestry to tell us that.
+    *score_out = value_identity_compare(type, target)
+        ? new_perfect_is_match_score()
+        : new_no_match_score();
+    return success();
+  }
+  TRY_DEF(ancestry, get_or_create_type_ancestry(runtime, space, type));
+  value_t score = get_id_hash_map_at(ancestry, target);
+  *score_out = in_condition_cause(ccNotFound, score)
+      ? new_no_match_score()
+      : score;
+  return success();
+}
+
+// Works out which parameter of the given signature each of the arguments
+// described by the given tags would bind to. Returns true if the signature can
+// match for some values of the arguments, in which case the parameter index of
+// each argument is stored in params_out and its guard in guards_out, or nothing
+// if the argument would be an extra argument. This is the part of signature
+// matching that only depends on the tags; it must be kept in sync with
+// generic_match_signature.
+static bool get_dispatch_plan_candidate_params(value_t signature, value_t tags,
+    int64_t *params_out, value_t *guards_out) {
+  size_t argc = (size_t) get_call_tags_entry_count(tags);
+  size_t mandatory_count = (size_t) get_signature_mandatory_count(signature);
+  if (argc < mandatory_count)
+    return false;
+  size_t param_count = (size_t) get_signature_parameter_count(signature);
+  bool allow_extra = get_signature_allow_extra(signature);
+  if (!allow_extra && (argc > param_count))
+    return false;
+  bit_vector_t params_seen;
+  bit_vector_init(&params_seen, param_count, false);
+  size_t mandatory_seen_count = 0;
+  value_t signature_tags = get_signature_tags(signature);
+  bool result = true;
+  for (size_t i = 0; i < argc && result; i++) {
+    value_t tag = get_call_tags_tag_at(tags, i);
+    value_t param = binary_search_pair_array(signature_tags, tag);
+    if (in_condition_cause(ccNotFound, param)) {
+      params_out[i] = kDispatchPlanExtraColumn;
+      guards_out[i] = nothing();
+      result = allow_extra;
+      continue;
+    }
+    size_t index = (size_t) get_parameter_index(param);
+    if (bit_vector_get_at(&params_seen, index)) {
+      result = false;
+      continue;
+    }
+    bit_vector_set_at(&params_seen, index, true);
+    params_out[i] = (int64_t) index;
+    guards_out[i] = get_parameter_guard(param);
+    if (!get_parameter_is_optional(param))
+      mandatory_seen_count++;
+  }
+  bit_vector_dispose(&params_seen);
+  return result && (mandatory_seen_count >= mandatory_count);
+}
+
+// Returns true if the two guards always give the same score for the same value.
+static bool is_same_guard(value_t a, value_t b) {
+  return is_same_value(a, b)
+      || ((get_guard_type(a) == get_guard_type(b))
+          && value_identity_compare(get_guard_value(a), get_guard_value(b)));
+}
+
+// Returns the index of the column that tests the given guard against the
+// value at the given index, adding one if there is none yet. The index is the
+// one generic_match_signature passes to the input when matching, the parameter
+// index. Returns -1 if a column is needed but there is no more room.
+static int64_t get_or_add_dispatch_plan_column(size_t *column_args,
+    value_t *column_guards, size_t *column_count, size_t arg_index,
+    value_t guard) {
+  for (size_t i = 0; i < *column_count; i++) {
+    if (column_args[i] == arg_index && is_same_guard(column_guards[i], guard))
+      return (int64_t) i;
+  }
+  if (*column_count == kDispatchPlanMaxColumnCount)
+    return -1;
+  size_t index = (*column_count)++;
+  column_args[index] = arg_index;
+  column_guards[index] = guard;
+  return (int64_t) index;
+}
+
+// Compiles the given slice into a dispatch plan for invocations with the given
+// tags. Returns nothing if the slice needs more guard columns than a plan can
+// hold.
+static value_t compile_dispatch_plan(runtime_t *runtime, value_t slice,
+    value_t tags) {
+  size_t argc = (size_t) get_call_tags_entry_count(tags);
+  CHECK_REL("too many arguments", argc, <=, kSmallLookupLimit);
+  value_t entries = get_signature_map_entries(slice);
+  size_t entry_count = (size_t) get_pair_array_buffer_length(entries);
+  size_t column_args[kDispatchPlanMaxColumnCount];
+  value_t column_guards[kDispatchPlanMaxColumnCount];
+  size_t column_count = 0;
+  int64_t params[kSmallLookupLimit];
+  value_t guards[kSmallLookupLimit];
+  // First pass: collect the columns and count the candidates so we know how
+  // big the plan has to be.
+  size_t candidate_count = 0;
+  for (size_t ei = 0; ei < entry_count; ei++) {
+    value_t signature = get_pair_array_buffer_first_at(entries, ei);
+    if (!get_dispatch_plan_candidate_params(signature, tags, params, guards))
+      continue;
+    candidate_count++;
+    for (size_t i = 0; i < argc; i++) {
+      if (params[i] == kDispatchPlanExtraColumn)
+        continue;
+      int64_t column = get_or_add_dispatch_plan_column(column_args,
+          column_guards, &column_count, (size_t) params[i], guards[i]);
+      if (column < 0)
+        return nothing();
+    }
+  }
+  size_t candidate_size = 1 + 2 * argc;
+  size_t candidates_start = kDispatchPlanHeaderSize
+      + kDispatchPlanColumnSize * column_count;
+  TRY_DEF(result, new_heap_array(runtime,
+      candidates_start + candidate_size * candidate_count));
+  set_array_at(result, kDispatchPlanSliceIndex, slice);
+  set_array_at(result, kDispatchPlanArgumentCountIndex, new_integer(argc));
+  set_array_at(result, kDispatchPlanColumnCountIndex, new_integer(column_count));
+  set_array_at(result, kDispatchPlanCandidateCountIndex,
+      new_integer(candidate_count));
+  for (size_t ci = 0; ci < column_count; ci++) {
+    size_t start = kDispatchPlanHeaderSize + kDispatchPlanColumnSize * ci;
+    set_array_at(result, start, new_integer(column_args[ci]));
+    set_array_at(result, start + 1, column_guards[ci]);
+  }
+  // Second pass: record the candidates, in the order they appear in the slice
+  // since the outcome of a lookup depends on the order of the entries.
+  size_t cursor = candidates_start;
+  for (size_t ei = 0; ei < entry_count; ei++) {
+    value_t signature = get_pair_array_buffer_first_at(entries, ei);
+    if (!get_dispatch_plan_candidate_params(signature, tags, params, guards))
+      continue;
+    set_array_at(result, cursor, new_integer(ei));
+    for (size_t i = 0; i < argc; i++) {
+      int64_t column = (params[i] == kDispatchPlanExtraColumn)
+          ? kDispatchPlanExtraColumn
+          : get_or_add_dispatch_plan_column(column_args, column_guards,
+                &column_count, (size_t) params[i], guards[i]);
+      set_array_at(result, cursor + 1 + i, new_integer(column));
+      set_array_at(result, cursor + 1 + argc + i, new_integer(params[i]));
+    }
+    cursor += candidate_size;
+  }
+  return result;
+}
+
+value_t get_or_create_methodspace_dispatch_plan(runtime_t *runtime,
+    value_t self, value_t selector, value_t tags) {
+  TRY_DEF(record, get_or_create_methodspace_selector_record(runtime, self,
+      selector));
+  value_t plans = get_array_at(record, kSelectorRecordPlansIndex);
+  if (is_nothing(plans)) {
+    TRY_SET(plans, new_heap_id_hash_map(runtime, 16));
+    set_array_at(record, kSelectorRecordPlansIndex, plans);
+  }
+  value_t plan = get_id_hash_map_at(plans, tags);
+  if (in_condition_cause(ccNotFound, plan)) {
+    value_t slice = get_array_at(record, kSelectorRecordSliceIndex);
+    TRY_SET(plan, compile_dispatch_plan(runtime, slice, tags));
+    TRY(set_id_hash_map_at(runtime, plans, tags, plan));
   }
-  return slice;
+  return plan;
 }
 
-void invalidate_methodspace_caches(value_t self) {
+void invalidate_methodspace_caches(runtime_t *runtime, value_t self) {
+  flush_lookup_result_caches(runtime);
   value_t cache_ptr = get_methodspace_cache_ptr(self);
   set_freeze_cheat_value(cache_ptr, nothing());
 }
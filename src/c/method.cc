@@ -23,31 +23,52 @@ END_C_INCLUDES
 /// inputs or outputs, but the basic algorithm is always the same. To avoid
 /// repetition we use templates which are specialized below.
 
-template <typename I>
-value_t generic_match_signature(value_t self, I *input, value_t space,
-    match_info_t *match_info, match_result_t *result_out) {
-  CHECK_FAMILY(ofSignature, self);
-  CHECK_FAMILY_OPT(ofMethodspace, space);
-  TOPIC_INFO(Lookup, "Matching against %5v", self);
-  size_t argc = input->get_argument_count();
-  CHECK_REL("score array too short", argc, <=, match_info->capacity);
-  // Fast case if fewer than that minimum number of arguments is given.
-  size_t mandatory_count = (size_t) get_signature_mandatory_count(self);
-  if (argc < mandatory_count) {
-    *result_out = mrMissingArgument;
-    return success();
+// Set of the parameters seen while matching a signature, for signatures with
+// few enough parameters that the set fits in a word on the stack.
+class SmallParamsSeen {
+public:
+  SmallParamsSeen() : mask_(0) { }
+  // Marks the parameter with the given index as seen, returning true if it had
+  // already been seen.
+  bool test_and_set(size_t index) {
+    uint64_t bit = static_cast<uint64_t>(1) << index;
+    bool result = (mask_ & bit) != 0;
+    mask_ |= bit;
+    return result;
   }
-  // Fast case if too many arguments are given.
-  size_t param_count = (size_t) get_signature_parameter_count(self);
-  bool allow_extra = get_signature_allow_extra(self);
-  if (!allow_extra && (argc > param_count)) {
-    *result_out = mrUnexpectedArgument;
-    return success();
+  // The max number of parameters this set can hold.
+  static const size_t kLimit = 64;
+private:
+  uint64_t mask_;
+};
+
+// Set of the parameters seen while matching a signature with too many
+// parameters for a SmallParamsSeen.
+class LargeParamsSeen {
+public:
+  LargeParamsSeen(size_t param_count) {
+    bit_vector_init(&seen_, param_count, false);
   }
-  // Vector of parameters seen. This is used to ensure that we only see each
-  // parameter once.
-  bit_vector_t params_seen;
-  bit_vector_init(&params_seen, param_count, false);
+  ~LargeParamsSeen() {
+    bit_vector_dispose(&seen_);
+  }
+  bool test_and_set(size_t index) {
+    bool result = bit_vector_get_at(&seen_, index);
+    bit_vector_set_at(&seen_, index, true);
+    return result;
+  }
+private:
+  bit_vector_t seen_;
+};
+
+// Matches the input's arguments against the parameters of the given signature.
+// This is the part of generic_match_signature that runs after the fast checks
+// on the argument count.
+template <typename I, typename S>
+static value_t match_signature_arguments(value_t self, I *input, value_t space,
+    S *params_seen, match_info_t *match_info, match_result_t *result_out) {
+  size_t argc = input->get_argument_count();
+  bool allow_extra = get_signature_allow_extra(self);
   // Count how many mandatory parameters we see so we can check that we see all
   // of them.
   size_t mandatory_seen_count = 0;
@@ -58,13 +79,32 @@ value_t generic_match_signature(value_t self, I *input, value_t space,
     match_info->scores[i] = new_no_match_score();
     match_info->offsets[i] = kNoOffset;
   }
-  // Scan through the arguments and look them up in the signature.
+  // Scan through the arguments and look them up in the signature. Both the
+  // call tags and the signature's tags are sorted so rather than search for
+  // each tag we can find them all by merging the two, each step advancing
+  // through the signature's tags until we reach or pass the argument's tag.
   value_t tags = get_signature_tags(self);
+  size_t tag_count = (size_t) get_pair_array_length(tags);
+  size_t tag_cursor = 0;
   for (size_t i = 0; i < argc; i++) {
     value_t tag = input->get_tag_at(i);
-    // TODO: propagate any errors caused by this.
-    value_t param = binary_search_pair_array(tags, tag);
-    if (in_condition_cause(ccNotFound, param)) {
+    value_t param = nothing();
+    while (tag_cursor < tag_count) {
+      value_t current = get_pair_array_first_at(tags, tag_cursor);
+      if (is_same_value(current, tag)) {
+        param = get_pair_array_second_at(tags, tag_cursor++);
+        break;
+      }
+      TRY_DEF(ordering, value_ordering_compare(current, tag));
+      if (test_relation(ordering, reLessThan)) {
+        tag_cursor++;
+      } else {
+        if (test_relation(ordering, reEqual))
+          param = get_pair_array_second_at(tags, tag_cursor++);
+        break;
+      }
+    }
+    if (is_nothing(param)) {
       // The tag wasn't found in this signature.
       if (allow_extra) {
         // It's fine, this signature allows extra arguments.
@@ -73,17 +113,14 @@ value_t generic_match_signature(value_t self, I *input, value_t space,
         continue;
       } else {
         // This signature doesn't allow extra arguments so we bail out.
-        bit_vector_dispose(&params_seen);
         *result_out = mrUnexpectedArgument;
         return success();
       }
     }
-    CHECK_FALSE("binary search failed", get_value_domain(tags) == vdCondition);
     // The tag matched one in this signature.
     size_t index = (size_t) get_parameter_index(param);
-    if (bit_vector_get_at(&params_seen, index)) {
+    if (params_seen->test_and_set(index)) {
       // We've now seen two tags that match the same parameter. Bail out.
-      bit_vector_dispose(&params_seen);
       *result_out = mrRedundantArgument;
       return success();
     }
@@ -92,18 +129,16 @@ value_t generic_match_signature(value_t self, I *input, value_t space,
     TRY(input->match_value_at(index, guard, space, &score));
     if (!is_score_match(score)) {
       // The guard says the argument doesn't match. Bail out.
-      bit_vector_dispose(&params_seen);
       *result_out = mrGuardRejected;
       return success();
     }
     // We got a match! Record the result and move on to the next.
-    bit_vector_set_at(&params_seen, index, true);
     match_info->scores[i] = score;
     match_info->offsets[index] = input->get_offset_at(i);
     if (!get_parameter_is_optional(param))
       mandatory_seen_count++;
   }
-  bit_vector_dispose(&params_seen);
+  size_t mandatory_count = (size_t) get_signature_mandatory_count(self);
   if (mandatory_seen_count < mandatory_count) {
     // All arguments matched but there were mandatory arguments missing so it's
     // no good.
@@ -116,6 +151,41 @@ value_t generic_match_signature(value_t self, I *input, value_t space,
   }
 }
 
+template <typename I>
+value_t generic_match_signature(value_t self, I *input, value_t space,
+    match_info_t *match_info, match_result_t *result_out) {
+  CHECK_FAMILY(ofSignature, self);
+  CHECK_FAMILY_OPT(ofMethodspace, space);
+  TOPIC_INFO(Lookup, "Matching against %5v", self);
+  size_t argc = input->get_argument_count();
+  CHECK_REL("score array too short", argc, <=, match_info->capacity);
+  // Fast case if fewer than that minimum number of arguments is given.
+  size_t mandatory_count = (size_t) get_signature_mandatory_count(self);
+  if (argc < mandatory_count) {
+    *result_out = mrMissingArgument;
+    return success();
+  }
+  // Fast case if too many arguments are given.
+  size_t param_count = (size_t) get_signature_parameter_count(self);
+  bool allow_extra = get_signature_allow_extra(self);
+  if (!allow_extra && (argc > param_count)) {
+    *result_out = mrUnexpectedArgument;
+    return success();
+  }
+  // Keep track of the parameters seen to ensure that we only see each
+  // parameter once. Almost all signatures are small enough that this can be
+  // done with a mask on the stack.
+  if (param_count <= SmallParamsSeen::kLimit) {
+    SmallParamsSeen params_seen;
+    return match_signature_arguments(self, input, space, &params_seen,
+        match_info, result_out);
+  } else {
+    LargeParamsSeen params_seen(param_count);
+    return match_signature_arguments(self, input, space, &params_seen,
+        match_info, result_out);
+  }
+}
+
 // The state maintained while doing signature map lookup. Originally called
 // signature_map_lookup_state but it, and particularly the derived names, got
 // so long that it's now called the less descriptive sigmap_state_t.
@@ -156,10 +226,6 @@ static void sigmap_state_reset(sigmap_state_t<I, O> *state) {
     state->max_score[i] = new_no_match_score();
 }
 
-// The max amount of arguments for which we'll allocate the lookup state on the
-// stack.
-#define kSmallLookupLimit 8
-
 // Prepares a signature map lookup and then calls the callback which must
 // traverse the signature maps to include in the lookup and invoke
 // continue_signature_map_lookup for each of them. When the callback returns
@@ -186,6 +252,37 @@ static value_t generic_lookup_method(T *thunk, I *input, O *output) {
   return output->get_result();
 }
 
+// Includes a match of the given value with the score and offsets currently
+// stored in the given match info in the lookup associated with the given state.
+template <class I, class O>
+static value_t sigmap_state_add_match(sigmap_state_t<I, O> *state,
+    value_t value, match_info_t *match_info) {
+  size_t argc = state->input->get_argument_count();
+  join_status_t status = join_score_vectors(state->max_score,
+      match_info->scores, argc);
+  if (status == jsBetter || (state->max_is_synthetic && status == jsEqual)) {
+    // This score is either better than the previous best, or it is equal to
+    // the max which is itself synthetic and hence better than any of the
+    // entries we've seen so far.
+    TRY(state->output->add_better(value));
+    // Now the max definitely isn't synthetic.
+    state->max_is_synthetic = false;
+    // The offsets for the result is now stored in scratch_offsets and we have
+    // no more use for the previous result_offsets so we swap them around.
+    sigmap_state_swap_offsets(state);
+    // And then we have to update the match info with the new scratch offsets.
+    match_info_init(match_info, match_info->scores, state->scratch_offsets,
+        kSmallLookupLimit);
+  } else if (status != jsWorse) {
+    // The next score was not strictly worse than the best we've seen so we
+    // don't have a unique best.
+    TRY(state->output->add_ambiguous(value));
+    // If the result is ambiguous that means the max is now synthetic.
+    state->max_is_synthetic = (status == jsAmbiguous);
+  }
+  return success();
+}
+
 // Includes the given signature map in the lookup associated with the given
 // lookup state.
 template <class I, class O>
@@ -200,8 +297,6 @@ value_t continue_sigmap_lookup(sigmap_state_t<I, O> *state, value_t sigmap, valu
   match_info_init(&match_info, scratch_score, state->scratch_offsets,
       kSmallLookupLimit);
   I *input = state->input;
-  O *output = state->output;
-  size_t argc = input->get_argument_count();
   for (size_t current = 0; current < entry_count; current++) {
     value_t signature = get_pair_array_buffer_first_at(entries, current);
     value_t value = get_pair_array_buffer_second_at(entries, current);
@@ -209,28 +304,79 @@ value_t continue_sigmap_lookup(sigmap_state_t<I, O> *state, value_t sigmap, valu
     TRY(generic_match_signature(signature, input, space, &match_info, &match));
     if (!match_result_is_match(match))
       continue;
-    join_status_t status = join_score_vectors(state->max_score, scratch_score,
-        argc);
-    if (status == jsBetter || (state->max_is_synthetic && status == jsEqual)) {
-      // This score is either better than the previous best, or it is equal to
-      // the max which is itself synthetic and hence better than any of the
-      // entries we've seen so far.
-      TRY(output->add_better(value));
-      // Now the max definitely isn't synthetic.
-      state->max_is_synthetic = false;
-      // The offsets for the result is now stored in scratch_offsets and we have
-      // no more use for the previous result_offsets so we swap them around.
-      sigmap_state_swap_offsets(state);
-      // And then we have to update the match info with the new scratch offsets.
-      match_info_init(&match_info, scratch_score, state->scratch_offsets,
-          kSmallLookupLimit);
-    } else if (status != jsWorse) {
-      // The next score was not strictly worse than the best we've seen so we
-      // don't have a unique best.
-      TRY(output->add_ambiguous(value));
-      // If the result is ambiguous that means the max is now synthetic.
-      state->max_is_synthetic = (status == jsAmbiguous);
+    TRY(sigmap_state_add_match(state, value, &match_info));
+  }
+  return success();
+}
+
+// Includes the slice of the given dispatch plan in the lookup associated with
+// the given lookup state. This gives exactly the same result as scanning the
+// slice with continue_sigmap_lookup but only visits the entries that can match
+// the tags and tests each distinct guard at most once. Guards are tested
+// lazily in the same order as the scan would, so the input sees a subset of
+// the same guard matches.
+template <class I, class O>
+value_t continue_dispatch_plan_lookup(sigmap_state_t<I, O> *state, value_t plan,
+    value_t space) {
+  CHECK_FAMILY(ofArray, plan);
+  CHECK_FAMILY(ofMethodspace, space);
+  value_t slice = get_array_at(plan, kDispatchPlanSliceIndex);
+  TOPIC_INFO(Lookup, "Looking up through dispatch plan for %v", slice);
+  value_t entries = get_signature_map_entries(slice);
+  size_t argc = state->input->get_argument_count();
+  CHECK_EQ("plan for different tags", argc, (size_t) get_integer_value(
+      get_array_at(plan, kDispatchPlanArgumentCountIndex)));
+  size_t column_count = (size_t) get_integer_value(
+      get_array_at(plan, kDispatchPlanColumnCountIndex));
+  size_t candidate_count = (size_t) get_integer_value(
+      get_array_at(plan, kDispatchPlanCandidateCountIndex));
+  // The score of each column, or nothing if it hasn't been tested yet.
+  value_t column_scores[kDispatchPlanMaxColumnCount];
+  for (size_t i = 0; i < column_count; i++)
+    column_scores[i] = nothing();
+  value_t scratch_score[kSmallLookupLimit];
+  match_info_t match_info;
+  match_info_init(&match_info, scratch_score, state->scratch_offsets,
+      kSmallLookupLimit);
+  I *input = state->input;
+  size_t candidate_size = 1 + 2 * argc;
+  size_t cursor = kDispatchPlanHeaderSize + kDispatchPlanColumnSize * column_count;
+  for (size_t ci = 0; ci < candidate_count; ci++, cursor += candidate_size) {
+    bool is_match = true;
+    for (size_t i = 0; i < argc; i++) {
+      match_info.scores[i] = new_no_match_score();
+      match_info.offsets[i] = kNoOffset;
+    }
+    for (size_t i = 0; i < argc; i++) {
+      int64_t column = get_integer_value(get_array_at(plan, cursor + 1 + i));
+      if (column == kDispatchPlanExtraColumn) {
+        match_info.scores[i] = new_extra_match_score();
+        continue;
+      }
+      value_t score = column_scores[column];
+      if (is_nothing(score)) {
+        size_t column_start = kDispatchPlanHeaderSize
+            + kDispatchPlanColumnSize * column;
+        size_t index = (size_t) get_integer_value(get_array_at(plan,
+            column_start));
+        value_t guard = get_array_at(plan, column_start + 1);
+        TRY(input->match_value_at(index, guard, space, &score));
+        column_scores[column] = score;
+      }
+      if (!is_score_match(score)) {
+        is_match = false;
+        break;
+      }
+      size_t param = (size_t) get_integer_value(
+          get_array_at(plan, cursor + 1 + argc + i));
+      match_info.scores[i] = score;
+      match_info.offsets[param] = input->get_offset_at(i);
     }
+    if (!is_match)
+      continue;
+    size_t entry = (size_t) get_integer_value(get_array_at(plan, cursor));
+    value_t value = get_pair_array_buffer_second_at(entries, entry);
+    TRY(sigmap_state_add_match(state, value, &match_info));
   }
   return success();
 }
@@ -277,10 +423,18 @@ static value_t lookup_through_input(sigmap_state_t<I, O> *state) {
     }
   } else {
     // If there is a selector the methodspace will give us a pre-computed slice
-    // of methods that are the ones that can match, no others.
-    TRY_DEF(slice, get_or_create_methodspace_selector_slice(state->input->get_runtime(),
-        space, selector));
-    TRY(continue_sigmap_lookup(state, slice, space));
+    // of methods that are the ones that can match, no others, compiled into a
+    // plan for these tags if possible.
+    runtime_t *runtime = state->input->get_runtime();
+    TRY_DEF(plan, get_or_create_methodspace_dispatch_plan(runtime, space,
+        selector, state->input->get_tags()));
+    if (is_nothing(plan)) {
+      TRY_DEF(slice, get_or_create_methodspace_selector_slice(runtime, space,
+          selector));
+      TRY(continue_sigmap_lookup(state, slice, space));
+    } else {
+      TRY(continue_dispatch_plan_lookup(state, plan, space));
+    }
   }
   return success();
 }
@@ -297,6 +451,9 @@ public:
   runtime_t *get_runtime();
   value_t get_ambience();
   value_t get_tags();
+  // Called when the lookup has to resolve the result through the subject, for
+  // instance the methods of a lambda. By default does nothing.
+  void on_special_lookup() { }
 private:
   value_t ambience_;
   value_t tags_;
@@ -414,6 +571,59 @@ value_t FrameSigmapInputWithNexts::match_value_at(size_t index, value_t guard,
   }
 }
 
+// Frame input that records the lookup's footprint as it goes.
+class FootprintFrameSigmapInput : public FrameSigmapInput {
+public:
+  FootprintFrameSigmapInput(sigmap_input_layout_t *layout, frame_t *frame,
+      lookup_footprint_t *footprint);
+  value_t get_selector();
+  value_t match_value_at(size_t index, value_t guard, value_t space, value_t *score_out);
+  void on_special_lookup();
+private:
+  // Marks the argument at the given index as being compared by identity.
+  void record_identity_dependency(size_t index);
+  lookup_footprint_t *footprint_;
+};
+
+FootprintFrameSigmapInput::FootprintFrameSigmapInput(sigmap_input_layout_t *layout,
+    frame_t *frame, lookup_footprint_t *footprint)
+  : FrameSigmapInput(layout, frame)
+  , footprint_(footprint) {
+  footprint_->identity_mask = 0;
+  footprint_->is_cacheable = true;
+}
+
+void FootprintFrameSigmapInput::record_identity_dependency(size_t index) {
+  if (index < 32) {
+    footprint_->identity_mask |= (1u << index);
+  } else {
+    footprint_->is_cacheable = false;
+  }
+}
+
+value_t FootprintFrameSigmapInput::get_selector() {
+  // The selector determines which slice of the methodspace is looked through
+  // so the result always depends on its identity, regardless of which guards
+  // end up being matched.
+  value_t offset = get_call_tags_selector_offset(get_tags());
+  if (!is_nothing(offset))
+    record_identity_dependency((size_t) get_integer_value(offset));
+  return FrameSigmapInput::get_selector();
+}
+
+value_t FootprintFrameSigmapInput::match_value_at(size_t index, value_t guard,
+    value_t space, value_t *score_out) {
+  // Is-guards only depend on the primary type and any-guards don't depend on
+  // the value at all so it's only eq-guards that make the identity matter.
+  if (get_guard_type(guard) == gtEq)
+    record_identity_dependency(index);
+  return FrameSigmapInput::match_value_at(index, guard, space, score_out);
+}
+
+void FootprintFrameSigmapInput::on_special_lookup() {
+  footprint_->is_cacheable = false;
+}
+
 // Lookup input that gets values from an array.
 class ValueArraySigmapInput : public AbstractSigmapInput {
 public:
@@ -650,11 +860,13 @@ value_t InvocationThunk<I, O>::call(sigmap_state_t<I, O> *state) {
     value_t result_flags = get_method_flags(result);
     if (!is_flag_set_empty(result_flags)) {
       value_t subject = input_->get_subject();
-      // The result has at least one special flag set so we have to give this
+      // The result has at least one flag set so we may have to give this
       // lookup special treatment.
       if (get_flag_set_at(result_flags, mfLambdaDelegate)) {
+        input_->on_special_lookup();
         return complete_special_lambda_lookup(subject, state, arg_map_out_);
       } else if (get_flag_set_at(result_flags, mfBlockDelegate)) {
+        input_->on_special_lookup();
         return complete_special_block_lookup(subject, state, arg_map_out_);
       }
     }
@@ -709,20 +921,194 @@ value_t match_signature_from_call_data(value_t self, sigmap_input_layout_t *layo
   return generic_match_signature(self, &in, space, match_info, result_out);
 }
 
+/// ## Global lookup cache
+///
+/// Lookups whose footprint says they're cacheable are memoized in a runtime-
+/// wide table that sits in front of the full lookup. It covers the lookups the
+/// interpreter's inline caches can't: megamorphic sites, and signal handler
+/// lookups. The table is lossy, each lookup hashes to exactly one entry which
+/// is simply overwritten on conflict, and it's flushed lazily: entries are
+/// only valid under the methodspace epoch they were stored under.
+
+// The different kinds of lookups stored in the global lookup cache. Entries
+// of different kinds may look the same otherwise but mean different things.
+typedef enum {
+  glInvocation,
+  glSignalHandler
+} global_lookup_kind_t;
+
+// Returns the key the argument with the given index is identified by in a
+// global lookup cache entry.
+static value_t get_global_lookup_cache_key(runtime_t *runtime, frame_t *frame,
+    value_t tags, size_t index, uint32_t identity_mask) {
+  value_t value = frame_get_pending_argument_at(frame, tags, index);
+  return (identity_mask & (1u << index))
+      ? value
+      : get_primary_type(value, runtime);
+}
+
+// Writes the given part of a global lookup cache key to the hash stream. Heap
+// objects are hashed by the identity hash the heap gives them rather than by
+// their address, so an entry stays in the same place when the gc moves its
+// keys.
+static value_t global_lookup_cache_hash_key(runtime_t *runtime,
+    hash_stream_t *stream, value_t key) {
+  if (get_value_domain(key) == vdHeapObject) {
+    TRY_DEF(serial, heap_get_identity_hash(&runtime->heap, key));
+    hash_stream_write_int64(stream, get_integer_value(serial));
+  } else {
+    hash_stream_write_int64(stream, key.encoded);
+  }
+  return success();
+}
+
+// Returns the start of the global lookup cache entry that the lookup of the
+// invocation pending on the given frame hashes to, or a condition if it can't
+// be hashed. The hash only depends on the primary types of the arguments,
+// except for the selector which every invocation depends on the identity of,
+// since the identity mask isn't known until an entry has been found.
+static value_t get_global_lookup_cache_entry_start(runtime_t *runtime,
+    global_lookup_kind_t kind, value_t space, value_t tags, frame_t *frame) {
+  hash_stream_t stream;
+  hash_stream_init(&stream);
+  hash_stream_write_int64(&stream, kind);
+  TRY(global_lookup_cache_hash_key(runtime, &stream, space));
+  TRY(global_lookup_cache_hash_key(runtime, &stream, tags));
+  value_t selector_offset = get_call_tags_selector_offset(tags);
+  uint32_t selector_mask = is_nothing(selector_offset)
+      ? 0
+      : (1u << get_integer_value(selector_offset));
+  size_t argc = (size_t) get_call_tags_entry_count(tags);
+  for (size_t i = 0; i < argc; i++) {
+    value_t key = get_global_lookup_cache_key(runtime, frame, tags, i,
+        selector_mask);
+    TRY(key);
+    TRY(global_lookup_cache_hash_key(runtime, &stream, key));
+  }
+  uint64_t hash = (uint64_t) hash_stream_flush(&stream);
+  return new_integer((int64_t) ((hash % kGlobalLookupCacheEntryCount)
+      * kGlobalLookupCacheEntrySize));
+}
+
+// Looks up the invocation pending on the given frame in the global lookup
+// cache. If there is an entry returns the method, storing the argument map and
+// footprint in the out parameters, otherwise returns nothing.
+static value_t global_lookup_cache_probe(runtime_t *runtime,
+    global_lookup_kind_t kind, value_t space, value_t tags, frame_t *frame,
+    value_t *arg_map_out, lookup_footprint_t *footprint_out) {
+  size_t argc = (size_t) get_call_tags_entry_count(tags);
+  if (argc > kGlobalLookupCacheMaxArgc)
+    return nothing();
+  value_t cache = MROOT(runtime, global_lookup_cache);
+  value_t start_value = get_global_lookup_cache_entry_start(runtime, kind,
+      space, tags, frame);
+  if (is_condition(start_value))
+    // If the lookup can't be hashed it's treated as a miss.
+    return nothing();
+  size_t start = (size_t) get_integer_value(start_value);
+  value_t epoch = get_array_at(cache, start + kGlobalLookupCacheEntryEpochIndex);
+  if (is_null(epoch)
+      || get_integer_value(epoch) != (int64_t) runtime->methodspace_epoch
+      || get_integer_value(get_array_at(cache, start + kGlobalLookupCacheEntryKindIndex)) != kind
+      || !is_same_value(space, get_array_at(cache, start + kGlobalLookupCacheEntryMethodspaceIndex))
+      || !is_same_value(tags, get_array_at(cache, start + kGlobalLookupCacheEntryTagsIndex)))
+    return nothing();
+  value_t mask_value = get_array_at(cache,
+      start + kGlobalLookupCacheEntryIdentityMaskIndex);
+  uint32_t identity_mask = (uint32_t) get_integer_value(mask_value);
+  for (size_t i = 0; i < argc; i++) {
+    value_t key = get_global_lookup_cache_key(runtime, frame, tags, i,
+        identity_mask);
+    value_t entry_key = get_array_at(cache,
+        start + kGlobalLookupCacheEntryFirstKeyIndex + i);
+    if (!is_same_value(key, entry_key))
+      return nothing();
+  }
+  *arg_map_out = get_array_at(cache,
+      start + kGlobalLookupCacheEntryArgumentMapIndex);
+  footprint_out->identity_mask = identity_mask;
+  footprint_out->is_cacheable = true;
+  return get_array_at(cache, start + kGlobalLookupCacheEntryMethodIndex);
+}
+
+// Records the result of a lookup of the invocation pending on the given frame
+// in the global lookup cache, replacing whatever entry was there before.
+static void global_lookup_cache_store(runtime_t *runtime,
+    global_lookup_kind_t kind, value_t space, value_t tags, frame_t *frame,
+    value_t method, value_t arg_map, lookup_footprint_t *footprint) {
+  CHECK_TRUE("caching uncacheable", footprint->is_cacheable);
+  size_t argc = (size_t) get_call_tags_entry_count(tags);
+  if (argc > kGlobalLookupCacheMaxArgc)
+    return;
+  value_t cache = MROOT(runtime, global_lookup_cache);
+  value_t start_value = get_global_lookup_cache_entry_start(runtime, kind,
+      space, tags, frame);
+  if (is_condition(start_value))
+    return;
+  size_t start = (size_t) get_integer_value(start_value);
+  for (size_t i = 0; i < argc; i++) {
+    value_t key = get_global_lookup_cache_key(runtime, frame, tags, i,
+        footprint->identity_mask);
+    if (is_condition(key)) {
+      // If we can't key on this argument we can't cache the result; make
+      // sure the entry isn't left half-written.
+      set_array_at(cache, start + kGlobalLookupCacheEntryEpochIndex, null());
+      return;
+    }
+    set_array_at(cache, start + kGlobalLookupCacheEntryFirstKeyIndex + i, key);
+  }
+  set_array_at(cache, start + kGlobalLookupCacheEntryKindIndex, new_integer(kind));
+  set_array_at(cache, start + kGlobalLookupCacheEntryMethodspaceIndex, space);
+  set_array_at(cache, start + kGlobalLookupCacheEntryTagsIndex, tags);
+  set_array_at(cache, start + kGlobalLookupCacheEntryMethodIndex, method);
+  set_array_at(cache, start + kGlobalLookupCacheEntryArgumentMapIndex, arg_map);
+  set_array_at(cache, start + kGlobalLookupCacheEntryIdentityMaskIndex,
+      new_integer(footprint->identity_mask));
+  set_array_at(cache, start + kGlobalLookupCacheEntryEpochIndex,
+      new_integer((int64_t) runtime->methodspace_epoch));
+}
+
 value_t lookup_method_full_from_frame(sigmap_input_layout_t *layout,
     frame_t *frame, value_t *arg_map_out) {
-  UniqueBestMatchOutput out;
   if (is_nothing(layout->next_guards)) {
-    FrameSigmapInput in(layout, frame);
-    InvocationThunk<FrameSigmapInput, UniqueBestMatchOutput> thunk(&in, arg_map_out);
-    return generic_lookup_method(&thunk, &in, &out);
+    // Go through the footprint version so the lookup can use the global
+    // lookup cache.
+    lookup_footprint_t footprint;
+    return lookup_method_full_from_frame_with_footprint(layout, frame,
+        arg_map_out, &footprint);
   } else {
+    UniqueBestMatchOutput out;
     FrameSigmapInputWithNexts in(layout, frame);
     InvocationThunk<FrameSigmapInputWithNexts, UniqueBestMatchOutput> thunk(&in, arg_map_out);
     return generic_lookup_method(&thunk, &in, &out);
   }
 }
 
+value_t lookup_method_full_from_frame_with_footprint(
+    sigmap_input_layout_t *layout, frame_t *frame, value_t *arg_map_out,
+    lookup_footprint_t *footprint_out) {
+  if (!is_nothing(layout->next_guards)) {
+    footprint_out->identity_mask = 0;
+    footprint_out->is_cacheable = false;
+    return lookup_method_full_from_frame(layout, frame, arg_map_out);
+  }
+  runtime_t *runtime = get_ambience_runtime(layout->ambience);
+  value_t space = get_ambience_methodspace(layout->ambience);
+  value_t cached = global_lookup_cache_probe(runtime, glInvocation, space,
+      layout->tags, frame, arg_map_out, footprint_out);
+  if (!is_nothing(cached))
+    return cached;
+  UniqueBestMatchOutput out;
+  FootprintFrameSigmapInput in(layout, frame, footprint_out);
+  InvocationThunk<FootprintFrameSigmapInput, UniqueBestMatchOutput> thunk(&in,
+      arg_map_out);
+  TRY_DEF(result, generic_lookup_method(&thunk, &in, &out));
+  if (footprint_out->is_cacheable)
+    global_lookup_cache_store(runtime, glInvocation, space, layout->tags,
+        frame, result, *arg_map_out, footprint_out);
+  return result;
+}
+
 value_t lookup_method_full_from_value_array(sigmap_input_layout_t *layout,
     value_t values, value_t *arg_map_out) {
   UniqueBestMatchOutput out;
@@ -732,12 +1118,53 @@ value_t lookup_method_full_from_value_array(sigmap_input_layout_t *layout,
   return generic_lookup_method(&thunk, &in, &out);
 }
 
+// If there is exactly one signal handler on the stack returns it, otherwise
+// returns nothing.
+static value_t get_only_signal_handler(frame_t *frame) {
+  value_t result = nothing();
+  barrier_iter_t barrier_iter;
+  value_t barrier = barrier_iter_init(&barrier_iter, frame);
+  while (!is_nothing(barrier)) {
+    if (in_genus(dgSignalHandlerSection, barrier)) {
+      if (!is_nothing(result))
+        return nothing();
+      result = barrier;
+    }
+    barrier = barrier_iter_advance(&barrier_iter);
+  }
+  return result;
+}
+
 value_t lookup_signal_handler_method_from_frame(sigmap_input_layout_t *layout,
     frame_t *frame, value_t *handler_out, value_t *arg_map_out) {
-  FrameSigmapInput in(layout, frame);
-  SignalHandlerThunk<FrameSigmapInput> thunk(handler_out, arg_map_out, frame);
+  // The result of a signal handler lookup depends on all the handlers on the
+  // stack which we can't key on in general. With just one handler though the
+  // lookup only depends on that one's methods.
+  value_t handler = get_only_signal_handler(frame);
+  if (is_nothing(handler)) {
+    FrameSigmapInput in(layout, frame);
+    SignalHandlerThunk<FrameSigmapInput> thunk(handler_out, arg_map_out, frame);
+    SignalHandlerOutput out;
+    return generic_lookup_method(&thunk, &in, &out);
+  }
+  runtime_t *runtime = get_ambience_runtime(layout->ambience);
+  value_t space = get_barrier_state_payload(handler);
+  lookup_footprint_t footprint;
+  value_t cached = global_lookup_cache_probe(runtime, glSignalHandler, space,
+      layout->tags, frame, arg_map_out, &footprint);
+  if (!is_nothing(cached)) {
+    *handler_out = handler;
+    return cached;
+  }
+  FootprintFrameSigmapInput in(layout, frame, &footprint);
+  SignalHandlerThunk<FootprintFrameSigmapInput> thunk(handler_out, arg_map_out,
+      frame);
   SignalHandlerOutput out;
-  return generic_lookup_method(&thunk, &in, &out);
+  TRY_DEF(result, generic_lookup_method(&thunk, &in, &out));
+  if (footprint.is_cacheable)
+    global_lookup_cache_store(runtime, glSignalHandler, space, layout->tags,
+        frame, result, *arg_map_out, &footprint);
+  return result;
 }
 
 value_t lookup_signal_handler_method_from_value_array(sigmap_input_layout_t *layout,
@@ -205,7 +205,11 @@ typedef enum {
   // This method delegates to a block. If lookup results in a method with this
   // flag the lookup process should take an extra step to resolve the method in
   // the subject block's home methodspace.
-  mfBlockDelegate = 0x02
+  mfBlockDelegate = 0x02,
+  // This method is implemented by a builtin that only accesses its arguments
+  // through the builtin argument accessors and never escapes, so it can be
+  // called directly without pushing a frame for it.
+  mfFrameless = 0x04
 } method_flag_t;
 
 static const size_t kMethodSize = HEAP_OBJECT_SIZE(5);
@@ -302,6 +306,14 @@ value_t add_methodspace_inheritance(runtime_t *runtime, value_t self,
 // Returns the array buffer of parents of the given type.
 value_t get_type_parents(runtime_t *runtime, value_t space, value_t type);
 
+// Stores in score_out the score of matching a value whose primary type is the
+// given type against an is-guard for the target type within the given
+// methodspace. The closer the target is to the type in the inheritance
+// hierarchy the better the score. Each type's ancestry is computed once and
+// cached until the methodspace changes so this takes a single lookup.
+value_t match_methodspace_type(runtime_t *runtime, value_t space, value_t type,
+    value_t target, value_t *score_out);
+
 // Add a method to this metod space. Returns a condition if adding fails, for
 // instance if we run out of memory to increase the size of the map.
 value_t add_methodspace_method(runtime_t *runtime, value_t self,
@@ -311,10 +323,101 @@ value_t add_methodspace_method(runtime_t *runtime, value_t self,
 value_t get_or_create_methodspace_selector_slice(runtime_t *runtime, value_t self,
     value_t selector);
 
-// Clears any caches that depend on the current state of this methodspace.
-// Ideally there wouldn't be any caches in a mutable methodspace but that'll
-// have to be cleaned up later.
-void invalidate_methodspace_caches(value_t self);
+// The max amount of arguments for which we'll allocate the lookup state on the
+// stack.
+#define kSmallLookupLimit 8
+
+// A dispatch plan is a selector slice compiled for invocations with a
+// particular set of call tags. All the work of the lookup that only depends on
+// the tags, which parameter each argument binds to and whether the signature
+// can match at all, is done once when the plan is built, and the guards that
+// remain are numbered such that each distinct guard is tested at most once
+// for each argument position. The plan is stored in an array laid out as the
+// header below followed by the guard columns, each a pair of the index the
+// guard is matched at and the guard, and then by the candidates, each the
+// index of the entry in the slice followed by one column index and one
+// parameter index per argument.
+static const size_t kDispatchPlanSliceIndex = 0;
+static const size_t kDispatchPlanArgumentCountIndex = 1;
+static const size_t kDispatchPlanColumnCountIndex = 2;
+static const size_t kDispatchPlanCandidateCountIndex = 3;
+static const size_t kDispatchPlanHeaderSize = 4;
+
+// The size of a guard column.
+static const size_t kDispatchPlanColumnSize = 2;
+
+// The max number of distinct guards a plan can test; slices that need more
+// than this are looked up by scanning.
+#define kDispatchPlanMaxColumnCount 256
+
+// Column index used for arguments that match a signature as an extra argument
+// so there is no guard to test.
+static const int64_t kDispatchPlanExtraColumn = -1;
+
+// Returns the dispatch plan for invocations of the given selector with the
+// given tags through the given methodspace, creating it if it doesn't already
+// exist. If the slice can't be compiled into a plan nothing is returned.
+value_t get_or_create_methodspace_dispatch_plan(runtime_t *runtime,
+    value_t self, value_t selector, value_t tags);
+
+// Clears any caches that depend on the current state of this methodspace,
+// including any inline caches in the interpreter that may have cached lookups
+// through it. Ideally there wouldn't be any caches in a mutable methodspace but
+// that'll have to be cleaned up later.
+void invalidate_methodspace_caches(runtime_t *runtime, value_t self);
+
+// Updates the caches that depend on this methodspace's methods after the given
+// method has been added. Only the selector slices the method can be part of
+// are affected, and those that exist are updated in place rather than rebuilt.
+// Inline caches in the interpreter are flushed.
+void update_methodspace_selector_caches(runtime_t *runtime, value_t self,
+    value_t signature, value_t method);
+
+// Clears the caches that depend on this methodspace's inheritance hierarchy,
+// including any inline caches in the interpreter.
+void invalidate_methodspace_type_caches(runtime_t *runtime, value_t self);
+
+// Describes what the result of a method lookup depended on, other than the
+// call tags and the methodspace being looked through. If the result is
+// cacheable any other invocation with the same tags, where the arguments have
+// the same primary types and the arguments in the identity mask are identical,
+// will give the same result as long as no methodspaces change.
+typedef struct {
+  // Bit i is set if the result depends on the identity of the argument at
+  // index i of the call tags, not just its primary type.
+  uint32_t identity_mask;
+  // Can the result be cached at all? This will be false if the lookup
+  // depended on state that isn't captured by the arguments, for instance the
+  // methods of a lambda subject.
+  bool is_cacheable;
+} lookup_footprint_t;
+
+// The number of entries in the runtime-wide lookup cache.
+#define kGlobalLookupCacheEntryCount 256
+
+// The max number of arguments a lookup can have and still be cached in the
+// global lookup cache.
+#define kGlobalLookupCacheMaxArgc 8
+
+// The global lookup cache is a fixed-size, lossy hash table stored in a single
+// flat array. Each entry holds the methodspace epoch it was stored under (or
+// null if it's empty), the kind of lookup, the methodspace and call tags, the
+// resulting method and argument map, the identity mask of the lookup's
+// footprint, and then one key per argument, the argument itself if it's in the
+// identity mask otherwise its primary type.
+static const size_t kGlobalLookupCacheEntryEpochIndex = 0;
+static const size_t kGlobalLookupCacheEntryKindIndex = 1;
+static const size_t kGlobalLookupCacheEntryMethodspaceIndex = 2;
+static const size_t kGlobalLookupCacheEntryTagsIndex = 3;
+static const size_t kGlobalLookupCacheEntryMethodIndex = 4;
+static const size_t kGlobalLookupCacheEntryArgumentMapIndex = 5;
+static const size_t kGlobalLookupCacheEntryIdentityMaskIndex = 6;
+static const size_t kGlobalLookupCacheEntryFirstKeyIndex = 7;
+static const size_t kGlobalLookupCacheEntrySize = 7 + kGlobalLookupCacheMaxArgc;
+
+// The total size of the array that holds the global lookup cache.
+static const size_t kGlobalLookupCacheSize =
+    kGlobalLookupCacheEntryCount * kGlobalLookupCacheEntrySize;
 
 // Looks up a method in the given fragment given a set of inputs, including
 // resolving lambda and block methods. If the match is successful, as a
@@ -326,6 +429,15 @@ void invalidate_methodspace_caches(value_t self);
 value_t lookup_method_full_from_frame(sigmap_input_layout_t *layout,
     frame_t *frame, value_t *arg_map_out);
 
+// Works the same way as lookup_method_full_from_frame but additionally records
+// in the given footprint what the result depended on, such that the caller can
+// decide whether and how to cache it. Lookups that use next guards are never
+// considered cacheable. Cacheable lookups are served from and recorded in the
+// runtime's global lookup cache.
+value_t lookup_method_full_from_frame_with_footprint(
+    sigmap_input_layout_t *layout, frame_t *frame, value_t *arg_map_out,
+    lookup_footprint_t *footprint_out);
+
 // Looks up a method in the given fragment given a set of inputs, including
 // resolving lambda and block methods. If the match is successful, as a
 // side-effect stores an argument map that maps between the result's parameters
@@ -342,7 +454,9 @@ value_t lookup_methodspace_method_from_frame(sigmap_input_layout_t *layout,
 
 // Scans through the stack looking for signal handler methods, returning the
 // best match if there is one otherwise a LookupError condition. The signal
-// handler that contains the method is stored in handler_out.
+// handler that contains the method is stored in handler_out. If there is just
+// one signal handler on the stack the lookup goes through the global lookup
+// cache.
 value_t lookup_signal_handler_method_from_frame(sigmap_input_layout_t *layout,
     frame_t *frame, value_t *handler_out, value_t *arg_map_out);
 
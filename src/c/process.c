@@ -129,6 +129,10 @@ static void read_stack_piece_lid(value_t piece, frame_t *frame) {
 
 void open_stack_piece(value_t piece, frame_t *frame) {
   CHECK_FAMILY(ofStackPiece, piece);
+  // Frames write directly into the piece's storage without going through the
+  // write barrier so the piece is recorded up front instead. This relies on
+  // there being no collections while a piece is open.
+  heap_object_bulk_write_barrier(piece);
   read_stack_piece_lid(piece, frame);
   set_stack_piece_lid_frame_pointer(piece, nothing());
 }
@@ -197,8 +201,8 @@ void frame_walk_down_stack(frame_t *frame) {
   frame->limit_pointer = stack_start + frame_get_previous_limit_pointer(&snapshot);
   frame->flags = frame_get_previous_flags(&snapshot);
   frame->pc = frame_get_previous_pc(&snapshot);
-  // The stack pointer will be the first field of the top frame's header.
-  frame->stack_pointer = snapshot.frame_pointer - kFrameHeaderSize;
+  frame->stack_pointer = stack_start
+      + frame_get_previous_stack_pointer(&snapshot);
 }
 
 bool frame_has_flag(frame_t *frame, frame_flag_t flag) {
@@ -264,11 +268,57 @@ bool try_push_new_frame(frame_t *frame, size_t frame_capacity, uint32_t flags,
   // Record the relevant information about the previous frame in the new frame's
   // header.
   frame_set_previous_frame_pointer(frame, old_frame.frame_pointer - stack_piece_start);
+  frame_set_previous_stack_pointer(frame, old_frame.stack_pointer - stack_piece_start);
   frame_set_previous_limit_pointer(frame, old_frame.limit_pointer - stack_piece_start);
   frame_set_previous_flags(frame, old_frame.flags);
   frame_set_previous_pc(frame, old_frame.pc);
   frame_set_code_block(frame, nothing());
   frame_set_argument_map(frame, nothing());
+  frame_set_tail_call_tags(frame, nothing());
+  return true;
+}
+
+bool try_push_tail_frame(frame_t *frame, size_t frame_capacity, size_t argc,
+    value_t arg_map, value_t tags) {
+  value_t stack_piece = frame->stack_piece;
+  CHECK_FALSE("pushing closed stack piece", is_stack_piece_closed(stack_piece));
+  CHECK_TRUE("tail call from synthetic frame", frame_has_flag(frame, ffOrganic));
+  frame_t old_frame = *frame;
+  value_t *stack_piece_start = get_stack_piece_storage(stack_piece);
+  size_t capacity = (size_t) get_integer_value(get_stack_piece_capacity(stack_piece));
+  value_t *stack_piece_limit = stack_piece_start + capacity - kFrameHeaderSize;
+  // The new frame starts where the caller's stack ended, that is, where the
+  // old frame's arguments end if it was pushed by a normal invocation or where
+  // they start if it was itself pushed by a tail call. Either way the caller's
+  // stack is left untouched.
+  size_t previous_stack_pointer = frame_get_previous_stack_pointer(&old_frame);
+  value_t *new_arguments = stack_piece_start + previous_stack_pointer;
+  value_t *new_frame_pointer = new_arguments + argc + kFrameHeaderSize;
+  value_t *new_frame_limit = new_frame_pointer + frame_capacity;
+  if (new_frame_limit > stack_piece_limit)
+    return false;
+  // Grab the old header before it gets overwritten.
+  size_t previous_frame_pointer = frame_get_previous_frame_pointer(&old_frame);
+  size_t previous_limit_pointer = frame_get_previous_limit_pointer(&old_frame);
+  value_t previous_flags = frame_get_previous_flags(&old_frame);
+  size_t previous_pc = frame_get_previous_pc(&old_frame);
+  // Move the arguments down. The destination is always below the source so
+  // copying from the bottom up is safe even if they overlap.
+  value_t *old_arguments = old_frame.stack_pointer - argc;
+  for (size_t i = 0; i < argc; i++)
+    new_arguments[i] = old_arguments[i];
+  frame->stack_pointer = frame->frame_pointer = new_frame_pointer;
+  frame->limit_pointer = new_frame_limit;
+  frame->flags = new_flag_set(ffOrganic);
+  frame->pc = 0;
+  frame_set_previous_frame_pointer(frame, previous_frame_pointer);
+  frame_set_previous_stack_pointer(frame, previous_stack_pointer);
+  frame_set_previous_limit_pointer(frame, previous_limit_pointer);
+  frame_set_previous_flags(frame, previous_flags);
+  frame_set_previous_pc(frame, previous_pc);
+  frame_set_code_block(frame, nothing());
+  frame_set_argument_map(frame, arg_map);
+  frame_set_tail_call_tags(frame, tags);
   return true;
 }
 
@@ -305,6 +355,16 @@ size_t frame_get_previous_frame_pointer(frame_t *frame) {
       *access_frame_header_field(frame, kFrameHeaderPreviousFramePointerOffset));
 }
 
+void frame_set_previous_stack_pointer(frame_t *frame, size_t value) {
+  *access_frame_header_field(frame, kFrameHeaderPreviousStackPointerOffset) =
+      new_integer(value);
+}
+
+size_t frame_get_previous_stack_pointer(frame_t *frame) {
+  return (size_t) get_integer_value(
+      *access_frame_header_field(frame, kFrameHeaderPreviousStackPointerOffset));
+}
+
 void frame_set_previous_limit_pointer(frame_t *frame, size_t value) {
   *access_frame_header_field(frame, kFrameHeaderPreviousLimitPointerOffset) =
       new_integer(value);
@@ -340,6 +400,14 @@ value_t frame_get_argument_map(frame_t *frame) {
   return *access_frame_header_field(frame, kFrameHeaderArgumentMapOffset);
 }
 
+void frame_set_tail_call_tags(frame_t *frame, value_t tags) {
+  *access_frame_header_field(frame, kFrameHeaderTailCallTagsOffset) = tags;
+}
+
+value_t frame_get_tail_call_tags(frame_t *frame) {
+  return *access_frame_header_field(frame, kFrameHeaderTailCallTagsOffset);
+}
+
 void frame_set_previous_pc(frame_t *frame, size_t pc) {
   *access_frame_header_field(frame, kFrameHeaderPreviousPcOffset) = new_integer(pc);
 }
@@ -641,6 +709,19 @@ void backtrace_print_on(value_t value, print_on_context_t *context) {
   }
 }
 
+// Adds the given entry to the given backtrace entries unless it is nothing or
+// there are still entries to be skipped.
+static value_t add_backtrace_entry(runtime_t *runtime, value_t frames,
+    value_t entry, size_t *remaining_skips) {
+  if (is_nothing(entry))
+    return success();
+  if (*remaining_skips > 0) {
+    (*remaining_skips)--;
+    return success();
+  }
+  return add_to_array_buffer(runtime, frames, entry);
+}
+
 value_t capture_backtrace(runtime_t *runtime, frame_t *top, size_t skip_count) {
   TRY_DEF(frames, new_heap_array_buffer(runtime, 16));
   frame_iter_t iter = frame_iter_from_frame(top);
@@ -651,13 +732,12 @@ value_t capture_backtrace(runtime_t *runtime, frame_t *top, size_t skip_count) {
     // capture it so do that first before deciding whether to skip. It's a
     // little wasteful but shouldn't be a big deal.
     TRY_DEF(entry, capture_backtrace_entry(runtime, frame));
-    if (!is_nothing(entry)) {
-      if (remaining_skips == 0) {
-        TRY(add_to_array_buffer(runtime, frames, entry));
-      } else {
-        remaining_skips--;
-      }
-    }
+    TRY(add_backtrace_entry(runtime, frames, entry, &remaining_skips));
+    // If the frame was pushed by a tail call its caller's pc points to the
+    // invocation the frame replaced so the one that actually pushed it has to
+    // come from the frame itself.
+    TRY_DEF(tail_entry, capture_tail_call_backtrace_entry(runtime, frame));
+    TRY(add_backtrace_entry(runtime, frames, tail_entry, &remaining_skips));
   } while (frame_iter_advance(&iter));
   return new_heap_backtrace(runtime, frames);
 }
@@ -832,6 +912,9 @@ void backtrace_entry_print_on(value_t value, print_on_context_t *context) {
 static bool is_invocation_opcode(opcode_t op) {
   switch (op) {
   case ocInvoke:
+  case ocInvokeBuiltin:
+  case ocTailInvoke:
+  case ocTailInvokeBuiltin:
   case ocSignalEscape:
   case ocSignalContinue:
   case ocBuiltinMaybeEscape:
@@ -842,6 +925,22 @@ static bool is_invocation_opcode(opcode_t op) {
   }
 }
 
+// Creates a backtrace entry for the invocation with the given tags whose
+// arguments are on top of the given frame's stack.
+static value_t new_invocation_backtrace_entry(runtime_t *runtime,
+    frame_t *frame, value_t tags, opcode_t op) {
+  // Scan through the record to build the invocation map.
+  TRY_DEF(invocation, new_heap_id_hash_map(runtime, 16));
+  int64_t arg_count = get_call_tags_entry_count(tags);
+  for (int64_t i = 0; i < arg_count; i++) {
+    value_t tag = get_call_tags_tag_at(tags, i);
+    value_t arg = frame_detach_value(frame_get_pending_argument_at(frame, tags, i));
+    TRY(set_id_hash_map_at(runtime, invocation, tag, arg));
+  }
+  // Wrap the result in a backtrace entry.
+  return new_heap_backtrace_entry(runtime, invocation, new_integer(op));
+}
+
 value_t capture_backtrace_entry(runtime_t *runtime, frame_t *frame) {
   // Check whether the program counter stored for this frame points immediately
   // after an invoke instruction. If it does we'll use that instruction to
@@ -869,16 +968,19 @@ value_t capture_backtrace_entry(runtime_t *runtime, frame_t *frame) {
     value_t value_pool = get_code_block_value_pool(code_block);
     tags = get_array_at(value_pool, record_index);
   }
-  // Scan through the record to build the invocation map.
-  TRY_DEF(invocation, new_heap_id_hash_map(runtime, 16));
-  int64_t arg_count = get_call_tags_entry_count(tags);
-  for (int64_t i = 0; i < arg_count; i++) {
-    value_t tag = get_call_tags_tag_at(tags, i);
-    value_t arg = frame_detach_value(frame_get_pending_argument_at(frame, tags, i));
-    TRY(set_id_hash_map_at(runtime, invocation, tag, arg));
-  }
-  // Wrap the result in a backtrace entry.
-  return new_heap_backtrace_entry(runtime, invocation, new_integer(op));
+  return new_invocation_backtrace_entry(runtime, frame, tags, op);
+}
+
+value_t capture_tail_call_backtrace_entry(runtime_t *runtime, frame_t *frame) {
+  value_t tags = frame_get_tail_call_tags(frame);
+  if (is_nothing(tags))
+    return nothing();
+  // The arguments are right below the frame header, where they would be on
+  // top of the caller's stack if the frame had been pushed normally.
+  frame_t arguments = *frame;
+  arguments.stack_pointer = frame->frame_pointer - kFrameHeaderSize;
+  return new_invocation_backtrace_entry(runtime, &arguments, tags,
+      ocTailInvoke);
 }
 
 /// ## Task
@@ -143,11 +143,11 @@ static frame_t frame_empty() {
 
 // The number of words in a stack frame header.
 static const size_t kFrameHeaderSize
-    = (kFrameFieldCount - 2)  // The frame fields minus the stack pointer which
-                              //   is implicit and the stack piece.
+    = (kFrameFieldCount - 1)  // The frame fields minus the stack piece.
     + 1                       // The code block
     + 1                       // The PC
-    + 1;                      // The argument map
+    + 1                       // The argument map
+    + 1;                      // The tail call tags
 
 // Offsets _down_ from the frame pointer to the header fields.
 static const size_t kFrameHeaderPreviousFramePointerOffset = 0;
@@ -156,12 +156,22 @@ static const size_t kFrameHeaderPreviousFlagsOffset = 2;
 static const size_t kFrameHeaderPreviousPcOffset = 3;
 static const size_t kFrameHeaderCodeBlockOffset = 4;
 static const size_t kFrameHeaderArgumentMapOffset = 5;
+static const size_t kFrameHeaderPreviousStackPointerOffset = 6;
+static const size_t kFrameHeaderTailCallTagsOffset = 7;
 
 // Tries to allocate a new frame above the given frame of the given capacity.
 // Returns true iff allocation succeeds.
 bool try_push_new_frame(frame_t *frame, size_t capacity, uint32_t flags,
     bool is_lid);
 
+// Tries to replace the given frame with a new frame of the given capacity for a
+// tail call with the given call tags, moving the argc pending arguments on top
+// of the given frame down to where the given frame started. The new frame
+// returns directly to the given frame's caller. Returns true iff there was room
+// for the new frame.
+bool try_push_tail_frame(frame_t *frame, size_t capacity, size_t argc,
+    value_t arg_map, value_t tags);
+
 // Puts the given stack piece in the open state and stores the state required to
 // interact with it in the given frame struct.
 void open_stack_piece(value_t piece, frame_t *frame);
@@ -182,6 +192,14 @@ void frame_set_previous_frame_pointer(frame_t *frame, size_t value);
 // one.
 size_t frame_get_previous_frame_pointer(frame_t *frame);
 
+// Record the stack pointer for the previous stack frame. For frames pushed by a
+// normal invocation this is where the new frame's header starts but frames
+// pushed by a tail call start higher up.
+void frame_set_previous_stack_pointer(frame_t *frame, size_t value);
+
+// Returns the stack pointer for the previous stack frame.
+size_t frame_get_previous_stack_pointer(frame_t *frame);
+
 // Record the limit pointer of the previous stack frame.
 void frame_set_previous_limit_pointer(frame_t *frame, size_t value);
 
@@ -212,6 +230,15 @@ void frame_set_argument_map(frame_t *frame, value_t map);
 // Returns the mapping from parameter to argument indices for this frame.
 value_t frame_get_argument_map(frame_t *frame);
 
+// Sets the call tags of the tail call that pushed this frame.
+void frame_set_tail_call_tags(frame_t *frame, value_t tags);
+
+// Returns the call tags of the tail call that pushed this frame, or nothing if
+// it was pushed by a normal invocation. The caller's pc points to the
+// invocation a tail called frame replaced so its own tags can only be found
+// here.
+value_t frame_get_tail_call_tags(frame_t *frame);
+
 // Pushes a value onto this stack frame. The returned value will always be
 // success except on bounds check failures in soft check failure mode where it
 // will be OutOfBounds.
@@ -574,6 +601,10 @@ void backtrace_entry_invocation_print_on(value_t invocation, int32_t opcode,
 // created nothing is returned.
 value_t capture_backtrace_entry(runtime_t *runtime, frame_t *frame);
 
+// Creates a backtrace entry for the tail call that pushed the given frame. If
+// the frame wasn't pushed by a tail call nothing is returned.
+value_t capture_tail_call_backtrace_entry(runtime_t *runtime, frame_t *frame);
+
 
 /// ## Task
 ///
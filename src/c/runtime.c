@@ -383,6 +383,7 @@ value_t roots_init(value_t roots, const extended_runtime_config_t *config,
   TRY_SET(RAW_ROOT(roots, transport_key),
       new_heap_key(runtime, RAW_RSTR(roots, transport)));
   TRY_SET(RAW_ROOT(roots, builtin_impls), new_heap_id_hash_map(runtime, 256));
+  TRY_SET(RAW_ROOT(roots, builtin_folders), new_heap_id_hash_map(runtime, 16));
   TRY_SET(RAW_ROOT(roots, op_call),
       new_heap_operation(runtime, afFreeze, otCall, null()));
   TRY_SET(RAW_ROOT(roots, stack_bottom_code_block),
@@ -518,6 +519,7 @@ value_t roots_validate(value_t roots) {
   VALIDATE_HEAP_OBJECT(ofKey, RAW_ROOT(roots, transport_key));
   VALIDATE_CHECK_EQ(kTransportKeyId, get_key_id(RAW_ROOT(roots, transport_key)));
   VALIDATE_HEAP_OBJECT(ofIdHashMap, RAW_ROOT(roots, builtin_impls));
+  VALIDATE_HEAP_OBJECT(ofIdHashMap, RAW_ROOT(roots, builtin_folders));
   VALIDATE_HEAP_OBJECT(ofOperation, RAW_ROOT(roots, op_call));
   VALIDATE_CHECK_EQ(otCall, get_operation_type(RAW_ROOT(roots, op_call)));
   VALIDATE_HEAP_OBJECT(ofCodeBlock,
@@ -568,6 +570,7 @@ value_t mutable_roots_validate(value_t self) {
   VALIDATE_FAMILY(ofMutableRoots, self);
   VALIDATE_HEAP_OBJECT(ofArgumentMapTrie,
       RAW_MROOT(self, argument_map_trie_root));
+  VALIDATE_HEAP_OBJECT(ofArray, RAW_MROOT(self, global_lookup_cache));
   return success();
 }
 
@@ -661,6 +664,8 @@ static value_t runtime_soft_init(runtime_t *runtime,
   TRY_FINALLY {
     safe_value_t s_builtin_impls = protect(pool, ROOT(runtime, builtin_impls));
     E_TRY(add_builtin_implementations(runtime, s_builtin_impls));
+    E_TRY(init_builtin_folders(ROOT(runtime, builtin_folders),
+        deref(s_builtin_impls), runtime));
     E_TRY(init_special_imports(runtime, ROOT(runtime, special_imports)));
     E_TRY(init_services(runtime, ROOT(runtime, special_imports), config));
     E_RETURN(runtime_validate(runtime, nothing()));
@@ -716,6 +721,9 @@ value_t runtime_init(runtime_t *runtime,
     gc_fuzzer_init(runtime->gc_fuzzer, kGcFuzzerMinFrequency,
         config->base.gc_fuzz_freq, config->base.gc_fuzz_seed);
   }
+  // Incremental collection does its work from within allocation so like
+  // fuzzing it is only enabled once initialization is done.
+  runtime->heap.replication.is_enabled = (config->base.gc_max_pause_millis > 0);
   return success();
 }
 
@@ -856,19 +864,21 @@ static void garbage_collection_state_dispose(garbage_collection_state_o *self) {
   pending_fixup_worklist_dispose(&self->pending_fixups);
 }
 
-static value_t migrate_object_shallow(value_t object, space_t *space) {
+static value_t migrate_object_shallow(heap_t *heap, value_t object) {
   // Ask the object to describe its layout.
   heap_object_layout_t layout;
   get_heap_object_layout(object, &layout);
   // Allocate new room for the object.
   address_t source = get_heap_object_address(object);
   address_t target = NULL;
-  bool alloc_succeeded = space_try_alloc(space, layout.size, &target);
+  bool alloc_succeeded = space_try_alloc(&heap->to_space, layout.size, &target);
   CHECK_TRUE("clone alloc failed", alloc_succeeded);
   // Do a raw copy of the object to the target.
   memcpy(target, source, layout.size);
   // Tag the new location as an object and return it.
-  return new_heap_object(target);
+  value_t result = new_heap_object(target);
+  gc_family_stats_record(heap->stats.current.families, result, layout.size);
+  return result;
 }
 
 // Returns true if the given object needs to apply a fixup after migration.
@@ -910,11 +920,11 @@ static value_t ensure_heap_object_migrated(garbage_collection_state_o *self,
     // Check with the object whether it needs post processing. This is the last
     // time the object is intact so it's the last point we can call methods on
     // it to find out.
-    CHECK_TRUE("migrating clone",
-        space_contains(&self->runtime->heap.from_space, get_heap_object_address(old_object)));
+    CHECK_TRUE("migrating clone", heap_is_collecting_address(
+        &self->runtime->heap, get_heap_object_address(old_object)));
     bool needs_fixup = needs_post_migrate_fixup(old_object);
-    value_t new_object = migrate_object_shallow(old_object,
-        &self->runtime->heap.to_space);
+    value_t new_object = migrate_object_shallow(&self->runtime->heap,
+        old_object);
     CHECK_DOMAIN(vdHeapObject, new_object);
     if (!blob_is_empty(self->runtime->heap.backpointer_space))
       record_backpointer(&self->runtime->heap, parent, new_object);
@@ -934,6 +944,15 @@ static value_t ensure_heap_object_migrated(garbage_collection_state_o *self,
   }
 }
 
+// Returns a derived object pointer at the same offset within the given new
+// clone of the host as the given one is within the old host.
+static value_t rebase_derived_object(value_t old_derived, value_t new_host) {
+  value_t anchor = get_derived_object_anchor(old_derived);
+  size_t host_offset = (size_t) get_derived_object_anchor_host_offset(anchor);
+  address_t new_addr = get_heap_object_address(new_host) + host_offset;
+  return new_derived_object(new_addr);
+}
+
 // Returns a new derived object pointer identical to the given one except that
 // it points to the new clone of the host rather than the old one.
 static value_t migrate_derived_object(garbage_collection_state_o *self,
@@ -942,10 +961,7 @@ static value_t migrate_derived_object(garbage_collection_state_o *self,
   value_t old_host = get_derived_object_host(old_derived);
   value_t new_host = ensure_heap_object_migrated(self, parent, old_host);
   // Calculate the new address derived from the new host.
-  value_t anchor = get_derived_object_anchor(old_derived);
-  size_t host_offset = (size_t) get_derived_object_anchor_host_offset(anchor);
-  address_t new_addr = get_heap_object_address(new_host) + host_offset;
-  return new_derived_object(new_addr);
+  return rebase_derived_object(old_derived, new_host);
 }
 
 // Callback that migrates an object from from to to space, if it hasn't been
@@ -955,12 +971,24 @@ static value_t migrate_field_shallow(field_visitor_o *super_self,
   garbage_collection_state_o *self = DOWNCAST(garbage_collection_state_o,
       super_self);
   value_t old_value = *field.ptr;
-  // If this is not a heap object there's nothing to do.
+  heap_t *heap = &self->runtime->heap;
+  // If this is not a heap object there's nothing to do. Neither is there if
+  // this is a nursery collection and the object is old.
   value_domain_t domain = get_value_domain(old_value);
   if (domain == vdHeapObject) {
-    TRY_SET(*field.ptr, ensure_heap_object_migrated(self, field.parent, old_value));
+    if (heap_is_collecting_address(heap, get_heap_object_address(old_value))) {
+      TRY_SET(*field.ptr, ensure_heap_object_migrated(self, field.parent,
+          old_value));
+    } else if (heap_try_mark_large_object(heap, old_value)) {
+      // Large objects stay where they are but what they point to must be
+      // migrated too.
+      heap_schedule_large_object_scan(heap, old_value);
+    }
   } else if (domain == vdDerivedObject) {
-    TRY_SET(*field.ptr, migrate_derived_object(self, field.parent, old_value));
+    value_t host = get_derived_object_host(old_value);
+    if (heap_is_collecting_address(heap, get_heap_object_address(host)))
+      TRY_SET(*field.ptr, migrate_derived_object(self, field.parent,
+          old_value));
   }
   return success();
 }
@@ -982,6 +1010,7 @@ static void runtime_apply_fixups(garbage_collection_state_o *self) {
     pending_fixup_t *fixup = &worklist->fixups[i];
     apply_fixup(self->runtime, fixup->new_heap_object, fixup->old_object);
   }
+  self->runtime->heap.stats.current.fixup_count += worklist->length;
 }
 
 // Works the opposite way from offsetof: yields a member based on a base pointer
@@ -996,11 +1025,20 @@ static void runtime_notify_observers(runtime_t *runtime, size_t field_offset) {
   }
 }
 
-value_t runtime_garbage_collect(runtime_t *runtime) {
-  // Validate that everything's healthy before we start.
-  TRY(runtime_validate(runtime, nothing()));
-  // Create to-space and swap it in, making the current to-space into from-space.
-  TRY(heap_prepare_garbage_collection(&runtime->heap));
+// Records the roots in the remembered set. They're updated directly rather
+// than through the setters so it's simpler to always scan them during nursery
+// collections than to apply the barrier everywhere.
+static void runtime_remember_roots(runtime_t *runtime) {
+  heap_t *heap = &runtime->heap;
+  if (!heap_has_nursery(heap))
+    return;
+  heap_remember_object(heap, runtime->roots);
+  heap_remember_object(heap, runtime->mutable_roots);
+}
+
+// Migrates everything reachable from the roots into to-space on the calling
+// thread, leaving the heap ready for the collection to be completed.
+static value_t runtime_migrate_serial(runtime_t *runtime) {
   // Initialize the state we'll maintain during collection.
   garbage_collection_state_o state = garbage_collection_state_new(runtime);
   field_visitor_o *visitor = UPCAST(&state);
@@ -1013,12 +1051,806 @@ value_t runtime_garbage_collect(runtime_t *runtime) {
   TRY(heap_for_each_field(&runtime->heap, visitor, false));
   // Update the state of the heap's object trackers.
   TRY(heap_post_process_object_trackers(&runtime->heap));
+  TRY(heap_post_process_identity_hashes(&runtime->heap));
   // At this point everything has been migrated so we can run the fixups and
   // then we're done with the state.
   runtime_apply_fixups(&state);
   garbage_collection_state_dispose(&state);
+  return success();
+}
+
+/// ## Parallel collection
+///
+/// If the heap is configured with more than one gc thread full collections
+/// spread the work of migrating objects over that many workers. The calling
+/// thread's worker migrates the roots and then all the workers, the calling
+/// thread's included, scan the objects that have been copied but whose fields
+/// haven't been migrated yet until there are none left.
+///
+/// Each worker copies objects into a buffer of its own carved out of to-space
+/// and scans that buffer like a Cheney scan. When the buffer fills up the part
+/// that hasn't been scanned yet is pushed onto the worker's deque as a chunk
+/// and workers that run out of work steal chunks from the other deques.
+///
+/// Objects are claimed for migration by setting their bit in the heap's claim
+/// bits rather than by swapping the header. The header can't be touched until
+/// the object has been copied since reading the layout of some objects goes
+/// through it. Once copied the claiming worker publishes the forward pointer
+/// and workers that lost the race wait for it.
+
+// The size of the buffers workers copy objects into.
+static const size_t kGcWorkerBufferSize = 64 * kKB;
+
+// Objects at least this large are copied directly into to-space rather than
+// into a worker's buffer. This bounds how much of a buffer is left unused when
+// an object doesn't fit at the end of it.
+static const size_t kGcWorkerLargeObjectSize = 8 * kKB;
+
+// A range of to-space holding objects that have been copied but not scanned.
+typedef struct {
+  address_t start;
+  address_t limit;
+} gc_chunk_t;
+
+// A deque of chunks. The owning worker pushes and pops at the bottom and other
+// workers steal from the top. Chunks are large enough that the deques are
+// touched rarely so they're guarded by a spin lock rather than being lock
+// free.
+typedef struct {
+  // Nonzero while the deque is locked.
+  volatile address_arith_t lock;
+  // The index of the oldest chunk, the next one to be stolen.
+  volatile size_t top;
+  // The index after the newest chunk.
+  volatile size_t bottom;
+  // The max number of chunks.
+  size_t capacity;
+  // Storage for the chunks.
+  gc_chunk_t *chunks;
+} gc_chunk_deque_t;
+
+// Spins until the given lock can be acquired.
+static void gc_spin_lock(volatile address_arith_t *lock) {
+  while (atomic_word_compare_and_swap(lock, 0, 1) != 0)
+    ;
+}
+
+// Releases a lock acquired with gc_spin_lock.
+static void gc_spin_unlock(volatile address_arith_t *lock) {
+  atomic_word_store(lock, 0);
+}
+
+// Adds the given delta to the counter at the given location.
+static void gc_atomic_add(volatile address_arith_t *ptr,
+    address_arith_t delta) {
+  while (true) {
+    address_arith_t value = atomic_word_load(ptr);
+    if (atomic_word_compare_and_swap(ptr, value, value + delta) == value)
+      return;
+  }
+}
+
+static void gc_chunk_deque_init(gc_chunk_deque_t *deque, gc_chunk_t *chunks,
+    size_t capacity) {
+  deque->lock = 0;
+  deque->top = 0;
+  deque->bottom = 0;
+  deque->capacity = capacity;
+  deque->chunks = chunks;
+}
+
+// Returns true if the given deque looks empty. This doesn't lock so the answer
+// may be stale unless it's the owner asking.
+static bool gc_chunk_deque_is_empty(gc_chunk_deque_t *deque) {
+  return deque->top == deque->bottom;
+}
+
+// Adds a chunk at the bottom of the deque. Must only be called by the owner.
+static void gc_chunk_deque_push(gc_chunk_deque_t *deque, gc_chunk_t chunk) {
+  gc_spin_lock(&deque->lock);
+  // The capacity is enough to hold every chunk a collection can create so
+  // this can't fail.
+  CHECK_REL("chunk deque overflow", deque->bottom, <, deque->capacity);
+  deque->chunks[deque->bottom] = chunk;
+  deque->bottom = deque->bottom + 1;
+  gc_spin_unlock(&deque->lock);
+}
+
+// Takes a chunk from the given end of the given deque, storing it in the out
+// parameter. Returns false if the deque is empty.
+static bool gc_chunk_deque_take(gc_chunk_deque_t *deque, bool from_bottom,
+    gc_chunk_t *chunk_out) {
+  if (gc_chunk_deque_is_empty(deque))
+    return false;
+  gc_spin_lock(&deque->lock);
+  bool result = false;
+  if (deque->top < deque->bottom) {
+    if (from_bottom) {
+      deque->bottom = deque->bottom - 1;
+      *chunk_out = deque->chunks[deque->bottom];
+    } else {
+      *chunk_out = deque->chunks[deque->top];
+      deque->top = deque->top + 1;
+    }
+    result = true;
+  }
+  if (deque->top == deque->bottom)
+    // Start over from the beginning once the deque has been drained.
+    deque->top = deque->bottom = 0;
+  gc_spin_unlock(&deque->lock);
+  return result;
+}
+
+FORWARD(parallel_collection_t);
+
+IMPLEMENTATION(gc_worker_o, field_visitor_o);
+
+// One of the workers taking part in a parallel collection. Also functions as
+// the field visitor that migrates the fields of the objects it scans.
+struct gc_worker_o {
+  IMPLEMENTATION_HEADER(gc_worker_o, field_visitor_o);
+  // The collection this worker is part of.
+  parallel_collection_t *collection;
+  // This worker's index among the collection's workers.
+  size_t index;
+  // The buffer objects are copied into.
+  space_t buffer;
+  // The next object in the buffer to scan.
+  address_t scan;
+  // The chunks waiting to be scanned.
+  gc_chunk_deque_t deque;
+  // The range of the collection's fixups this worker applies.
+  size_t fixups_start;
+  size_t fixups_limit;
+  // The objects this worker has copied, merged into the heap's stats once the
+  // workers are done.
+  gc_family_stats_t families[kGcFamilyStatsCount];
+  // The outcome of running this worker.
+  value_t result;
+  // The thread running this worker if it's not the calling thread.
+  native_thread_t *thread;
+  nullary_callback_t *callback;
+};
+
+// The state shared between the workers of a parallel collection.
+struct parallel_collection_t {
+  // The runtime being collected.
+  runtime_t *runtime;
+  // The workers, the first of which runs on the calling thread.
+  gc_worker_o *workers;
+  size_t worker_count;
+  // The number of workers that have run out of work.
+  volatile address_arith_t idle_count;
+  // Set if a worker failed such that the others should stop.
+  volatile address_arith_t has_failed;
+  // Fixups scheduled by any of the workers, guarded by the lock.
+  volatile address_arith_t fixup_lock;
+  pending_fixup_worklist_t pending_fixups;
+  // Memory holding the workers and the chunks of their deques.
+  blob_t memory;
+};
+
+// Pushes the part of the worker's buffer that hasn't been scanned yet onto its
+// deque such that any worker can scan it and then gives up the buffer.
+static void gc_worker_retire_buffer(gc_worker_o *self) {
+  if (space_is_empty(&self->buffer))
+    return;
+  if (self->scan < self->buffer.next_free) {
+    gc_chunk_t chunk = {self->scan, self->buffer.next_free};
+    gc_chunk_deque_push(&self->deque, chunk);
+  }
+  space_retire_buffer(&self->buffer);
+  self->scan = NULL;
+}
+
+// Allocates room for a copy of an object of the given size in to-space.
+static address_t gc_worker_alloc(gc_worker_o *self, size_t size) {
+  space_t *to_space = &self->collection->runtime->heap.to_space;
+  address_t result = NULL;
+  if (size < kGcWorkerLargeObjectSize) {
+    if (!space_is_empty(&self->buffer)
+        && space_try_alloc(&self->buffer, size, &result))
+      return result;
+    gc_worker_retire_buffer(self);
+    if (space_try_alloc_buffer(to_space, kGcWorkerBufferSize,
+            align_size(kValueSize, size), &self->buffer)) {
+      self->scan = self->buffer.start;
+      bool alloc_succeeded = space_try_alloc(&self->buffer, size, &result);
+      CHECK_TRUE("buffer alloc failed", alloc_succeeded);
+      return result;
+    }
+  }
+  bool alloc_succeeded = space_try_alloc_shared(to_space, size, &result);
+  CHECK_TRUE("clone alloc failed", alloc_succeeded);
+  return result;
+}
+
+// Schedules a fixup in the collection's shared list.
+static value_t parallel_collection_add_fixup(parallel_collection_t *self,
+    pending_fixup_t *fixup) {
+  gc_spin_lock(&self->fixup_lock);
+  value_t result = pending_fixup_worklist_add(&self->pending_fixups, fixup);
+  gc_spin_unlock(&self->fixup_lock);
+  return result;
+}
+
+// The parallel counterpart to ensure_heap_object_migrated.
+static value_t gc_worker_ensure_migrated(gc_worker_o *self, value_t parent,
+    value_t old_object) {
+  heap_t *heap = &self->collection->runtime->heap;
+  volatile address_arith_t *header_ptr = (volatile address_arith_t*)
+      access_heap_object_field(old_object, kHeapObjectHeaderOffset);
+  value_t header;
+  header.encoded = atomic_word_load(header_ptr);
+  if (get_value_domain(header) != vdMovedObject
+      && !heap_try_claim_object(heap, old_object)) {
+    // Another worker is migrating the object; it publishes the forward pointer
+    // as soon as the copy has been made so just wait for that.
+    do {
+      header.encoded = atomic_word_load(header_ptr);
+    } while (get_value_domain(header) != vdMovedObject);
+  }
+  if (get_value_domain(header) == vdMovedObject)
+    return get_moved_object_target(header);
+  // We've claimed the object so only we will touch the header until the
+  // forward pointer is in place.
+  CHECK_DOMAIN(vdHeapObject, header);
+  bool needs_fixup = needs_post_migrate_fixup(old_object);
+  heap_object_layout_t layout;
+  heap_object_layout_init(&layout);
+  get_heap_object_layout(old_object, &layout);
+  address_t target = gc_worker_alloc(self, layout.size);
+  memcpy(target, get_heap_object_address(old_object), layout.size);
+  value_t new_object = new_heap_object(target);
+  atomic_word_store(header_ptr, new_moved_object(new_object).encoded);
+  gc_family_stats_record(self->families, new_object, layout.size);
+  if (!blob_is_empty(heap->backpointer_space))
+    record_backpointer(heap, parent, new_object);
+  bool is_buffered = !space_is_empty(&self->buffer)
+      && (self->buffer.start <= target) && (target < self->buffer.limit);
+  if (!is_buffered) {
+    // The copy went directly into to-space so it won't be scanned as part of
+    // the buffer.
+    gc_chunk_t chunk = {target, target + align_size(kValueSize, layout.size)};
+    gc_chunk_deque_push(&self->deque, chunk);
+  }
+  if (needs_fixup) {
+    pending_fixup_t fixup = { new_object, old_object };
+    TRY(parallel_collection_add_fixup(self->collection, &fixup));
+  }
+  return new_object;
+}
+
+// Returns the size of the object at the given address.
+static size_t get_object_size_at(address_t addr) {
+  heap_object_layout_t layout;
+  heap_object_layout_init(&layout);
+  get_heap_object_layout(new_heap_object(addr), &layout);
+  return layout.size;
+}
+
+// The parallel counterpart to migrate_field_shallow.
+static value_t gc_worker_migrate_field(field_visitor_o *super_self,
+    value_field_t field) {
+  gc_worker_o *self = DOWNCAST(gc_worker_o, super_self);
+  value_t old_value = *field.ptr;
+  heap_t *heap = &self->collection->runtime->heap;
+  value_domain_t domain = get_value_domain(old_value);
+  if (domain == vdHeapObject) {
+    address_t addr = get_heap_object_address(old_value);
+    if (heap_is_collecting_address(heap, addr)) {
+      TRY_SET(*field.ptr, gc_worker_ensure_migrated(self, field.parent,
+          old_value));
+    } else if (heap_try_mark_large_object(heap, old_value)) {
+      // The large object stays put so its fields are scanned in place.
+      gc_chunk_t chunk = {addr, addr + get_object_size_at(addr)};
+      gc_chunk_deque_push(&self->deque, chunk);
+    }
+  } else if (domain == vdDerivedObject) {
+    value_t old_host = get_derived_object_host(old_value);
+    if (heap_is_collecting_address(heap, get_heap_object_address(old_host))) {
+      TRY_DEF(new_host, gc_worker_ensure_migrated(self, field.parent,
+          old_host));
+      *field.ptr = rebase_derived_object(old_value, new_host);
+    }
+  }
+  return success();
+}
+
+VTABLE(gc_worker_o, field_visitor_o) { gc_worker_migrate_field };
+
+// Scans all the objects in the given chunk.
+static value_t gc_worker_scan_chunk(gc_worker_o *self, gc_chunk_t chunk) {
+  address_t current = chunk.start;
+  while (current < chunk.limit) {
+    size_t size = get_object_size_at(current);
+    TRY(heap_object_for_each_field(new_heap_object(current), UPCAST(self)));
+    current += size;
+  }
+  return success();
+}
+
+// Scans the next object in the worker's buffer.
+static value_t gc_worker_scan_buffered(gc_worker_o *self) {
+  address_t current = self->scan;
+  // Move past the object before scanning it in case scanning retires the
+  // buffer, it's only what comes after that's still left to scan then.
+  self->scan = current + get_object_size_at(current);
+  return heap_object_for_each_field(new_heap_object(current), UPCAST(self));
+}
+
+// Looks for a chunk to steal from the other workers' deques.
+static bool gc_worker_steal(gc_worker_o *self, gc_chunk_t *chunk_out) {
+  parallel_collection_t *collection = self->collection;
+  size_t count = collection->worker_count;
+  for (size_t i = 1; i < count; i++) {
+    gc_worker_o *victim = &collection->workers[(self->index + i) % count];
+    if (gc_chunk_deque_take(&victim->deque, false, chunk_out))
+      return true;
+  }
+  return false;
+}
+
+// Returns true if any of the workers' deques have chunks in them.
+static bool parallel_collection_has_chunks(parallel_collection_t *self) {
+  for (size_t i = 0; i < self->worker_count; i++) {
+    if (!gc_chunk_deque_is_empty(&self->workers[i].deque))
+      return true;
+  }
+  return false;
+}
+
+// Called when the worker has run out of work. Waits until either all workers
+// are out of work, in which case the collection is done and true is returned,
+// or more work shows up, in which case false is returned.
+static bool gc_worker_try_terminate(gc_worker_o *self) {
+  parallel_collection_t *collection = self->collection;
+  gc_atomic_add(&collection->idle_count, 1);
+  while (true) {
+    if (atomic_word_load(&collection->idle_count) == collection->worker_count
+        || atomic_word_load(&collection->has_failed))
+      return true;
+    if (parallel_collection_has_chunks(collection)) {
+      // A worker that isn't idle can't be out of work so it's safe to stop
+      // being idle before we've actually got some.
+      gc_atomic_add(&collection->idle_count, (address_arith_t) -1);
+      return false;
+    }
+  }
+}
+
+// Keeps scanning objects until there are none left anywhere.
+static value_t gc_worker_scan_until_done(gc_worker_o *self) {
+  gc_chunk_t chunk;
+  while (true) {
+    if (self->scan != NULL && self->scan < self->buffer.next_free) {
+      TRY(gc_worker_scan_buffered(self));
+    } else if (gc_chunk_deque_take(&self->deque, true, &chunk)
+        || gc_worker_steal(self, &chunk)) {
+      TRY(gc_worker_scan_chunk(self, chunk));
+    } else if (gc_worker_try_terminate(self)) {
+      break;
+    }
+  }
+  gc_worker_retire_buffer(self);
+  return success();
+}
+
+// Thread entry point for the scanning phase.
+static opaque_t gc_worker_scan_bridge(opaque_t opaque_worker) {
+  gc_worker_o *self = (gc_worker_o*) o2p(opaque_worker);
+  self->result = gc_worker_scan_until_done(self);
+  if (is_condition(self->result))
+    atomic_word_store(&self->collection->has_failed, 1);
+  return o0();
+}
+
+// Thread entry point for the fixup phase.
+static opaque_t gc_worker_fixup_bridge(opaque_t opaque_worker) {
+  gc_worker_o *self = (gc_worker_o*) o2p(opaque_worker);
+  pending_fixup_worklist_t *worklist = &self->collection->pending_fixups;
+  for (size_t i = self->fixups_start; i < self->fixups_limit; i++) {
+    pending_fixup_t *fixup = &worklist->fixups[i];
+    apply_fixup(self->collection->runtime, fixup->new_heap_object,
+        fixup->old_object);
+  }
+  return o0();
+}
+
+// Runs the given entry point for each worker, the first on the calling thread
+// and the rest on threads of their own, and waits for them all to finish.
+static void parallel_collection_run(parallel_collection_t *self,
+    opaque_t (*entry_point)(opaque_t)) {
+  for (size_t i = 1; i < self->worker_count; i++) {
+    gc_worker_o *worker = &self->workers[i];
+    worker->callback = nullary_callback_new_1(entry_point, p2o(worker));
+    worker->thread = native_thread_new(worker->callback);
+    native_thread_start(worker->thread);
+  }
+  entry_point(p2o(&self->workers[0]));
+  for (size_t i = 1; i < self->worker_count; i++) {
+    gc_worker_o *worker = &self->workers[i];
+    native_thread_join(worker->thread);
+    native_thread_destroy(worker->thread);
+    callback_destroy(worker->callback);
+    worker->thread = NULL;
+    worker->callback = NULL;
+  }
+}
+
+// Sets up the state for a parallel collection of the given runtime's heap,
+// which must have been prepared for collection.
+static value_t parallel_collection_init(parallel_collection_t *self,
+    runtime_t *runtime) {
+  heap_t *heap = &runtime->heap;
+  size_t worker_count = heap_gc_thread_count(heap);
+  // Each chunk is either the unscanned part of a buffer, of which there is at
+  // most one per buffer, an object copied directly into to-space, or an object
+  // in the large object space so this is the most there can be.
+  size_t to_space_size = heap->to_space.limit - heap->to_space.start;
+  size_t chunk_capacity = (to_space_size / kGcWorkerBufferSize)
+      + (to_space_size / kGcWorkerLargeObjectSize) + heap->large_object_count
+      + worker_count;
+  size_t workers_size = worker_count * sizeof(gc_worker_o);
+  size_t chunks_size = chunk_capacity * sizeof(gc_chunk_t);
+  self->memory = allocator_default_malloc(
+      workers_size + (worker_count * chunks_size));
+  if (blob_is_empty(self->memory))
+    return new_system_call_failed_condition("malloc");
+  self->runtime = runtime;
+  self->workers = (gc_worker_o*) self->memory.start;
+  self->worker_count = worker_count;
+  self->idle_count = 0;
+  self->has_failed = 0;
+  self->fixup_lock = 0;
+  pending_fixup_worklist_init(&self->pending_fixups);
+  byte_t *chunks_start = ((byte_t*) self->memory.start) + workers_size;
+  for (size_t i = 0; i < worker_count; i++) {
+    gc_worker_o *worker = &self->workers[i];
+    VTABLE_INIT(gc_worker_o, UPCAST(worker));
+    worker->collection = self;
+    worker->index = i;
+    space_clear(&worker->buffer);
+    worker->scan = NULL;
+    gc_chunk_t *chunks = (gc_chunk_t*) (chunks_start + (i * chunks_size));
+    gc_chunk_deque_init(&worker->deque, chunks, chunk_capacity);
+    worker->fixups_start = worker->fixups_limit = 0;
+    memset(worker->families, 0, sizeof(worker->families));
+    worker->result = success();
+    worker->thread = NULL;
+    worker->callback = NULL;
+  }
+  return success();
+}
+
+static void parallel_collection_dispose(parallel_collection_t *self) {
+  pending_fixup_worklist_dispose(&self->pending_fixups);
+  allocator_default_free(self->memory);
+  self->memory = blob_empty();
+}
+
+// Migrates everything reachable using a parallel collection. The parallel
+// counterpart to runtime_migrate_serial.
+static value_t runtime_migrate_parallel(runtime_t *runtime) {
+  heap_t *heap = &runtime->heap;
+  parallel_collection_t collection;
+  TRY(parallel_collection_init(&collection, runtime));
+  // The roots are few so the calling thread's worker takes care of those and
+  // then the rest join in for scanning what they point to.
+  field_visitor_o *visitor = UPCAST(&collection.workers[0]);
+  TRY_FINALLY {
+    E_TRY(field_visitor_visit(visitor, value_field_new(nothing(),
+        &runtime->roots)));
+    E_TRY(field_visitor_visit(visitor, value_field_new(nothing(),
+        &runtime->mutable_roots)));
+    E_TRY(heap_for_each_object_tracker_field(heap, visitor, false));
+    parallel_collection_run(&collection, gc_worker_scan_bridge);
+    for (size_t i = 0; i < collection.worker_count; i++)
+      E_TRY(collection.workers[i].result);
+    gc_family_stats_t *families = heap->stats.current.families;
+    for (size_t i = 0; i < collection.worker_count; i++) {
+      gc_worker_o *worker = &collection.workers[i];
+      for (size_t j = 0; j < kGcFamilyStatsCount; j++) {
+        families[j].count += worker->families[j].count;
+        families[j].bytes += worker->families[j].bytes;
+      }
+    }
+    E_TRY(heap_post_process_object_trackers(heap));
+    E_TRY(heap_post_process_identity_hashes(heap));
+    // Each fixup only touches its own object so they can be split evenly
+    // between the workers.
+    size_t fixup_count = collection.pending_fixups.length;
+    size_t worker_count = collection.worker_count;
+    for (size_t i = 0; i < worker_count; i++) {
+      collection.workers[i].fixups_start = (fixup_count * i) / worker_count;
+      collection.workers[i].fixups_limit =
+          (fixup_count * (i + 1)) / worker_count;
+    }
+    parallel_collection_run(&collection, gc_worker_fixup_bridge);
+    heap->stats.current.fixup_count += fixup_count;
+    E_RETURN(success());
+  } FINALLY {
+    parallel_collection_dispose(&collection);
+  } YRT
+}
+
+/// ## Incremental collection
+///
+/// If the config sets a max pause, full collections are done incrementally.
+/// Once to-space is half full the heap starts replicating it into the spare
+/// space, a slice at a time every kReplicationSliceBytes of allocation, while
+/// the mutator keeps running on the originals. Since a slice doesn't change
+/// anything the mutator can see it is safe to do from within allocation,
+/// where raw values may be held on the C stack. The replicas are scanned like
+/// a Cheney scan except that pointers into the nursery are left alone: nursery
+/// collections keep running while replicating so the nursery is only
+/// replicated when the heap flips. An original that may point into the nursery
+/// has been remembered so it gets refreshed when the heap flips anyway.
+///
+/// Stores into originals that have been replicated are logged by the write
+/// barrier, as are, up front, objects that are written directly rather than
+/// through the barrier. Once the replicas are complete the next collection,
+/// which may be one that would otherwise only have collected the nursery, or
+/// the job loop flips the heap: it refreshes the logged replicas, replicates
+/// what the roots and the nursery still add, and then completes like a full
+/// collection. The flip only has to deal with what changed while replicating
+/// so it is much shorter than a full collection.
+
+// The number of objects to scan between looking at the clock.
+static const size_t kReplicationClockInterval = 64;
+
+IMPLEMENTATION(replicator_o, field_visitor_o);
+
+// Field visitor that translates pointers to originals into pointers to their
+// replicas, replicating them first if necessary.
+struct replicator_o {
+  IMPLEMENTATION_HEADER(replicator_o, field_visitor_o);
+  // The runtime we're collecting.
+  runtime_t *runtime;
+  // Should fields be updated? The fields of objects the mutator is still
+  // using are only read.
+  bool is_updating;
+  // Once the heap is flipping this is the state used to migrate the nursery;
+  // NULL while replicating.
+  garbage_collection_state_o *flip_state;
+};
+
+// Returns true if stores into the given object aren't guaranteed to go
+// through the write barrier so its replica must be refreshed when the heap
+// flips regardless.
+static bool replicator_must_refresh(runtime_t *runtime, value_t original) {
+  if (is_same_value(original, runtime->roots)
+      || is_same_value(original, runtime->mutable_roots))
+    return true;
+  switch (get_heap_object_family(original)) {
+  case ofStackPiece:
+  case ofBlob:
+  case ofCObject:
+    // Frames, inline caches, and c object data are written directly.
+    return true;
+  default:
+    break;
+  }
+  // Remembered objects may point into the nursery and the nursery collections
+  // that update those pointers write them directly.
+  heap_t *heap = &runtime->heap;
+  return heap_has_nursery(heap) && heap_is_object_remembered(heap, original);
+}
+
+// Returns the replica of the given original, replicating it if it hasn't been
+// already.
+static value_t replicator_ensure_replicated(replicator_o *self,
+    value_t original) {
+  runtime_t *runtime = self->runtime;
+  heap_t *heap = &runtime->heap;
+  value_t replica = heap_get_replica(heap, original);
+  if (!is_nothing(replica))
+    return replica;
+  replica = heap_replicate_object(heap, original,
+      get_object_size_at(get_heap_object_address(original)));
+  if (needs_post_migrate_fixup(original))
+    TRY(heap_record_replica_fixup(heap, original));
+  if ((heap->replication.state == rsReplicating)
+      && replicator_must_refresh(runtime, original))
+    heap_record_replica_write(heap, original);
+  return replica;
+}
+
+// Returns what the given object, which was found in a field of the given
+// parent, should be replaced with in the replicas.
+static value_t replicator_translate(replicator_o *self, value_t parent,
+    value_t object) {
+  heap_t *heap = &self->runtime->heap;
+  address_t addr = get_heap_object_address(object);
+  if (heap_is_replica_original(heap, addr)) {
+    return replicator_ensure_replicated(self, object);
+  } else if (heap_is_young_address(heap, addr)) {
+    if (self->flip_state != NULL)
+      return ensure_heap_object_migrated(self->flip_state, parent, object);
+  } else if (heap_try_mark_large_object(heap, object)) {
+    heap_schedule_large_object_scan(heap, object);
+  }
+  return object;
+}
+
+static value_t replicator_visit_field(field_visitor_o *super_self,
+    value_field_t field) {
+  replicator_o *self = DOWNCAST(replicator_o, super_self);
+  value_t value = *field.ptr;
+  value_domain_t domain = get_value_domain(value);
+  if (domain == vdHeapObject) {
+    TRY_DEF(replica, replicator_translate(self, field.parent, value));
+    if (self->is_updating)
+      *field.ptr = replica;
+  } else if (domain == vdDerivedObject) {
+    value_t host = get_derived_object_host(value);
+    TRY_DEF(replica, replicator_translate(self, field.parent, host));
+    if (self->is_updating && !is_same_value(replica, host))
+      *field.ptr = rebase_derived_object(value, replica);
+  }
+  return success();
+}
+
+VTABLE(replicator_o, field_visitor_o) { replicator_visit_field };
+
+static replicator_o replicator_new(runtime_t *runtime,
+    garbage_collection_state_o *flip_state) {
+  replicator_o result;
+  VTABLE_INIT(replicator_o, UPCAST(&result));
+  result.runtime = runtime;
+  result.is_updating = true;
+  result.flip_state = flip_state;
+  return result;
+}
+
+static uint64_t get_current_gc_micros();
+
+// Scans the replicas and the marked large objects until there are none left
+// or, if max_micros is nonzero, until that much time has passed. At least one
+// object is scanned if there are any so every slice makes progress.
+static value_t replicator_scan(replicator_o *self, uint64_t max_micros) {
+  runtime_t *runtime = self->runtime;
+  heap_t *heap = &runtime->heap;
+  replication_t *replication = &heap->replication;
+  uint64_t start = get_current_gc_micros();
+  for (size_t count = 1; true; count++) {
+    space_t *space = heap_get_replica_space(heap);
+    value_t object = whatever();
+    if (replication->scan < space->next_free) {
+      object = new_heap_object(replication->scan);
+      replication->scan += get_object_size_at(replication->scan);
+      self->is_updating = true;
+    } else if (heap_take_grey_large_object(heap, &object)) {
+      // The mutator uses the large objects themselves so until the heap
+      // flips what they point to can only be replicated, not updated.
+      self->is_updating = (self->flip_state != NULL);
+    } else {
+      return success();
+    }
+    TRY(heap_object_for_each_field(object, UPCAST(self)));
+    if ((max_micros > 0)
+        && ((count % kReplicationClockInterval) == 0)
+        && (get_current_gc_micros() - start >= max_micros))
+      return success();
+  }
+}
+
+// Starts an incremental collection by replicating what the roots point to.
+static value_t runtime_start_incremental_collection(runtime_t *runtime) {
+  TRY(heap_start_replication(&runtime->heap));
+  // The roots are written directly so they're only read now and visited again
+  // when the heap flips.
+  replicator_o replicator = replicator_new(runtime, NULL);
+  replicator.is_updating = false;
+  field_visitor_o *visitor = UPCAST(&replicator);
+  TRY(field_visitor_visit(visitor, value_field_new(nothing(), &runtime->roots)));
+  TRY(field_visitor_visit(visitor, value_field_new(nothing(), &runtime->mutable_roots)));
+  return success();
+}
+
+value_t runtime_garbage_collect_increment(runtime_t *runtime) {
+  heap_t *heap = &runtime->heap;
+  if (!heap_is_replicating(heap)) {
+    if (!heap_wants_replication(heap))
+      return success();
+    TRY(runtime_start_incremental_collection(runtime));
+  }
+  CHECK_TRUE("incremental step while flipping",
+      heap->replication.state == rsReplicating);
+  if (heap->replication.has_failed) {
+    // The write barrier has lost track of stores so the replicas can't be
+    // trusted. Leave it to a full collection.
+    heap_abort_replication(heap);
+    return success();
+  }
+  replicator_o replicator = replicator_new(runtime, NULL);
+  uint64_t max_pause = max_size(heap->config.base.gc_max_pause_millis, 1);
+  uint64_t start = get_current_gc_micros();
+  value_t result = replicator_scan(&replicator, max_pause * 1000);
+  gc_collection_stats_t *stats = &heap->stats.incremental;
+  stats->slice_count++;
+  stats->slice_micros += get_current_gc_micros() - start;
+  return result;
+}
+
+bool runtime_is_incremental_collection_ready(runtime_t *runtime) {
+  heap_t *heap = &runtime->heap;
+  return (heap->replication.state == rsReplicating)
+      && !heap->replication.has_failed
+      && heap_is_replication_complete(heap);
+}
+
+// Brings the replica of the given original, which has been written since it
+// was replicated, up to date.
+static value_t replicator_refresh(replicator_o *self, value_t original) {
+  heap_t *heap = &self->runtime->heap;
+  value_t replica = heap_get_replica(heap, original);
+  address_t replica_addr = get_heap_object_address(replica);
+  size_t replica_size = get_object_size_at(replica_addr);
+  size_t size = get_object_size_at(get_heap_object_address(original));
+  CHECK_REL("original grew", size, <=, replica_size);
+  memcpy(replica_addr, get_heap_object_address(original), size);
+  if (size < replica_size)
+    // The original was truncated after it was replicated and the replica
+    // space must remain a contiguous array of objects.
+    shed_heap_object_tail(self->runtime, replica, replica_size, size);
+  return heap_object_for_each_field(replica, UPCAST(self));
+}
+
+// Switches the heap over to the replicas, finishing off any replication that
+// remains. The incremental counterpart to runtime_migrate_serial.
+static value_t runtime_flip_incremental_collection(runtime_t *runtime) {
+  heap_t *heap = &runtime->heap;
+  TRY(heap_flip_replication(heap));
+  garbage_collection_state_o state = garbage_collection_state_new(runtime);
+  replicator_o replicator = replicator_new(runtime, &state);
+  field_visitor_o *visitor = UPCAST(&replicator);
+  object_log_t *dirty = &heap->replication.dirty;
+  for (size_t i = 0; i < dirty->length; i++)
+    TRY(replicator_refresh(&replicator, object_log_objects(dirty)[i]));
+  replicator.is_updating = true;
+  TRY(field_visitor_visit(visitor, value_field_new(nothing(), &runtime->roots)));
+  TRY(field_visitor_visit(visitor, value_field_new(nothing(), &runtime->mutable_roots)));
+  TRY(heap_for_each_object_tracker_field(heap, visitor, false));
+  TRY(replicator_scan(&replicator, 0));
+  TRY(heap_post_process_object_trackers(heap));
+  TRY(heap_post_process_identity_hashes(heap));
+  object_log_t *fixups = &heap->replication.fixups;
+  for (size_t i = 0; i < fixups->length; i++) {
+    value_t original = object_log_objects(fixups)[i];
+    apply_fixup(runtime, heap_get_replica(heap, original), original);
+  }
+  heap->stats.current.fixup_count += fixups->length;
+  runtime_apply_fixups(&state);
+  garbage_collection_state_dispose(&state);
+  return success();
+}
+
+value_t runtime_garbage_collect(runtime_t *runtime) {
+  // Validate that everything's healthy before we start.
+  TRY(runtime_validate(runtime, nothing()));
+  uint64_t start = get_current_gc_micros();
+  heap_t *heap = &runtime->heap;
+  if (heap_is_replicating(heap) && heap->replication.has_failed)
+    heap_abort_replication(heap);
+  if (heap_is_replicating(heap)) {
+    // An incremental collection is in progress so this is where it flips,
+    // even if its replicas aren't complete yet.
+    TRY(runtime_flip_incremental_collection(runtime));
+  } else {
+    // Create to-space and swap it in, making the current to-space into
+    // from-space.
+    TRY(heap_prepare_garbage_collection(heap));
+    if (heap_gc_thread_count(heap) > 1) {
+      TRY(runtime_migrate_parallel(runtime));
+    } else {
+      TRY(runtime_migrate_serial(runtime));
+    }
+  }
   // Now everything has been migrated so we can throw away from-space.
   TRY(heap_complete_garbage_collection(&runtime->heap));
+  runtime_remember_roots(runtime);
+  heap_end_gc_stats(heap, get_current_gc_micros() - start);
   // Validate that everything's still healthy.
   TRY(runtime_validate(runtime, nothing()));
   // Notify any observers.
@@ -1026,6 +1858,85 @@ value_t runtime_garbage_collect(runtime_t *runtime) {
   return success();
 }
 
+IMPLEMENTATION(remembered_object_migrator_o, value_visitor_o);
+
+// Visitor that migrates the young values held by remembered objects.
+struct remembered_object_migrator_o {
+  IMPLEMENTATION_HEADER(remembered_object_migrator_o, value_visitor_o);
+  garbage_collection_state_o *state;
+};
+
+static value_t remembered_object_migrator_visit(value_visitor_o *super_self,
+    value_t object) {
+  remembered_object_migrator_o *self = DOWNCAST(remembered_object_migrator_o,
+      super_self);
+  garbage_collection_state_o *state = self->state;
+  TRY(heap_object_for_each_field(object, UPCAST(state)));
+  if (needs_post_migrate_fixup(object)) {
+    // The object itself stays put but what it holds may have moved so it gets
+    // the same fixup as if it had been migrated, just in place.
+    pending_fixup_t fixup = { object, object };
+    TRY(pending_fixup_worklist_add(&state->pending_fixups, &fixup));
+  }
+  return success();
+}
+
+VTABLE(remembered_object_migrator_o, value_visitor_o) {
+  remembered_object_migrator_visit
+};
+
+// Collects only the nursery. The roots are the usual ones plus the remembered
+// set; the old objects that aren't remembered are known not to point into the
+// nursery so they're not looked at.
+static value_t runtime_garbage_collect_nursery(runtime_t *runtime) {
+  heap_t *heap = &runtime->heap;
+  // Validating means scanning the whole heap which is what nursery collections
+  // are meant to avoid so only do it when checks are expensive anyway.
+  IF_EXPENSIVE_CHECKS_ENABLED(TRY(runtime_validate(runtime, nothing())));
+  IF_EXPENSIVE_CHECKS_ENABLED(TRY(heap_validate_remembered_set(heap)));
+  uint64_t start = get_current_gc_micros();
+  TRY(heap_prepare_nursery_collection(heap));
+  garbage_collection_state_o state = garbage_collection_state_new(runtime);
+  field_visitor_o *visitor = UPCAST(&state);
+  TRY(field_visitor_visit(visitor, value_field_new(nothing(), &runtime->roots)));
+  TRY(field_visitor_visit(visitor, value_field_new(nothing(), &runtime->mutable_roots)));
+  // Migrate everything the remembered objects point to.
+  remembered_object_migrator_o migrator;
+  VTABLE_INIT(remembered_object_migrator_o, UPCAST(&migrator));
+  migrator.state = &state;
+  TRY(heap_for_each_remembered_object(heap, UPCAST(&migrator)));
+  // Then the object trackers and the objects that have been promoted so far,
+  // which like for a full collection keeps going until everything reachable
+  // has been promoted.
+  TRY(heap_for_each_field(heap, visitor, false));
+  TRY(heap_post_process_object_trackers(heap));
+  TRY(heap_post_process_identity_hashes(heap));
+  runtime_apply_fixups(&state);
+  garbage_collection_state_dispose(&state);
+  TRY(heap_complete_nursery_collection(heap));
+  runtime_remember_roots(runtime);
+  heap_end_gc_stats(heap, get_current_gc_micros() - start);
+  IF_EXPENSIVE_CHECKS_ENABLED(TRY(runtime_validate(runtime, nothing())));
+  runtime_notify_observers(runtime, offsetof(runtime_observer_t, on_gc_done));
+  return success();
+}
+
+value_t runtime_garbage_collect_young(runtime_t *runtime) {
+  if (runtime_is_incremental_collection_ready(runtime)) {
+    // The heap is exhausted because the incremental collection is waiting to
+    // flip, collecting the nursery wouldn't help.
+    return runtime_garbage_collect(runtime);
+  } else if (heap_can_collect_nursery(&runtime->heap)) {
+    return runtime_garbage_collect_nursery(runtime);
+  } else {
+    return runtime_garbage_collect(runtime);
+  }
+}
+
+const gc_stats_t *runtime_get_gc_stats(runtime_t *runtime) {
+  return &runtime->heap.stats;
+}
+
 void runtime_clear(runtime_t *runtime) {
   runtime->next_key_index = 0;
   runtime->gc_fuzzer = NULL;
@@ -1035,6 +1946,7 @@ void runtime_clear(runtime_t *runtime) {
   runtime->top_observer = NULL;
   runtime->io_engine = NULL;
   runtime->next_job_serial = 0;
+  runtime->methodspace_epoch = 0;
 }
 
 // Perform any pre-processing we need to do before releasing the runtime.
@@ -1149,7 +2061,7 @@ bool runtime_toggle_fuzzing(runtime_t *runtime, bool enable) {
 
 value_t runtime_prepare_retry_after_heap_exhausted(runtime_t *runtime,
     value_t condition) {
-  TRY(runtime_garbage_collect(runtime));
+  TRY(runtime_garbage_collect_young(runtime));
   return new_boolean(runtime_toggle_fuzzing(runtime, false));
 }
 
@@ -1298,3 +2210,34 @@ void runtime_ensure_static_inits_run() {
   pthread_once(&once, runtime_run_static_inits);
 #endif
 }
+
+
+// --- G c   c l o c k ---
+
+// GC pauses are timed with the system's monotonic clock rather than the
+// runtime's clock: that one only has millisecond resolution, which most
+// nursery collections finish well within, and it may be adjusted while a
+// collection is running.
+#ifdef IS_MSVC
+
+static uint64_t get_current_gc_micros() {
+  LARGE_INTEGER frequency;
+  LARGE_INTEGER counter;
+  QueryPerformanceFrequency(&frequency);
+  QueryPerformanceCounter(&counter);
+  // Split the conversion so multiplying by a million can't overflow.
+  uint64_t seconds = counter.QuadPart / frequency.QuadPart;
+  uint64_t rest = counter.QuadPart % frequency.QuadPart;
+  return (seconds * 1000000) + ((rest * 1000000) / frequency.QuadPart);
+}
+
+#else
+#  include <time.h>
+
+static uint64_t get_current_gc_micros() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (((uint64_t) now.tv_sec) * 1000000) + (now.tv_nsec / 1000);
+}
+
+#endif
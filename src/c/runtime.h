@@ -97,6 +97,7 @@
 #define ENUM_ROOT_SINGLETONS(F)                                                \
   F(any_guard)                                                                 \
   F(array_of_zero)                                                             \
+  F(builtin_folders)                                                           \
   F(builtin_impls)                                                             \
   F(call_thunk_code_block)                                                     \
   F(ctrino_factory)                                                            \
@@ -193,7 +194,8 @@ static inline value_t get_roots_entry_at(value_t roots, root_key_t key) {
 
 // Invokes the argument for each mutable root.
 #define ENUM_MUTABLE_ROOTS(F)                                                  \
-  F(argument_map_trie_root)
+  F(argument_map_trie_root)                                                    \
+  F(global_lookup_cache)
 
 typedef enum {
   __mk_first__ = -1
@@ -246,7 +248,8 @@ bool gc_fuzzer_tick(gc_fuzzer_t *fuzzer);
 typedef struct runtime_observer_t {
   // The observer below this one.
   struct runtime_observer_t *prev;
-  // The callback to invoke after a gc.
+  // The callback to invoke after a gc. The stats of the collection are
+  // available through runtime_get_gc_stats.
   unary_callback_t *on_gc_done;
 } runtime_observer_t;
 
@@ -285,6 +288,10 @@ struct runtime_t {
   // The next job serial number. This has to fit in an integer so stick with
   // 32-bit ints. Also it should be okay if this overflows.
   uint32_t next_job_serial;
+  // Counter that is incremented whenever a methodspace changes in a way that
+  // may affect method lookup. Inline caches record the value when they're
+  // populated and are flushed when it has changed.
+  uint64_t methodspace_epoch;
   // A debug event sequence that can optionally be used to trace execution. Will
   // be printed on dispose if non-empty.
   event_sequence_t debug_events;
@@ -320,9 +327,28 @@ void runtime_clear(runtime_t *runtime);
 value_t runtime_dispose(runtime_t *runtime, uint32_t flags);
 
 // Collect garbage in the given runtime. If anything goes wrong, such as the os
-// running out a memory, a condition will be returned.
+// running out a memory, a condition will be returned. This is always a full
+// collection that moves every live object.
 value_t runtime_garbage_collect(runtime_t *runtime);
 
+// Collect garbage in the given runtime as cheaply as possible. If the heap has
+// a nursery that can be collected on its own this only collects the nursery,
+// promoting the survivors; otherwise it is a full collection.
+value_t runtime_garbage_collect_young(runtime_t *runtime);
+
+// Does a slice of incremental collection work, no more than the configured
+// max pause's worth, starting an incremental collection first if the heap is
+// due one. This never moves any objects so it is safe to call anywhere.
+value_t runtime_garbage_collect_increment(runtime_t *runtime);
+
+// Returns true if there is an incremental collection in progress that has
+// replicated everything and is waiting for a collection to flip the heap.
+bool runtime_is_incremental_collection_ready(runtime_t *runtime);
+
+// Returns the statistics about the garbage collections the given runtime has
+// done so far, including those of the most recent one.
+const gc_stats_t *runtime_get_gc_stats(runtime_t *runtime);
+
 // Run a series of sanity checks on the runtime to check that it is consistent.
 // Returns a condition iff something is wrong. A runtime will only validate if it
 // has been initialized successfully. The cause is an optional value that
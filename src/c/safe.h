@@ -49,24 +49,24 @@ typedef enum {
 
 // Flags set by the gc on object trackers that indicate their current state.
 typedef enum {
-  tsGarbage = 0x1
+  tsGarbage = 0x1,
+  // The tracker isn't in use; its memory is on the free list of the heap's
+  // tracker slab.
+  tsFree = 0x2
 } object_tracker_state_t;
 
-// An object reference tracked by the runtime. These handles form a
-// doubly-linked list such that nodes can add and remove themselves from the
-// chain of all object trackers. Object trackers can only store heap objects
-// since they're the only values that require tracking.
+// An object reference tracked by the runtime. The heap allocates these from
+// slabs such that they never move and can be found by scanning the slabs.
+// Object trackers can only store heap objects since they're the only values
+// that require tracking.
 typedef struct object_tracker_t {
-  // The pinned value.
+  // The pinned value. While the tracker is free this holds the next free
+  // tracker instead.
   value_t value;
   // Flags that control how the tracker behaves.
   uint32_t flags;
   // Flags that indicate the current state of the tracker.
   uint32_t state;
-  // The next pin descriptor.
-  struct object_tracker_t *next;
-  // The previous pin descriptor.
-  struct object_tracker_t *prev;
 } object_tracker_t;
 
 // Returns true iff the given object tracker is an always-weak reference. Note
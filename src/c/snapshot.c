@@ -0,0 +1,110 @@
+//- Copyright 2014 the Neutrino authors (see AUTHORS).
+//- Licensed under the Apache License, Version 2.0 (see LICENSE).
+
+#include "behavior.h"
+#include "derived.h"
+#include "heap.h"
+#include "snapshot.h"
+#include "try-inl.h"
+#include "value-inl.h"
+
+// Returns the address the snapshot uses to identify the object referenced by
+// the given value, or NULL if the value doesn't reference an object.
+static address_t get_snapshot_edge_address(value_t value) {
+  switch (get_value_domain(value)) {
+    case vdHeapObject:
+      return get_heap_object_address(value);
+    case vdDerivedObject:
+      return get_heap_object_address(get_derived_object_host(value));
+    default:
+      return NULL;
+  }
+}
+
+// Writes a root record for the given value if it references an object.
+static void write_snapshot_root(out_stream_t *out, value_t value,
+    const char *label) {
+  address_t addr = get_snapshot_edge_address(value);
+  if (addr != NULL)
+    out_stream_printf(out, "r %p %s\n", addr, label);
+}
+
+IMPLEMENTATION(snapshot_root_writer_o, field_visitor_o);
+
+// Field visitor that writes a root record for each object tracker field.
+struct snapshot_root_writer_o {
+  IMPLEMENTATION_HEADER(snapshot_root_writer_o, field_visitor_o);
+  out_stream_t *out;
+};
+
+static value_t snapshot_root_writer_visit(field_visitor_o *super_self,
+    value_field_t field) {
+  snapshot_root_writer_o *self = DOWNCAST(snapshot_root_writer_o, super_self);
+  write_snapshot_root(self->out, *field.ptr, "tracker");
+  return success();
+}
+
+VTABLE(snapshot_root_writer_o, field_visitor_o) { snapshot_root_writer_visit };
+
+IMPLEMENTATION(snapshot_object_writer_o, value_visitor_o);
+
+// Value visitor that writes an object record for each object in the heap.
+struct snapshot_object_writer_o {
+  IMPLEMENTATION_HEADER(snapshot_object_writer_o, value_visitor_o);
+  out_stream_t *out;
+};
+
+static value_t snapshot_object_writer_visit(value_visitor_o *super_self,
+    value_t object) {
+  snapshot_object_writer_o *self = DOWNCAST(snapshot_object_writer_o, super_self);
+  heap_object_layout_t layout;
+  heap_object_layout_init(&layout);
+  get_heap_object_layout(object, &layout);
+  const char *family = get_heap_object_family_name(get_heap_object_family(object));
+  out_stream_printf(self->out, "o %p %s %lli", get_heap_object_address(object),
+      family, (long long) layout.size);
+  out_stream_printf(self->out, " %p",
+      get_heap_object_address(get_heap_object_species(object)));
+  value_field_iter_t iter;
+  value_field_iter_init(&iter, object);
+  value_field_t field = value_field_empty();
+  while (value_field_iter_next(&iter, &field)) {
+    address_t addr = get_snapshot_edge_address(*field.ptr);
+    if (addr != NULL)
+      out_stream_printf(self->out, " %p", addr);
+  }
+  out_stream_printf(self->out, "\n");
+  return success();
+}
+
+VTABLE(snapshot_object_writer_o, value_visitor_o) { snapshot_object_writer_visit };
+
+value_t runtime_write_heap_snapshot(runtime_t *runtime, out_stream_t *out) {
+  heap_t *heap = &runtime->heap;
+  out_stream_printf(out, "neutrino-heap-snapshot %i\n", kHeapSnapshotFormatVersion);
+  write_snapshot_root(out, runtime->roots, "roots");
+  write_snapshot_root(out, runtime->mutable_roots, "mutable_roots");
+  snapshot_root_writer_o root_writer;
+  VTABLE_INIT(snapshot_root_writer_o, UPCAST(&root_writer));
+  root_writer.out = out;
+  TRY(heap_for_each_object_tracker_field(heap, UPCAST(&root_writer), false));
+  snapshot_object_writer_o object_writer;
+  VTABLE_INIT(snapshot_object_writer_o, UPCAST(&object_writer));
+  object_writer.out = out;
+  TRY(heap_for_each_allocated_object(heap, UPCAST(&object_writer)));
+  out_stream_printf(out, "end\n");
+  out_stream_flush(out);
+  return success();
+}
+
+value_t runtime_dump_heap_snapshot(runtime_t *runtime, utf8_t path) {
+  file_streams_t streams = file_system_open(runtime->file_system, path,
+      OPEN_FILE_MODE_WRITE);
+  if (!streams.is_open)
+    return new_system_call_failed_condition("open");
+  TRY_FINALLY {
+    E_RETURN(runtime_write_heap_snapshot(runtime, streams.out));
+  } FINALLY {
+    file_streams_close(&streams);
+  } YRT
+}
@@ -0,0 +1,68 @@
+//- Copyright 2014 the Neutrino authors (see AUTHORS).
+//- Licensed under the Apache License, Version 2.0 (see LICENSE).
+
+/// # Heap snapshots
+///
+/// A heap snapshot is a dump of every object in the heap along with the
+/// references between them. It's meant for answering questions like "what is
+/// keeping all these objects alive" offline, typically using
+/// `src/sh/analyze-heap-snapshot.py` which computes the dominator tree of the
+/// object graph and the retained size of each object and family.
+///
+/// A snapshot can be taken from neutrino code by calling
+/// `@ctrino.dump_heap_snapshot!(path)`, from C by calling
+/// `runtime_dump_heap_snapshot`, and through the public api by calling
+/// `Runtime::dump_heap_snapshot`. Taking a snapshot doesn't allocate in the
+/// heap or move any objects so it can be done at any point where the heap is
+/// consistent, including while an incremental collection is in progress.
+///
+/// ## Format
+///
+/// The snapshot is written as a stream of text records, one per line, with the
+/// parts of each record separated by single spaces. That way the dump can be
+/// written without buffering the heap and read back without any special
+/// tools. The first line is always the header,
+///
+///     neutrino-heap-snapshot 1
+///
+/// where the number is the version of the format. After that come the roots,
+///
+///     r <address> <label>
+///
+/// one for each value the runtime keeps alive directly. The label says where
+/// the reference comes from: `roots` and `mutable_roots` are the runtime's
+/// root objects and `tracker` is a strong object tracker. Weak trackers don't
+/// keep their values alive so they're not included. Then come the objects,
+///
+///     o <address> <family> <size> <edge>*
+///
+/// one for each object allocated in the heap whether or not it is still
+/// reachable. The family is the name of the object's family without the `of`
+/// prefix, the size is the object's size in bytes, and the edges are the
+/// addresses of the objects referenced by its fields, species first. A field
+/// that holds a derived object counts as an edge to the derived object's host.
+/// The same edge may occur more than once. Addresses are written in hex.
+/// Finally the snapshot ends with
+///
+///     end
+///
+/// A snapshot that doesn't end with `end` was cut short and should be
+/// considered incomplete.
+
+#ifndef _SNAPSHOT
+#define _SNAPSHOT
+
+#include "runtime.h"
+
+// The version of the snapshot format written by this runtime.
+static const int kHeapSnapshotFormatVersion = 1;
+
+// Writes a snapshot of the given runtime's heap to the given stream. Returns a
+// condition if writing fails.
+value_t runtime_write_heap_snapshot(runtime_t *runtime, out_stream_t *out);
+
+// Writes a snapshot of the given runtime's heap to the file with the given
+// name, replacing it if it already exists.
+value_t runtime_dump_heap_snapshot(runtime_t *runtime, utf8_t path);
+
+#endif // _SNAPSHOT
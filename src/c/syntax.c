@@ -4,6 +4,7 @@
 #include "alloc.h"
 #include "behavior.h"
 #include "freeze.h"
+#include "method.h"
 #include "runtime-inl.h"
 #include "syntax.h"
 #include "tagged-inl.h"
@@ -243,6 +244,589 @@ value_t plankton_new_array_ast(runtime_t *runtime) {
 }
 
 
+// --- C o n s t a n t   f o l d i n g ---
+
+// Before emitting an invocation or namespace variable the compiler checks
+// whether its value can be determined at compile time and if so pushes the
+// value directly. Invocations are only folded once the methodspace has been
+// frozen, since only then is it certain which method a call resolves to, and
+// only if it resolves to one of the pure builtins below.
+
+// The most arguments, including the implicit ones, a foldable invocation can
+// have: a subject, a selector, a transport, and one positional argument.
+static const size_t kMaxFoldableArgumentCount = 4;
+
+static value_t build_call_tags(value_t arguments, runtime_t *runtime);
+
+// Compile-time implementation of a pure builtin. The arguments have already
+// been matched against the builtin's signature so they have the expected
+// types; that is nothing for builtins that take no argument. Returns nothing if
+// the result can't be computed at compile time.
+typedef value_t (*builtin_folder_t)(runtime_t *runtime, value_t self,
+    value_t that);
+
+// Division by zero is left to fail at runtime, where it belongs.
+static value_t fold_integer_divide_integer(runtime_t *runtime, value_t self,
+    value_t that) {
+  if (get_integer_value(that) == 0)
+    return nothing();
+  return apply_integer_divide_integer(runtime, self, that);
+}
+
+static value_t fold_integer_modulo_integer(runtime_t *runtime, value_t self,
+    value_t that) {
+  if (get_integer_value(that) == 0)
+    return nothing();
+  return apply_integer_modulo_integer(runtime, self, that);
+}
+
+// Invokes the given macro for each builtin that can be evaluated at compile
+// time, along with the function that evaluates it. Where possible that is the
+// function the builtin itself uses.
+#define ENUM_FOLDABLE_BUILTINS(F)                                              \
+  F("-int",     apply_integer_negate)                                          \
+  F("int+int",  apply_integer_plus_integer)                                    \
+  F("int-int",  apply_integer_minus_integer)                                   \
+  F("int*int",  apply_integer_times_integer)                                   \
+  F("int/int",  fold_integer_divide_integer)                                   \
+  F("int%int",  fold_integer_modulo_integer)                                   \
+  F("int<int",  apply_integer_less_integer)                                    \
+  F("-f32",     apply_float_32_negate)                                         \
+  F("f32+f32",  apply_float_32_plus_float_32)                                  \
+  F("f32-f32",  apply_float_32_minus_float_32)                                 \
+  F("f32==f32", apply_float_32_equals_float_32)                                \
+  F("str+str",  apply_string_plus_string)                                      \
+  F("str==str", apply_string_equals_string)
+
+// A foldable builtin's name along with its folder.
+typedef struct {
+  const char *name;
+  builtin_folder_t folder;
+} builtin_folder_entry_t;
+
+static const builtin_folder_entry_t kBuiltinFolders[] = {
+#define __EMIT_FOLDER_ENTRY__(NAME, folder) {NAME, folder},
+  ENUM_FOLDABLE_BUILTINS(__EMIT_FOLDER_ENTRY__)
+#undef __EMIT_FOLDER_ENTRY__
+};
+
+value_t init_builtin_folders(value_t map, value_t builtin_impls,
+    runtime_t *runtime) {
+  // The map goes from code block to the index of the folder in the table,
+  // that's what a method has to go on when it's being folded.
+  for (size_t i = 0; i < ARRAY_SIZE(kBuiltinFolders); i++) {
+    TRY_DEF(name, new_heap_utf8(runtime, new_c_string(kBuiltinFolders[i].name)));
+    TRY_DEF(impl, get_id_hash_map_at(builtin_impls, name));
+    value_t code = get_builtin_implementation_code(impl);
+    TRY(set_id_hash_map_at(runtime, map, code, new_integer(i)));
+  }
+  return success();
+}
+
+// Returns the folder for the builtin that implements the given method, or NULL
+// if the method isn't a foldable builtin.
+static builtin_folder_t get_method_builtin_folder(runtime_t *runtime,
+    value_t method) {
+  value_t code = get_freeze_cheat_value(get_method_code_ptr(method));
+  if (is_nothing(code))
+    // Builtin methods have their code set when they're bound.
+    return NULL;
+  value_t index = get_id_hash_map_at(ROOT(runtime, builtin_folders), code);
+  if (in_condition_cause(ccNotFound, index))
+    return NULL;
+  return kBuiltinFolders[get_integer_value(index)].folder;
+}
+
+// Returns true if the given value is immutable and simple enough to be
+// emitted in place of the expression that produced it.
+static bool is_inlineable_constant(value_t value) {
+  switch (get_value_domain(value)) {
+    case vdInteger:
+    case vdCustomTagged:
+      return true;
+    case vdHeapObject:
+      return in_family(ofUtf8, value) && is_frozen(value);
+    default:
+      return false;
+  }
+}
+
+static value_t get_ast_constant_value(value_t ast, assembler_t *assm);
+
+// Returns the value of the given namespace variable if it is known at compile
+// time, otherwise nothing. The bindings of a fragment can't change once it is
+// bound so any immutable value bound there can be used directly.
+static value_t get_namespace_variable_ast_constant_value(value_t self,
+    assembler_t *assm) {
+  if (!in_family(ofModuleFragment, assm->fragment))
+    return nothing();
+  value_t ident = get_namespace_variable_ast_identifier(self);
+  value_t target = get_module_fragment_predecessor_at(assm->fragment,
+      get_identifier_stage(ident));
+  if (!in_family(ofModuleFragment, target) || !is_module_fragment_bound(target))
+    return nothing();
+  value_t value = module_fragment_lookup_path_full(assm->runtime, target,
+      get_identifier_path(ident));
+  // If the lookup fails leave it to the runtime to report it.
+  return is_inlineable_constant(value) ? value : nothing();
+}
+
+// Computes the result of the given invocation if it can be determined at
+// compile time, otherwise returns nothing.
+static value_t compute_invocation_ast_constant_value(value_t self,
+    assembler_t *assm) {
+  runtime_t *runtime = assm->runtime;
+  value_t fragment = assm->fragment;
+  if (!in_family(ofModuleFragment, fragment))
+    return nothing();
+  value_t methodspace = get_module_fragment_methodspace(fragment);
+  if (!is_frozen(methodspace))
+    return nothing();
+  value_t arguments = get_invocation_ast_arguments(self);
+  size_t argc = (size_t) get_array_length(arguments);
+  if (argc > kMaxFoldableArgumentCount)
+    return nothing();
+  value_t values[kMaxFoldableArgumentCount];
+  for (size_t i = 0; i < argc; i++) {
+    value_t arg = get_array_at(arguments, i);
+    if (!is_nothing(get_argument_ast_next_guard(arg)))
+      return nothing();
+    TRY_SET(values[i], get_ast_constant_value(get_argument_ast_value(arg), assm));
+    if (is_nothing(values[i]))
+      return nothing();
+  }
+  // All the arguments are known so look up the method exactly like the
+  // interpreter would, with the values in stack order.
+  TRY_DEF(tags, build_call_tags(arguments, runtime));
+  TRY_DEF(value_array, new_heap_array(runtime, argc));
+  for (size_t i = 0; i < argc; i++)
+    set_array_at(value_array, argc - i - 1, values[i]);
+  if (is_nothing(assm->fold_ambience)) {
+    // The lookup only needs the methodspace from the ambience and that's the
+    // same for everything this assembler folds.
+    TRY_SET(assm->fold_ambience, new_heap_ambience(runtime));
+    set_ambience_methodspace(assm->fold_ambience, methodspace);
+  }
+  sigmap_input_layout_t layout = sigmap_input_layout_new(assm->fold_ambience,
+      tags, nothing());
+  value_t arg_map = whatever();
+  value_t method = lookup_method_full_from_value_array(&layout, value_array,
+      &arg_map);
+  if (!in_family(ofMethod, method))
+    // Lookup errors are reported when the invocation is executed.
+    return nothing();
+  builtin_folder_t folder = get_method_builtin_folder(runtime, method);
+  if (folder == NULL)
+    return nothing();
+  value_t subject_offset = get_call_tags_subject_offset(tags);
+  if (is_nothing(subject_offset))
+    return nothing();
+  value_t subject = get_array_at(value_array, get_integer_value(subject_offset));
+  value_t that = nothing();
+  for (size_t i = 0; i < argc; i++) {
+    value_t tag = get_argument_ast_tag(get_array_at(arguments, i));
+    if (is_integer(tag) && get_integer_value(tag) == 0)
+      that = values[i];
+  }
+  TRY_DEF(result, folder(runtime, subject, that));
+  // Strings built by the folder have to be frozen before they can be shared.
+  TRY(ensure_frozen(runtime, result));
+  return is_inlineable_constant(result) ? result : nothing();
+}
+
+// Returns the result of the given invocation if it can be computed at compile
+// time, otherwise nothing. The result is cached in the assembler since each
+// invocation is looked at both by the invocations that contain it and when it
+// is emitted itself, and computing it from scratch every time would make
+// folding quadratic in the depth of nested invocations.
+static value_t get_invocation_ast_constant_value(value_t self,
+    assembler_t *assm) {
+  if (is_nothing(assm->constant_values))
+    TRY_SET(assm->constant_values, new_heap_id_hash_map(assm->runtime, 16));
+  value_t cached = get_id_hash_map_at(assm->constant_values, self);
+  if (!in_condition_cause(ccNotFound, cached))
+    return cached;
+  TRY_DEF(result, compute_invocation_ast_constant_value(self, assm));
+  TRY(set_id_hash_map_at(assm->runtime, assm->constant_values, self, result));
+  return result;
+}
+
+// Returns the value of the given expression if it is known at compile time,
+// otherwise nothing.
+static value_t get_ast_constant_value(value_t ast, assembler_t *assm) {
+  switch (get_heap_object_family(ast)) {
+    case ofLiteralAst:
+      return get_literal_ast_value(ast);
+    case ofNamespaceVariableAst:
+      return get_namespace_variable_ast_constant_value(ast, assm);
+    case ofInvocationAst:
+      return get_invocation_ast_constant_value(ast, assm);
+    default:
+      return nothing();
+  }
+}
+
+// Returns true iff the given value is an infix operation with the given name.
+static bool is_infix_operation_named(value_t value, const char *name) {
+  if (!in_family(ofOperation, value) || get_operation_type(value) != otInfix)
+    return false;
+  value_t op_name = get_operation_value(value);
+  return in_family(ofUtf8, op_name)
+      && string_equals_cstr(get_utf8_contents(op_name), name);
+}
+
+static bool ast_may_leak_symbol(runtime_t *runtime, value_t ast, value_t symbol,
+    value_t method_asts);
+
+// Returns the body of the lambda method ast that handles the infix operation
+// with the given name, provided it takes no arguments beyond the implicit
+// ones and never refers to those. Otherwise returns nothing. The body is meant
+// to be emitted in place of the call where there is no lambda to be the
+// subject, so it can't be allowed to use its parameters.
+static value_t get_lambda_ast_thunk_body(runtime_t *runtime, value_t lambda,
+    const char *name) {
+  value_t method_asts = get_lambda_ast_methods(lambda);
+  for (int64_t i = 0; i < get_array_length(method_asts); i++) {
+    value_t method_ast = get_array_at(method_asts, i);
+    value_t params = get_signature_ast_parameters(
+        get_method_ast_signature(method_ast));
+    bool is_match = false;
+    bool is_thunk = true;
+    for (int64_t j = 0; j < get_array_length(params); j++) {
+      value_t param = get_array_at(params, j);
+      value_t tags = get_parameter_ast_tags(param);
+      if (in_array(tags, ROOT(runtime, selector_key))) {
+        value_t guard = get_parameter_ast_guard(param);
+        value_t guard_value = get_guard_ast_value(guard);
+        is_match = get_guard_ast_type(guard) == gtEq
+            && in_family(ofLiteralAst, guard_value)
+            && is_infix_operation_named(get_literal_ast_value(guard_value), name);
+      } else if (!in_array(tags, ROOT(runtime, subject_key))
+          && !in_array(tags, ROOT(runtime, transport_key))) {
+        is_thunk = false;
+      }
+    }
+    if (!is_match)
+      continue;
+    value_t signature = get_method_ast_signature(method_ast);
+    value_t body = get_method_ast_body(method_ast);
+    if (!is_thunk || !is_nothing(get_signature_ast_reified(signature)))
+      return nothing();
+    for (int64_t j = 0; j < get_array_length(params); j++) {
+      value_t symbol = get_parameter_ast_symbol(get_array_at(params, j));
+      if (!is_nothing(symbol)
+          && ast_may_leak_symbol(runtime, body, symbol, nothing()))
+        return nothing();
+    }
+    return body;
+  }
+  return nothing();
+}
+
+// Returns true iff the given namespace variable ast refers to @core:if.
+static bool is_core_if_variable_ast(runtime_t *runtime, value_t ast) {
+  if (!in_family(ofNamespaceVariableAst, ast))
+    return false;
+  value_t path = get_identifier_path(get_namespace_variable_ast_identifier(ast));
+  if (is_path_empty(path)
+      || !value_identity_compare(get_path_head(path), RSTR(runtime, core)))
+    return false;
+  value_t tail = get_path_tail(path);
+  if (is_path_empty(tail) || !is_path_empty(get_path_tail(tail)))
+    return false;
+  value_t name = get_path_head(tail);
+  return in_family(ofUtf8, name)
+      && string_equals_cstr(get_utf8_contents(name), "if");
+}
+
+// If the given invocation is an if expression whose condition is known at
+// compile time, returns the expression of the branch that will be taken.
+// Otherwise returns nothing.
+static value_t get_invocation_ast_static_branch(value_t self,
+    assembler_t *assm) {
+  runtime_t *runtime = assm->runtime;
+  value_t arguments = get_invocation_ast_arguments(self);
+  if (get_array_length(arguments) != 5)
+    return nothing();
+  value_t cond_ast = nothing();
+  value_t thunk_ast = nothing();
+  for (int64_t i = 0; i < 5; i++) {
+    value_t arg = get_array_at(arguments, i);
+    if (!is_nothing(get_argument_ast_next_guard(arg)))
+      return nothing();
+    value_t tag = get_argument_ast_tag(arg);
+    value_t value = get_argument_ast_value(arg);
+    bool is_expected;
+    if (is_same_value(tag, ROOT(runtime, subject_key))) {
+      is_expected = is_core_if_variable_ast(runtime, value);
+    } else if (is_same_value(tag, ROOT(runtime, selector_key))) {
+      is_expected = in_family(ofLiteralAst, value)
+          && value_identity_compare(get_literal_ast_value(value),
+              ROOT(runtime, op_call));
+    } else if (is_same_value(tag, ROOT(runtime, transport_key))) {
+      is_expected = in_family(ofLiteralAst, value)
+          && is_same_value(get_literal_ast_value(value), transport_sync());
+    } else if (is_same_value(tag, new_integer(0))) {
+      cond_ast = value;
+      is_expected = true;
+    } else if (is_same_value(tag, new_integer(1))) {
+      thunk_ast = value;
+      is_expected = in_family(ofLambdaAst, value);
+    } else {
+      is_expected = false;
+    }
+    if (!is_expected)
+      return nothing();
+  }
+  if (is_nothing(cond_ast) || is_nothing(thunk_ast))
+    return nothing();
+  TRY_DEF(cond, get_ast_constant_value(cond_ast, assm));
+  if (!in_phylum(tpBoolean, cond))
+    return nothing();
+  return get_lambda_ast_thunk_body(runtime, thunk_ast,
+      get_boolean_value(cond) ? "then!" : "else!");
+}
+
+
+// --- I n l i n i n g ---
+
+// Once the methodspace has been frozen an invocation whose selector is known
+// at compile time may resolve to the same method whatever the values of the
+// other arguments. If that method's body is small it is emitted in place of
+// the invocation with the parameters bound to the arguments on the stack, which
+// saves pushing and popping a frame for the call. The code may end up running
+// in a different ambience than the one it was compiled for so the inlined body
+// is guarded by a check that the methodspace is still the one the method was
+// resolved in, falling back to a normal invocation if it isn't. A frozen
+// methodspace can't change so its identity is all the guard needs. The
+// methodspace epoch would be no use here: add_methodspace_method bumps it
+// whenever a method is added to any methodspace, which includes the ones built
+// at compile time for lambdas and signal handlers by
+// build_methodspace_from_method_asts, so it changes all the time without the
+// frozen methodspace being affected.
+
+// The most arguments, including the implicit ones, an inlined invocation can
+// have.
+static const size_t kMaxInlineArgumentCount = 8;
+
+// The most syntax nodes the body of an inlined method can have.
+static const size_t kMaxInlineBodySize = 8;
+
+// How deeply inlined bodies can nest within each other, which among other
+// things stops a recursive method from being inlined into itself forever.
+static const size_t kMaxInlineDepth = 2;
+
+static value_t create_call_tags(value_t arguments, assembler_t *assm);
+
+// Returns true if the given expression is simple enough to be part of the body
+// of an inlined method, counting its nodes against the given budget. Only
+// expressions that can't bind symbols, create blocks, or escape are allowed so
+// the body behaves the same whether it has its own frame or not.
+static bool is_inlineable_body_ast(value_t ast, size_t *budget) {
+  if (*budget == 0)
+    return false;
+  (*budget)--;
+  switch (get_heap_object_family(ast)) {
+    case ofLiteralAst:
+    case ofLocalVariableAst:
+    case ofNamespaceVariableAst:
+      return true;
+    case ofArrayAst: {
+      value_t elements = get_array_ast_elements(ast);
+      for (int64_t i = 0; i < get_array_length(elements); i++) {
+        if (!is_inlineable_body_ast(get_array_at(elements, i), budget))
+          return false;
+      }
+      return true;
+    }
+    case ofInvocationAst: {
+      value_t arguments = get_invocation_ast_arguments(ast);
+      for (int64_t i = 0; i < get_array_length(arguments); i++) {
+        value_t arg = get_array_at(arguments, i);
+        if (!is_nothing(get_argument_ast_next_guard(arg))
+            || !is_inlineable_body_ast(get_argument_ast_value(arg), budget))
+          return false;
+      }
+      return true;
+    }
+    default:
+      return false;
+  }
+}
+
+// Returns the index of the first of the given argument asts whose tag is one of
+// the given tags, or -1 if there is none.
+static int64_t get_argument_index_with_tags(value_t arguments, value_t tags) {
+  for (int64_t i = 0; i < get_array_length(arguments); i++) {
+    if (in_array(tags, get_argument_ast_tag(get_array_at(arguments, i))))
+      return i;
+  }
+  return -1;
+}
+
+// Returns true if the given parameter is certain to match the value of the
+// given argument ast, whatever that value turns out to be.
+static bool is_parameter_static_match(value_t param, value_t arg_ast) {
+  value_t guard = get_parameter_guard(param);
+  switch (get_guard_type(guard)) {
+    case gtAny:
+      return true;
+    case gtEq:
+      return in_family(ofLiteralAst, arg_ast)
+          && value_identity_compare(get_literal_ast_value(arg_ast),
+              get_guard_value(guard));
+    default:
+      // Whether an is-guard matches depends on the type of the value.
+      return false;
+  }
+}
+
+// Returns the method the given invocation will resolve to whatever the values
+// of its arguments, provided the method is small enough to be inlined.
+// Otherwise returns nothing.
+static value_t get_invocation_ast_inline_method(value_t self,
+    assembler_t *assm) {
+  runtime_t *runtime = assm->runtime;
+  value_t fragment = assm->fragment;
+  if (assm->inline_depth >= kMaxInlineDepth
+      || !in_family(ofModuleFragment, fragment))
+    return nothing();
+  value_t methodspace = get_module_fragment_methodspace(fragment);
+  if (!is_frozen(methodspace))
+    return nothing();
+  value_t arguments = get_invocation_ast_arguments(self);
+  size_t argc = (size_t) get_array_length(arguments);
+  if (argc > kMaxInlineArgumentCount)
+    return nothing();
+  value_t selector = nothing();
+  for (size_t i = 0; i < argc; i++) {
+    value_t arg = get_array_at(arguments, i);
+    if (!is_nothing(get_argument_ast_next_guard(arg)))
+      return nothing();
+    value_t value = get_argument_ast_value(arg);
+    if (is_same_value(get_argument_ast_tag(arg), ROOT(runtime, selector_key))
+        && in_family(ofLiteralAst, value))
+      selector = get_literal_ast_value(value);
+  }
+  if (is_nothing(selector))
+    return nothing();
+  // The selector slice holds every method that could possibly match so if
+  // there's just one and it's certain to match it's the one that'll be called.
+  TRY_DEF(slice, get_or_create_methodspace_selector_slice(runtime, methodspace,
+      selector));
+  value_t entries = get_signature_map_entries(slice);
+  if (get_pair_array_buffer_length(entries) != 1)
+    return nothing();
+  value_t signature = get_pair_array_buffer_first_at(entries, 0);
+  value_t method = get_pair_array_buffer_second_at(entries, 0);
+  // Each argument must match a different parameter and there must be as many
+  // arguments as parameters, so each parameter is matched exactly once.
+  if ((size_t) get_signature_parameter_count(signature) != argc)
+    return nothing();
+  uint64_t params_seen = 0;
+  for (size_t i = 0; i < argc; i++) {
+    value_t arg = get_array_at(arguments, i);
+    value_t tag = get_argument_ast_tag(arg);
+    value_t param = nothing();
+    for (int64_t j = 0; j < get_signature_tag_count(signature); j++) {
+      if (value_identity_compare(get_signature_tag_at(signature, j), tag)) {
+        param = get_signature_parameter_at(signature, j);
+        break;
+      }
+    }
+    if (is_nothing(param)
+        || !is_parameter_static_match(param, get_argument_ast_value(arg)))
+      return nothing();
+    uint64_t param_bit = ((uint64_t) 1) << get_parameter_index(param);
+    if ((params_seen & param_bit) != 0)
+      return nothing();
+    params_seen |= param_bit;
+  }
+  // Builtins and delegates have no body to inline.
+  value_t flags = get_method_flags(method);
+  if (get_flag_set_at(flags, mfLambdaDelegate)
+      || get_flag_set_at(flags, mfBlockDelegate))
+    return nothing();
+  value_t method_ast = get_method_syntax(method);
+  if (!in_family(ofMethodAst, method_ast))
+    return nothing();
+  value_t method_fragment = get_method_module_fragment(method);
+  if (!in_family(ofModuleFragment, method_fragment)
+      || !is_same_value(get_module_fragment_methodspace(method_fragment),
+          methodspace))
+    return nothing();
+  value_t signature_ast = get_method_ast_signature(method_ast);
+  if (!is_nothing(get_signature_ast_reified(signature_ast)))
+    return nothing();
+  value_t param_asts = get_signature_ast_parameters(signature_ast);
+  for (int64_t i = 0; i < get_array_length(param_asts); i++) {
+    value_t param_ast = get_array_at(param_asts, i);
+    if (!is_nothing(get_parameter_ast_symbol(param_ast))
+        && get_argument_index_with_tags(arguments,
+            get_parameter_ast_tags(param_ast)) < 0)
+      return nothing();
+  }
+  size_t budget = kMaxInlineBodySize;
+  if (!is_inlineable_body_ast(get_method_ast_body(method_ast), &budget))
+    return nothing();
+  return method;
+}
+
+// Emits the given invocation with the body of the given method, which it has
+// been determined to resolve to, inlined in place of the call.
+static value_t emit_inlined_invocation(value_t self, value_t method,
+    assembler_t *assm) {
+  value_t arguments = get_invocation_ast_arguments(self);
+  size_t argc = (size_t) get_array_length(arguments);
+  value_t method_ast = get_method_syntax(method);
+  value_t param_asts = get_signature_ast_parameters(
+      get_method_ast_signature(method_ast));
+  value_t fragment = assm->fragment;
+  // The arguments are evaluated onto the stack exactly as for a normal
+  // invocation, since the fallback needs them there, and the inlined body
+  // reads them from there as locals.
+  size_t args_offset = assm->stack_height;
+  TRY_DEF(tags, create_call_tags(arguments, assm));
+  map_scope_o param_scope;
+  TRY(assembler_push_map_scope(assm, &param_scope));
+  for (int64_t i = 0; i < get_array_length(param_asts); i++) {
+    value_t param_ast = get_array_at(param_asts, i);
+    value_t symbol = get_parameter_ast_symbol(param_ast);
+    if (is_nothing(symbol))
+      continue;
+    int64_t index = get_argument_index_with_tags(arguments,
+        get_parameter_ast_tags(param_ast));
+    TRY(map_scope_bind(&param_scope, symbol, btLocal,
+        (uint16_t) (args_offset + index)));
+  }
+  short_buffer_cursor_t fallback;
+  size_t guard_offset = assembler_get_code_cursor(assm);
+  TRY(assembler_emit_guard_inline(assm,
+      get_module_fragment_methodspace(fragment), &fallback));
+  // The body refers to the namespace of the fragment the method was defined in
+  // which may not be the one we're compiling within.
+  assm->fragment = get_method_module_fragment(method);
+  assm->inline_depth++;
+  TRY(emit_value(get_method_ast_body(method_ast), assm));
+  assm->inline_depth--;
+  assm->fragment = fragment;
+  assembler_pop_map_scope(assm, &param_scope);
+  short_buffer_cursor_t join;
+  size_t goto_offset = assembler_get_code_cursor(assm);
+  TRY(assembler_emit_goto_forward(assm, &join));
+  // The fallback is reached from the guard, before the body has pushed its
+  // result.
+  size_t fallback_offset = assembler_get_code_cursor(assm);
+  short_buffer_cursor_set(&fallback, (uint16_t) (fallback_offset - guard_offset));
+  assembler_adjust_stack_height(assm, -1);
+  TRY(assembler_emit_invocation(assm, fragment, tags, nothing()));
+  size_t join_offset = assembler_get_code_cursor(assm);
+  short_buffer_cursor_set(&join, (uint16_t) (join_offset - goto_offset));
+  TRY(assembler_emit_slap(assm, argc));
+  return success();
+}
+
+
 // --- I n v o c a t i o n ---
 
 TRIVIAL_PRINT_ON_IMPL(InvocationAst, invocation_ast);
@@ -252,23 +836,29 @@ NO_BUILTIN_METHODS(invocation_ast);
 ACCESSORS_IMPL(InvocationAst, invocation_ast, snInFamilyOpt(ofArray), Arguments,
     arguments);
 
-static value_t create_call_tags(value_t arguments, assembler_t *assm) {
+// Builds the call tags for an invocation with the given arguments.
+static value_t build_call_tags(value_t arguments, runtime_t *runtime) {
   size_t arg_count = (size_t) get_array_length(arguments);
-  // Build the invocation record and emit the values at the same time.
-  TRY_DEF(entries, new_heap_pair_array(assm->runtime, arg_count));
+  TRY_DEF(entries, new_heap_pair_array(runtime, arg_count));
   for (size_t i = 0; i < arg_count; i++) {
     value_t argument = get_array_at(arguments, i);
-    // Add the tag to the invocation record.
     value_t tag = get_argument_ast_tag(argument);
     set_pair_array_first_at(entries, i, tag);
     set_pair_array_second_at(entries, i, new_integer(arg_count - i - 1));
-    // Emit the value.
-    value_t value = get_argument_ast_value(argument);
-    TRY(emit_value(value, assm));
   }
   TRY(co_sort_pair_array(entries));
   IF_EXPENSIVE_CHECKS_ENABLED(check_call_tags_entries_unique(entries));
-  return new_heap_call_tags(assm->runtime, afFreeze, entries);
+  return new_heap_call_tags(runtime, afFreeze, entries);
+}
+
+static value_t create_call_tags(value_t arguments, assembler_t *assm) {
+  // Emit the values in evaluation order and then build the invocation record.
+  size_t arg_count = (size_t) get_array_length(arguments);
+  for (size_t i = 0; i < arg_count; i++) {
+    value_t argument = get_array_at(arguments, i);
+    TRY(emit_value(get_argument_ast_value(argument), assm));
+  }
+  return build_call_tags(arguments, assm->runtime);
 }
 
 // Given a guard ast, evaluates it to a guard within the given fragment. There
@@ -316,6 +906,17 @@ static value_t create_call_next_guards(value_t arguments, assembler_t *assm) {
 
 value_t emit_invocation_ast(value_t value, assembler_t *assm) {
   CHECK_FAMILY(ofInvocationAst, value);
+  TRY_DEF(constant, get_invocation_ast_constant_value(value, assm));
+  if (!is_nothing(constant))
+    return assembler_emit_push(assm, constant);
+  TRY_DEF(branch, get_invocation_ast_static_branch(value, assm));
+  if (!is_nothing(branch))
+    // The branch that isn't taken is dropped and the one that is gets emitted
+    // inline rather than as a lambda.
+    return emit_value(branch, assm);
+  TRY_DEF(method, get_invocation_ast_inline_method(value, assm));
+  if (!is_nothing(method))
+    return emit_inlined_invocation(value, method, assm);
   value_t arguments = get_invocation_ast_arguments(value);
   TRY_DEF(record, create_call_tags(arguments, assm));
   TRY_DEF(next_guards, create_call_next_guards(arguments, assm));
@@ -732,8 +1333,166 @@ ACCESSORS_IMPL(LocalDeclarationAst, local_declaration_ast, snInSyntaxFamilyOpt,
 ACCESSORS_IMPL(LocalDeclarationAst, local_declaration_ast, snInSyntaxFamilyOpt,
     Body, body);
 
+// Returns the parameter ast of the given method ast that has the given tag,
+// or nothing if there is none.
+static value_t get_method_ast_parameter_with_tag(value_t method_ast, value_t tag) {
+  value_t signature = get_method_ast_signature(method_ast);
+  value_t params = get_signature_ast_parameters(signature);
+  for (int64_t i = 0; i < get_array_length(params); i++) {
+    value_t param = get_array_at(params, i);
+    if (in_array(get_parameter_ast_tags(param), tag))
+      return param;
+  }
+  return nothing();
+}
+
+// Returns true iff the given selector is matched exactly by one of the given
+// lambda method asts.
+static bool is_lambda_method_selector(runtime_t *runtime, value_t method_asts,
+    value_t selector) {
+  for (int64_t i = 0; i < get_array_length(method_asts); i++) {
+    value_t param = get_method_ast_parameter_with_tag(
+        get_array_at(method_asts, i), ROOT(runtime, selector_key));
+    if (is_nothing(param))
+      continue;
+    value_t guard = get_parameter_ast_guard(param);
+    if (get_guard_ast_type(guard) != gtEq)
+      continue;
+    value_t guard_value = get_guard_ast_value(guard);
+    if (in_family(ofLiteralAst, guard_value)
+        && value_identity_compare(get_literal_ast_value(guard_value), selector))
+      return true;
+  }
+  return false;
+}
+
+// Returns true iff the given argument ast invokes one of the given lambda
+// method asts on the given symbol, that is, the invocation has the symbol as
+// its subject, a literal selector one of the methods matches, and a literal
+// sync transport. An async invocation hands the subject to whatever runs the
+// call later so it may outlive the symbol.
+static bool is_local_lambda_method_invocation(runtime_t *runtime,
+    value_t arguments, value_t symbol, value_t method_asts) {
+  bool has_subject = false;
+  bool has_selector = false;
+  bool is_sync = false;
+  for (int64_t i = 0; i < get_array_length(arguments); i++) {
+    value_t arg = get_array_at(arguments, i);
+    value_t tag = get_argument_ast_tag(arg);
+    value_t value = get_argument_ast_value(arg);
+    if (is_same_value(tag, ROOT(runtime, subject_key))) {
+      has_subject = in_family(ofLocalVariableAst, value)
+          && value_identity_compare(get_local_variable_ast_symbol(value), symbol);
+    } else if (is_same_value(tag, ROOT(runtime, selector_key))) {
+      has_selector = in_family(ofLiteralAst, value)
+          && is_lambda_method_selector(runtime, method_asts,
+              get_literal_ast_value(value));
+    } else if (is_same_value(tag, ROOT(runtime, transport_key))) {
+      is_sync = in_family(ofLiteralAst, value)
+          && is_same_value(get_literal_ast_value(value), transport_sync());
+    }
+  }
+  return has_subject && has_selector && is_sync;
+}
+
+// Returns true iff the given syntax tree uses the given symbol in a way that
+// could let the symbol's value escape. If method_asts is an array of lambda
+// method asts then invocations of those methods on the symbol don't count as
+// uses, except within a nested lambda since that may outlive the symbol.
+static bool ast_may_leak_symbol(runtime_t *runtime, value_t ast, value_t symbol,
+    value_t method_asts) {
+  if (in_family(ofArray, ast)) {
+    for (int64_t i = 0; i < get_array_length(ast); i++) {
+      if (ast_may_leak_symbol(runtime, get_array_at(ast, i), symbol, method_asts))
+        return true;
+    }
+    return false;
+  } else if (!in_syntax_family(ast)) {
+    return false;
+  }
+  switch (get_heap_object_family(ast)) {
+    case ofLiteralAst:
+    case ofSymbolAst:
+      // Literals can't refer to symbols and symbols point back to their origin
+      // so traversing either is at best pointless.
+      return false;
+    case ofLocalVariableAst:
+      return value_identity_compare(get_local_variable_ast_symbol(ast), symbol);
+    case ofLambdaAst:
+      return ast_may_leak_symbol(runtime, get_lambda_ast_methods(ast), symbol,
+          nothing());
+    case ofInvocationAst: {
+      value_t arguments = get_invocation_ast_arguments(ast);
+      if (!is_nothing(method_asts)
+          && is_local_lambda_method_invocation(runtime, arguments, symbol,
+              method_asts)) {
+        // The subject is fine but the other arguments may still leak the
+        // symbol so they must be checked.
+        for (int64_t i = 0; i < get_array_length(arguments); i++) {
+          value_t arg = get_array_at(arguments, i);
+          if (is_same_value(get_argument_ast_tag(arg), ROOT(runtime, subject_key)))
+            continue;
+          if (ast_may_leak_symbol(runtime, arg, symbol, method_asts))
+            return true;
+        }
+        return false;
+      }
+      return ast_may_leak_symbol(runtime, arguments, symbol, method_asts);
+    }
+    default: {
+      value_field_iter_t iter;
+      value_field_iter_init(&iter, ast);
+      value_field_t field = value_field_empty();
+      while (value_field_iter_next(&iter, &field)) {
+        if (ast_may_leak_symbol(runtime, *field.ptr, symbol, method_asts))
+          return true;
+      }
+      return false;
+    }
+  }
+}
+
+// Returns true iff the given local declaration binds a lambda that provably
+// can't outlive the declaration's body and so can be compiled as a block,
+// which lives in the frame and reads the variables it uses from the enclosing
+// scope rather than having them captured into a heap array. A lambda can't
+// escape if it is immutably bound, the body only ever invokes its methods
+// directly, and its methods never refer to their own subject. This only covers
+// locals: a lambda passed to a method, like the thunks passed to @if, could be
+// kept by the method so it must still be a real lambda.
+static bool is_local_lambda_non_escaping(runtime_t *runtime, value_t self) {
+  value_t value = get_local_declaration_ast_value(self);
+  if (!in_family(ofLambdaAst, value)
+      || get_boolean_value(get_local_declaration_ast_is_mutable(self)))
+    return false;
+  value_t method_asts = get_lambda_ast_methods(value);
+  for (int64_t i = 0; i < get_array_length(method_asts); i++) {
+    value_t method_ast = get_array_at(method_asts, i);
+    // The reified arguments include the subject so there's no telling where
+    // it might end up.
+    if (!is_nothing(get_signature_ast_reified(get_method_ast_signature(method_ast))))
+      return false;
+    value_t subject = get_method_ast_parameter_with_tag(method_ast,
+        ROOT(runtime, subject_key));
+    if (is_nothing(subject))
+      return false;
+    value_t subject_symbol = get_parameter_ast_symbol(subject);
+    if (!is_nothing(subject_symbol) && ast_may_leak_symbol(runtime,
+        get_method_ast_body(method_ast), subject_symbol, nothing()))
+      return false;
+  }
+  return !ast_may_leak_symbol(runtime, get_local_declaration_ast_body(self),
+      get_local_declaration_ast_symbol(self), method_asts);
+}
+
+// Emits a local declaration of a lambda that has been shown not to escape as a
+// block. Defined with the block ast.
+static value_t emit_local_lambda_as_block(value_t self, assembler_t *assm);
+
 value_t emit_local_declaration_ast(value_t self, assembler_t *assm) {
   CHECK_FAMILY(ofLocalDeclarationAst, self);
+  if (is_local_lambda_non_escaping(assm->runtime, self))
+    return emit_local_lambda_as_block(self, assm);
   // Record the stack offset where the value is being pushed.
   size_t offset = assm->stack_height;
   // Emit the value, wrapping it in a reference if this is a mutable local. The
@@ -885,15 +1644,15 @@ static value_t emit_block_value(value_t method_asts, assembler_t *assm) {
   return success();
 }
 
-value_t emit_block_ast(value_t self, assembler_t *assm) {
-  CHECK_FAMILY(ofBlockAst, self);
+// Emits a block with the given methods bound to the given symbol within the
+// given body.
+static value_t emit_block_binding(value_t symbol, value_t method_asts,
+    value_t body, assembler_t *assm) {
   // Record the stack offset where the value is being pushed.
   size_t offset = assm->stack_height + get_genus_descriptor(dgBlockSection)->field_count;
-  value_t method_asts = get_block_ast_methods(self);
   TRY(emit_block_value(method_asts, assm));
   // Record in the scope chain that the symbol is bound and where the value is
   // located on the stack.
-  value_t symbol = get_block_ast_symbol(self);
   CHECK_FAMILY(ofSymbolAst, symbol);
   if (assembler_is_symbol_bound(assm, symbol))
     // We're trying to redefine an already defined symbol. That's not valid.
@@ -901,7 +1660,6 @@ value_t emit_block_ast(value_t self, assembler_t *assm) {
   single_symbol_scope_o scope;
   assembler_push_single_symbol_scope(assm, &scope, symbol, btLocal,
       (uint16_t) offset);
-  value_t body = get_block_ast_body(self);
   // Emit the body in scope of the local.
   TRY(emit_value(body, assm));
   assembler_pop_single_symbol_scope(assm, &scope);
@@ -910,6 +1668,19 @@ value_t emit_block_ast(value_t self, assembler_t *assm) {
   return success();
 }
 
+value_t emit_block_ast(value_t self, assembler_t *assm) {
+  CHECK_FAMILY(ofBlockAst, self);
+  return emit_block_binding(get_block_ast_symbol(self),
+      get_block_ast_methods(self), get_block_ast_body(self), assm);
+}
+
+static value_t emit_local_lambda_as_block(value_t self, assembler_t *assm) {
+  CHECK_FAMILY(ofLocalDeclarationAst, self);
+  value_t lambda = get_local_declaration_ast_value(self);
+  return emit_block_binding(get_local_declaration_ast_symbol(self),
+      get_lambda_ast_methods(lambda), get_local_declaration_ast_body(self), assm);
+}
+
 value_t block_ast_validate(value_t self) {
   VALIDATE_FAMILY(ofBlockAst, self);
   VALIDATE_FAMILY_OPT(ofSymbolAst, get_block_ast_symbol(self));
@@ -1101,6 +1872,9 @@ ACCESSORS_IMPL(NamespaceVariableAst, namespace_variable_ast,
     snInFamilyOpt(ofIdentifier), Identifier, identifier);
 
 value_t emit_namespace_variable_ast(value_t self, assembler_t *assm) {
+  value_t constant = get_namespace_variable_ast_constant_value(self, assm);
+  if (!is_nothing(constant))
+    return assembler_emit_push(assm, constant);
   value_t ident = get_namespace_variable_ast_identifier(self);
   value_t target = get_module_fragment_predecessor_at(assm->fragment,
       get_identifier_stage(ident));
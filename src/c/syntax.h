@@ -14,6 +14,11 @@
 // Initialize the map from syntax factory names to the factories themselves.
 value_t init_plankton_syntax_factories(value_t map, runtime_t *runtime);
 
+// Initialize the map from the code blocks of the builtins the compiler can
+// evaluate at compile time to how it evaluates them.
+value_t init_builtin_folders(value_t map, value_t builtin_impls,
+    runtime_t *runtime);
+
 // Emits bytecode representing the given syntax tree value. If the value is not
 // a syntax tree an InvalidSyntax condition is returned.
 value_t emit_value(value_t value, assembler_t *assm);
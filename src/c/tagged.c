@@ -146,36 +146,52 @@ bool is_float_32_nan(value_t value) {
   return isnan(get_float_32_value(value));
 }
 
-static value_t float_32_negate(builtin_arguments_t *args) {
-  value_t self = get_builtin_subject(args);
+value_t apply_float_32_negate(runtime_t *runtime, value_t self, value_t that) {
   CHECK_PHYLUM(tpFloat32, self);
   return new_float_32(-get_float_32_value(self));
 }
 
-static value_t float_32_minus_float_32(builtin_arguments_t *args) {
-  value_t self = get_builtin_subject(args);
-  value_t that = get_builtin_argument(args, 0);
+value_t apply_float_32_minus_float_32(runtime_t *runtime, value_t self,
+    value_t that) {
   CHECK_PHYLUM(tpFloat32, self);
   CHECK_PHYLUM(tpFloat32, that);
   return new_float_32(get_float_32_value(self) - get_float_32_value(that));
 }
 
-static value_t float_32_plus_float_32(builtin_arguments_t *args) {
-  value_t self = get_builtin_subject(args);
-  value_t that = get_builtin_argument(args, 0);
+value_t apply_float_32_plus_float_32(runtime_t *runtime, value_t self,
+    value_t that) {
   CHECK_PHYLUM(tpFloat32, self);
   CHECK_PHYLUM(tpFloat32, that);
   return new_float_32(get_float_32_value(self) + get_float_32_value(that));
 }
 
-static value_t float_32_equals_float_32(builtin_arguments_t *args) {
-  value_t self = get_builtin_subject(args);
-  value_t that = get_builtin_argument(args, 0);
+value_t apply_float_32_equals_float_32(runtime_t *runtime, value_t self,
+    value_t that) {
   CHECK_PHYLUM(tpFloat32, self);
   CHECK_PHYLUM(tpFloat32, that);
   return new_boolean(test_relation(value_ordering_compare(self, that), reEqual));
 }
 
+static value_t float_32_negate(builtin_arguments_t *args) {
+  return apply_float_32_negate(get_builtin_runtime(args),
+      get_builtin_subject(args), nothing());
+}
+
+static value_t float_32_minus_float_32(builtin_arguments_t *args) {
+  return apply_float_32_minus_float_32(get_builtin_runtime(args),
+      get_builtin_subject(args), get_builtin_argument(args, 0));
+}
+
+static value_t float_32_plus_float_32(builtin_arguments_t *args) {
+  return apply_float_32_plus_float_32(get_builtin_runtime(args),
+      get_builtin_subject(args), get_builtin_argument(args, 0));
+}
+
+static value_t float_32_equals_float_32(builtin_arguments_t *args) {
+  return apply_float_32_equals_float_32(get_builtin_runtime(args),
+      get_builtin_subject(args), get_builtin_argument(args, 0));
+}
+
 value_t add_float_32_builtin_implementations(runtime_t *runtime, safe_value_t s_map) {
   ADD_BUILTIN_IMPL("-f32", 0, float_32_negate);
   ADD_BUILTIN_IMPL("f32+f32", 1, float_32_plus_float_32);
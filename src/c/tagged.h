@@ -201,6 +201,16 @@ bool is_float_32_finite(value_t value);
 // Returns true if the value is the float-32 representation of NaN.
 bool is_float_32_nan(value_t value);
 
+// The operations behind the float-32 builtins, shared with constant folding
+// like the integer ones.
+value_t apply_float_32_negate(runtime_t *runtime, value_t self, value_t that);
+value_t apply_float_32_plus_float_32(runtime_t *runtime, value_t self,
+    value_t that);
+value_t apply_float_32_minus_float_32(runtime_t *runtime, value_t self,
+    value_t that);
+value_t apply_float_32_equals_float_32(runtime_t *runtime, value_t self,
+    value_t that);
+
 
 /// ## Flag set
 ///
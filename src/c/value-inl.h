@@ -182,6 +182,7 @@ void init_frozen_##receiver##_##field(value_t self, value_t value) {           \
   CHECK_DEEP_FROZEN(value);                                                    \
   CHECK_SENTRY(SENTRY, value);                                                 \
   *access_heap_object_field(self, k##Receiver##Field##Offset) = value;         \
+  heap_object_write_barrier(self, value);                                      \
 }                                                                              \
 ACCESSORS_IMPL(Receiver, receiver, SENTRY, Field, field)
 
@@ -193,6 +194,7 @@ void set_##receiver##_##field(value_t self, value_t value) {                   \
   CHECK_MUTABLE(self);                                                         \
   CHECK_SENTRY(SENTRY, value);                                                 \
   *access_heap_object_field(self, k##Receiver##Field##Offset) = value;         \
+  heap_object_write_barrier(self, value);                                      \
 }                                                                              \
 GETTER_IMPL(Receiver, receiver, Field, field)
 
@@ -209,16 +211,21 @@ SWALLOW_SEMI(gi)
 void set_##receiver##_##field(value_t self, value_t value) {                   \
   CHECK_SENTRY(SENTRY, value);                                                 \
   *access_derived_object_field(self, k##Receiver##Field##Offset) = value;      \
+  heap_object_write_barrier(get_derived_object_host(self), value);             \
 }                                                                              \
 DERIVED_GETTER_IMPL(Receiver, receiver, Field, field)
 
 
 // --- I n t e g e r / e n u m   a c c e s s o r s ---
 
+// The stored value is never a heap object so the barrier is only there to let
+// an incremental collection know that the replica has gone stale.
 #define __MAPPING_SETTER_IMPL__(Receiver, receiver, type_t, Field, field, MAP) \
 void set_##receiver##_##field(value_t self, type_t value) {                    \
   CHECK_FAMILY(of##Receiver, self);                                            \
-  *access_heap_object_field(self, k##Receiver##Field##Offset) = MAP(type_t, value); \
+  value_t mapped = MAP(type_t, value);                                         \
+  *access_heap_object_field(self, k##Receiver##Field##Offset) = mapped;        \
+  heap_object_write_barrier(self, mapped);                                     \
 }                                                                              \
 SWALLOW_SEMI(msi)
 
@@ -273,6 +280,7 @@ void set_##receiver_species##_species_##field(value_t self, value_t value) {   \
   CHECK_DIVISION(sd##ReceiverSpecies, self);                                   \
   CHECK_SENTRY(SENTRY, value);                                                 \
   *access_heap_object_field(self, k##ReceiverSpecies##Species##Field##Offset) = value; \
+  heap_object_write_barrier(self, value);                                      \
 }                                                                              \
 SPECIES_GETTER_IMPL(Receiver, receiver, ReceiverSpecies, receiver_species,     \
     Field, field)
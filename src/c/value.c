@@ -125,61 +125,89 @@ bool value_type_info_is_empty(value_type_info_t info) {
 
 // --- I n t e g e r ---
 
-static value_t integer_plus_integer(builtin_arguments_t *args) {
-  value_t self = get_builtin_subject(args);
-  value_t that = get_builtin_argument(args, 0);
+value_t apply_integer_negate(runtime_t *runtime, value_t self, value_t that) {
+  CHECK_DOMAIN(vdInteger, self);
+  return decode_value(-self.encoded);
+}
+
+value_t apply_integer_plus_integer(runtime_t *runtime, value_t self,
+    value_t that) {
   CHECK_DOMAIN(vdInteger, self);
   CHECK_DOMAIN(vdInteger, that);
   return decode_value(self.encoded + that.encoded);
 }
 
-static value_t integer_minus_integer(builtin_arguments_t *args) {
-  value_t self = get_builtin_subject(args);
-  value_t that = get_builtin_argument(args, 0);
+value_t apply_integer_minus_integer(runtime_t *runtime, value_t self,
+    value_t that) {
   CHECK_DOMAIN(vdInteger, self);
   CHECK_DOMAIN(vdInteger, that);
   return decode_value(self.encoded - that.encoded);
 }
 
-static value_t integer_times_integer(builtin_arguments_t *args) {
-  value_t self = get_builtin_subject(args);
-  value_t that = get_builtin_argument(args, 0);
+value_t apply_integer_times_integer(runtime_t *runtime, value_t self,
+    value_t that) {
   CHECK_DOMAIN(vdInteger, self);
   CHECK_DOMAIN(vdInteger, that);
   int64_t result = get_integer_value(self) * get_integer_value(that);
   return new_integer(result);
 }
 
-static value_t integer_divide_integer(builtin_arguments_t *args) {
-  value_t self = get_builtin_subject(args);
-  value_t that = get_builtin_argument(args, 0);
+value_t apply_integer_divide_integer(runtime_t *runtime, value_t self,
+    value_t that) {
   CHECK_DOMAIN(vdInteger, self);
   CHECK_DOMAIN(vdInteger, that);
   int64_t result = get_integer_value(self) / get_integer_value(that);
   return new_integer(result);
 }
 
-static value_t integer_modulo_integer(builtin_arguments_t *args) {
-  value_t self = get_builtin_subject(args);
-  value_t that = get_builtin_argument(args, 0);
+value_t apply_integer_modulo_integer(runtime_t *runtime, value_t self,
+    value_t that) {
   CHECK_DOMAIN(vdInteger, self);
   CHECK_DOMAIN(vdInteger, that);
   int64_t result = get_integer_value(self) % get_integer_value(that);
   return new_integer(result);
 }
 
-static value_t integer_less_integer(builtin_arguments_t *args) {
-  value_t self = get_builtin_subject(args);
-  value_t that = get_builtin_argument(args, 0);
+value_t apply_integer_less_integer(runtime_t *runtime, value_t self,
+    value_t that) {
   CHECK_DOMAIN(vdInteger, self);
   CHECK_DOMAIN(vdInteger, that);
   return new_boolean(get_integer_value(self) < get_integer_value(that));
 }
 
 static value_t integer_negate(builtin_arguments_t *args) {
-  value_t self = get_builtin_subject(args);
-  CHECK_DOMAIN(vdInteger, self);
-  return decode_value(-self.encoded);
+  return apply_integer_negate(get_builtin_runtime(args),
+      get_builtin_subject(args), nothing());
+}
+
+static value_t integer_plus_integer(builtin_arguments_t *args) {
+  return apply_integer_plus_integer(get_builtin_runtime(args),
+      get_builtin_subject(args), get_builtin_argument(args, 0));
+}
+
+static value_t integer_minus_integer(builtin_arguments_t *args) {
+  return apply_integer_minus_integer(get_builtin_runtime(args),
+      get_builtin_subject(args), get_builtin_argument(args, 0));
+}
+
+static value_t integer_times_integer(builtin_arguments_t *args) {
+  return apply_integer_times_integer(get_builtin_runtime(args),
+      get_builtin_subject(args), get_builtin_argument(args, 0));
+}
+
+static value_t integer_divide_integer(builtin_arguments_t *args) {
+  return apply_integer_divide_integer(get_builtin_runtime(args),
+      get_builtin_subject(args), get_builtin_argument(args, 0));
+}
+
+static value_t integer_modulo_integer(builtin_arguments_t *args) {
+  return apply_integer_modulo_integer(get_builtin_runtime(args),
+      get_builtin_subject(args), get_builtin_argument(args, 0));
+}
+
+static value_t integer_less_integer(builtin_arguments_t *args) {
+  return apply_integer_less_integer(get_builtin_runtime(args),
+      get_builtin_subject(args), get_builtin_argument(args, 0));
 }
 
 static value_t integer_print(builtin_arguments_t *args) {
@@ -211,6 +239,7 @@ void fast_fill_with_whatever(value_t *data, size_t length) {
 
 void set_heap_object_header(value_t value, value_t species) {
   *access_heap_object_field(value, kHeapObjectHeaderOffset) = species;
+  heap_object_write_barrier(value, species);
 }
 
 value_t get_heap_object_header(value_t value) {
@@ -322,6 +351,11 @@ void set_species_division_behavior(value_t value, division_behavior_t *behavior)
   *access_heap_object_field(value, kSpeciesDivisionBehaviorOffset) = pointer_to_value_bit_cast(behavior);
 }
 
+void set_species_heap(value_t value, heap_t *heap) {
+  *access_heap_object_field(value, kSpeciesHeapOffset) =
+      pointer_to_value_bit_cast(heap);
+}
+
 division_behavior_t *get_species_division_behavior(value_t value) {
   void *ptr = value_to_pointer_bit_cast(*access_heap_object_field(value, kSpeciesDivisionBehaviorOffset));
   return (division_behavior_t*) ptr;
@@ -502,9 +536,8 @@ void truncate_utf8(runtime_t *runtime, value_t self, size_t new_length) {
   shed_heap_object_tail(runtime, self, old_size, new_size);
 }
 
-static value_t string_plus_string(builtin_arguments_t *args) {
-  value_t self = get_builtin_subject(args);
-  value_t that = get_builtin_argument(args, 0);
+value_t apply_string_plus_string(runtime_t *runtime, value_t self,
+    value_t that) {
   CHECK_FAMILY(ofUtf8, self);
   CHECK_FAMILY(ofUtf8, that);
   string_buffer_t buf;
@@ -514,19 +547,28 @@ static value_t string_plus_string(builtin_arguments_t *args) {
   str = get_utf8_contents(that);
   string_buffer_append(&buf, str);
   str = string_buffer_flush(&buf);
-  TRY_DEF(result, new_heap_utf8(get_builtin_runtime(args), str));
+  TRY_DEF(result, new_heap_utf8(runtime, str));
   string_buffer_dispose(&buf);
   return result;
 }
 
-static value_t string_equals_string(builtin_arguments_t *args) {
-  value_t self = get_builtin_subject(args);
-  value_t that = get_builtin_argument(args, 0);
+value_t apply_string_equals_string(runtime_t *runtime, value_t self,
+    value_t that) {
   CHECK_FAMILY(ofUtf8, self);
   CHECK_FAMILY(ofUtf8, that);
   return new_boolean(value_identity_compare(self, that));
 }
 
+static value_t string_plus_string(builtin_arguments_t *args) {
+  return apply_string_plus_string(get_builtin_runtime(args),
+      get_builtin_subject(args), get_builtin_argument(args, 0));
+}
+
+static value_t string_equals_string(builtin_arguments_t *args) {
+  return apply_string_equals_string(get_builtin_runtime(args),
+      get_builtin_subject(args), get_builtin_argument(args, 0));
+}
+
 static value_t string_print_raw(builtin_arguments_t *args) {
   value_t self = get_builtin_subject(args);
   CHECK_FAMILY(ofUtf8, self);
@@ -951,6 +993,7 @@ void set_array_at(value_t value, int64_t index, value_t element) {
   CHECK_MUTABLE(value);
   CHECK_TRUE("array index out of bounds", within_array_bounds(value, index));
   get_array_start(value)[index] = element;
+  heap_object_write_barrier(value, element);
 }
 
 value_t *get_array_start(value_t value) {
@@ -1026,6 +1069,7 @@ value_t sort_array_partial(value_t value, int64_t elmc) {
   // compare functions back out but that shouldn't be a huge issue. We'll check
   // on them for now and later on this will have to be rewritten in n anyway.
   qsort(elements, (size_t) elmc, kValueSize, &value_compare_function);
+  heap_object_bulk_write_barrier(value);
   return success();
 }
 
@@ -1072,6 +1116,7 @@ value_t co_sort_pair_array(value_t value) {
   // first value pointed to by its arguments, it doesn't care if there are more
   // values after it.
   qsort(elements, (size_t) pair_count, kValueSize << 1, &value_compare_function);
+  heap_object_bulk_write_barrier(value);
   return success();
 }
 
@@ -1387,15 +1432,20 @@ void set_fifo_buffer_values_at(value_t self, size_t index, value_t *values,
     size_t values_size) {
   CHECK_EQ("invalid fifo buffer set", get_fifo_buffer_width(self), values_size);
   size_t node_offset = index * get_fifo_buffer_node_length(self) + kFifoBufferNodeHeaderSize;
-  value_t *nodes_start = get_array_start(get_fifo_buffer_nodes(self));
+  value_t nodes = get_fifo_buffer_nodes(self);
+  value_t *nodes_start = get_array_start(nodes);
   memcpy(nodes_start + node_offset, values, sizeof(value_t) * values_size);
+  for (size_t i = 0; i < values_size; i++)
+    heap_object_write_barrier(nodes, values[i]);
 }
 
 void clear_fifo_buffer_values_at(value_t self, size_t index) {
   size_t width = (size_t) get_fifo_buffer_width(self);
   size_t node_offset = (size_t) (index * get_fifo_buffer_node_length(self) + kFifoBufferNodeHeaderSize);
-  value_t *nodes_start = get_array_start(get_fifo_buffer_nodes(self));
+  value_t nodes = get_fifo_buffer_nodes(self);
+  value_t *nodes_start = get_array_start(nodes);
   fast_fill_with_whatever(nodes_start + node_offset, width);
+  heap_object_bulk_write_barrier(nodes);
 }
 
 size_t get_fifo_buffer_next_at(value_t self, size_t index) {
@@ -1713,6 +1763,11 @@ value_t try_set_id_hash_map_at(value_t map, value_t key, value_t value,
     return new_condition(ccMapFull);
   }
   set_id_hash_map_entry(entry, key, hash, value);
+  // The entry is written directly into the entry array so the barrier has to be
+  // applied by hand.
+  value_t entry_array = get_id_hash_map_entry_array(map);
+  heap_object_write_barrier(entry_array, key);
+  heap_object_write_barrier(entry_array, value);
   // Only increment the size if we created a new entry.
   if (create_mode != cmNotCreated) {
     // A new mapping was created.
@@ -1757,6 +1812,7 @@ value_t delete_id_hash_map_at(runtime_t *runtime, value_t map, value_t key) {
   if (find_id_hash_map_entry(map, key, hash, &entry, NULL)) {
     // We found the key; mark its entry as deleted.
     delete_id_hash_map_entry(runtime, entry);
+    heap_object_bulk_write_barrier(get_id_hash_map_entry_array(map));
     // We decrement the map size but keep the occupied size the same because
     // a deleted entry counts as occupied.
     set_id_hash_map_size(map, get_id_hash_map_size(map) - 1);
@@ -1766,54 +1822,6 @@ value_t delete_id_hash_map_at(runtime_t *runtime, value_t map, value_t key) {
   }
 }
 
-void fixup_id_hash_map_post_migrate(runtime_t *runtime, value_t new_heap_object,
-    value_t old_object) {
-  // In this fixup we rehash the migrated hash map since the hash values are
-  // allowed to change during garbage collection. We do it by copying the
-  // entries currently stored in the object into space that's left over by the
-  // old one, clearing out the new entry array completely, and then re-adding
-  // the entries one by one, reading them from the scratch storage. Dumb but it
-  // works.
-
-  // Get the raw entry array from the new map.
-  value_t new_entry_array = get_id_hash_map_entry_array(new_heap_object);
-  size_t entry_array_length = (size_t) get_array_length(new_entry_array);
-  value_t *new_entries = get_array_start(new_entry_array);
-  // Get the raw entry array from the old map. This requires going directly
-  // through the object since the nice accessors do sanity checking and the
-  // state of the object at this point is, well, not sane.
-  value_t old_entry_array = *access_heap_object_field(old_object, kIdHashMapEntryArrayOffset);
-  CHECK_DOMAIN(vdMovedObject, get_heap_object_header(old_entry_array));
-  value_t *old_entries = get_array_start_unchecked(old_entry_array);
-  // Copy the contents of the new entry array into the old one and clear it as
-  // we go so it's ready to have elements added back.
-  for (size_t i = 0; i < entry_array_length; i++) {
-    old_entries[i] = new_entries[i];
-    new_entries[i] = null();
-  }
-  // Reset the map's fields. It is now empty.
-  set_id_hash_map_size(new_heap_object, 0);
-  set_id_hash_map_occupied_count(new_heap_object, 0);
-  // Fake an iterator that scans over the old array.
-  id_hash_map_iter_t iter;
-  iter.entries = old_entries;
-  iter.cursor = 0;
-  iter.capacity = get_id_hash_map_capacity(new_heap_object);
-  iter.current = NULL;
-  // Then simple scan over the entries and add them one at a time. Since they
-  // come from the map originally adding them again must succeed.
-  while (id_hash_map_iter_advance(&iter)) {
-    value_t key;
-    value_t value;
-    id_hash_map_iter_get_current(&iter, &key, &value);
-    // We need to be able to add elements even if the map is frozen and it's
-    // okay because at the end it will be in the same state it was in before
-    // so it's not really mutating it.
-    value_t added = try_set_id_hash_map_at(new_heap_object, key, value, true);
-    CHECK_FALSE("rehash failed to set", is_condition(added));
-  }
-}
-
 void id_hash_map_iter_init(id_hash_map_iter_t *iter, value_t map) {
   value_t entry_array = get_id_hash_map_entry_array(map);
   iter->entries = get_array_start(entry_array);
@@ -2079,6 +2087,7 @@ void factory_print_on(value_t value, print_on_context_t *context) {
 ACCESSORS_IMPL(CodeBlock, code_block, snInFamily(ofBlob), Bytecode, bytecode);
 ACCESSORS_IMPL(CodeBlock, code_block, snInFamily(ofArray), ValuePool, value_pool);
 INTEGER_ACCESSORS_IMPL(CodeBlock, code_block, HighWaterMark, high_water_mark);
+INTEGER_ACCESSORS_IMPL(CodeBlock, code_block, IsVerified, is_verified);
 
 value_t code_block_validate(value_t value) {
   VALIDATE_FAMILY(ofCodeBlock, value);
@@ -3118,6 +3127,7 @@ void set_hash_source_field(value_t self, value_t value) {
   CHECK_MUTABLE(self);
   CHECK_FAMILY(ofSoftField, value);
   *access_heap_object_field(self, hash_source_values_offset()) = value;
+  heap_object_write_barrier(self, value);
 }
 
 value_t get_hash_source_field(value_t self) {
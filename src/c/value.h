@@ -45,6 +45,7 @@
 
 FORWARD(cycle_detector_t);
 FORWARD(hash_stream_t);
+FORWARD(heap_t);
 FORWARD(runtime_t);
 FORWARD(serialize_state_t);
 
@@ -254,6 +255,23 @@ static int64_t get_integer_value(value_t value) {
   return value.as_integer.data >> kDomainTagSize;
 }
 
+// The operations behind the integer builtins. They're shared with the
+// compiler's constant folding so a folded expression always gives the same
+// result as evaluating it. Unary operations ignore 'that'.
+value_t apply_integer_negate(runtime_t *runtime, value_t self, value_t that);
+value_t apply_integer_plus_integer(runtime_t *runtime, value_t self,
+    value_t that);
+value_t apply_integer_minus_integer(runtime_t *runtime, value_t self,
+    value_t that);
+value_t apply_integer_times_integer(runtime_t *runtime, value_t self,
+    value_t that);
+value_t apply_integer_divide_integer(runtime_t *runtime, value_t self,
+    value_t that);
+value_t apply_integer_modulo_integer(runtime_t *runtime, value_t self,
+    value_t that);
+value_t apply_integer_less_integer(runtime_t *runtime, value_t self,
+    value_t that);
+
 // Returns a value that is _not_ a condition. This can be used to indicate
 // unspecific success.
 static value_t success() {
@@ -451,7 +469,7 @@ static inline value_t chase_moved_object(value_t raw) {
   F(HashOracle,              hash_oracle,               X, X, (_, _, _, _, _, _, X, _, _, _), 87)\
   F(HashSource,              hash_source,               _, X, (_, _, _, X, _, _, _, _, _, _), 86)\
   F(Identifier,              identifier,                X, _, (X, X, X, _, _, _, _, _, _, _), 27)\
-  F(IdHashMap,               id_hash_map,               X, X, (_, _, _, _, X, _, X, _, _, X), 24)\
+  F(IdHashMap,               id_hash_map,               X, X, (_, _, _, _, _, _, X, _, _, X), 24)\
   F(IncomingRequestThunk,    incoming_request_thunk,    _, X, (_, _, _, _, _, _, _, _, _, _), 92)\
   F(Instance,                instance,                  _, X, (_, _, X, _, _, _, X, _, _, X), 60)\
   F(InstanceManager,         instance_manager,          _, X, (_, _, _, _, _, _, _, _, _, _),  3)\
@@ -513,7 +531,9 @@ static inline value_t chase_moved_object(value_t raw) {
 // code it's just a reminder. Remember to update it when adding families. The
 // family enum values are not the raw ordinals but the ordinals shifted left by
 // the tag size so that they're tagged as integers. Those values are sometimes
-// stored as uint16s so the ordinals are allowed to take up to 14 bits.
+// stored as uint16s so the ordinals are allowed to take up to 14 bits. The gc
+// stats keep a table indexed by ordinal so if this goes above
+// kGcFamilyStatsCount that has to grow too.
 static const int kNextFamilyOrdinal = 96;
 
 // Enumerates all the object families.
@@ -1105,7 +1125,7 @@ ENUM_SPECIES_DIVISIONS(DECLARE_SPECIES_DIVISION_ENUM)
 const char *get_species_division_name(species_division_t division);
 
 // The size of the species header, the part that's the same for all species.
-#define kSpeciesHeaderSize HEAP_OBJECT_SIZE(3)
+#define kSpeciesHeaderSize HEAP_OBJECT_SIZE(4)
 
 // The instance family could be stored within the family struct but we need it
 // so often that it's worth the extra space to have it as close at hand as
@@ -1113,6 +1133,10 @@ const char *get_species_division_name(species_division_t division);
 static const size_t kSpeciesInstanceFamilyOffset = HEAP_OBJECT_FIELD_OFFSET(0);
 static const size_t kSpeciesFamilyBehaviorOffset = HEAP_OBJECT_FIELD_OFFSET(1);
 static const size_t kSpeciesDivisionBehaviorOffset = HEAP_OBJECT_FIELD_OFFSET(2);
+// The heap that holds the species and its instances. The write barrier needs
+// to get from an object to its heap and going through the species is the
+// cheapest way to do that.
+static const size_t kSpeciesHeapOffset = HEAP_OBJECT_FIELD_OFFSET(3);
 
 // Expands to the size of a species with N field in addition to the species
 // header.
@@ -1145,6 +1169,15 @@ division_behavior_t *get_species_division_behavior(value_t species);
 // Sets the species division behavior of this species.
 void set_species_division_behavior(value_t species, division_behavior_t *behavior);
 
+// Sets the heap that holds this species.
+void set_species_heap(value_t species, heap_t *heap);
+
+// Returns the heap that holds this species. This is a macro because it is used
+// by the write barrier.
+#define get_species_heap(VALUE)                                                \
+  ((heap_t*) value_to_pointer_bit_cast(                                        \
+      *access_heap_object_field((VALUE), kSpeciesHeapOffset)))
+
 // Returns the division the given species belongs to.
 species_division_t get_species_division(value_t value);
 
@@ -1268,6 +1301,13 @@ void string_buffer_append_utf8(string_buffer_t *buf, value_t value);
 // Truncates the end of the given string so it becomes the new length.
 void truncate_utf8(runtime_t *runtime, value_t self, size_t new_length);
 
+// The operations behind the string builtins, shared with constant folding
+// like the integer ones.
+value_t apply_string_plus_string(runtime_t *runtime, value_t self,
+    value_t that);
+value_t apply_string_equals_string(runtime_t *runtime, value_t self,
+    value_t that);
+
 
 /// ## Ascii string view
 
@@ -1785,10 +1825,11 @@ FROZEN_ACCESSORS_DECL(factory, name);
 
 //  --- C o d e   b l o c k ---
 
-static const size_t kCodeBlockSize = HEAP_OBJECT_SIZE(3);
+static const size_t kCodeBlockSize = HEAP_OBJECT_SIZE(4);
 static const size_t kCodeBlockBytecodeOffset = HEAP_OBJECT_FIELD_OFFSET(0);
 static const size_t kCodeBlockValuePoolOffset = HEAP_OBJECT_FIELD_OFFSET(1);
 static const size_t kCodeBlockHighWaterMarkOffset = HEAP_OBJECT_FIELD_OFFSET(2);
+static const size_t kCodeBlockIsVerifiedOffset = HEAP_OBJECT_FIELD_OFFSET(3);
 
 // The binary blob of bytecode for this code block.
 ACCESSORS_DECL(code_block, bytecode);
@@ -1799,6 +1840,9 @@ ACCESSORS_DECL(code_block, value_pool);
 // The highest stack height possible when executing this code.
 INTEGER_ACCESSORS_DECL(code_block, high_water_mark);
 
+// Did this code pass verification when it was created? See verify.h.
+INTEGER_ACCESSORS_DECL(code_block, is_verified);
+
 
 // --- T y p e ---
 
@@ -0,0 +1,318 @@
+//- Copyright 2014 the Neutrino authors (see AUTHORS).
+//- Licensed under the Apache License, Version 2.0 (see LICENSE).
+
+#include "derived.h"
+#include "interp.h"
+#include "try-inl.h"
+#include "value-inl.h"
+#include "verify.h"
+
+// Returns a validation failure from the enclosing function unless the given
+// expression holds.
+#define VERIFY_CHECK(EXPR) do {                                                \
+  if (!(EXPR))                                                                 \
+    return new_condition(ccValidationFailed);                                  \
+} while (false)
+
+// Marker for stack heights that aren't known, either because the operation
+// hasn't been reached yet or because it can't be reached at all.
+static const int64_t kUnknownHeight = -1;
+
+// Describes how an operation passes control on, and what it does to the stack
+// height on the way.
+typedef struct {
+  // Does execution continue with the next operation?
+  bool falls_through;
+  // The change in stack height when continuing with the next operation.
+  int64_t delta;
+  // Does this operation also pass control to some other operation?
+  bool has_jump;
+  // The offset of the other operation within the block.
+  size_t jump_target;
+  // The change in stack height when continuing with the other operation.
+  int64_t jump_delta;
+  // A bit for each operand that is an index into the value pool.
+  uint32_t value_operands;
+} operation_flow_t;
+
+// The stack height change of creating and disposing the different kinds of
+// stack sections: the section itself plus the value pushed along with it.
+static int64_t get_section_height(derived_object_genus_t genus) {
+  return (int64_t) get_genus_descriptor(genus)->field_count + 1;
+}
+
+// Fills in the flow of the operation with the given opcode and operands, which
+// start with the opcode itself, located at the given offset. This must match
+// how the assembler adjusts the stack height when emitting each operation.
+static void get_operation_flow(opcode_t opcode, const short_t *operands,
+    size_t offset, operation_flow_t *flow_out) {
+  size_t size = get_opcode_size(opcode);
+  flow_out->falls_through = true;
+  flow_out->delta = 0;
+  flow_out->has_jump = false;
+  flow_out->jump_target = 0;
+  flow_out->jump_delta = 0;
+  flow_out->value_operands = 0;
+  switch (opcode) {
+    case ocPush:
+    case ocReifyArguments:
+    case ocBuiltin:
+      flow_out->delta = 1;
+      flow_out->value_operands = 1 << 1;
+      break;
+    case ocPushPair:
+      flow_out->delta = 2;
+      flow_out->value_operands = (1 << 1) | (1 << 2);
+      break;
+    case ocLoadLocalPair:
+      flow_out->delta = 2;
+      break;
+    case ocLoadArgument:
+    case ocLoadLambdaCapture:
+    case ocLoadLocal:
+    case ocLoadRawArgument:
+    case ocLoadRefractedArgument:
+    case ocLoadRefractedCapture:
+    case ocLoadRefractedLocal:
+    case ocCallEnsurer:
+    case ocDelegateToLambda:
+    case ocDelegateToBlock:
+    case ocModuleFragmentPrivateInvokeCallData:
+    case ocModuleFragmentPrivateInvokeReifiedArguments:
+    case ocModuleFragmentPrivateLeaveReifiedArguments:
+      flow_out->delta = 1;
+      break;
+    case ocLoadGlobal:
+      flow_out->delta = 1;
+      flow_out->value_operands = (1 << 1) | (1 << 2) | (1 << 3);
+      break;
+    case ocInvoke:
+    case ocTailInvoke:
+    case ocInvokeBuiltin:
+    case ocTailInvokeBuiltin:
+      // The result is pushed on top of the arguments.
+      flow_out->delta = 1;
+      flow_out->value_operands = (1 << 1) | (1 << 2) | (1 << 3) | (1 << 4);
+      break;
+    case ocPop:
+      flow_out->delta = -((int64_t) operands[1]);
+      break;
+    case ocSlap:
+      flow_out->delta = -((int64_t) operands[1]);
+      break;
+    case ocNewArray:
+      flow_out->delta = 1 - ((int64_t) operands[1]);
+      break;
+    case ocCreateCallData:
+      flow_out->delta = 1 - 2 * ((int64_t) operands[1]);
+      break;
+    case ocLambda:
+      flow_out->delta = 1 - ((int64_t) operands[2]);
+      flow_out->value_operands = 1 << 1;
+      break;
+    case ocSetReference:
+      flow_out->delta = -1;
+      break;
+    case ocGetReference:
+    case ocNewReference:
+    case ocCheckStackHeight:
+      break;
+    case ocCreateBlock:
+      flow_out->delta = get_section_height(dgBlockSection);
+      flow_out->value_operands = 1 << 1;
+      break;
+    case ocDisposeBlock:
+      flow_out->delta = -get_section_height(dgBlockSection);
+      break;
+    case ocCreateEnsurer:
+      flow_out->delta = get_section_height(dgEnsureSection);
+      flow_out->value_operands = 1 << 1;
+      break;
+    case ocDisposeEnsurer:
+      // The section, the code shard pointer and the result of the ensure
+      // block.
+      flow_out->delta = -get_section_height(dgEnsureSection) - 1;
+      break;
+    case ocCreateEscape:
+      // Firing the escape returns to the destination with the value on top of
+      // the state captured after this operation.
+      flow_out->delta = get_section_height(dgEscapeSection);
+      flow_out->has_jump = true;
+      flow_out->jump_target = offset + size + operands[1];
+      flow_out->jump_delta = flow_out->delta + 1;
+      break;
+    case ocDisposeEscape:
+      flow_out->delta = -get_section_height(dgEscapeSection);
+      break;
+    case ocInstallSignalHandler:
+      // Leaving a handler returns to the destination the same way firing an
+      // escape does.
+      flow_out->delta = get_section_height(dgSignalHandlerSection);
+      flow_out->value_operands = 1 << 1;
+      flow_out->has_jump = true;
+      flow_out->jump_target = offset + size + operands[2];
+      flow_out->jump_delta = flow_out->delta + 1;
+      break;
+    case ocUninstallSignalHandler:
+      flow_out->delta = -get_section_height(dgSignalHandlerSection);
+      break;
+    case ocGoto:
+      flow_out->falls_through = false;
+      flow_out->has_jump = true;
+      flow_out->jump_target = offset + operands[1];
+      break;
+    case ocGuardInline:
+      // Either continues with the inlined code or jumps to the invocation it
+      // replaces, neither of which changes the stack.
+      flow_out->value_operands = 1 << 1;
+      flow_out->has_jump = true;
+      flow_out->jump_target = offset + operands[2];
+      break;
+    case ocSignalEscape:
+      // If a handler is found its result is pushed, otherwise execution is
+      // abandoned.
+      flow_out->delta = 1;
+      flow_out->value_operands = 1 << 1;
+      break;
+    case ocSignalContinue:
+      // If a handler is found its result is pushed and execution continues
+      // with the goto that follows, otherwise the goto is skipped.
+      flow_out->delta = 1;
+      flow_out->value_operands = 1 << 1;
+      flow_out->has_jump = true;
+      flow_out->jump_target = offset + size + kGotoOperationSize;
+      flow_out->jump_delta = 0;
+      break;
+    case ocBuiltinMaybeEscape:
+      // If the builtin signals the handler is called and returns to the
+      // destination, leaving its result on top of the signal's arguments. The
+      // argument count is stored in the operation's padding.
+      flow_out->delta = 1;
+      flow_out->value_operands = 1 << 1;
+      flow_out->has_jump = true;
+      flow_out->jump_target = offset + operands[2];
+      flow_out->jump_delta = 1 + (int64_t) operands[3];
+      break;
+    case ocReturn:
+    case ocFireEscapeOrBarrier:
+    case ocLeaveOrFireBarrier:
+    case ocStackBottom:
+    case ocStackPieceBottom:
+      // These leave the frame so whatever the stack height is doesn't matter
+      // to this block anymore.
+      flow_out->falls_through = false;
+      break;
+    default:
+      UNREACHABLE("unexpected opcode");
+      break;
+  }
+}
+
+// Records that control can reach the operation at the given offset with the
+// given stack height, scheduling it to be visited if it hasn't been reached
+// before. Returns a validation failure if the offset isn't the start of an
+// operation or the height is inconsistent with an earlier visit.
+static value_t verify_reach(int64_t *heights, bool *is_start, size_t length,
+    size_t *pending, size_t *pending_count, size_t offset, int64_t height,
+    size_t high_water_mark) {
+  VERIFY_CHECK(offset < length);
+  VERIFY_CHECK(is_start[offset]);
+  VERIFY_CHECK(0 <= height && height <= (int64_t) high_water_mark);
+  if (heights[offset] == kUnknownHeight) {
+    heights[offset] = height;
+    pending[(*pending_count)++] = offset;
+  } else {
+    VERIFY_CHECK(heights[offset] == height);
+  }
+  return success();
+}
+
+// Checks the stack heights on all paths through the given bytecode, given
+// which offsets are the starts of operations.
+static value_t verify_stack_heights(const short_t *code, size_t length,
+    bool *is_start, int64_t *heights, size_t *pending,
+    size_t high_water_mark) {
+  for (size_t i = 0; i < length; i++)
+    heights[i] = kUnknownHeight;
+  size_t pending_count = 0;
+  if (length > 0)
+    TRY(verify_reach(heights, is_start, length, pending, &pending_count, 0, 0,
+        high_water_mark));
+  // Each operation is scheduled at most once, when it's first reached, so
+  // there's never more pending than there are shorts in the code.
+  while (pending_count > 0) {
+    size_t offset = pending[--pending_count];
+    int64_t height = heights[offset];
+    opcode_t opcode = (opcode_t) code[offset];
+    const short_t *operands = code + offset;
+    if (opcode == ocCheckStackHeight)
+      VERIFY_CHECK((int64_t) operands[1] == height);
+    operation_flow_t flow;
+    get_operation_flow(opcode, operands, offset, &flow);
+    if (flow.falls_through) {
+      size_t next = offset + get_opcode_size(opcode);
+      // Falling off the end is caught by verify_reach.
+      if (opcode == ocSignalContinue)
+        VERIFY_CHECK(next < length && code[next] == ocGoto);
+      TRY(verify_reach(heights, is_start, length, pending, &pending_count,
+          next, height + flow.delta, high_water_mark));
+    }
+    if (flow.has_jump)
+      TRY(verify_reach(heights, is_start, length, pending, &pending_count,
+          flow.jump_target, height + flow.jump_delta, high_water_mark));
+  }
+  return success();
+}
+
+// Checks that the given bytecode consists of valid operations whose value
+// operands are within the value pool, marking the start of each operation.
+static value_t verify_operations(const short_t *code, size_t length,
+    int64_t pool_size, bool *is_start) {
+  for (size_t i = 0; i < length; i++)
+    is_start[i] = false;
+  size_t offset = 0;
+  while (offset < length) {
+    VERIFY_CHECK(code[offset] < kOpcodeCount);
+    opcode_t opcode = (opcode_t) code[offset];
+    size_t size = get_opcode_size(opcode);
+    VERIFY_CHECK(size > 0 && offset + size <= length);
+    is_start[offset] = true;
+    operation_flow_t flow;
+    get_operation_flow(opcode, code + offset, offset, &flow);
+    for (size_t i = 1; i < size; i++) {
+      if ((flow.value_operands & (1 << i)) != 0)
+        VERIFY_CHECK((int64_t) code[offset + i] < pool_size);
+    }
+    offset += size;
+  }
+  return success();
+}
+
+value_t verify_bytecode(blob_t bytecode, value_t value_pool,
+    size_t high_water_mark) {
+  CHECK_FAMILY(ofArray, value_pool);
+  const short_t *code = (const short_t*) bytecode.start;
+  size_t length = blob_short_length(bytecode);
+  if (length == 0)
+    return success();
+  size_t heights_size = length * sizeof(int64_t);
+  size_t pending_size = length * sizeof(size_t);
+  size_t is_start_size = length * sizeof(bool);
+  blob_t memory = allocator_default_malloc(heights_size + pending_size
+      + is_start_size);
+  if (blob_is_empty(memory))
+    return new_system_call_failed_condition("malloc");
+  byte_t *start = (byte_t*) memory.start;
+  int64_t *heights = (int64_t*) start;
+  size_t *pending = (size_t*) (start + heights_size);
+  bool *is_start = (bool*) (start + heights_size + pending_size);
+  TRY_FINALLY {
+    E_TRY(verify_operations(code, length, get_array_length(value_pool),
+        is_start));
+    E_TRY(verify_stack_heights(code, length, is_start, heights, pending,
+        high_water_mark));
+    E_RETURN(success());
+  } FINALLY {
+    allocator_default_free(memory);
+  } YRT
+}
@@ -0,0 +1,41 @@
+//- Copyright 2014 the Neutrino authors (see AUTHORS).
+//- Licensed under the Apache License, Version 2.0 (see LICENSE).
+
+/// # Bytecode verification
+///
+/// Each code block is verified once, when it is created, and the result is
+/// recorded in the block. Verification checks that the bytecode is well-formed
+/// -- every opcode is valid, every operation fits within the block, and every
+/// value operand is a valid index into the block's value pool -- and then
+/// follows every path through the code computing the stack height before each
+/// operation. It checks that,
+///
+///   - jumps, escape destinations and signal handler destinations land on the
+///     start of an operation within the block.
+///   - all paths that reach an operation agree on the stack height there, the
+///     height never goes below zero and never above the block's high water
+///     mark.
+///   - execution can't fall off the end of the block.
+///   - any stack height checks in the code agree with the computed heights.
+///
+/// The stack heights are those the assembler assumes when emitting code, which
+/// are the heights the interpreter's stack height checks compare against. The
+/// interpreter uses the fact that a block has been verified to read operands
+/// without bounds checks.
+///
+/// Code that can only be reached by leaving some other frame, for instance
+/// code following an operation that always escapes, is checked for being
+/// well-formed but its stack heights are not known and so not checked.
+
+#ifndef _VERIFY
+#define _VERIFY
+
+#include "value.h"
+
+// Verifies the given bytecode and value pool that are about to make up a code
+// block with the given high water mark. Returns success if the code is valid
+// and a validation failure if not.
+value_t verify_bytecode(blob_t bytecode, value_t value_pool,
+    size_t high_water_mark);
+
+#endif // _VERIFY
@@ -0,0 +1,220 @@
+#!/usr/bin/python
+# Copyright 2014 the Neutrino authors (see AUTHORS).
+# Licensed under the Apache License, Version 2.0 (see LICENSE).
+
+# Reads a heap snapshot written by the runtime and reports what is keeping the
+# heap alive. The dominator tree of the object graph is computed from the roots
+# and used to find the retained size of each object, that is, how much memory
+# would be freed if the object became unreachable. The format of the snapshot
+# is described in src/c/snapshot.h.
+#
+#   analyze-heap-snapshot.py [--top <count>] <snapshot file>
+
+import optparse
+import sys
+
+# The snapshot format version this script understands.
+_FORMAT_VERSION = "1"
+
+# The index of the artificial root node that references all the roots.
+_ROOT = 0
+
+class SnapshotError(Exception):
+  pass
+
+# The object graph read from a snapshot. Node 0 is the artificial root, the
+# objects are numbered from 1 in the order they occur in the snapshot.
+class Graph(object):
+
+  def __init__(self):
+    self.addresses = [None]
+    self.families = ["(root)"]
+    self.sizes = [0]
+    self.edges = [[]]
+    self.index = {}
+    # Until all objects have been read the edges are kept as addresses.
+    self.root_addresses = []
+
+  def add_object(self, address, family, size, edges):
+    self.index[address] = len(self.addresses)
+    self.addresses.append(address)
+    self.families.append(family)
+    self.sizes.append(size)
+    self.edges.append(edges)
+
+  # Replaces the edge addresses with node indices, dropping the ones that don't
+  # point to objects in the snapshot.
+  def resolve(self):
+    index = self.index
+    self.edges[_ROOT] = self.root_addresses
+    for i in range(len(self.edges)):
+      resolved = set()
+      for address in self.edges[i]:
+        target = index.get(address)
+        if not target is None:
+          resolved.add(target)
+      self.edges[i] = sorted(resolved)
+
+  def size(self):
+    return len(self.addresses)
+
+# Reads the snapshot from the given file.
+def read_snapshot(input):
+  graph = Graph()
+  header = input.readline().split()
+  if header != ["neutrino-heap-snapshot", _FORMAT_VERSION]:
+    raise SnapshotError("Not a version %s heap snapshot" % _FORMAT_VERSION)
+  is_complete = False
+  for line in input:
+    parts = line.split()
+    if not parts:
+      continue
+    kind = parts[0]
+    if kind == "r":
+      graph.root_addresses.append(int(parts[1], 16))
+    elif kind == "o":
+      edges = [int(edge, 16) for edge in parts[4:]]
+      graph.add_object(int(parts[1], 16), parts[2], int(parts[3]), edges)
+    elif kind == "end":
+      is_complete = True
+      break
+    else:
+      raise SnapshotError("Unexpected record %s" % kind)
+  if not is_complete:
+    raise SnapshotError("Snapshot is incomplete")
+  graph.resolve()
+  return graph
+
+# Returns the nodes reachable from the root in reverse postorder.
+def get_reverse_postorder(graph):
+  visited = [False] * graph.size()
+  order = []
+  visited[_ROOT] = True
+  stack = [(_ROOT, iter(graph.edges[_ROOT]))]
+  while stack:
+    (node, edges) = stack[-1]
+    advanced = False
+    for target in edges:
+      if not visited[target]:
+        visited[target] = True
+        stack.append((target, iter(graph.edges[target])))
+        advanced = True
+        break
+    if not advanced:
+      stack.pop()
+      order.append(node)
+  order.reverse()
+  return order
+
+# Computes the immediate dominator of each reachable node using the iterative
+# algorithm from Cooper, Harvey and Kennedy's "A Simple, Fast Dominance
+# Algorithm". Unreachable nodes get None.
+def get_dominators(graph, order):
+  position = [None] * graph.size()
+  for (i, node) in enumerate(order):
+    position[node] = i
+  predecessors = [[] for i in range(graph.size())]
+  for node in order:
+    for target in graph.edges[node]:
+      predecessors[target].append(node)
+  dominators = [None] * graph.size()
+  dominators[_ROOT] = _ROOT
+  def intersect(a, b):
+    while a != b:
+      while position[a] > position[b]:
+        a = dominators[a]
+      while position[b] > position[a]:
+        b = dominators[b]
+    return a
+  changed = True
+  while changed:
+    changed = False
+    for node in order[1:]:
+      current = None
+      for pred in predecessors[node]:
+        if dominators[pred] is None:
+          continue
+        current = pred if current is None else intersect(pred, current)
+      if dominators[node] != current:
+        dominators[node] = current
+        changed = True
+  return dominators
+
+# Returns the retained size of each node given the immediate dominators.
+# Children always come after their dominators in reverse postorder so walking
+# it backwards sees each subtree before its root.
+def get_retained_sizes(graph, order, dominators):
+  retained = list(graph.sizes)
+  for node in reversed(order[1:]):
+    retained[dominators[node]] += retained[node]
+  return retained
+
+# Returns a map from family to [count, size, retained size] where the retained
+# size of a family only counts objects that aren't dominated by another object
+# of the same family, so nested objects aren't counted twice.
+def get_family_stats(graph, order, dominators, retained):
+  stats = {}
+  # The set of families on the dominator chain above and including each node.
+  # Reverse postorder guarantees that a node's dominator has been processed
+  # before the node itself.
+  chains = [frozenset()] * graph.size()
+  for node in order[1:]:
+    family = graph.families[node]
+    parent_chain = chains[dominators[node]]
+    entry = stats.setdefault(family, [0, 0, 0])
+    entry[0] += 1
+    entry[1] += graph.sizes[node]
+    if family in parent_chain:
+      chains[node] = parent_chain
+    else:
+      chains[node] = parent_chain | frozenset([family])
+      entry[2] += retained[node]
+  return stats
+
+def print_report(graph, top_count, out):
+  order = get_reverse_postorder(graph)
+  dominators = get_dominators(graph, order)
+  retained = get_retained_sizes(graph, order, dominators)
+  total_size = sum(graph.sizes)
+  reachable_size = retained[_ROOT]
+  out.write("Objects: %i (%i bytes)\n" % (graph.size() - 1, total_size))
+  out.write("Reachable: %i (%i bytes)\n" % (len(order) - 1, reachable_size))
+  out.write("Unreachable: %i bytes\n" % (total_size - reachable_size))
+  out.write("\nFamilies by retained size:\n")
+  out.write("%-24s %10s %12s %12s\n" % ("family", "count", "size", "retained"))
+  stats = get_family_stats(graph, order, dominators, retained)
+  for (family, (count, size, family_retained)) in sorted(stats.items(),
+      key=lambda item: -item[1][2]):
+    out.write("%-24s %10i %12i %12i\n" % (family, count, size, family_retained))
+  out.write("\nObjects by retained size:\n")
+  out.write("%-18s %-24s %12s %12s  %s\n" % ("address", "family", "size",
+      "retained", "dominator"))
+  largest = sorted(order[1:], key=lambda node: -retained[node])[:top_count]
+  for node in largest:
+    dominator = dominators[node]
+    if dominator == _ROOT:
+      dominator_name = "(root)"
+    else:
+      dominator_name = "%x %s" % (graph.addresses[dominator],
+          graph.families[dominator])
+    out.write("%-18x %-24s %12i %12i  %s\n" % (graph.addresses[node],
+        graph.families[node], graph.sizes[node], retained[node], dominator_name))
+
+def main(argv):
+  parser = optparse.OptionParser(usage="%prog [--top <count>] <snapshot file>")
+  parser.add_option("--top", type="int", default=25,
+      help="how many of the largest objects to report")
+  (options, args) = parser.parse_args(argv)
+  if len(args) != 1:
+    parser.error("expected a single snapshot file")
+  with open(args[0]) as input:
+    try:
+      graph = read_snapshot(input)
+    except SnapshotError as e:
+      sys.stderr.write("%s: %s\n" % (args[0], e))
+      return 1
+  print_report(graph, options.top, sys.stdout)
+  return 0
+
+if __name__ == "__main__":
+  sys.exit(main(sys.argv[1:]))
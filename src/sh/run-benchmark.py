@@ -0,0 +1,70 @@
+#!/usr/bin/python
+# Copyright 2014 the Neutrino authors (see AUTHORS).
+# Licensed under the Apache License, Version 2.0 (see LICENSE).
+
+# Runs a benchmark a number of times and reports the best time per operation.
+# If perf is available the branch and instruction counters of the best run are
+# reported per operation too. Anything the benchmark prints during the best run,
+# for instance a breakdown of its results, is passed through.
+#
+#   run-benchmark.py <operation count> <command> <args>...
+#
+# The number of runs can be set using the BENCH_RUNS environment variable.
+
+import os
+import subprocess
+import sys
+import time
+
+# The perf events to report.
+_PERF_EVENTS = ["instructions", "branches", "branch-misses"]
+
+# Returns true if perf is available on this system.
+def has_perf():
+  try:
+    with open(os.devnull, "w") as devnull:
+      return subprocess.call(["perf", "--version"], stdout=devnull, stderr=devnull) == 0
+  except OSError:
+    return False
+
+# Runs the command once, returning the elapsed time in seconds, a dict of the
+# perf counters recorded (empty if perf isn't used), and what it printed.
+def run_once(command, use_perf):
+  if use_perf:
+    command = ["perf", "stat", "-x", ",", "-e", ",".join(_PERF_EVENTS)] + command
+  start = time.time()
+  process = subprocess.Popen(command, stdout=subprocess.PIPE, stderr=subprocess.PIPE)
+  (stdout, stderr) = process.communicate()
+  elapsed = time.time() - start
+  if process.returncode != 0:
+    sys.stdout.write(stdout)
+    sys.stderr.write(stderr)
+    sys.exit(process.returncode)
+  counters = {}
+  if use_perf:
+    # In csv mode perf prints one "value,unit,event,..." line per event.
+    for line in stderr.splitlines():
+      parts = line.split(",")
+      if len(parts) >= 3 and parts[2] in _PERF_EVENTS and parts[0].isdigit():
+        counters[parts[2]] = int(parts[0])
+  return (elapsed, counters, stdout)
+
+def main():
+  op_count = int(sys.argv[1])
+  command = sys.argv[2:]
+  runs = int(os.environ.get("BENCH_RUNS", "5"))
+  use_perf = has_perf()
+  best = None
+  for i in range(0, runs):
+    result = run_once(command, use_perf)
+    if (best is None) or (result[0] < best[0]):
+      best = result
+  (elapsed, counters, stdout) = best
+  sys.stdout.write(stdout)
+  print "%.1f ns/op (best of %i, %i ops)" % (elapsed * 1e9 / op_count, runs, op_count)
+  for event in _PERF_EVENTS:
+    if event in counters:
+      print "%.2f %s/op" % (float(counters[event]) / op_count, event)
+
+if __name__ == '__main__':
+  main()
@@ -61,6 +61,65 @@ TEST(heap, space_alloc) {
   space_dispose(&space);
 }
 
+TEST(heap, semispace_flip) {
+  CREATE_RUNTIME();
+
+  // The two semispaces are mapped once and take turns being to-space.
+  address_t first = runtime->heap.to_space.start;
+  address_t second = runtime->heap.spare_space.start;
+  ASSERT_TRUE(first != second);
+  ASSERT_SUCCESS(runtime_garbage_collect(runtime));
+  ASSERT_PTREQ(second, runtime->heap.to_space.start);
+  ASSERT_PTREQ(first, runtime->heap.spare_space.start);
+  ASSERT_TRUE(space_is_empty(&runtime->heap.from_space));
+  // The spare space has been emptied so it's ready to be copied into.
+  ASSERT_PTREQ(first, runtime->heap.spare_space.next_free);
+  ASSERT_SUCCESS(runtime_garbage_collect(runtime));
+  ASSERT_PTREQ(first, runtime->heap.to_space.start);
+  ASSERT_PTREQ(second, runtime->heap.spare_space.start);
+
+  DISPOSE_RUNTIME();
+}
+
+TEST(heap, adaptive_semispace_size) {
+  extended_runtime_config_t config = *extended_runtime_config_get_default();
+  config.base.max_semispace_size_bytes = 4 * config.base.semispace_size_bytes;
+  config.base.heap_shrink_survival_percent = 40;
+  config.base.nursery_size_bytes = 0;
+  config.base.large_object_size_bytes = 0;
+  CREATE_RUNTIME_WITH_CONFIG(&config);
+  heap_t *heap = &runtime->heap;
+  size_t initial = config.base.semispace_size_bytes;
+
+  // Fill almost all of to-space with something that survives.
+  size_t free_bytes = heap->to_space.limit - heap->to_space.next_free;
+  value_t array = new_heap_array(runtime, (free_bytes - 16 * kKB) / kValueSize);
+  ASSERT_SUCCESS(array);
+  safe_value_t s_array = runtime_protect_value(runtime, array);
+  ASSERT_SUCCESS(runtime_garbage_collect(runtime));
+  // The heap wants to grow but to-space only follows after the next flip.
+  ASSERT_EQ(2 * initial, heap->semispace_size);
+  ASSERT_EQ(initial, (size_t) (heap->to_space.limit - heap->to_space.start));
+  ASSERT_SUCCESS(runtime_garbage_collect(runtime));
+  ASSERT_EQ(2 * initial, (size_t) (heap->to_space.limit - heap->to_space.start));
+  ASSERT_EQ(4 * initial, heap->semispace_size);
+  // Now that to-space is twice the size the same data is less than half of it
+  // so the heap stays at the max.
+  ASSERT_SUCCESS(runtime_garbage_collect(runtime));
+  ASSERT_EQ(4 * initial, (size_t) (heap->to_space.limit - heap->to_space.start));
+  ASSERT_EQ(4 * initial, heap->semispace_size);
+
+  // Once most of it is garbage the heap shrinks back, but not below the
+  // initial size.
+  safe_value_destroy(runtime, s_array);
+  for (size_t i = 0; i < 4; i++)
+    ASSERT_SUCCESS(runtime_garbage_collect(runtime));
+  ASSERT_EQ(initial, heap->semispace_size);
+  ASSERT_EQ(initial, (size_t) (heap->to_space.limit - heap->to_space.start));
+
+  DISPOSE_RUNTIME();
+}
+
 TEST(heap, clone) {
   CREATE_RUNTIME();
 
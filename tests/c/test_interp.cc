@@ -5,6 +5,7 @@
 
 BEGIN_C_INCLUDES
 #include "alloc.h"
+#include "codegen.h"
 #include "freeze.h"
 #include "interp.h"
 #include "safe-inl.h"
@@ -198,3 +199,424 @@ TEST(interp, lookup_error) {
   DISPOSE_TEST_ARENA();
   DISPOSE_RUNTIME();
 }
+
+// Returns call tags for an invocation whose arguments are tagged 0 to argc - 1
+// and evaluated in that order.
+static value_t new_ordered_call_tags(runtime_t *runtime, size_t argc) {
+  TRY_DEF(entries, new_heap_pair_array(runtime, argc));
+  for (size_t i = 0; i < argc; i++) {
+    set_pair_array_first_at(entries, i, new_integer(i));
+    set_pair_array_second_at(entries, i, new_integer(argc - i - 1));
+  }
+  return new_heap_call_tags(runtime, afFreeze, entries);
+}
+
+// Emits an invocation of the argc arguments on top of the stack and returns
+// its result.
+static value_t emit_invocation_and_return(assembler_t *assm, size_t argc) {
+  TRY_DEF(tags, new_ordered_call_tags(assm->runtime, argc));
+  TRY(assembler_emit_invocation(assm, nothing(), tags, nothing()));
+  TRY(assembler_emit_slap(assm, argc));
+  return assembler_emit_return(assm);
+}
+
+// Returns the cached value of the single cached site, an invocation or global
+// load, in the given code block.
+static value_t get_single_site_cache(value_t code) {
+  value_t pool = get_code_block_value_pool(code);
+  for (int64_t i = 0; i < get_array_length(pool); i++) {
+    value_t value = get_array_at(pool, i);
+    if (in_family(ofFreezeCheat, value))
+      return get_freeze_cheat_value(value);
+  }
+  return whatever();
+}
+
+// Returns the number of entries in the given inline cache.
+static int64_t get_inline_cache_entry_count(value_t inline_cache) {
+  if (is_nothing(inline_cache))
+    return 0;
+  int64_t count = 0;
+  // The first element is the epoch, the rest are the entries.
+  for (int64_t i = 1; i < get_array_length(inline_cache); i++) {
+    if (!is_null(get_array_at(inline_cache, i)))
+      count++;
+  }
+  return count;
+}
+
+// Runs a code block that calls the method with the given selector on the given
+// subject and returns the result.
+static value_t call_with_subject(value_t ambience, value_t subject,
+    value_t selector) {
+  runtime_t *runtime = get_ambience_runtime(ambience);
+  assembler_t assm;
+  ASSERT_SUCCESS(assembler_init(&assm, runtime, nothing(), scope_get_bottom()));
+  ASSERT_SUCCESS(assembler_emit_push(&assm, subject));
+  ASSERT_SUCCESS(assembler_emit_push(&assm, selector));
+  ASSERT_SUCCESS(emit_invocation_and_return(&assm, 2));
+  value_t code = assembler_flush(&assm);
+  ASSERT_SUCCESS(code);
+  assembler_dispose(&assm);
+  return run_code_block_until_condition(ambience, code);
+}
+
+// Runs a code block that calls the outer method on the given subject and
+// checks that it returns the inner method's result.
+static void assert_outer_call(value_t ambience, value_t subject,
+    value_t selector) {
+  ASSERT_VALEQ(new_integer(7), call_with_subject(ambience, subject, selector));
+}
+
+TEST(interp, inline_cache) {
+  CREATE_RUNTIME();
+  CREATE_TEST_ARENA();
+
+  value_t space = get_ambience_methodspace(ambience);
+  variant_t *any_guard = vGuard(gtAny, vNull());
+  value_t outer = C(vStr("outer"));
+  value_t inner = C(vStr("inner"));
+
+  // The inner method returns 7 whatever the subject is.
+  assembler_t assm;
+  ASSERT_SUCCESS(assembler_init(&assm, runtime, nothing(), scope_get_bottom()));
+  ASSERT_SUCCESS(assembler_emit_push(&assm, new_integer(7)));
+  ASSERT_SUCCESS(assembler_emit_return(&assm));
+  value_t inner_code = assembler_flush(&assm);
+  ASSERT_SUCCESS(inner_code);
+  assembler_dispose(&assm);
+  value_t inner_sig = C(vSignature(
+      false,
+      vParameter(any_guard, false, vInt(0)),
+      vParameter(vGuard(gtEq, vValue(inner)), false, vInt(1))));
+  value_t inner_method = new_heap_method(runtime, afFreeze, inner_sig,
+      nothing(), inner_code, nothing(), new_flag_set(kFlagSetAllOff));
+  ASSERT_SUCCESS(add_methodspace_method(runtime, space, inner_method));
+
+  // The outer method passes its subject on to the inner method so all calls
+  // to the outer method go through the same invocation site.
+  ASSERT_SUCCESS(assembler_init(&assm, runtime, nothing(), scope_get_bottom()));
+  ASSERT_SUCCESS(assembler_emit_load_argument(&assm, 0));
+  ASSERT_SUCCESS(assembler_emit_push(&assm, inner));
+  ASSERT_SUCCESS(emit_invocation_and_return(&assm, 2));
+  value_t outer_code = assembler_flush(&assm);
+  ASSERT_SUCCESS(outer_code);
+  assembler_dispose(&assm);
+  value_t outer_sig = C(vSignature(
+      false,
+      vParameter(any_guard, false, vInt(0)),
+      vParameter(vGuard(gtEq, vValue(outer)), false, vInt(1))));
+  value_t outer_method = new_heap_method(runtime, afFreeze, outer_sig,
+      nothing(), outer_code, nothing(), new_flag_set(kFlagSetAllOff));
+  ASSERT_SUCCESS(add_methodspace_method(runtime, space, outer_method));
+
+  ASSERT_TRUE(is_nothing(get_single_site_cache(outer_code)));
+
+  // Calling with the same type again hits the existing entry.
+  assert_outer_call(ambience, new_integer(1), outer);
+  value_t cache = get_single_site_cache(outer_code);
+  ASSERT_EQ(1, get_inline_cache_entry_count(cache));
+  value_t entry = get_array_at(cache, 1);
+  assert_outer_call(ambience, new_integer(2), outer);
+  ASSERT_EQ(1, get_inline_cache_entry_count(cache));
+  ASSERT_SAME(entry, get_array_at(cache, 1));
+
+  // A new type makes the site polymorphic without disturbing the first entry.
+  assert_outer_call(ambience, C(vStr("foo")), outer);
+  ASSERT_EQ(2, get_inline_cache_entry_count(cache));
+  ASSERT_SAME(entry, get_array_at(cache, 1));
+  assert_outer_call(ambience, null(), outer);
+  assert_outer_call(ambience, yes(), outer);
+  ASSERT_EQ(4, get_inline_cache_entry_count(cache));
+
+  // Once the cache is full calls with new types are still looked up
+  // correctly, they're just not cached, and the existing entries keep hitting.
+  assert_outer_call(ambience, C(vEmptyArray()), outer);
+  ASSERT_EQ(4, get_inline_cache_entry_count(cache));
+  assert_outer_call(ambience, new_integer(3), outer);
+  ASSERT_SAME(cache, get_single_site_cache(outer_code));
+  ASSERT_EQ(4, get_inline_cache_entry_count(cache));
+
+  DISPOSE_TEST_ARENA();
+  DISPOSE_RUNTIME();
+}
+
+TEST(interp, inline_cache_max_argc) {
+  CREATE_RUNTIME();
+  CREATE_TEST_ARENA();
+
+  // A method that takes any number of extra arguments.
+  value_t wide = C(vStr("wide"));
+  value_t sig = C(vSignature(
+      true,
+      vParameter(vGuard(gtAny, vNull()), false, vInt(0)),
+      vParameter(vGuard(gtEq, vValue(wide)), false, vInt(1))));
+  assembler_t assm;
+  ASSERT_SUCCESS(assembler_init(&assm, runtime, nothing(), scope_get_bottom()));
+  ASSERT_SUCCESS(assembler_emit_push(&assm, new_integer(7)));
+  ASSERT_SUCCESS(assembler_emit_return(&assm));
+  value_t method_code = assembler_flush(&assm);
+  ASSERT_SUCCESS(method_code);
+  assembler_dispose(&assm);
+  value_t method = new_heap_method(runtime, afFreeze, sig, nothing(),
+      method_code, nothing(), new_flag_set(kFlagSetAllOff));
+  ASSERT_SUCCESS(add_methodspace_method(runtime,
+      get_ambience_methodspace(ambience), method));
+
+  // Invocations with more arguments than there are bits in the identity mask
+  // are never cached.
+  static const size_t kArgc = 40;
+  ASSERT_SUCCESS(assembler_init(&assm, runtime, nothing(), scope_get_bottom()));
+  ASSERT_SUCCESS(assembler_emit_push(&assm, new_integer(0)));
+  ASSERT_SUCCESS(assembler_emit_push(&assm, wide));
+  for (size_t i = 2; i < kArgc; i++)
+    ASSERT_SUCCESS(assembler_emit_push(&assm, new_integer(i)));
+  ASSERT_SUCCESS(emit_invocation_and_return(&assm, kArgc));
+  value_t code = assembler_flush(&assm);
+  ASSERT_SUCCESS(code);
+  assembler_dispose(&assm);
+  for (size_t i = 0; i < 2; i++) {
+    ASSERT_VALEQ(new_integer(7), run_code_block_until_condition(ambience, code));
+    ASSERT_TRUE(is_nothing(get_single_site_cache(code)));
+  }
+
+  DISPOSE_TEST_ARENA();
+  DISPOSE_RUNTIME();
+}
+
+// A frameless builtin that ignores its arguments.
+static value_t return_seven(builtin_arguments_t *args) {
+  return new_integer(7);
+}
+
+// Returns the opcode currently at the given offset in the code block.
+static opcode_t get_code_block_opcode_at(value_t code, size_t offset) {
+  return (opcode_t) blob_short_at(get_blob_data(get_code_block_bytecode(code)),
+      offset);
+}
+
+TEST(interp, quickening) {
+  CREATE_RUNTIME();
+  CREATE_TEST_ARENA();
+
+  value_t space = get_ambience_methodspace(ambience);
+  variant_t *any_guard = vGuard(gtAny, vNull());
+  value_t outer = C(vStr("outer"));
+  value_t seven = C(vStr("seven"));
+
+  // A frameless builtin method, the same shape as the ones created by
+  // add_builtin_method_impl.
+  assembler_t assm;
+  ASSERT_SUCCESS(assembler_init(&assm, runtime, nothing(), scope_get_bottom()));
+  ASSERT_SUCCESS(assembler_emit_builtin(&assm, return_seven));
+  ASSERT_SUCCESS(assembler_emit_return(&assm));
+  value_t seven_code = assembler_flush(&assm);
+  ASSERT_SUCCESS(seven_code);
+  assembler_dispose(&assm);
+  value_t seven_sig = C(vSignature(
+      false,
+      vParameter(any_guard, false, vInt(0)),
+      vParameter(vGuard(gtEq, vValue(seven)), false, vInt(1))));
+  value_t seven_method = new_heap_method(runtime, afFreeze, seven_sig,
+      nothing(), seven_code, nothing(), new_flag_set(mfFrameless));
+  ASSERT_SUCCESS(add_methodspace_method(runtime, space, seven_method));
+
+  // The outer method wraps the result of calling the builtin on its subject
+  // in an array so the invocation isn't in tail position.
+  ASSERT_SUCCESS(assembler_init(&assm, runtime, nothing(), scope_get_bottom()));
+  ASSERT_SUCCESS(assembler_emit_load_argument(&assm, 0));
+  ASSERT_SUCCESS(assembler_emit_push(&assm, seven));
+  size_t invoke_offset = assembler_get_code_cursor(&assm);
+  value_t tags = new_ordered_call_tags(runtime, 2);
+  ASSERT_SUCCESS(assembler_emit_invocation(&assm, nothing(), tags, nothing()));
+  ASSERT_SUCCESS(assembler_emit_slap(&assm, 2));
+  ASSERT_SUCCESS(assembler_emit_new_array(&assm, 1));
+  ASSERT_SUCCESS(assembler_emit_return(&assm));
+  value_t outer_code = assembler_flush(&assm);
+  ASSERT_SUCCESS(outer_code);
+  assembler_dispose(&assm);
+  value_t outer_sig = C(vSignature(
+      false,
+      vParameter(any_guard, false, vInt(0)),
+      vParameter(vGuard(gtEq, vValue(outer)), false, vInt(1))));
+  value_t outer_method = new_heap_method(runtime, afFreeze, outer_sig,
+      nothing(), outer_code, nothing(), new_flag_set(kFlagSetAllOff));
+  ASSERT_SUCCESS(add_methodspace_method(runtime, space, outer_method));
+
+  value_t expected = C(vArray(vInt(7)));
+  ASSERT_EQ(ocInvoke, get_code_block_opcode_at(outer_code, invoke_offset));
+
+  // The first call only fills the cache, the second hits it and quickens the
+  // site, and after that the site stays quickened.
+  ASSERT_VALEQ(expected, call_with_subject(ambience, new_integer(1), outer));
+  ASSERT_EQ(ocInvoke, get_code_block_opcode_at(outer_code, invoke_offset));
+  for (size_t i = 0; i < 3; i++) {
+    ASSERT_VALEQ(expected, call_with_subject(ambience, new_integer(2), outer));
+    ASSERT_EQ(ocInvokeBuiltin, get_code_block_opcode_at(outer_code,
+        invoke_offset));
+  }
+
+  // A new type makes the guard fail so the site falls back to the generic
+  // invoke, and since the site is now polymorphic it isn't quickened again.
+  ASSERT_VALEQ(expected, call_with_subject(ambience, C(vStr("foo")), outer));
+  ASSERT_EQ(ocInvoke, get_code_block_opcode_at(outer_code, invoke_offset));
+  ASSERT_EQ(2, get_inline_cache_entry_count(get_single_site_cache(outer_code)));
+  ASSERT_VALEQ(expected, call_with_subject(ambience, new_integer(3), outer));
+  ASSERT_EQ(ocInvoke, get_code_block_opcode_at(outer_code, invoke_offset));
+
+  // A method that returns the builtin's result directly, so its invocation is
+  // a tail invoke.
+  value_t tail = C(vStr("tail"));
+  ASSERT_SUCCESS(assembler_init(&assm, runtime, nothing(), scope_get_bottom()));
+  ASSERT_SUCCESS(assembler_emit_load_argument(&assm, 0));
+  ASSERT_SUCCESS(assembler_emit_push(&assm, seven));
+  ASSERT_SUCCESS(emit_invocation_and_return(&assm, 2));
+  value_t tail_code = assembler_flush(&assm);
+  ASSERT_SUCCESS(tail_code);
+  assembler_dispose(&assm);
+  value_t tail_sig = C(vSignature(
+      false,
+      vParameter(any_guard, false, vInt(0)),
+      vParameter(vGuard(gtEq, vValue(tail)), false, vInt(1))));
+  value_t tail_method = new_heap_method(runtime, afFreeze, tail_sig,
+      nothing(), tail_code, nothing(), new_flag_set(kFlagSetAllOff));
+  ASSERT_SUCCESS(add_methodspace_method(runtime, space, tail_method));
+  ASSERT_EQ(ocTailInvoke, get_code_block_opcode_at(tail_code, invoke_offset));
+
+  // Tail invokes are quickened too, and go back to being tail invokes when
+  // the guard fails.
+  ASSERT_VALEQ(new_integer(7), call_with_subject(ambience, new_integer(1), tail));
+  ASSERT_EQ(ocTailInvoke, get_code_block_opcode_at(tail_code, invoke_offset));
+  for (size_t i = 0; i < 3; i++) {
+    ASSERT_VALEQ(new_integer(7), call_with_subject(ambience, new_integer(2),
+        tail));
+    ASSERT_EQ(ocTailInvokeBuiltin, get_code_block_opcode_at(tail_code,
+        invoke_offset));
+  }
+  ASSERT_VALEQ(new_integer(7), call_with_subject(ambience, C(vStr("foo")),
+      tail));
+  ASSERT_EQ(ocTailInvoke, get_code_block_opcode_at(tail_code, invoke_offset));
+
+  DISPOSE_TEST_ARENA();
+  DISPOSE_RUNTIME();
+}
+
+TEST(interp, guard_inline_fallback) {
+  CREATE_RUNTIME();
+  CREATE_TEST_ARENA();
+
+  value_t space = get_ambience_methodspace(ambience);
+  value_t selector = C(vStr("guarded"));
+
+  // Code shaped like what the compiler emits for an inlined invocation: the
+  // inlined body returns 7 and the fallback does a normal invocation. The
+  // methodspace it's guarded by has no method for the selector so if the
+  // fallback were taken there the lookup would fail.
+  assembler_t assm;
+  ASSERT_SUCCESS(assembler_init(&assm, runtime, nothing(), scope_get_bottom()));
+  ASSERT_SUCCESS(assembler_emit_push(&assm, new_integer(1)));
+  ASSERT_SUCCESS(assembler_emit_push(&assm, selector));
+  short_buffer_cursor_t fallback;
+  size_t guard_offset = assembler_get_code_cursor(&assm);
+  ASSERT_SUCCESS(assembler_emit_guard_inline(&assm, space, &fallback));
+  ASSERT_SUCCESS(assembler_emit_push(&assm, new_integer(7)));
+  short_buffer_cursor_t join;
+  size_t goto_offset = assembler_get_code_cursor(&assm);
+  ASSERT_SUCCESS(assembler_emit_goto_forward(&assm, &join));
+  size_t fallback_offset = assembler_get_code_cursor(&assm);
+  short_buffer_cursor_set(&fallback, (uint16_t) (fallback_offset - guard_offset));
+  assembler_adjust_stack_height(&assm, -1);
+  value_t tags = new_ordered_call_tags(runtime, 2);
+  ASSERT_SUCCESS(assembler_emit_invocation(&assm, nothing(), tags, nothing()));
+  size_t join_offset = assembler_get_code_cursor(&assm);
+  short_buffer_cursor_set(&join, (uint16_t) (join_offset - goto_offset));
+  ASSERT_SUCCESS(assembler_emit_slap(&assm, 2));
+  ASSERT_SUCCESS(assembler_emit_return(&assm));
+  value_t code = assembler_flush(&assm);
+  ASSERT_SUCCESS(code);
+  assembler_dispose(&assm);
+  ASSERT_VALEQ(new_integer(7), run_code_block_until_condition(ambience, code));
+
+  // A different methodspace, where the selector resolves to a method that
+  // returns 8.
+  value_t other_space = new_heap_methodspace(runtime, nothing());
+  ASSERT_SUCCESS(other_space);
+  ASSERT_SUCCESS(assembler_init(&assm, runtime, nothing(), scope_get_bottom()));
+  ASSERT_SUCCESS(assembler_emit_push(&assm, new_integer(8)));
+  ASSERT_SUCCESS(assembler_emit_return(&assm));
+  value_t method_code = assembler_flush(&assm);
+  ASSERT_SUCCESS(method_code);
+  assembler_dispose(&assm);
+  value_t sig = C(vSignature(
+      false,
+      vParameter(vGuard(gtAny, vNull()), false, vInt(0)),
+      vParameter(vGuard(gtEq, vValue(selector)), false, vInt(1))));
+  value_t method = new_heap_method(runtime, afFreeze, sig, nothing(),
+      method_code, nothing(), new_flag_set(kFlagSetAllOff));
+  ASSERT_SUCCESS(add_methodspace_method(runtime, other_space, method));
+
+  // Running the same code there takes the fallback.
+  set_ambience_methodspace(ambience, other_space);
+  ASSERT_VALEQ(new_integer(8), run_code_block_until_condition(ambience, code));
+
+  // Going back to the original methodspace makes the inlined body valid again.
+  set_ambience_methodspace(ambience, space);
+  ASSERT_VALEQ(new_integer(7), run_code_block_until_condition(ambience, code));
+
+  DISPOSE_TEST_ARENA();
+  DISPOSE_RUNTIME();
+}
+
+// Returns a code block that loads the given path from the given fragment.
+static value_t new_load_global_code_block(runtime_t *runtime, value_t path,
+    value_t fragment) {
+  assembler_t assm;
+  TRY(assembler_init(&assm, runtime, fragment, scope_get_bottom()));
+  TRY_FINALLY {
+    E_TRY(assembler_emit_load_global(&assm, path, fragment));
+    E_TRY(assembler_emit_return(&assm));
+    E_RETURN(assembler_flush(&assm));
+  } FINALLY {
+    assembler_dispose(&assm);
+  } YRT
+}
+
+TEST(interp, load_global_cache) {
+  CREATE_RUNTIME();
+  CREATE_TEST_ARENA();
+
+  value_t path = C(vPath(vStr("x")));
+  value_t first_space = new_heap_namespace(runtime, nothing());
+  value_t first = new_heap_module_fragment(runtime, present_stage(), nothing(),
+      nothing(), first_space, nothing(), new_heap_id_hash_map(runtime, 16));
+  ASSERT_SUCCESS(set_namespace_binding_at(runtime, first_space, path,
+      new_integer(1)));
+  value_t second_space = new_heap_namespace(runtime, nothing());
+  value_t second = new_heap_module_fragment(runtime, present_stage(), nothing(),
+      first, second_space, nothing(), new_heap_id_hash_map(runtime, 16));
+  value_t code = new_load_global_code_block(runtime, path, second);
+  ASSERT_SUCCESS(code);
+
+  // While the fragment is being bound the load sees the current bindings every
+  // time it's executed, including ones made after the first execution.
+  ASSERT_VALEQ(new_integer(1), run_code_block_until_condition(ambience, code));
+  ASSERT_TRUE(is_nothing(get_single_site_cache(code)));
+  ASSERT_SUCCESS(set_namespace_binding_at(runtime, second_space, path,
+      new_integer(2)));
+  ASSERT_VALEQ(new_integer(2), run_code_block_until_condition(ambience, code));
+  value_t value = C(vStr("three"));
+  ASSERT_SUCCESS(set_namespace_binding_at(runtime, second_space, path, value));
+  ASSERT_SAME(value, run_code_block_until_condition(ambience, code));
+  ASSERT_TRUE(is_nothing(get_single_site_cache(code)));
+
+  // Once it's bound the result is cached and the cached load gives the same
+  // value as the full lookup.
+  set_module_fragment_epoch(second, feComplete);
+  ASSERT_SAME(value, run_code_block_until_condition(ambience, code));
+  ASSERT_SAME(value, get_single_site_cache(code));
+  ASSERT_SAME(module_fragment_lookup_path_full(runtime, second, path),
+      run_code_block_until_condition(ambience, code));
+
+  DISPOSE_TEST_ARENA();
+  DISPOSE_RUNTIME();
+}
@@ -176,6 +176,45 @@ TEST(method, multi_score) {
   DISPOSE_RUNTIME();
 }
 
+TEST(method, deep_is_score) {
+  CREATE_RUNTIME();
+
+  value_t a_p = new_heap_type(runtime, afFreeze, null());
+  value_t b_p = new_heap_type(runtime, afFreeze, null());
+  value_t c_p = new_heap_type(runtime, afFreeze, null());
+  value_t d_p = new_heap_type(runtime, afFreeze, null());
+  value_t space = new_heap_methodspace(runtime, nothing());
+  // d <: c <: b <: a, and also d <: a directly.
+  ASSERT_SUCCESS(add_methodspace_inheritance(runtime, space, d_p, c_p));
+  ASSERT_SUCCESS(add_methodspace_inheritance(runtime, space, c_p, b_p));
+  ASSERT_SUCCESS(add_methodspace_inheritance(runtime, space, b_p, a_p));
+  ASSERT_SUCCESS(add_methodspace_inheritance(runtime, space, d_p, a_p));
+  value_t is_a = new_heap_guard(runtime, afFreeze, gtIs, a_p);
+  value_t is_b = new_heap_guard(runtime, afFreeze, gtIs, b_p);
+  value_t is_c = new_heap_guard(runtime, afFreeze, gtIs, c_p);
+  value_t is_d = new_heap_guard(runtime, afFreeze, gtIs, d_p);
+
+  value_t d = new_instance_of(runtime, d_p);
+  // Matching a second time goes through the cached ancestry so do everything
+  // twice.
+  for (size_t i = 0; i < 2; i++) {
+    ASSERT_COMPARE(is_d, d, >, is_c, d);
+    // The shortest path to a is direct so it's as close as c.
+    ASSERT_COMPARE(is_a, d, ==, is_c, d);
+    ASSERT_COMPARE(is_c, d, >, is_b, d);
+  }
+
+  // Changing the hierarchy flushes the cached ancestries.
+  value_t e_p = new_heap_type(runtime, afFreeze, null());
+  value_t is_e = new_heap_guard(runtime, afFreeze, gtIs, e_p);
+  ASSERT_MATCH(false, is_e, d);
+  ASSERT_SUCCESS(add_methodspace_inheritance(runtime, space, b_p, e_p));
+  ASSERT_MATCH(true, is_e, d);
+  ASSERT_COMPARE(is_b, d, >, is_e, d);
+
+  DISPOSE_RUNTIME();
+}
+
 #undef ASSERT_COMPARE
 
 TEST(method, signature) {
@@ -565,6 +604,114 @@ TEST(method, extra_args) {
   DISPOSE_RUNTIME();
 }
 
+// Matches the given call tags against the given signature by searching for
+// each tag separately among the signature's tags, which is how matching worked
+// before the two were merged, and stores the offset of the argument matched by
+// each parameter in the given array. Only works for signatures whose guards
+// accept anything.
+static match_result_t match_tags_by_search(value_t signature, value_t tags,
+    size_t *offsets) {
+  size_t argc = (size_t) get_call_tags_entry_count(tags);
+  size_t mandatory_count = (size_t) get_signature_mandatory_count(signature);
+  if (argc < mandatory_count)
+    return mrMissingArgument;
+  bool allow_extra = get_signature_allow_extra(signature);
+  if (!allow_extra && argc > (size_t) get_signature_parameter_count(signature))
+    return mrUnexpectedArgument;
+  match_result_t on_match = mrMatch;
+  size_t mandatory_seen_count = 0;
+  uint64_t params_seen = 0;
+  for (size_t i = 0; i < argc; i++) {
+    value_t tag = get_call_tags_tag_at(tags, i);
+    value_t param = nothing();
+    for (int64_t j = 0; j < get_signature_tag_count(signature); j++) {
+      if (value_identity_compare(get_signature_tag_at(signature, j), tag)) {
+        param = get_signature_parameter_at(signature, j);
+        break;
+      }
+    }
+    if (is_nothing(param)) {
+      if (!allow_extra)
+        return mrUnexpectedArgument;
+      on_match = mrExtraMatch;
+      continue;
+    }
+    size_t index = (size_t) get_parameter_index(param);
+    uint64_t bit = ((uint64_t) 1) << index;
+    if ((params_seen & bit) != 0)
+      return mrRedundantArgument;
+    params_seen |= bit;
+    offsets[index] = (size_t) get_call_tags_offset_at(tags, i);
+    if (!get_parameter_is_optional(param))
+      mandatory_seen_count++;
+  }
+  return (mandatory_seen_count < mandatory_count) ? mrMissingArgument : on_match;
+}
+
+TEST(method, merged_tag_matching) {
+  CREATE_RUNTIME();
+  CREATE_TEST_ARENA();
+
+  // Call with every subset of these tags, which covers arguments interleaved
+  // with the signature's tags, missing and extra arguments, and several tags
+  // for the same parameter, and check that the result is the same as when
+  // each tag is searched for separately.
+  value_t universe = C(vArray(vInt(0), vInt(1), vInt(2), vInt(3), vStr("w"),
+      vStr("x"), vStr("y"), vStr("z")));
+  size_t universe_size = (size_t) get_array_length(universe);
+  variant_t *any_guard = vGuard(gtAny, vNull());
+  for (size_t allow_extra = 0; allow_extra < 2; allow_extra++) {
+    value_t sig = C(vSignature(
+        allow_extra == 1,
+        vParameter(any_guard, false, vInt(0), vStr("x")),
+        vParameter(any_guard, false, vInt(1), vStr("y")),
+        vParameter(any_guard, true, vInt(2), vStr("z"))));
+    size_t param_count = (size_t) get_signature_parameter_count(sig);
+    for (size_t subset = 0; subset < (1u << universe_size); subset++) {
+      size_t argc = 0;
+      for (size_t i = 0; i < universe_size; i++) {
+        if ((subset & (1u << i)) != 0)
+          argc++;
+      }
+      value_t tags = new_heap_array(runtime, argc);
+      for (size_t i = 0, next = 0; i < universe_size; i++) {
+        if ((subset & (1u << i)) != 0)
+          set_array_at(tags, next++, get_array_at(universe, i));
+      }
+      value_t entries = build_call_tags_entries(runtime, tags);
+      value_t call_tags = new_heap_call_tags(runtime, afFreeze, entries);
+      value_t values = new_heap_array(runtime, argc);
+      for (size_t i = 0; i < argc; i++)
+        set_array_at(values, i, new_integer(i));
+      value_t call_data = new_heap_call_data(runtime, call_tags, values);
+
+      size_t expected_offsets[16];
+      memset(expected_offsets, 0xFF, sizeof(expected_offsets));
+      match_result_t expected = match_tags_by_search(sig, call_tags,
+          expected_offsets);
+
+      sigmap_input_layout_t layout = sigmap_input_layout_new(ambience,
+          call_tags, nothing());
+      value_t scores[16];
+      size_t offsets[16];
+      memset(offsets, 0xFF, sizeof(offsets));
+      match_info_t match_info;
+      match_info_init(&match_info, scores, offsets, 16);
+      match_result_t found = __mrNone__;
+      ASSERT_SUCCESS(match_signature_from_call_data(sig, &layout, call_data,
+          nothing(), &match_info, &found));
+      ASSERT_EQ(expected, found);
+      if (match_result_is_match(found)) {
+        for (size_t i = 0; i < param_count; i++)
+          ASSERT_EQ(expected_offsets[i], offsets[i]);
+      }
+    }
+  }
+
+  DISPOSE_TEST_ARENA();
+  DISPOSE_RUNTIME();
+}
+
 TEST(method, match_argument_map) {
   CREATE_RUNTIME();
   CREATE_TEST_ARENA();
@@ -799,6 +946,373 @@ TEST(method, dense_perfect_lookup) {
   DISPOSE_RUNTIME();
 }
 
+// Returns call tags for a two-argument invocation with integer tags.
+static value_t new_two_argument_call_tags(runtime_t *runtime) {
+  value_t entries = new_heap_pair_array(runtime, 2);
+  for (size_t i = 0; i < 2; i++) {
+    set_pair_array_first_at(entries, i, new_integer(i));
+    set_pair_array_second_at(entries, i, new_integer(1 - i));
+  }
+  return new_heap_call_tags(runtime, afFreeze, entries);
+}
+
+// Looks up the given two arguments with the given tags through the ambience's
+// methodspace and stores the footprint of the lookup in the given out
+// parameter.
+static value_t lookup_with_tags(value_t ambience, value_t tags, value_t first,
+    value_t second, lookup_footprint_t *footprint_out) {
+  runtime_t *runtime = get_ambience_runtime(ambience);
+  value_t stack = new_heap_stack(runtime, 24);
+  frame_t frame = open_stack(stack);
+  push_stack_frame(runtime, stack, &frame, 2, null());
+  frame_push_value(&frame, first);
+  frame_push_value(&frame, second);
+  value_t arg_map;
+  sigmap_input_layout_t layout = sigmap_input_layout_new(ambience, tags, nothing());
+  return lookup_method_full_from_frame_with_footprint(&layout, &frame, &arg_map,
+      footprint_out);
+}
+
+// Looks up the given two arguments through the ambience's methodspace and
+// stores the footprint of the lookup in the given out parameter.
+static value_t lookup_with_footprint(value_t ambience, value_t first,
+    value_t second, lookup_footprint_t *footprint_out) {
+  runtime_t *runtime = get_ambience_runtime(ambience);
+  return lookup_with_tags(ambience, new_two_argument_call_tags(runtime), first,
+      second, footprint_out);
+}
+
+TEST(method, lookup_footprint) {
+  CREATE_RUNTIME();
+  CREATE_TEST_ARENA();
+
+  value_t space = get_ambience_methodspace(ambience);
+  value_t a_p = new_heap_type(runtime, afFreeze, C(vStr("A")));
+  value_t a = new_instance_of(runtime, a_p);
+  value_t eq_g = new_heap_guard(runtime, afFreeze, gtEq, new_integer(5));
+  value_t is_g = new_heap_guard(runtime, afFreeze, gtIs, a_p);
+  value_t any_g = new_heap_guard(runtime, afFreeze, gtAny, null());
+  value_t dummy_code = new_heap_code_block(runtime,
+      new_heap_blob(runtime, 0, afFreeze),
+      ROOT(runtime, empty_array),
+      0);
+
+  // f(0: == 5, 1: is A)
+  value_t eq_is_signature = C(vSignature(
+      false,
+      vParameter(vValue(eq_g), false, vInt(0)),
+      vParameter(vValue(is_g), false, vInt(1))));
+  value_t eq_is = new_heap_method(runtime, afFreeze, eq_is_signature,
+      nothing(), dummy_code, nothing(), new_flag_set(kFlagSetAllOff));
+  uint64_t epoch_before = runtime->methodspace_epoch;
+  ASSERT_SUCCESS(add_methodspace_method(runtime, space, eq_is));
+  // Changing the methodspace invalidates any inline caches.
+  ASSERT_TRUE(runtime->methodspace_epoch != epoch_before);
+
+  // Only the argument matched by an eq-guard depends on its identity.
+  lookup_footprint_t footprint;
+  value_t method = lookup_with_footprint(ambience, new_integer(5), a, &footprint);
+  ASSERT_VALEQ(eq_is, method);
+  ASSERT_TRUE(footprint.is_cacheable);
+  ASSERT_EQ(0x1, footprint.identity_mask);
+
+  // f(0: any, 1: any)
+  value_t any_any_signature = C(vSignature(
+      false,
+      vParameter(vValue(any_g), false, vInt(0)),
+      vParameter(vValue(any_g), false, vInt(1))));
+  value_t any_any = new_heap_method(runtime, afFreeze, any_any_signature,
+      nothing(), dummy_code, nothing(), new_flag_set(kFlagSetAllOff));
+  ASSERT_SUCCESS(add_methodspace_method(runtime, space, any_any));
+
+  // The eq-guard is still tried, and rejected, so the identity still matters
+  // even though the result doesn't come from the eq-guarded method.
+  method = lookup_with_footprint(ambience, new_integer(6), a, &footprint);
+  ASSERT_VALEQ(any_any, method);
+  ASSERT_TRUE(footprint.is_cacheable);
+  ASSERT_EQ(0x1, footprint.identity_mask);
+
+  DISPOSE_TEST_ARENA();
+  DISPOSE_RUNTIME();
+}
+
+// Returns the number of entries in the global lookup cache that are valid under
+// the current methodspace epoch.
+static size_t count_global_lookup_cache_entries(runtime_t *runtime) {
+  value_t cache = MROOT(runtime, global_lookup_cache);
+  size_t result = 0;
+  for (size_t i = 0; i < kGlobalLookupCacheEntryCount; i++) {
+    value_t epoch = get_array_at(cache, i * kGlobalLookupCacheEntrySize
+        + kGlobalLookupCacheEntryEpochIndex);
+    if (!is_null(epoch)
+        && get_integer_value(epoch) == (int64_t) runtime->methodspace_epoch)
+      result++;
+  }
+  return result;
+}
+
+TEST(method, global_lookup_cache) {
+  CREATE_RUNTIME();
+  CREATE_TEST_ARENA();
+
+  value_t space = get_ambience_methodspace(ambience);
+  value_t a_p = new_heap_type(runtime, afFreeze, C(vStr("A")));
+  value_t a = new_instance_of(runtime, a_p);
+  value_t eq_g = new_heap_guard(runtime, afFreeze, gtEq, new_integer(5));
+  value_t is_g = new_heap_guard(runtime, afFreeze, gtIs, a_p);
+  value_t any_g = new_heap_guard(runtime, afFreeze, gtAny, null());
+  value_t dummy_code = new_heap_code_block(runtime,
+      new_heap_blob(runtime, 0, afFreeze),
+      ROOT(runtime, empty_array),
+      0);
+  value_t tags = new_two_argument_call_tags(runtime);
+
+  // f(0: any, 1: any)
+  value_t any_any_signature = C(vSignature(
+      false,
+      vParameter(vValue(any_g), false, vInt(0)),
+      vParameter(vValue(any_g), false, vInt(1))));
+  value_t any_any = new_heap_method(runtime, afFreeze, any_any_signature,
+      nothing(), dummy_code, nothing(), new_flag_set(kFlagSetAllOff));
+  ASSERT_SUCCESS(add_methodspace_method(runtime, space, any_any));
+  ASSERT_EQ(0, count_global_lookup_cache_entries(runtime));
+
+  // The first lookup populates the cache, the second is served from it.
+  lookup_footprint_t footprint;
+  ASSERT_VALEQ(any_any, lookup_with_tags(ambience, tags, new_integer(5), a,
+      &footprint));
+  ASSERT_EQ(1, count_global_lookup_cache_entries(runtime));
+  ASSERT_VALEQ(any_any, lookup_with_tags(ambience, tags, new_integer(6), a,
+      &footprint));
+  ASSERT_TRUE(footprint.is_cacheable);
+  ASSERT_EQ(0, footprint.identity_mask);
+  ASSERT_EQ(1, count_global_lookup_cache_entries(runtime));
+
+  // f(0: == 5, 1: is A)
+  value_t eq_is_signature = C(vSignature(
+      false,
+      vParameter(vValue(eq_g), false, vInt(0)),
+      vParameter(vValue(is_g), false, vInt(1))));
+  value_t eq_is = new_heap_method(runtime, afFreeze, eq_is_signature,
+      nothing(), dummy_code, nothing(), new_flag_set(kFlagSetAllOff));
+  ASSERT_SUCCESS(add_methodspace_method(runtime, space, eq_is));
+
+  // Adding the method flushes the cache so the more specific method is found.
+  ASSERT_EQ(0, count_global_lookup_cache_entries(runtime));
+  ASSERT_VALEQ(eq_is, lookup_with_tags(ambience, tags, new_integer(5), a,
+      &footprint));
+  ASSERT_EQ(0x1, footprint.identity_mask);
+  // The entry now depends on the identity of the first argument so a
+  // different integer doesn't hit it.
+  ASSERT_VALEQ(any_any, lookup_with_tags(ambience, tags, new_integer(6), a,
+      &footprint));
+  ASSERT_VALEQ(eq_is, lookup_with_tags(ambience, tags, new_integer(5), a,
+      &footprint));
+
+  DISPOSE_TEST_ARENA();
+  DISPOSE_RUNTIME();
+}
+
+TEST(method, global_lookup_cache_after_gc) {
+  CREATE_RUNTIME();
+  CREATE_TEST_ARENA();
+
+  value_t space = get_ambience_methodspace(ambience);
+  value_t a_p = new_heap_type(runtime, afFreeze, C(vStr("A")));
+  value_t any_g = new_heap_guard(runtime, afFreeze, gtAny, null());
+  value_t dummy_code = new_heap_code_block(runtime,
+      new_heap_blob(runtime, 0, afFreeze),
+      ROOT(runtime, empty_array),
+      0);
+  value_t tags = new_two_argument_call_tags(runtime);
+  value_t any_any_signature = C(vSignature(
+      false,
+      vParameter(vValue(any_g), false, vInt(0)),
+      vParameter(vValue(any_g), false, vInt(1))));
+  value_t any_any = new_heap_method(runtime, afFreeze, any_any_signature,
+      nothing(), dummy_code, nothing(), new_flag_set(kFlagSetAllOff));
+  ASSERT_SUCCESS(add_methodspace_method(runtime, space, any_any));
+  lookup_footprint_t footprint;
+  ASSERT_VALEQ(any_any, lookup_with_tags(ambience, tags, new_integer(5),
+      new_instance_of(runtime, a_p), &footprint));
+  ASSERT_EQ(1, count_global_lookup_cache_entries(runtime));
+
+  // Move everything, including the keys of the entry.
+  safe_value_t s_ambience = runtime_protect_value(runtime, ambience);
+  safe_value_t s_a_p = runtime_protect_value(runtime, a_p);
+  safe_value_t s_tags = runtime_protect_value(runtime, tags);
+  safe_value_t s_any_any = runtime_protect_value(runtime, any_any);
+  ASSERT_SUCCESS(runtime_garbage_collect(runtime));
+  ambience = deref(s_ambience);
+  a_p = deref(s_a_p);
+  tags = deref(s_tags);
+  any_any = deref(s_any_any);
+
+  // Replace the method in the entry with a different one so a hit can be told
+  // apart from a fresh lookup.
+  value_t cache = MROOT(runtime, global_lookup_cache);
+  value_t marker = new_heap_method(runtime, afFreeze,
+      get_method_signature(any_any), nothing(), nothing(), nothing(),
+      new_flag_set(kFlagSetAllOff));
+  for (size_t i = 0; i < kGlobalLookupCacheEntryCount; i++) {
+    size_t start = i * kGlobalLookupCacheEntrySize;
+    if (!is_null(get_array_at(cache, start + kGlobalLookupCacheEntryEpochIndex)))
+      set_array_at(cache, start + kGlobalLookupCacheEntryMethodIndex, marker);
+  }
+
+  // The lookup still hashes to the same entry so it's served from the cache.
+  ASSERT_VALEQ(marker, lookup_with_tags(ambience, tags, new_integer(6),
+      new_instance_of(runtime, a_p), &footprint));
+  ASSERT_EQ(1, count_global_lookup_cache_entries(runtime));
+
+  safe_value_destroy(runtime, s_ambience);
+  safe_value_destroy(runtime, s_a_p);
+  safe_value_destroy(runtime, s_tags);
+  safe_value_destroy(runtime, s_any_any);
+  DISPOSE_TEST_ARENA();
+  DISPOSE_RUNTIME();
+}
+
+// Adds a method with the given signature and no implementation to the given
+// methodspace, returning the method.
+static value_t add_dummy_method(runtime_t *runtime, value_t space,
+    value_t signature) {
+  value_t dummy_code = new_heap_code_block(runtime,
+      new_heap_blob(runtime, 0, afFreeze),
+      ROOT(runtime, empty_array),
+      0);
+  value_t method = new_heap_method(runtime, afFreeze, signature, nothing(),
+      dummy_code, nothing(), new_flag_set(kFlagSetAllOff));
+  ASSERT_SUCCESS(add_methodspace_method(runtime, space, method));
+  return method;
+}
+
+TEST(method, dispatch_plan) {
+  CREATE_RUNTIME();
+  CREATE_TEST_ARENA();
+
+  value_t space = get_ambience_methodspace(ambience);
+  value_t a_p = new_heap_type(runtime, afFreeze, C(vStr("A")));
+  variant_t *sel_key = vValue(ROOT(runtime, selector_key));
+  variant_t *any_g = vGuard(gtAny, vNull());
+
+  // (sel: == "sel", 0: is A)
+  add_dummy_method(runtime, space, C(vSignature(
+      false,
+      vParameter(vGuard(gtEq, vStr("sel")), false, sel_key),
+      vParameter(vGuard(gtIs, vValue(a_p)), false, vInt(0)))));
+  // (sel: == "sel", 0: any)
+  add_dummy_method(runtime, space, C(vSignature(
+      false,
+      vParameter(vGuard(gtEq, vStr("sel")), false, sel_key),
+      vParameter(any_g, false, vInt(0)))));
+  // (sel: == "sel", 0: any, 1: any)
+  add_dummy_method(runtime, space, C(vSignature(
+      false,
+      vParameter(vGuard(gtEq, vStr("sel")), false, sel_key),
+      vParameter(any_g, false, vInt(0)),
+      vParameter(any_g, false, vInt(1)))));
+  // (sel: == "other", 0: any)
+  add_dummy_method(runtime, space, C(vSignature(
+      false,
+      vParameter(vGuard(gtEq, vStr("other")), false, sel_key),
+      vParameter(any_g, false, vInt(0)))));
+
+  value_t tags = make_call_tags(runtime, vArray(vInt(0), sel_key));
+  value_t plan = get_or_create_methodspace_dispatch_plan(runtime, space,
+      C(vStr("sel")), tags);
+  ASSERT_FAMILY(ofArray, plan);
+  ASSERT_EQ(2, get_integer_value(get_array_at(plan,
+      kDispatchPlanArgumentCountIndex)));
+  // The three-argument method can't match with two arguments and the "other"
+  // method isn't in the slice so there are only two candidates. Their two
+  // selector guards are the same so they share a column.
+  ASSERT_EQ(2, get_integer_value(get_array_at(plan,
+      kDispatchPlanCandidateCountIndex)));
+  ASSERT_EQ(3, get_integer_value(get_array_at(plan,
+      kDispatchPlanColumnCountIndex)));
+
+  // Equivalent tags give the same plan.
+  value_t same_tags = make_call_tags(runtime, vArray(sel_key, vInt(0)));
+  ASSERT_SAME(plan, get_or_create_methodspace_dispatch_plan(runtime, space,
+      C(vStr("sel")), same_tags));
+
+  // With both arguments all three "sel" methods can match.
+  value_t wide_tags = make_call_tags(runtime, vArray(vInt(0), vInt(1), sel_key));
+  value_t wide_plan = get_or_create_methodspace_dispatch_plan(runtime, space,
+      C(vStr("sel")), wide_tags);
+  ASSERT_EQ(3, get_integer_value(get_array_at(wide_plan,
+      kDispatchPlanArgumentCountIndex)));
+  // The two-argument methods have no parameter for tag 1 and don't allow
+  // extra arguments.
+  ASSERT_EQ(1, get_integer_value(get_array_at(wide_plan,
+      kDispatchPlanCandidateCountIndex)));
+
+  DISPOSE_TEST_ARENA();
+  DISPOSE_RUNTIME();
+}
+
+// A signature that matches a selector with the given guard and a single
+// argument.
+#define vSelectorSignature(G) vSignature(false,                                \
+    vParameter(G, false, vValue(ROOT(runtime, selector_key))),                 \
+    vParameter(vGuard(gtAny, vNull()), false, vInt(0)))
+
+TEST(method, incremental_selector_slice) {
+  CREATE_RUNTIME();
+  CREATE_TEST_ARENA();
+
+  value_t parent = new_heap_methodspace(runtime, nothing());
+  value_t space = new_heap_methodspace(runtime, parent);
+  value_t sel = C(vStr("sel"));
+  value_t p0 = add_dummy_method(runtime, parent,
+      C(vSelectorSignature(vGuard(gtEq, vStr("sel")))));
+  value_t m0 = add_dummy_method(runtime, space,
+      C(vSelectorSignature(vGuard(gtEq, vStr("sel")))));
+
+  value_t slice = get_or_create_methodspace_selector_slice(runtime, space, sel);
+  value_t entries = get_signature_map_entries(slice);
+  ASSERT_EQ(2, get_pair_array_buffer_length(entries));
+  ASSERT_SAME(m0, get_pair_array_buffer_second_at(entries, 0));
+  ASSERT_SAME(p0, get_pair_array_buffer_second_at(entries, 1));
+
+  // Adding a method for the same selector updates the slice in place, keeping
+  // the methodspace's own methods before its parent's.
+  value_t m1 = add_dummy_method(runtime, space,
+      C(vSelectorSignature(vGuard(gtEq, vStr("sel")))));
+  ASSERT_SAME(slice, get_or_create_methodspace_selector_slice(runtime, space,
+      sel));
+  entries = get_signature_map_entries(slice);
+  ASSERT_EQ(3, get_pair_array_buffer_length(entries));
+  ASSERT_SAME(m0, get_pair_array_buffer_second_at(entries, 0));
+  ASSERT_SAME(m1, get_pair_array_buffer_second_at(entries, 1));
+  ASSERT_SAME(p0, get_pair_array_buffer_second_at(entries, 2));
+
+  // Adding a method for a different selector doesn't affect the slice.
+  add_dummy_method(runtime, space,
+      C(vSelectorSignature(vGuard(gtEq, vStr("other")))));
+  ASSERT_SAME(slice, get_or_create_methodspace_selector_slice(runtime, space,
+      sel));
+  ASSERT_EQ(3, get_pair_array_buffer_length(get_signature_map_entries(slice)));
+
+  // A method that can match any selector causes the slices to be rebuilt.
+  value_t m2 = add_dummy_method(runtime, space,
+      C(vSelectorSignature(vGuard(gtAny, vNull()))));
+  value_t rebuilt = get_or_create_methodspace_selector_slice(runtime, space,
+      sel);
+  entries = get_signature_map_entries(rebuilt);
+  ASSERT_EQ(4, get_pair_array_buffer_length(entries));
+  ASSERT_SAME(m0, get_pair_array_buffer_second_at(entries, 0));
+  ASSERT_SAME(m1, get_pair_array_buffer_second_at(entries, 1));
+  ASSERT_SAME(m2, get_pair_array_buffer_second_at(entries, 2));
+  ASSERT_SAME(p0, get_pair_array_buffer_second_at(entries, 3));
+
+  DISPOSE_TEST_ARENA();
+  DISPOSE_RUNTIME();
+}
+
+#undef vSelectorSignature
+
 // Shorthand for testing how an operation prints.
 #define CHECK_OP_PRINT(EXPECTED, OP) do {                                      \
   value_t op = (OP);                                                           \
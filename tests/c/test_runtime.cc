@@ -110,6 +110,383 @@ TEST(runtime, safe_value_loop) {
   DISPOSE_RUNTIME();
 }
 
+TEST(runtime, gc_parallel) {
+  extended_runtime_config_t config = *extended_runtime_config_get_default();
+  config.base.semispace_size_bytes = 4 * kMB;
+  config.base.gc_thread_count = 4;
+  CREATE_RUNTIME_WITH_CONFIG(&config);
+
+  // Build a graph with lots of sharing, for the workers to race over, some
+  // objects too big for the workers' buffers, and a map keyed by objects that
+  // move.
+  static const size_t kCount = 512;
+  value_t shared = new_heap_array(runtime, 1);
+  value_t map = new_heap_id_hash_map(runtime, kCount);
+  value_t outer = new_heap_array(runtime, kCount);
+  for (size_t i = 0; i < kCount; i++) {
+    value_t inner = new_heap_array(runtime, 3);
+    set_array_at(inner, 0, new_integer(i));
+    set_array_at(inner, 1, shared);
+    value_t big = new_heap_array(runtime, (i % 64 == 0) ? 1100 : 4);
+    set_array_at(big, 0, inner);
+    set_array_at(inner, 2, big);
+    set_array_at(outer, i, inner);
+    ASSERT_SUCCESS(set_id_hash_map_at(runtime, map, inner, new_integer(i)));
+  }
+  safe_value_t s_outer = runtime_protect_value(runtime, outer);
+  safe_value_t s_map = runtime_protect_value(runtime, map);
+
+  for (size_t round = 0; round < 3; round++) {
+    ASSERT_SUCCESS(runtime_garbage_collect(runtime));
+    outer = deref(s_outer);
+    map = deref(s_map);
+    shared = get_array_at(get_array_at(outer, 0), 1);
+    for (size_t i = 0; i < kCount; i++) {
+      value_t inner = get_array_at(outer, i);
+      ASSERT_VALEQ(new_integer(i), get_array_at(inner, 0));
+      ASSERT_SAME(shared, get_array_at(inner, 1));
+      ASSERT_SAME(inner, get_array_at(get_array_at(inner, 2), 0));
+      ASSERT_VALEQ(new_integer(i), get_id_hash_map_at(map, inner));
+    }
+  }
+
+  safe_value_destroy(runtime, s_outer);
+  safe_value_destroy(runtime, s_map);
+  DISPOSE_RUNTIME();
+}
+
+// Returns true if the given object lives in the runtime's nursery.
+static bool is_young(runtime_t *runtime, value_t value) {
+  return heap_is_young_address(&runtime->heap, get_heap_object_address(value));
+}
+
+TEST(runtime, gc_nursery) {
+  CREATE_RUNTIME();
+  ASSERT_TRUE(heap_has_nursery(&runtime->heap));
+
+  // Make some old objects.
+  safe_value_t s_array = runtime_protect_value(runtime,
+      new_heap_array(runtime, 2));
+  safe_value_t s_map = runtime_protect_value(runtime,
+      new_heap_id_hash_map(runtime, 16));
+  ASSERT_SUCCESS(runtime_garbage_collect(runtime));
+  value_t old_array = deref(s_array);
+  value_t old_map = deref(s_map);
+  ASSERT_FALSE(is_young(runtime, old_array));
+  ASSERT_FALSE(is_young(runtime, old_map));
+  ASSERT_FALSE(heap_is_object_remembered(&runtime->heap, old_array));
+
+  // Storing young values in them makes the barrier remember them.
+  value_t young_key = new_heap_array(runtime, 1);
+  value_t young_value = new_heap_array(runtime, 1);
+  ASSERT_TRUE(is_young(runtime, young_key));
+  set_array_at(old_array, 0, young_key);
+  set_array_at(old_array, 1, new_integer(8));
+  ASSERT_TRUE(heap_is_object_remembered(&runtime->heap, old_array));
+  ASSERT_SUCCESS(set_id_hash_map_at(runtime, old_map, young_key, young_value));
+  ASSERT_TRUE(heap_is_object_remembered(&runtime->heap,
+      get_id_hash_map_entry_array(old_map)));
+
+  // A nursery collection promotes the young objects and leaves the old ones
+  // where they are.
+  ASSERT_TRUE(heap_can_collect_nursery(&runtime->heap));
+  ASSERT_SUCCESS(runtime_garbage_collect_young(runtime));
+  ASSERT_SAME(old_array, deref(s_array));
+  ASSERT_SAME(old_map, deref(s_map));
+  ASSERT_FALSE(heap_is_object_remembered(&runtime->heap, old_array));
+  value_t promoted_key = get_array_at(old_array, 0);
+  ASSERT_NSAME(young_key, promoted_key);
+  ASSERT_FALSE(is_young(runtime, promoted_key));
+  ASSERT_VALEQ(new_integer(8), get_array_at(old_array, 1));
+  // The key kept its hash when it was promoted so it can still be found.
+  value_t promoted_value = get_id_hash_map_at(old_map, promoted_key);
+  ASSERT_FAMILY(ofArray, promoted_value);
+  ASSERT_FALSE(is_young(runtime, promoted_value));
+
+  safe_value_destroy(runtime, s_array);
+  safe_value_destroy(runtime, s_map);
+  DISPOSE_RUNTIME();
+}
+
+// Returns true if the given object lives in the runtime's large object space.
+static bool is_large(runtime_t *runtime, value_t value) {
+  return heap_is_large_address(&runtime->heap, get_heap_object_address(value));
+}
+
+TEST(runtime, gc_large_objects) {
+  for (uint32_t thread_count = 1; thread_count <= 4; thread_count += 3) {
+    extended_runtime_config_t config = *extended_runtime_config_get_default();
+    config.base.gc_thread_count = thread_count;
+    CREATE_RUNTIME_WITH_CONFIG(&config);
+    heap_t *heap = &runtime->heap;
+    size_t threshold = config.base.large_object_size_bytes;
+
+    // Big arrays and blobs go in the large object space, small ones don't.
+    size_t count_before = heap->large_object_count;
+    value_t array = new_heap_array(runtime, threshold / kValueSize);
+    value_t blob = new_heap_blob(runtime, threshold, afMutable);
+    ASSERT_TRUE(is_large(runtime, array));
+    ASSERT_TRUE(is_large(runtime, blob));
+    ASSERT_FALSE(is_large(runtime, new_heap_array(runtime, 4)));
+    ASSERT_EQ(count_before + 2, heap->large_object_count);
+
+    // Storing a young value in a large object remembers it like any other old
+    // object so a nursery collection updates it in place.
+    value_t young = new_heap_array(runtime, 1);
+    set_array_at(array, 0, young);
+    set_array_at(array, 1, blob);
+    ASSERT_TRUE(heap_is_object_remembered(heap, array));
+    safe_value_t s_array = runtime_protect_value(runtime, array);
+    ASSERT_SUCCESS(runtime_garbage_collect_young(runtime));
+    ASSERT_SAME(array, deref(s_array));
+    ASSERT_FALSE(is_young(runtime, get_array_at(array, 0)));
+
+    // A full collection doesn't move them either but does migrate what they
+    // point to and keeps what they point to alive.
+    ASSERT_SUCCESS(runtime_garbage_collect(runtime));
+    ASSERT_SAME(array, deref(s_array));
+    ASSERT_SAME(blob, get_array_at(array, 1));
+    ASSERT_FAMILY(ofArray, get_array_at(array, 0));
+    ASSERT_FALSE(is_young(runtime, get_array_at(array, 0)));
+    ASSERT_FALSE(is_large(runtime, get_array_at(array, 0)));
+
+    // Once they're garbage the next full collection unmaps them.
+    size_t live_count = heap->large_object_count;
+    safe_value_destroy(runtime, s_array);
+    ASSERT_SUCCESS(runtime_garbage_collect(runtime));
+    ASSERT_EQ(live_count - 2, heap->large_object_count);
+
+    DISPOSE_RUNTIME();
+  }
+}
+
+// Fills to-space with a chain of live objects until allocating starts an
+// incremental collection. Returns the head of the chain.
+static safe_value_t fill_until_replicating(runtime_t *runtime) {
+  safe_value_t s_filler = runtime_protect_value(runtime,
+      new_heap_array(runtime, 1));
+  while (!heap_is_replicating(&runtime->heap)) {
+    value_t link = new_heap_array(runtime, 16);
+    if (is_heap_exhausted_condition(link)) {
+      ASSERT_SUCCESS(runtime_garbage_collect_young(runtime));
+      continue;
+    }
+    set_array_at(link, 0, deref(s_filler));
+    safe_value_destroy(runtime, s_filler);
+    s_filler = runtime_protect_value(runtime, link);
+  }
+  return s_filler;
+}
+
+TEST(runtime, gc_incremental) {
+  for (size_t nursery_size = 0; nursery_size <= 256 * kKB;
+      nursery_size += 256 * kKB) {
+    extended_runtime_config_t config = *extended_runtime_config_get_default();
+    config.base.nursery_size_bytes = nursery_size;
+    config.base.semispace_size_bytes = 1 * kMB;
+    config.base.max_semispace_size_bytes = 4 * kMB;
+    config.base.gc_max_pause_millis = 1;
+    CREATE_RUNTIME_WITH_CONFIG(&config);
+    heap_t *heap = &runtime->heap;
+
+    // Some live objects, including a map keyed by objects that move.
+    static const size_t kCount = 64;
+    value_t outer = new_heap_array(runtime, kCount);
+    value_t map = new_heap_id_hash_map(runtime, kCount);
+    for (size_t i = 0; i < kCount; i++) {
+      value_t inner = new_heap_array(runtime, 1);
+      set_array_at(inner, 0, new_integer(i));
+      set_array_at(outer, i, inner);
+      ASSERT_SUCCESS(set_id_hash_map_at(runtime, map, inner, new_integer(i)));
+    }
+    safe_value_t s_outer = runtime_protect_value(runtime, outer);
+    safe_value_t s_map = runtime_protect_value(runtime, map);
+    ASSERT_SUCCESS(runtime_garbage_collect(runtime));
+
+    // Fill to-space with live objects until allocating starts an incremental
+    // collection.
+    safe_value_t s_filler = fill_until_replicating(runtime);
+
+    // Replicating doesn't move anything.
+    outer = deref(s_outer);
+    map = deref(s_map);
+    while (!runtime_is_incremental_collection_ready(runtime))
+      ASSERT_SUCCESS(runtime_garbage_collect_increment(runtime));
+    ASSERT_SAME(outer, deref(s_outer));
+
+    // Write to objects that have been replicated.
+    value_t fresh = new_heap_array(runtime, 1);
+    set_array_at(fresh, 0, new_integer(-1));
+    set_array_at(outer, 0, fresh);
+    set_array_at(get_array_at(outer, 1), 0, new_integer(-2));
+    ASSERT_SUCCESS(set_id_hash_map_at(runtime, map, fresh, new_integer(-3)));
+
+    // The next collection flips the heap over to the replicas, which have
+    // picked up the writes.
+    ASSERT_SUCCESS(runtime_garbage_collect(runtime));
+    ASSERT_FALSE(heap_is_replicating(heap));
+    const gc_collection_stats_t *last = &runtime_get_gc_stats(runtime)->last;
+    ASSERT_EQ(gkIncremental, last->kind);
+    ASSERT_TRUE(last->slice_count > 0);
+    outer = deref(s_outer);
+    map = deref(s_map);
+    fresh = get_array_at(outer, 0);
+    ASSERT_VALEQ(new_integer(-1), get_array_at(fresh, 0));
+    ASSERT_VALEQ(new_integer(-3), get_id_hash_map_at(map, fresh));
+    ASSERT_VALEQ(new_integer(-2), get_array_at(get_array_at(outer, 1), 0));
+    for (size_t i = 1; i < kCount; i++) {
+      value_t inner = get_array_at(outer, i);
+      if (i > 1)
+        ASSERT_VALEQ(new_integer(i), get_array_at(inner, 0));
+      ASSERT_VALEQ(new_integer(i), get_id_hash_map_at(map, inner));
+    }
+
+    safe_value_destroy(runtime, s_outer);
+    safe_value_destroy(runtime, s_map);
+    safe_value_destroy(runtime, s_filler);
+    DISPOSE_RUNTIME();
+  }
+}
+
+TEST(runtime, gc_incremental_counts) {
+  for (size_t nursery_size = 0; nursery_size <= 256 * kKB;
+      nursery_size += 256 * kKB) {
+    extended_runtime_config_t config = *extended_runtime_config_get_default();
+    config.base.nursery_size_bytes = nursery_size;
+    config.base.semispace_size_bytes = 1 * kMB;
+    config.base.max_semispace_size_bytes = 4 * kMB;
+    config.base.gc_max_pause_millis = 1;
+    CREATE_RUNTIME_WITH_CONFIG(&config);
+    heap_t *heap = &runtime->heap;
+
+    // Room enough that adding only ever changes the counts, never the backing
+    // arrays.
+    static const size_t kCapacity = 256;
+    value_t buffer = new_heap_array_buffer(runtime, kCapacity);
+    value_t map = new_heap_id_hash_map(runtime, kCapacity);
+    safe_value_t s_buffer = runtime_protect_value(runtime, buffer);
+    safe_value_t s_map = runtime_protect_value(runtime, map);
+    ASSERT_SUCCESS(runtime_garbage_collect(runtime));
+    safe_value_t s_filler = fill_until_replicating(runtime);
+
+    // Add to both between slices, and once more when replication is done, so
+    // most additions happen after they've been replicated.
+    int64_t count = 0;
+    bool is_ready = false;
+    while (!is_ready) {
+      is_ready = runtime_is_incremental_collection_ready(runtime);
+      if (!is_ready)
+        ASSERT_SUCCESS(runtime_garbage_collect_increment(runtime));
+      buffer = deref(s_buffer);
+      map = deref(s_map);
+      ASSERT_SUCCESS(add_to_array_buffer(runtime, buffer, new_integer(count)));
+      ASSERT_SUCCESS(set_id_hash_map_at(runtime, map, new_integer(count),
+          new_integer(-count)));
+      count++;
+      ASSERT_TRUE((size_t) count < kCapacity / 2);
+    }
+
+    // After the flip the replicas have the new counts, not the ones they had
+    // when they were copied.
+    ASSERT_SUCCESS(runtime_garbage_collect(runtime));
+    ASSERT_FALSE(heap_is_replicating(heap));
+    ASSERT_EQ(gkIncremental, runtime_get_gc_stats(runtime)->last.kind);
+    buffer = deref(s_buffer);
+    map = deref(s_map);
+    ASSERT_EQ(count, get_array_buffer_length(buffer));
+    ASSERT_EQ(count, get_id_hash_map_size(map));
+    for (int64_t i = 0; i < count; i++) {
+      ASSERT_VALEQ(new_integer(i), get_array_buffer_at(buffer, i));
+      ASSERT_VALEQ(new_integer(-i), get_id_hash_map_at(map, new_integer(i)));
+    }
+
+    safe_value_destroy(runtime, s_buffer);
+    safe_value_destroy(runtime, s_map);
+    safe_value_destroy(runtime, s_filler);
+    DISPOSE_RUNTIME();
+  }
+}
+
+TEST(runtime, stable_identity_hash) {
+  CREATE_RUNTIME();
+  identity_hash_table_t *table = &runtime->heap.identity_hashes;
+
+  // Objects hashed by identity keep their hash when they move, whatever kind
+  // of collection moves them.
+  safe_value_t s_live = runtime_protect_value(runtime,
+      new_heap_array(runtime, 1));
+  value_t hash = value_transient_identity_hash(deref(s_live));
+  ASSERT_SUCCESS(hash);
+  ASSERT_VALEQ(hash, value_transient_identity_hash(deref(s_live)));
+  ASSERT_SUCCESS(runtime_garbage_collect_young(runtime));
+  ASSERT_VALEQ(hash, value_transient_identity_hash(deref(s_live)));
+  ASSERT_SUCCESS(runtime_garbage_collect(runtime));
+  ASSERT_VALEQ(hash, value_transient_identity_hash(deref(s_live)));
+
+  // Different objects get different hashes.
+  value_t other = new_heap_array(runtime, 1);
+  ASSERT_NSAME(hash, value_transient_identity_hash(other));
+
+  // The hashes of objects that die are dropped by the next collection.
+  size_t length_before = table->length;
+  for (size_t i = 0; i < 64; i++)
+    ASSERT_SUCCESS(value_transient_identity_hash(new_heap_array(runtime, 1)));
+  ASSERT_EQ(length_before + 64, table->length);
+  ASSERT_SUCCESS(runtime_garbage_collect(runtime));
+  ASSERT_TRUE(table->length <= length_before);
+  ASSERT_VALEQ(hash, value_transient_identity_hash(deref(s_live)));
+
+  safe_value_destroy(runtime, s_live);
+  DISPOSE_RUNTIME();
+}
+
+TEST(runtime, gc_stats) {
+  CREATE_RUNTIME();
+  const gc_stats_t *stats = runtime_get_gc_stats(runtime);
+  const gc_collection_stats_t *last = &stats->last;
+  size_t full_count = stats->full_count;
+  uint64_t total_copied = stats->total_bytes_copied;
+  size_t array_ordinal = ((size_t) ofArray) >> kDomainTagSize;
+
+  // Some arrays that survive and some that don't.
+  safe_value_t s_array = runtime_protect_value(runtime,
+      new_heap_array(runtime, 16));
+  for (size_t i = 0; i < 16; i++) {
+    set_array_at(deref(s_array), i, new_heap_array(runtime, 4));
+    new_heap_array(runtime, 4);
+  }
+  size_t allocated = stats->bytes_allocated_since_gc;
+  ASSERT_TRUE(allocated > 0);
+
+  // A full collection records what it copied.
+  ASSERT_SUCCESS(runtime_garbage_collect(runtime));
+  ASSERT_EQ(full_count + 1, stats->full_count);
+  ASSERT_EQ(gkFull, last->kind);
+  ASSERT_EQ(allocated, last->bytes_allocated);
+  ASSERT_EQ(0, stats->bytes_allocated_since_gc);
+  ASSERT_TRUE(last->bytes_copied <= last->bytes_before);
+  ASSERT_EQ(total_copied + last->bytes_copied, stats->total_bytes_copied);
+  ASSERT_EQ(runtime->heap.object_tracker_count, last->object_tracker_count);
+  size_t family_bytes = 0;
+  for (size_t i = 0; i < kGcFamilyStatsCount; i++)
+    family_bytes += last->families[i].bytes;
+  ASSERT_EQ(last->bytes_copied, family_bytes);
+  ASSERT_TRUE(last->families[array_ordinal].count >= 17);
+  ASSERT_TRUE(last->pause_micros <= stats->max_pause_micros);
+  ASSERT_TRUE(last->pause_micros <= stats->total_pause_micros);
+
+  // A nursery collection only records what it promoted.
+  if (heap_has_nursery(&runtime->heap)) {
+    set_array_at(deref(s_array), 0, new_heap_array(runtime, 4));
+    ASSERT_SUCCESS(runtime_garbage_collect_young(runtime));
+    ASSERT_EQ(gkNursery, last->kind);
+    ASSERT_EQ(1, last->families[array_ordinal].count);
+  }
+
+  safe_value_destroy(runtime, s_array);
+  DISPOSE_RUNTIME();
+}
+
 TEST(runtime, gc_fuzzer) {
   static const size_t kMin = 10;
   static const size_t kMean = 100;
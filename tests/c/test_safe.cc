@@ -73,6 +73,46 @@ TEST(safe, pool_overflow) {
   DISPOSE_RUNTIME();
 }
 
+TEST(safe, tracker_reuse) {
+  CREATE_RUNTIME();
+  heap_t *heap = &runtime->heap;
+  size_t count_before = heap->object_tracker_count;
+
+  // A destroyed tracker's memory is handed out again by the next protect.
+  safe_value_t s_first = runtime_protect_value(runtime,
+      new_heap_array(runtime, 1));
+  object_tracker_t *first = safe_value_to_object_tracker(s_first);
+  safe_value_destroy(runtime, s_first);
+  safe_value_t s_second = runtime_protect_value(runtime,
+      new_heap_array(runtime, 1));
+  ASSERT_PTREQ(first, safe_value_to_object_tracker(s_second));
+  safe_value_destroy(runtime, s_second);
+
+  // Enough trackers to fill several chunks survive collections, including
+  // when some of them in the middle have been destroyed.
+  static const size_t kCount = 3 * kObjectTrackerChunkSize;
+  safe_value_t s_values[kCount];
+  for (size_t i = 0; i < kCount; i++) {
+    value_t array = new_heap_array(runtime, 1);
+    set_array_at(array, 0, new_integer(i));
+    s_values[i] = runtime_protect_value(runtime, array);
+  }
+  ASSERT_EQ(count_before + kCount, heap->object_tracker_count);
+  for (size_t i = 0; i < kCount; i += 3)
+    safe_value_destroy(runtime, s_values[i]);
+  ASSERT_SUCCESS(runtime_garbage_collect(runtime));
+  ASSERT_SUCCESS(heap_validate(heap));
+  for (size_t i = 0; i < kCount; i++) {
+    if ((i % 3) == 0)
+      continue;
+    ASSERT_VALEQ(new_integer(i), get_array_at(deref(s_values[i]), 0));
+    safe_value_destroy(runtime, s_values[i]);
+  }
+  ASSERT_EQ(count_before, heap->object_tracker_count);
+
+  DISPOSE_RUNTIME();
+}
+
 TEST(safe, derived) {
   CREATE_RUNTIME();
 
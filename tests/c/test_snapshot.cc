@@ -0,0 +1,156 @@
+//- Copyright 2014 the Neutrino authors (see AUTHORS).
+//- Licensed under the Apache License, Version 2.0 (see LICENSE).
+
+#include "test.hh"
+
+BEGIN_C_INCLUDES
+#include "heap.h"
+#include "snapshot.h"
+#include "value-inl.h"
+END_C_INCLUDES
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+IMPLEMENTATION(object_counter_o, value_visitor_o);
+
+// Value visitor that counts the objects it's called with.
+struct object_counter_o {
+  IMPLEMENTATION_HEADER(object_counter_o, value_visitor_o);
+  size_t count;
+};
+
+static value_t object_counter_visit(value_visitor_o *super_self, value_t value) {
+  object_counter_o *self = DOWNCAST(object_counter_o, super_self);
+  self->count++;
+  return success();
+}
+
+VTABLE(object_counter_o, value_visitor_o) { object_counter_visit };
+
+// Returns the number of objects allocated in the given runtime's heap.
+static size_t count_allocated_objects(runtime_t *runtime) {
+  object_counter_o counter;
+  VTABLE_INIT(object_counter_o, UPCAST(&counter));
+  counter.count = 0;
+  ASSERT_SUCCESS(heap_for_each_allocated_object(&runtime->heap,
+      UPCAST(&counter)));
+  return counter.count;
+}
+
+// Reads the contents of the file with the given name into a newly allocated
+// null-terminated string which the caller is responsible for freeing.
+static char *read_file_contents(const char *path) {
+  FILE *file = fopen(path, "rb");
+  ASSERT_TRUE(file != NULL);
+  fseek(file, 0, SEEK_END);
+  size_t size = (size_t) ftell(file);
+  fseek(file, 0, SEEK_SET);
+  char *result = (char*) malloc(size + 1);
+  ASSERT_EQ(size, fread(result, 1, size, file));
+  result[size] = '\0';
+  fclose(file);
+  return result;
+}
+
+// Parses the hex address at the start of the given string, storing the end of
+// it in the given pointer.
+static address_arith_t parse_snapshot_address(const char *str, char **end_out) {
+  return (address_arith_t) strtoull(str, end_out, 16);
+}
+
+// Returns the address of the given object as written in snapshots.
+static address_arith_t get_snapshot_address(value_t value) {
+  return (address_arith_t) get_heap_object_address(value);
+}
+
+TEST(snapshot, write) {
+  CREATE_RUNTIME();
+
+  // An array that is only kept alive by a tracker and that references a
+  // string.
+  value_t str = new_heap_utf8(runtime, new_c_string("snapshot"));
+  ASSERT_SUCCESS(str);
+  value_t array = new_heap_array(runtime, 2);
+  ASSERT_SUCCESS(array);
+  set_array_at(array, 0, str);
+  safe_value_t s_array = runtime_protect_value(runtime, array);
+
+  const char *path = "test_snapshot.tmp";
+  ASSERT_SUCCESS(runtime_dump_heap_snapshot(runtime, new_c_string(path)));
+  // Writing the snapshot doesn't allocate so the heap is still the same.
+  size_t object_count = count_allocated_objects(runtime);
+  char *contents = read_file_contents(path);
+  remove(path);
+
+  char header[64];
+  sprintf(header, "neutrino-heap-snapshot %i", kHeapSnapshotFormatVersion);
+  bool has_header = false;
+  bool has_roots = false;
+  bool has_mutable_roots = false;
+  bool has_tracker = false;
+  bool has_array = false;
+  bool has_end = false;
+  size_t objects_seen = 0;
+  for (char *line = strtok(contents, "\n"); line != NULL;
+       line = strtok(NULL, "\n")) {
+    // Nothing may follow the end.
+    ASSERT_FALSE(has_end);
+    if (!has_header) {
+      ASSERT_EQ(0, strcmp(header, line));
+      has_header = true;
+    } else if (line[0] == 'r') {
+      // Roots all come before the objects.
+      ASSERT_EQ(0, objects_seen);
+      char *label = NULL;
+      address_arith_t addr = parse_snapshot_address(line + 2, &label);
+      label++;
+      if (strcmp("roots", label) == 0) {
+        ASSERT_EQ(get_snapshot_address(runtime->roots), addr);
+        has_roots = true;
+      } else if (strcmp("mutable_roots", label) == 0) {
+        ASSERT_EQ(get_snapshot_address(runtime->mutable_roots), addr);
+        has_mutable_roots = true;
+      } else {
+        ASSERT_EQ(0, strcmp("tracker", label));
+        if (addr == get_snapshot_address(array))
+          has_tracker = true;
+      }
+    } else if (line[0] == 'o') {
+      objects_seen++;
+      char *rest = NULL;
+      address_arith_t addr = parse_snapshot_address(line + 2, &rest);
+      if (addr != get_snapshot_address(array))
+        continue;
+      // The array's record has its family and size followed by the species
+      // and the string.
+      const char *family = get_heap_object_family_name(ofArray);
+      ASSERT_EQ(0, strncmp(family, rest + 1, strlen(family)));
+      rest += 1 + strlen(family);
+      heap_object_layout_t layout;
+      heap_object_layout_init(&layout);
+      get_heap_object_layout(array, &layout);
+      ASSERT_EQ(layout.size, (size_t) strtoull(rest, &rest, 10));
+      ASSERT_EQ(get_snapshot_address(get_heap_object_species(array)),
+          parse_snapshot_address(rest, &rest));
+      ASSERT_EQ(get_snapshot_address(str), parse_snapshot_address(rest, &rest));
+      ASSERT_EQ('\0', *rest);
+      has_array = true;
+    } else {
+      ASSERT_EQ(0, strcmp("end", line));
+      has_end = true;
+    }
+  }
+  ASSERT_TRUE(has_header);
+  ASSERT_TRUE(has_roots);
+  ASSERT_TRUE(has_mutable_roots);
+  ASSERT_TRUE(has_tracker);
+  ASSERT_TRUE(has_array);
+  ASSERT_TRUE(has_end);
+  ASSERT_EQ(object_count, objects_seen);
+
+  free(contents);
+  safe_value_destroy(runtime, s_array);
+  DISPOSE_RUNTIME();
+}
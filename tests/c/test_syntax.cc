@@ -28,6 +28,75 @@ TEST(syntax, emitting) {
   DISPOSE_RUNTIME();
 }
 
+// Stores the offsets of the operations in the given bytecode in the given
+// array and returns how many there are. Stack height checks are skipped since
+// they're only there when expensive checks are enabled.
+static size_t get_operation_offsets(blob_t bytecode, size_t *offsets_out,
+    size_t capacity) {
+  size_t count = 0;
+  size_t offset = 0;
+  while (offset < blob_short_length(bytecode)) {
+    opcode_t opcode = (opcode_t) blob_short_at(bytecode, offset);
+    if (opcode != ocCheckStackHeight) {
+      ASSERT_REL(count, <, capacity);
+      offsets_out[count++] = offset;
+    }
+    offset += get_opcode_size(opcode);
+  }
+  return count;
+}
+
+TEST(syntax, peephole) {
+  CREATE_RUNTIME();
+
+  assembler_t assm;
+  ASSERT_SUCCESS(assembler_init(&assm, runtime, nothing(), scope_get_bottom()));
+  ASSERT_SUCCESS(assembler_emit_push(&assm, new_integer(1)));
+  ASSERT_SUCCESS(assembler_emit_push(&assm, new_integer(2)));
+  ASSERT_SUCCESS(assembler_emit_push(&assm, new_integer(3)));
+  ASSERT_SUCCESS(assembler_emit_pop(&assm, 1));
+  ASSERT_SUCCESS(assembler_emit_pop(&assm, 1));
+  ASSERT_EQ(1, assm.stack_height);
+  assembler_emit_return(&assm);
+  value_t code = assembler_flush(&assm);
+  ASSERT_SUCCESS(code);
+  // The first two pushes are fused, the third is dropped along with the pop
+  // of its value.
+  blob_t bytecode = get_blob_data(get_code_block_bytecode(code));
+  size_t offsets[8];
+  ASSERT_EQ(3, get_operation_offsets(bytecode, offsets, 8));
+  ASSERT_EQ(ocPushPair, blob_short_at(bytecode, offsets[0]));
+  ASSERT_EQ(ocPop, blob_short_at(bytecode, offsets[1]));
+  ASSERT_EQ(1, blob_short_at(bytecode, offsets[1] + 1));
+  ASSERT_EQ(ocReturn, blob_short_at(bytecode, offsets[2]));
+  value_t result = run_code_block_until_condition(ambience, code);
+  ASSERT_VALEQ(new_integer(1), result);
+  assembler_dispose(&assm);
+
+  // Two slaps are merged and a slap right before a return is dropped since
+  // returning discards what's below the result anyway.
+  ASSERT_SUCCESS(assembler_init(&assm, runtime, nothing(), scope_get_bottom()));
+  ASSERT_SUCCESS(assembler_emit_push(&assm, new_integer(4)));
+  ASSERT_SUCCESS(assembler_emit_push(&assm, new_integer(5)));
+  ASSERT_SUCCESS(assembler_emit_push(&assm, new_integer(6)));
+  ASSERT_SUCCESS(assembler_emit_slap(&assm, 1));
+  ASSERT_SUCCESS(assembler_emit_slap(&assm, 1));
+  ASSERT_EQ(1, assm.stack_height);
+  assembler_emit_return(&assm);
+  code = assembler_flush(&assm);
+  ASSERT_SUCCESS(code);
+  bytecode = get_blob_data(get_code_block_bytecode(code));
+  ASSERT_EQ(3, get_operation_offsets(bytecode, offsets, 8));
+  ASSERT_EQ(ocPushPair, blob_short_at(bytecode, offsets[0]));
+  ASSERT_EQ(ocPush, blob_short_at(bytecode, offsets[1]));
+  ASSERT_EQ(ocReturn, blob_short_at(bytecode, offsets[2]));
+  result = run_code_block_until_condition(ambience, code);
+  ASSERT_VALEQ(new_integer(6), result);
+  assembler_dispose(&assm);
+
+  DISPOSE_RUNTIME();
+}
+
 // Shorthand for running an ordering index test.
 #define CHECK_ORDERING_INDEX(N, V)                                             \
   ASSERT_EQ((N), get_parameter_order_index_for_array(variant_to_value(runtime, (V))))
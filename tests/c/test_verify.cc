@@ -0,0 +1,98 @@
+//- Copyright 2014 the Neutrino authors (see AUTHORS).
+//- Licensed under the Apache License, Version 2.0 (see LICENSE).
+
+#include "test.hh"
+
+BEGIN_C_INCLUDES
+#include "alloc.h"
+#include "codegen.h"
+#include "interp.h"
+#include "verify.h"
+END_C_INCLUDES
+
+// Verifies the given array of shorts as bytecode.
+#define VERIFY_SHORTS(SHORTS, POOL, HIGH_WATER_MARK)                           \
+  verify_bytecode(blob_new((SHORTS), sizeof(SHORTS)), (POOL), (HIGH_WATER_MARK))
+
+TEST(verify, compiled) {
+  CREATE_RUNTIME();
+
+  assembler_t assm;
+  ASSERT_SUCCESS(assembler_init(&assm, runtime, nothing(), scope_get_bottom()));
+  ASSERT_SUCCESS(assembler_emit_push(&assm, new_integer(1)));
+  ASSERT_SUCCESS(assembler_emit_push(&assm, new_integer(2)));
+  ASSERT_SUCCESS(assembler_emit_pop(&assm, 1));
+  ASSERT_SUCCESS(assembler_emit_return(&assm));
+  value_t code = assembler_flush(&assm);
+  ASSERT_SUCCESS(code);
+  ASSERT_EQ(1, get_code_block_is_verified(code));
+  assembler_dispose(&assm);
+
+  DISPOSE_RUNTIME();
+}
+
+TEST(verify, operations) {
+  CREATE_RUNTIME();
+
+  value_t pool = new_heap_array(runtime, 1);
+  short_t valid[] = {ocPush, 0, ocReturn};
+  ASSERT_SUCCESS(VERIFY_SHORTS(valid, pool, 1));
+  short_t bad_index[] = {ocPush, 1, ocReturn};
+  ASSERT_CONDITION(ccValidationFailed, VERIFY_SHORTS(bad_index, pool, 1));
+  short_t bad_opcode[] = {(short_t) kOpcodeCount};
+  ASSERT_CONDITION(ccValidationFailed, VERIFY_SHORTS(bad_opcode, pool, 1));
+  short_t truncated[] = {ocPush};
+  ASSERT_CONDITION(ccValidationFailed, VERIFY_SHORTS(truncated, pool, 1));
+
+  DISPOSE_RUNTIME();
+}
+
+TEST(verify, stack_heights) {
+  CREATE_RUNTIME();
+
+  value_t pool = new_heap_array(runtime, 1);
+  short_t checked[] = {ocPush, 0, ocCheckStackHeight, 1, ocReturn};
+  ASSERT_SUCCESS(VERIFY_SHORTS(checked, pool, 1));
+  short_t bad_check[] = {ocPush, 0, ocCheckStackHeight, 2, ocReturn};
+  ASSERT_CONDITION(ccValidationFailed, VERIFY_SHORTS(bad_check, pool, 1));
+  short_t too_high[] = {ocPush, 0, ocPush, 0, ocReturn};
+  ASSERT_CONDITION(ccValidationFailed, VERIFY_SHORTS(too_high, pool, 1));
+  short_t too_low[] = {ocPop, 1, ocReturn};
+  ASSERT_CONDITION(ccValidationFailed, VERIFY_SHORTS(too_low, pool, 1));
+  short_t falls_off[] = {ocPush, 0};
+  ASSERT_CONDITION(ccValidationFailed, VERIFY_SHORTS(falls_off, pool, 1));
+  // Code that can't be reached isn't held to any particular stack height.
+  short_t unreachable[] = {ocPush, 0, ocReturn, ocPop, 5, ocReturn};
+  ASSERT_SUCCESS(VERIFY_SHORTS(unreachable, pool, 1));
+
+  DISPOSE_RUNTIME();
+}
+
+TEST(verify, jumps) {
+  CREATE_RUNTIME();
+
+  value_t pool = new_heap_array(runtime, 1);
+  short_t valid[] = {ocPush, 0, ocGoto, 2, ocReturn};
+  ASSERT_SUCCESS(VERIFY_SHORTS(valid, pool, 1));
+  short_t into_operation[] = {ocPush, 0, ocGoto, 1, ocReturn};
+  ASSERT_CONDITION(ccValidationFailed, VERIFY_SHORTS(into_operation, pool, 1));
+  short_t past_end[] = {ocPush, 0, ocGoto, 3, ocReturn};
+  ASSERT_CONDITION(ccValidationFailed, VERIFY_SHORTS(past_end, pool, 1));
+  // The push after the goto is reached both through the goto, with the
+  // handler's result on the stack, and by skipping the goto, without it.
+  short_t inconsistent[] = {ocSignalContinue, 0, 0, 0, 0, ocGoto, 2, ocPush, 0,
+      ocReturn};
+  ASSERT_CONDITION(ccValidationFailed, VERIFY_SHORTS(inconsistent, pool, 2));
+  short_t consistent[] = {ocSignalContinue, 0, 0, 0, 0, ocGoto, 4, ocPush, 0,
+      ocReturn};
+  ASSERT_SUCCESS(VERIFY_SHORTS(consistent, pool, 2));
+  // Both the inlined code after the guard and the fallback it jumps to start
+  // out at the same height.
+  short_t guarded[] = {ocGuardInline, 0, 6, ocPush, 0, ocReturn, ocPush, 0,
+      ocReturn};
+  ASSERT_SUCCESS(VERIFY_SHORTS(guarded, pool, 1));
+  short_t bad_guard[] = {ocGuardInline, 0, 4, ocPush, 0, ocReturn};
+  ASSERT_CONDITION(ccValidationFailed, VERIFY_SHORTS(bad_guard, pool, 1));
+
+  DISPOSE_RUNTIME();
+}
@@ -0,0 +1,112 @@
+#!/usr/bin/python
+
+import imp
+import os.path
+import StringIO
+import unittest
+
+
+_HERE = os.path.dirname(os.path.abspath(__file__))
+_ROOT = os.path.join(_HERE, os.pardir, os.pardir, os.pardir)
+analyzer = imp.load_source("analyzer",
+    os.path.join(_ROOT, "src", "sh", "analyze-heap-snapshot.py"))
+
+
+# The fixture has two roots: the roots object and a tracked array. Some objects
+# are reachable more than one way, one object references itself, and one isn't
+# reachable at all.
+def read_fixture():
+  with open(os.path.join(_HERE, "heap-snapshot.txt")) as input:
+    return analyzer.read_snapshot(input)
+
+
+class AnalyzeHeapSnapshotTest(unittest.TestCase):
+
+  def setUp(self):
+    self.graph = read_fixture()
+    self.order = analyzer.get_reverse_postorder(self.graph)
+    self.dominators = analyzer.get_dominators(self.graph, self.order)
+    self.retained = analyzer.get_retained_sizes(self.graph, self.order,
+        self.dominators)
+
+  # Returns the node index of the object with the given address.
+  def node(self, address):
+    return self.graph.index[address]
+
+  def test_read(self):
+    graph = self.graph
+    self.assertEquals(9, graph.size())
+    self.assertEquals(["(root)", "Roots", "Array", "Utf8", "Array", "Utf8",
+        "Array", "Utf8", "Species"], graph.families)
+    self.assertEquals([0, 32, 24, 16, 40, 8, 16, 100, 10], graph.sizes)
+    self.assertEquals([self.node(0x10), self.node(0x40)], graph.edges[0])
+    # Duplicate edges are only counted once.
+    self.assertEquals([self.node(0x50), self.node(0x60), self.node(0x90)],
+        graph.edges[self.node(0x40)])
+
+  def test_dominators(self):
+    def get_dominator(address):
+      dominator = self.dominators[self.node(address)]
+      return None if dominator is None else self.graph.addresses[dominator]
+    self.assertEquals(None, get_dominator(0x10))
+    self.assertEquals(None, get_dominator(0x40))
+    self.assertEquals(0x10, get_dominator(0x20))
+    self.assertEquals(0x10, get_dominator(0x30))
+    self.assertEquals(None, get_dominator(0x50))
+    self.assertEquals(0x40, get_dominator(0x60))
+    self.assertEquals(None, get_dominator(0x90))
+    # The unreachable object has no dominator at all, not even the root.
+    self.assertEquals(None, self.dominators[self.node(0x70)])
+    self.assertTrue(self.node(0x70) not in self.order)
+
+  def test_retained_sizes(self):
+    def get_retained(address):
+      return self.retained[self.node(address)]
+    self.assertEquals(146, self.retained[0])
+    self.assertEquals(72, get_retained(0x10))
+    self.assertEquals(24, get_retained(0x20))
+    self.assertEquals(56, get_retained(0x40))
+    self.assertEquals(16, get_retained(0x60))
+    self.assertEquals(8, get_retained(0x50))
+    self.assertEquals(10, get_retained(0x90))
+
+  def test_family_stats(self):
+    stats = analyzer.get_family_stats(self.graph, self.order, self.dominators,
+        self.retained)
+    self.assertEquals({
+      "Roots": [1, 32, 72],
+      "Array": [3, 80, 80],
+      "Utf8": [2, 24, 24],
+      "Species": [1, 10, 10],
+    }, stats)
+
+  def test_report(self):
+    out = StringIO.StringIO()
+    analyzer.print_report(self.graph, 2, out)
+    lines = out.getvalue().split("\n")
+    self.assertEquals("Objects: 8 (246 bytes)", lines[0])
+    self.assertEquals("Reachable: 7 (146 bytes)", lines[1])
+    self.assertEquals("Unreachable: 100 bytes", lines[2])
+    # The families come out in order of retained size.
+    self.assertEquals(["Array", "Roots", "Utf8", "Species"],
+        [line.split()[0] for line in lines[6:10]])
+    # Only the two largest objects are listed.
+    self.assertEquals(["10", "Roots", "32", "72", "(root)"], lines[13].split())
+    self.assertEquals(["40", "Array", "40", "56", "(root)"], lines[14].split())
+    self.assertEquals([""], lines[15:])
+
+  def test_errors(self):
+    def read(text):
+      return analyzer.read_snapshot(StringIO.StringIO(text))
+    self.assertRaises(analyzer.SnapshotError, read,
+        "neutrino-heap-snapshot 2\nend\n")
+    self.assertRaises(analyzer.SnapshotError, read,
+        "neutrino-heap-snapshot 1\nr 0x10 roots\no 0x10 Roots 8\n")
+    self.assertRaises(analyzer.SnapshotError, read,
+        "neutrino-heap-snapshot 1\nx 0x10\nend\n")
+    self.assertEquals(1, read("neutrino-heap-snapshot 1\nend\n").size())
+
+
+if __name__ == '__main__':
+  runner = unittest.TextTestRunner(verbosity=0)
+  unittest.main(testRunner=runner)